@@ -0,0 +1,217 @@
+#include <limits>
+#include <algorithm>
+
+#include "BVH.h"
+
+namespace Modeler {
+
+    BVHBounds::BVHBounds() {
+        this->reset();
+    }
+
+    void BVHBounds::reset() {
+        for (unsigned int i = 0; i < 3; i++) {
+            this->min[i] = std::numeric_limits<Core::Real>::max();
+            this->max[i] = -std::numeric_limits<Core::Real>::max();
+        }
+    }
+
+    void BVHBounds::grow(const Core::Real* point) {
+        for (unsigned int i = 0; i < 3; i++) {
+            this->min[i] = std::min(this->min[i], point[i]);
+            this->max[i] = std::max(this->max[i], point[i]);
+        }
+    }
+
+    void BVHBounds::grow(const BVHBounds& bounds) {
+        for (unsigned int i = 0; i < 3; i++) {
+            this->min[i] = std::min(this->min[i], bounds.min[i]);
+            this->max[i] = std::max(this->max[i], bounds.max[i]);
+        }
+    }
+
+    Core::Real BVHBounds::surfaceArea() const {
+        if (this->isEmpty()) return 0.0f;
+        Core::Real x = this->max[0] - this->min[0];
+        Core::Real y = this->max[1] - this->min[1];
+        Core::Real z = this->max[2] - this->min[2];
+        return 2.0f * (x * y + y * z + z * x);
+    }
+
+    Core::Real BVHBounds::centroid(Core::UInt32 axis) const {
+        return (this->min[axis] + this->max[axis]) * 0.5f;
+    }
+
+    bool BVHBounds::isEmpty() const {
+        return this->min[0] > this->max[0];
+    }
+
+    void BVHBounds::transform(const Core::Real* m, BVHBounds& result) const {
+        // Arvo's method: project the box extents through each matrix element
+        for (unsigned int row = 0; row < 3; row++) {
+            result.min[row] = result.max[row] = m[12 + row];
+            for (unsigned int column = 0; column < 3; column++) {
+                Core::Real a = m[column * 4 + row] * this->min[column];
+                Core::Real b = m[column * 4 + row] * this->max[column];
+                result.min[row] += a < b ? a : b;
+                result.max[row] += a < b ? b : a;
+            }
+        }
+    }
+
+    Core::Int32 BVHBounds::classify(const Core::Real* planes, Core::UInt32 planeCount) const {
+        bool inside = true;
+        for (Core::UInt32 p = 0; p < planeCount; p++) {
+            const Core::Real* plane = planes + p * 4;
+            Core::Real minDistance = plane[3];
+            Core::Real maxDistance = plane[3];
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                Core::Real a = plane[axis] * this->min[axis];
+                Core::Real b = plane[axis] * this->max[axis];
+                minDistance += a < b ? a : b;
+                maxDistance += a < b ? b : a;
+            }
+            if (maxDistance < 0.0f) return -1;
+            if (minDistance < 0.0f) inside = false;
+        }
+        return inside ? 1 : 0;
+    }
+
+    BVHRay::BVHRay(const Core::Real* origin, const Core::Real* direction) {
+        for (unsigned int i = 0; i < 3; i++) {
+            this->origin[i] = origin[i];
+            this->direction[i] = direction[i];
+            this->inverseDirection[i] = direction[i] != 0.0f ? 1.0f / direction[i] : std::numeric_limits<Core::Real>::max();
+        }
+    }
+
+    Core::Real BVHRay::intersect(const BVHBounds& bounds, Core::Real maxT) const {
+        Core::Real tMin = 0.0f;
+        Core::Real tMax = maxT;
+        for (unsigned int i = 0; i < 3; i++) {
+            Core::Real t1 = (bounds.min[i] - this->origin[i]) * this->inverseDirection[i];
+            Core::Real t2 = (bounds.max[i] - this->origin[i]) * this->inverseDirection[i];
+            tMin = std::max(tMin, std::min(t1, t2));
+            tMax = std::min(tMax, std::max(t1, t2));
+        }
+        return tMax >= tMin ? tMin : -1.0f;
+    }
+
+    void BVHBuilder::build(const std::vector<BVHBounds>& primitiveBounds, Core::UInt32 maxLeafPrimitives,
+                           std::vector<BVHNode>& nodes, std::vector<Core::UInt32>& primitiveOrder) {
+        Core::UInt32 primitiveCount = (Core::UInt32)primitiveBounds.size();
+        nodes.clear();
+        primitiveOrder.resize(primitiveCount);
+        for (Core::UInt32 i = 0; i < primitiveCount; i++) primitiveOrder[i] = i;
+        if (primitiveCount == 0) return;
+
+        std::vector<Core::Real> centroids(primitiveCount * 3);
+        for (Core::UInt32 i = 0; i < primitiveCount; i++) {
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                centroids[i * 3 + axis] = primitiveBounds[i].centroid(axis);
+            }
+        }
+
+        nodes.reserve(primitiveCount * 2);
+        nodes.push_back(BVHNode());
+        nodes[0].firstPrimitive = 0;
+        nodes[0].primitiveCount = primitiveCount;
+
+        std::vector<Core::UInt32> pendingNodes;
+        pendingNodes.push_back(0);
+        while (pendingNodes.size() > 0) {
+            Core::UInt32 nodeIndex = pendingNodes.back();
+            pendingNodes.pop_back();
+
+            Core::UInt32 first = nodes[nodeIndex].firstPrimitive;
+            Core::UInt32 count = nodes[nodeIndex].primitiveCount;
+
+            BVHBounds nodeBounds;
+            BVHBounds centroidBounds;
+            for (Core::UInt32 i = first; i < first + count; i++) {
+                nodeBounds.grow(primitiveBounds[primitiveOrder[i]]);
+                centroidBounds.grow(&centroids[primitiveOrder[i] * 3]);
+            }
+            nodes[nodeIndex].bounds = nodeBounds;
+            if (count <= maxLeafPrimitives) continue;
+
+            // evaluate the SAH cost of every bin boundary on every axis
+            Core::Real bestCost = std::numeric_limits<Core::Real>::max();
+            Core::Int32 bestAxis = -1;
+            Core::UInt32 bestSplit = 0;
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                Core::Real extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+                if (extent <= 0.0f) continue;
+
+                BVHBounds binBounds[BinCount];
+                Core::UInt32 binCounts[BinCount] = {0};
+                Core::Real binScale = (Core::Real)BinCount / extent;
+                for (Core::UInt32 i = first; i < first + count; i++) {
+                    Core::UInt32 primitive = primitiveOrder[i];
+                    Core::UInt32 bin = std::min(BinCount - 1, (Core::UInt32)((centroids[primitive * 3 + axis] - centroidBounds.min[axis]) * binScale));
+                    binCounts[bin]++;
+                    binBounds[bin].grow(primitiveBounds[primitive]);
+                }
+
+                Core::Real leftAreas[BinCount - 1];
+                Core::UInt32 leftCounts[BinCount - 1];
+                BVHBounds accumulated;
+                Core::UInt32 accumulatedCount = 0;
+                for (Core::UInt32 b = 0; b < BinCount - 1; b++) {
+                    accumulated.grow(binBounds[b]);
+                    accumulatedCount += binCounts[b];
+                    leftAreas[b] = accumulated.surfaceArea();
+                    leftCounts[b] = accumulatedCount;
+                }
+
+                accumulated.reset();
+                accumulatedCount = 0;
+                for (Core::UInt32 b = BinCount - 1; b > 0; b--) {
+                    accumulated.grow(binBounds[b]);
+                    accumulatedCount += binCounts[b];
+                    Core::Real cost = leftAreas[b - 1] * leftCounts[b - 1] + accumulated.surfaceArea() * accumulatedCount;
+                    if (leftCounts[b - 1] > 0 && accumulatedCount > 0 && cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = b;
+                    }
+                }
+            }
+
+            Core::Real leafCost = nodeBounds.surfaceArea() * count;
+            if (bestAxis < 0 || (bestCost >= leafCost && count <= maxLeafPrimitives * 4)) continue;
+
+            Core::Real binScale = (Core::Real)BinCount / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+            Core::UInt32* begin = &primitiveOrder[first];
+            Core::UInt32* middle = std::partition(begin, begin + count, [&](Core::UInt32 primitive) {
+                Core::UInt32 bin = std::min(BinCount - 1, (Core::UInt32)((centroids[primitive * 3 + bestAxis] - centroidBounds.min[bestAxis]) * binScale));
+                return bin < bestSplit;
+            });
+            Core::UInt32 leftCount = (Core::UInt32)(middle - begin);
+
+            Core::UInt32 leftChild = (Core::UInt32)nodes.size();
+            nodes.push_back(BVHNode());
+            nodes.push_back(BVHNode());
+            nodes[leftChild].firstPrimitive = first;
+            nodes[leftChild].primitiveCount = leftCount;
+            nodes[leftChild + 1].firstPrimitive = first + leftCount;
+            nodes[leftChild + 1].primitiveCount = count - leftCount;
+
+            nodes[nodeIndex].firstChild = leftChild;
+            nodes[nodeIndex].primitiveCount = 0;
+
+            pendingNodes.push_back(leftChild);
+            pendingNodes.push_back(leftChild + 1);
+        }
+    }
+
+    void BVHBuilder::refitInterior(std::vector<BVHNode>& nodes) {
+        for (Core::UInt32 i = (Core::UInt32)nodes.size(); i > 0; i--) {
+            BVHNode& node = nodes[i - 1];
+            if (node.isLeaf()) continue;
+            node.bounds = nodes[node.firstChild].bounds;
+            node.bounds.grow(nodes[node.firstChild + 1].bounds);
+        }
+    }
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    class BVHBounds {
+    public:
+        BVHBounds();
+
+        void reset();
+        void grow(const Core::Real* point);
+        void grow(const BVHBounds& bounds);
+        Core::Real surfaceArea() const;
+        Core::Real centroid(Core::UInt32 axis) const;
+        bool isEmpty() const;
+        // bounds of this box after an affine column-major transform
+        void transform(const Core::Real* matrix, BVHBounds& result) const;
+        // against a convex volume of planes (a, b, c, d), inside where a x + b y + c z + d >= 0:
+        // -1 when fully outside, 1 when fully inside, 0 when straddling
+        Core::Int32 classify(const Core::Real* planes, Core::UInt32 planeCount) const;
+
+        Core::Real min[3];
+        Core::Real max[3];
+    };
+
+    class BVHRay {
+    public:
+        BVHRay(const Core::Real* origin, const Core::Real* direction);
+
+        // returns the entry distance, or a negative value if the box is missed within maxT
+        Core::Real intersect(const BVHBounds& bounds, Core::Real maxT) const;
+
+        Core::Real origin[3];
+        Core::Real direction[3];
+        Core::Real inverseDirection[3];
+    };
+
+    // Children of an interior node are stored consecutively at firstChild and
+    // firstChild + 1, always after their parent. Leaves reference primitiveCount
+    // entries of the primitive order starting at firstPrimitive.
+    class BVHNode {
+    public:
+        BVHNode(): firstChild(0), firstPrimitive(0), primitiveCount(0) {}
+
+        bool isLeaf() const { return primitiveCount > 0; }
+
+        BVHBounds bounds;
+        Core::UInt32 firstChild;
+        Core::UInt32 firstPrimitive;
+        Core::UInt32 primitiveCount;
+    };
+
+    // Stack for the BVH walks. The first InlineCapacity entries live in the caller's frame,
+    // anything deeper (a degenerate tree) spills into a vector instead of being dropped.
+    class BVHTraversalStack {
+    public:
+        static const Core::UInt32 InlineCapacity = 64;
+
+        BVHTraversalStack(): size(0) {}
+
+        void push(Core::UInt32 node) {
+            if (this->size < InlineCapacity) this->inlineEntries[this->size] = node;
+            else this->overflow.push_back(node);
+            this->size++;
+        }
+
+        Core::UInt32 pop() {
+            this->size--;
+            if (this->size < InlineCapacity) return this->inlineEntries[this->size];
+            Core::UInt32 node = this->overflow.back();
+            this->overflow.pop_back();
+            return node;
+        }
+
+        bool isEmpty() const { return this->size == 0; }
+
+    private:
+        Core::UInt32 inlineEntries[InlineCapacity];
+        std::vector<Core::UInt32> overflow;
+        Core::UInt32 size;
+    };
+
+    // Binned surface area heuristic builder shared by both BVH levels.
+    class BVHBuilder {
+    public:
+        static const Core::UInt32 BinCount = 12;
+
+        static void build(const std::vector<BVHBounds>& primitiveBounds, Core::UInt32 maxLeafPrimitives,
+                          std::vector<BVHNode>& nodes, std::vector<Core::UInt32>& primitiveOrder);
+
+        // recomputes interior node bounds from their children, leaves must already be up to date
+        static void refitInterior(std::vector<BVHNode>& nodes);
+
+    private:
+        BVHBuilder();
+    };
+
+}
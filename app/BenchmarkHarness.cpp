@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <numeric>
+
+#include <QDebug>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTextStream>
+
+#include "BenchmarkHarness.h"
+#include "ModelerApp.h"
+#include "RenderSurface.h"
+#include "RendererGL.h"
+
+namespace Modeler {
+
+    namespace {
+
+        // frames rendered after the last command, so late GPU timings and picks can land
+        const Core::UInt32 DrainFrames = 8;
+
+        QJsonObject summarize(std::vector<double> values) {
+            QJsonObject summary;
+            summary["count"] = (int)values.size();
+            if (values.size() == 0) return summary;
+
+            std::sort(values.begin(), values.end());
+            auto percentile = [&values](double p) {
+                size_t index = (size_t)(p * (values.size() - 1) + 0.5);
+                return values[index];
+            };
+            summary["mean"] = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+            summary["min"] = values.front();
+            summary["p50"] = percentile(0.50);
+            summary["p95"] = percentile(0.95);
+            summary["p99"] = percentile(0.99);
+            summary["max"] = values.back();
+            return summary;
+        }
+
+        // VmRSS / VmHWM from /proc; 0 on platforms without it
+        Core::UInt64 residentBytes(const char* field) {
+            QFile status("/proc/self/status");
+            if (!status.open(QIODevice::ReadOnly | QIODevice::Text)) return 0;
+            QTextStream stream(&status);
+            QString line;
+            while (!(line = stream.readLine()).isNull()) {
+                if (line.startsWith(field)) {
+                    QStringList parts = line.simplified().split(' ');
+                    return parts.size() >= 2 ? parts[1].toULongLong() * 1024 : 0;
+                }
+            }
+            return 0;
+        }
+
+    }
+
+    BenchmarkHarness::BenchmarkHarness(QQuickView* view, ModelerApp* modelerApp):
+        QObject(view), view(view), modelerApp(modelerApp), renderSurface(nullptr), stage(Stage::WaitingForEngine),
+        warmupFrames(30), repeatCount(1), nextModel(0), nextCommand(0), framesRemaining(0), pendingPicks(0),
+        pickHits(0), residentBytesAfterLoad(0) {
+
+        connect(this, &BenchmarkHarness::frameTimed, this, &BenchmarkHarness::onFrameTimed, Qt::QueuedConnection);
+        connect(modelerApp, &ModelerApp::importFinished, this, &BenchmarkHarness::onImportFinished, Qt::QueuedConnection);
+        connect(modelerApp, &ModelerApp::pickCompleted, this, &BenchmarkHarness::onPickCompleted, Qt::QueuedConnection);
+        this->timeoutTimer.setSingleShot(true);
+        connect(&this->timeoutTimer, &QTimer::timeout, this, &BenchmarkHarness::onTimeout);
+    }
+
+    bool BenchmarkHarness::start(const QString& scriptPath, const QString& reportPath) {
+        this->scriptPath = scriptPath;
+        this->reportPath = reportPath;
+
+        QFile scriptFile(scriptPath);
+        if (!scriptFile.open(QIODevice::ReadOnly)) {
+            qDebug() << "Unable to open benchmark script: " << scriptPath;
+            return false;
+        }
+        QJsonParseError parseError;
+        QJsonDocument document = QJsonDocument::fromJson(scriptFile.readAll(), &parseError);
+        if (!document.isObject() || !this->parseScript(document.object())) {
+            qDebug() << "Invalid benchmark script (" << scriptPath << "): " << parseError.errorString();
+            return false;
+        }
+
+        this->renderSurface = this->view->rootObject()->findChild<RenderSurface*>("render_surface");
+        if (!this->renderSurface) {
+            qDebug() << "Benchmark harness is unable to locate the render surface!";
+            return false;
+        }
+
+        if (this->scriptObject.contains("width") && this->scriptObject.contains("height")) {
+            this->view->resize(this->scriptObject["width"].toInt(), this->scriptObject["height"].toInt());
+        }
+
+        // frames must flow without input for the timings to mean anything
+        this->renderSurface->getRenderer().onUpdate([this](RendererGL* renderer) {
+            renderer->setRenderMode(RendererGL::RenderMode::Continuous);
+            renderer->setFrameTimingCallback([this](const RendererGL::FrameTiming& timing) {
+                emit this->frameTimed(timing.frameIndex, timing.cpuMilliseconds, timing.gpuMilliseconds, timing.inputLatencyMilliseconds);
+            });
+        });
+
+        this->timeoutTimer.start(TimeoutMs);
+        return true;
+    }
+
+    bool BenchmarkHarness::parseScript(const QJsonObject& script) {
+        this->scriptObject = script;
+        this->warmupFrames = (Core::UInt32)std::max(0, script["warmupFrames"].toInt(30));
+        this->repeatCount = (Core::UInt32)std::max(1, script["repeat"].toInt(1));
+
+        for (const QJsonValue& value : script["models"].toArray()) {
+            QJsonObject model = value.toObject();
+            if (!model.contains("path")) return false;
+            ModelEntry entry;
+            entry.path = model["path"].toString();
+            entry.scale = QString::number(model["scale"].toDouble(1.0));
+            entry.smoothingThreshold = QString::number(model["smoothingThreshold"].toInt(80));
+            entry.zUp = model["zUp"].toBool(false);
+            entry.generateLods = model["lods"].toBool(false);
+            entry.optimizeMeshes = model["optimize"].toBool(false);
+            entry.packVertices = model["compact"].toBool(false);
+            this->models.push_back(entry);
+        }
+
+        for (const QJsonValue& value : script["camera"].toArray()) {
+            QJsonObject command = value.toObject();
+            if (command.contains("drag")) {
+                QJsonArray drag = command["drag"].toArray();
+                if (drag.size() != 4) return false;
+                this->cameraPath.push_back(RenderCommand::drag(1, drag[0].toInt(), drag[1].toInt(), drag[2].toInt(), drag[3].toInt()));
+            }
+            else if (command.contains("scroll")) {
+                this->cameraPath.push_back(RenderCommand::scroll((Core::Real)command["scroll"].toDouble()));
+            }
+            else if (command.contains("pick")) {
+                QJsonArray pick = command["pick"].toArray();
+                if (pick.size() != 2) return false;
+                this->cameraPath.push_back(RenderCommand::pick(pick[0].toInt(), pick[1].toInt()));
+            }
+            else if (command.contains("idle")) {
+                for (int i = 0; i < command["idle"].toInt(); i++) {
+                    this->cameraPath.push_back(RenderCommand());
+                }
+            }
+            else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void BenchmarkHarness::onFrameTimed(quint64 frameIndex, double cpuMilliseconds, double gpuMilliseconds, double inputLatencyMilliseconds) {
+        Q_UNUSED(frameIndex);
+        switch (this->stage) {
+            case Stage::WaitingForEngine:
+                this->stage = Stage::Loading;
+                this->loadNextModel();
+            break;
+            case Stage::Warmup:
+                if (this->framesRemaining > 0) {
+                    this->framesRemaining--;
+                    break;
+                }
+                this->stage = Stage::Playback;
+                this->nextCommand = 0;
+                this->playNextCommand();
+            break;
+            case Stage::Playback:
+            {
+                FrameSample sample;
+                sample.cpuMilliseconds = cpuMilliseconds;
+                sample.gpuMilliseconds = gpuMilliseconds;
+                sample.inputLatencyMilliseconds = inputLatencyMilliseconds;
+                this->frames.push_back(sample);
+                this->playNextCommand();
+            }
+            break;
+            case Stage::Draining:
+                if (this->framesRemaining > 0) this->framesRemaining--;
+                if (this->framesRemaining == 0 && this->pendingPicks == 0) this->finish(0);
+            break;
+            default:
+            break;
+        }
+    }
+
+    void BenchmarkHarness::onImportFinished(const QString& path, bool success) {
+        if (this->stage != Stage::Loading) return;
+
+        QJsonObject load;
+        load["path"] = path;
+        load["success"] = success;
+        load["milliseconds"] = this->loadTimer.nsecsElapsed() / 1000000.0;
+        this->loads.push_back(load);
+        this->loadNextModel();
+    }
+
+    void BenchmarkHarness::onPickCompleted(qreal latencyMs, bool hit) {
+        if (this->pendingPicks == 0) return;
+        this->pendingPicks--;
+        this->pickLatencies.push_back(latencyMs);
+        if (hit) this->pickHits++;
+    }
+
+    void BenchmarkHarness::onTimeout() {
+        qDebug() << "Benchmark timed out, writing a partial report.";
+        this->finish(2);
+    }
+
+    void BenchmarkHarness::loadNextModel() {
+        if (this->nextModel >= this->models.size()) {
+            this->residentBytesAfterLoad = residentBytes("VmRSS:");
+            this->stage = Stage::Warmup;
+            this->framesRemaining = this->warmupFrames;
+            return;
+        }
+
+        const ModelEntry& entry = this->models[this->nextModel++];
+        this->loadTimer.start();
+        this->modelerApp->loadModel(entry.path, entry.scale, entry.smoothingThreshold, entry.zUp, entry.generateLods, entry.optimizeMeshes, entry.packVertices);
+    }
+
+    void BenchmarkHarness::playNextCommand() {
+        Core::UInt32 totalCommands = (Core::UInt32)this->cameraPath.size() * this->repeatCount;
+        if (this->nextCommand >= totalCommands) {
+            this->stage = Stage::Draining;
+            this->framesRemaining = DrainFrames;
+            return;
+        }
+
+        const RenderCommand& command = this->cameraPath[this->nextCommand % this->cameraPath.size()];
+        this->nextCommand++;
+        if (command.type == RenderCommand::Type::None) return;
+        if (this->modelerApp->postRenderCommand(command) && command.type == RenderCommand::Type::Pick) {
+            this->pendingPicks++;
+        }
+    }
+
+    void BenchmarkHarness::finish(int exitCode) {
+        if (this->stage == Stage::Done) return;
+        this->stage = Stage::Done;
+        this->timeoutTimer.stop();
+
+        QByteArray report = QJsonDocument(this->buildReport()).toJson();
+        if (this->reportPath.isEmpty()) {
+            QTextStream(stdout) << report;
+        }
+        else {
+            QFile reportFile(this->reportPath);
+            if (!reportFile.open(QIODevice::WriteOnly) || reportFile.write(report) != report.size()) {
+                qDebug() << "Unable to write benchmark report: " << this->reportPath;
+                exitCode = 1;
+            }
+        }
+        QGuiApplication::exit(exitCode);
+    }
+
+    QJsonObject BenchmarkHarness::buildReport() const {
+        QJsonObject report;
+        report["script"] = this->scriptPath;
+        report["platform"] = QGuiApplication::platformName();
+        report["completed"] = this->stage == Stage::Done && this->nextCommand >= this->cameraPath.size() * this->repeatCount;
+
+        QJsonArray loadArray;
+        for (const QJsonObject& load : this->loads) loadArray.append(load);
+        report["loads"] = loadArray;
+
+        std::vector<double> cpuTimes, gpuTimes, inputLatencies;
+        QJsonArray frameArray;
+        for (const FrameSample& frame : this->frames) {
+            cpuTimes.push_back(frame.cpuMilliseconds);
+            if (frame.gpuMilliseconds >= 0.0) gpuTimes.push_back(frame.gpuMilliseconds);
+            if (frame.inputLatencyMilliseconds >= 0.0) inputLatencies.push_back(frame.inputLatencyMilliseconds);
+            frameArray.append(QJsonArray({frame.cpuMilliseconds, frame.gpuMilliseconds}));
+        }
+        QJsonObject frames;
+        frames["cpuMilliseconds"] = summarize(cpuTimes);
+        frames["gpuMilliseconds"] = summarize(gpuTimes);
+        // camera commands are stamped when posted, so this is post-to-submit for scripted input
+        frames["inputLatencyMilliseconds"] = summarize(inputLatencies);
+        frames["samples"] = frameArray; // [cpu, gpu] per frame, gpu is -1 when unavailable
+        report["frames"] = frames;
+
+        QJsonObject picks = summarize(this->pickLatencies);
+        picks["hits"] = (int)this->pickHits;
+        report["pickLatencyMilliseconds"] = picks;
+
+        // imported meshes only, one draw per node reference without batching
+        QJsonObject drawCalls;
+        drawCalls["unbatched"] = (double)this->modelerApp->getUnbatchedDrawCount();
+        drawCalls["batched"] = (double)this->modelerApp->getBatchedDrawCount();
+        report["drawCalls"] = drawCalls;
+
+        QJsonObject memory;
+        memory["residentBytesAfterLoad"] = (double)this->residentBytesAfterLoad;
+        memory["residentBytes"] = (double)residentBytes("VmRSS:");
+        memory["peakResidentBytes"] = (double)residentBytes("VmHWM:");
+        report["memory"] = memory;
+        return report;
+    }
+
+}
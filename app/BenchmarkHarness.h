@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+
+#include <QObject>
+#include <QString>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QTimer>
+#include <QtQuick/QQuickView>
+
+#include "RenderCommand.h"
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // forward declarations
+    class ModelerApp;
+    class RenderSurface;
+
+    // Drives a ModelerApp from a JSON script and writes a JSON timing report. Intended
+    // to run headless: Modeler --benchmark script.json [--report report.json]
+    //
+    // Script format:
+    //     {
+    //         "width": 1280, "height": 720,
+    //         "models": [{"path": "...", "scale": 1.0, "smoothingThreshold": 80, "zUp": false, "lods": false, "optimize": false, "compact": false}],
+    //         "warmupFrames": 30,
+    //         "repeat": 1,
+    //         "camera": [{"drag": [startX, startY, endX, endY]}, {"scroll": 0.5}, {"pick": [x, y]}, {"idle": 10}]
+    //     }
+    // The camera path holds the same commands the GUI posts through CoreSync and is
+    // played back at one entry per frame.
+    class BenchmarkHarness: public QObject {
+
+        Q_OBJECT
+
+    public:
+        static const int TimeoutMs = 600000;
+
+        BenchmarkHarness(QQuickView* view, ModelerApp* modelerApp);
+
+        bool start(const QString& scriptPath, const QString& reportPath);
+
+    signals:
+        void frameTimed(quint64 frameIndex, double cpuMilliseconds, double gpuMilliseconds, double inputLatencyMilliseconds);
+
+    private slots:
+        void onFrameTimed(quint64 frameIndex, double cpuMilliseconds, double gpuMilliseconds, double inputLatencyMilliseconds);
+        void onImportFinished(const QString& path, bool success);
+        void onPickCompleted(qreal latencyMs, bool hit);
+        void onTimeout();
+
+    private:
+
+        enum class Stage {
+            WaitingForEngine = 0,
+            Loading = 1,
+            Warmup = 2,
+            Playback = 3,
+            Draining = 4,
+            Done = 5,
+        };
+
+        class ModelEntry {
+        public:
+            QString path;
+            QString scale;
+            QString smoothingThreshold;
+            bool zUp;
+            bool generateLods;
+            bool optimizeMeshes;
+            bool packVertices;
+        };
+
+        class FrameSample {
+        public:
+            double cpuMilliseconds;
+            double gpuMilliseconds;
+            double inputLatencyMilliseconds;
+        };
+
+        bool parseScript(const QJsonObject& script);
+        void loadNextModel();
+        void playNextCommand();
+        void finish(int exitCode);
+        QJsonObject buildReport() const;
+
+        QQuickView* view;
+        ModelerApp* modelerApp;
+        RenderSurface* renderSurface;
+        QString scriptPath;
+        QString reportPath;
+        QTimer timeoutTimer;
+
+        Stage stage;
+        std::vector<ModelEntry> models;
+        std::vector<RenderCommand> cameraPath;
+        Core::UInt32 warmupFrames;
+        Core::UInt32 repeatCount;
+        Core::UInt32 nextModel;
+        Core::UInt32 nextCommand;
+        Core::UInt32 framesRemaining;
+        Core::UInt32 pendingPicks;
+        QElapsedTimer loadTimer;
+
+        QJsonObject scriptObject;
+        std::vector<QJsonObject> loads;
+        std::vector<FrameSample> frames;
+        std::vector<double> pickLatencies;
+        Core::UInt32 pickHits;
+        Core::UInt64 residentBytesAfterLoad;
+    };
+
+}
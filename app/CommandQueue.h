@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Bounded lock-free multi-producer queue (Vyukov's sequenced ring), drained by a
+    // single consumer. T must be cheap to copy. Producers never block; push() fails when the
+    // ring is full.
+    template <typename T, unsigned int Capacity>
+    class CommandQueue final {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "CommandQueue capacity must be a power of two.");
+
+    public:
+        CommandQueue(): enqueuePosition(0), dequeuePosition(0) {
+            for (unsigned int i = 0; i < Capacity; i++) {
+                this->cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        bool push(const T& command) {
+            Cell* cell;
+            size_t position = this->enqueuePosition.load(std::memory_order_relaxed);
+            while (true) {
+                cell = &this->cells[position & (Capacity - 1)];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+                if (difference == 0) {
+                    if (this->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                }
+                else if (difference < 0) {
+                    return false;
+                }
+                else {
+                    position = this->enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+            cell->command = command;
+            cell->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T& command) {
+            size_t position = this->dequeuePosition.load(std::memory_order_relaxed);
+            Cell* cell = &this->cells[position & (Capacity - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            if ((intptr_t)sequence - (intptr_t)(position + 1) < 0) return false;
+
+            command = cell->command;
+            cell->sequence.store(position + Capacity, std::memory_order_release);
+            this->dequeuePosition.store(position + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // Drains at most Capacity commands, so a producer that keeps pushing cannot stall
+        // the consumer.
+        template <typename Handler>
+        Core::UInt32 drain(Handler handler) {
+            Core::UInt32 handled = 0;
+            T command;
+            while (handled < Capacity && this->pop(command)) {
+                handler(command);
+                handled++;
+            }
+            return handled;
+        }
+
+    private:
+        class Cell {
+        public:
+            std::atomic<size_t> sequence;
+            T command;
+        };
+
+        Cell cells[Capacity];
+        alignas(64) std::atomic<size_t> enqueuePosition;
+        alignas(64) std::atomic<size_t> dequeuePosition;
+    };
+
+}
@@ -10,10 +10,24 @@ namespace Modeler {
 
     }
 
-    void CoreSync::run(Runnable runnable) {
-        RendererGL::LifeCycleEventCallback temp = [this, runnable](RendererGL* renderer) {
-            runnable(this->renderSurface->getRenderer().getEngine());
-        };
-        renderSurface->getRenderer().onUpdate(temp);
+    bool CoreSync::post(const RenderCommand& command) {
+        bool queued = this->commands.push(command);
+        this->renderSurface->getRenderer().requestFrame();
+        return queued;
+    }
+
+    void CoreSync::requestFrame() {
+        this->renderSurface->getRenderer().requestFrame();
+    }
+
+    void CoreSync::setCommandHandler(CommandHandler handler) {
+        this->commandHandler = handler;
+    }
+
+    void CoreSync::processCommands() {
+        if (!this->commandHandler) return;
+        this->commands.drain([this](const RenderCommand& command) {
+            this->commandHandler(command);
+        });
     }
 }
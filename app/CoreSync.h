@@ -5,6 +5,9 @@
 
 #include <QMutex>
 
+#include "CommandQueue.h"
+#include "RenderCommand.h"
+
 #include "Core/Engine.h"
 
 namespace Modeler {
@@ -14,15 +17,26 @@ namespace Modeler {
 
     class CoreSync final {
     public:
-        typedef std::function<void(Core::WeakPointer<Core::Engine>)> Runnable;
+        typedef std::function<void(const RenderCommand&)> CommandHandler;
+
+        static const unsigned int CommandQueueCapacity = 1024;
 
         CoreSync(RenderSurface* renderSurface);
         ~CoreSync();
-        void run(Runnable runnable);
+
+        // lock-free, callable from any thread; returns false if the queue is full
+        bool post(const RenderCommand& command);
+        // thread-safe, for state the render thread picks up on its own (e.g. latched input)
+        void requestFrame();
+        void setCommandHandler(CommandHandler handler);
+        // render thread only
+        void processCommands();
 
     private:
         RenderSurface* renderSurface;
         QMutex sync;
+        CommandQueue<RenderCommand, CommandQueueCapacity> commands;
+        CommandHandler commandHandler;
     };
 
 }
@@ -1,7 +0,0 @@
-#include "EventQueue.h"
-
-namespace modeler {
-    EventQueue::EventQueue() {
-
-    }
-}
@@ -1,33 +1,131 @@
 #pragma once
 
 #include <type_traits>
-#include <unordered_map>
 #include <functional>
 #include <vector>
+#include <algorithm>
 
 #include "Event.h"
 #include "Types.h"
 
+#include "Core/common/types.h"
+
 namespace Modeler {
 
     template <typename T, typename Enable = void>
     class EventQueue;
 
+    // A typed event channel. Events are either delivered right away (dispatch) or queued and
+    // delivered together on the next flush (post), which lets high-frequency events such as
+    // mouse moves be merged into one per frame. Delivery doesn't allocate or copy the
+    // subscriber list: subscribing and the queue's first growth are the only allocations, and
+    // the queue keeps its capacity between flushes.
+    //
+    // Callbacks may subscribe, unsubscribe, dispatch and post while an event is being
+    // delivered; subscriptions made during delivery only see later events. Not thread-safe.
     template <typename T>
     class EventQueue<T, enable_if_t<std::is_base_of<Event, T>::value>> {
 
     public:
 
-        typedef std::function<void(T)> EventCallback;
+        typedef std::function<void(const T&)> EventCallback;
+        typedef Core::UInt32 SubscriptionID;
+
+        static const SubscriptionID InvalidSubscription = 0;
 
-        EventQueue() {}
+        EventQueue(): nextSubscription(1), deliveryDepth(0), nextPending(0), flushing(false), lastCoalescable(false) {}
 
-        void on(EventCallback callback) {
-            queue.push_back(callback);
+        SubscriptionID on(EventCallback callback) {
+            SubscriptionID id = this->nextSubscription++;
+            if (this->deliveryDepth > 0) this->addedSubscribers.push_back(Subscriber(id, callback));
+            else this->subscribers.push_back(Subscriber(id, callback));
+            return id;
+        }
+
+        bool off(SubscriptionID id) {
+            for (auto subscriber = this->addedSubscribers.begin(); subscriber != this->addedSubscribers.end(); ++subscriber) {
+                if (subscriber->id != id) continue;
+                this->addedSubscribers.erase(subscriber);
+                return true;
+            }
+            for (auto subscriber = this->subscribers.begin(); subscriber != this->subscribers.end(); ++subscriber) {
+                if (subscriber->id != id) continue;
+                // the callback may be the one running, so it's only dropped once delivery is done
+                if (this->deliveryDepth > 0) subscriber->id = InvalidSubscription;
+                else this->subscribers.erase(subscriber);
+                return true;
+            }
+            return false;
+        }
+
+        // delivers anything queued first, so subscribers see events in the order they happened
+        void dispatch(const T& event) {
+            this->flush();
+            this->deliver(event);
+        }
+
+        // queues the event until the next flush; a coalescable event replaces the newest queued
+        // one if that was coalescable too
+        void post(const T& event, bool coalesce = false) {
+            if (coalesce && this->lastCoalescable && this->pending.size() > this->nextPending) this->pending.back() = event;
+            else this->pending.push_back(event);
+            this->lastCoalescable = coalesce;
+        }
+
+        bool hasPending() const {
+            return this->pending.size() > 0;
+        }
+
+        void flush() {
+            if (this->flushing || this->pending.size() == 0) return;
+            this->flushing = true;
+            // callbacks may post more, which go out in this flush as well
+            while (this->nextPending < this->pending.size()) {
+                T event = this->pending[this->nextPending++];
+                this->deliver(event);
+            }
+            this->pending.clear();
+            this->nextPending = 0;
+            this->lastCoalescable = false;
+            this->flushing = false;
         }
 
     private:
-        std::vector<EventCallback> queue;
+        class Subscriber {
+        public:
+            Subscriber(SubscriptionID id, EventCallback callback): id(id), callback(callback) {}
+
+            SubscriptionID id;
+            EventCallback callback;
+        };
+
+        void deliver(const T& event) {
+            this->deliveryDepth++;
+            Core::UInt32 count = (Core::UInt32)this->subscribers.size();
+            for (Core::UInt32 i = 0; i < count; i++) {
+                if (this->subscribers[i].id != InvalidSubscription) this->subscribers[i].callback(event);
+            }
+            this->deliveryDepth--;
+            if (this->deliveryDepth > 0) return;
+
+            auto removed = std::remove_if(this->subscribers.begin(), this->subscribers.end(), [](const Subscriber& subscriber) {
+                return subscriber.id == InvalidSubscription;
+            });
+            this->subscribers.erase(removed, this->subscribers.end());
+            if (this->addedSubscribers.size() > 0) {
+                this->subscribers.insert(this->subscribers.end(), this->addedSubscribers.begin(), this->addedSubscribers.end());
+                this->addedSubscribers.clear();
+            }
+        }
+
+        SubscriptionID nextSubscription;
+        Core::UInt32 deliveryDepth;
+        Core::UInt32 nextPending;
+        bool flushing;
+        bool lastCoalescable;
+        std::vector<Subscriber> subscribers;
+        std::vector<Subscriber> addedSubscribers;
+        std::vector<T> pending;
 
     };
 
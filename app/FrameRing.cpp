@@ -0,0 +1,127 @@
+#include <utility>
+
+#include <QtGui/QOpenGLContext>
+#include <QDebug>
+
+#include "FrameRing.h"
+
+namespace Modeler {
+
+    namespace {
+
+        // fences are the only GL calls made here, for whichever context is current
+        QOpenGLFunctions_3_3_Core* currentFunctions() {
+            QOpenGLContext* context = QOpenGLContext::currentContext();
+            QOpenGLFunctions_3_3_Core* functions = context ? context->versionFunctions<QOpenGLFunctions_3_3_Core>() : nullptr;
+            if (!functions || !functions->initializeOpenGLFunctions()) {
+                qDebug() << "FrameRing -> OpenGL 3.3 is required to share frames between contexts.";
+                return nullptr;
+            }
+            return functions;
+        }
+
+        void waitAndDelete(QOpenGLFunctions_3_3_Core* gl, GLsync& fence) {
+            if (!fence) return;
+            // a server side wait: the GPU holds back this context's later commands, the CPU moves on
+            gl->glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+            gl->glDeleteSync(fence);
+            fence = 0;
+        }
+
+    }
+
+    FrameRing::FrameRing(): drawing(0), ready(1), displayed(2), readyIsNew(false), nextGeneration(1) {
+
+    }
+
+    FrameRing::~FrameRing() {
+
+    }
+
+    QOpenGLFramebufferObject* FrameRing::beginFrame(const QSize& size) {
+        QOpenGLFunctions_3_3_Core* gl = currentFunctions();
+        if (!gl) return nullptr;
+
+        Buffer& buffer = this->buffers[this->drawing];
+        GLsync releaseFence;
+        {
+            QMutexLocker ml(&this->mutex);
+            releaseFence = buffer.releaseFence;
+            buffer.releaseFence = 0;
+        }
+        waitAndDelete(gl, releaseFence);
+        // the frame it held was replaced before it could be shown
+        if (buffer.readyFence) {
+            gl->glDeleteSync(buffer.readyFence);
+            buffer.readyFence = 0;
+        }
+
+        if (!buffer.framebuffer || buffer.framebuffer->size() != size) {
+            delete buffer.framebuffer;
+            // only color is copied out of the engine's target, so no depth attachment
+            buffer.framebuffer = new QOpenGLFramebufferObject(size, QOpenGLFramebufferObject::NoAttachment, GL_TEXTURE_2D, GL_RGBA8);
+            buffer.generation = this->nextGeneration++;
+        }
+        return buffer.framebuffer;
+    }
+
+    void FrameRing::publishFrame() {
+        QOpenGLFunctions_3_3_Core* gl = currentFunctions();
+        if (!gl) return;
+
+        GLsync readyFence = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // the scene graph's context can only wait on a fence that has been submitted
+        gl->glFlush();
+
+        QMutexLocker ml(&this->mutex);
+        this->buffers[this->drawing].readyFence = readyFence;
+        std::swap(this->drawing, this->ready);
+        this->readyIsNew = true;
+    }
+
+    void FrameRing::destroy() {
+        QOpenGLFunctions_3_3_Core* gl = currentFunctions();
+        QMutexLocker ml(&this->mutex);
+        for (Core::UInt32 i = 0; i < BufferCount; i++) {
+            Buffer& buffer = this->buffers[i];
+            if (gl && buffer.readyFence) gl->glDeleteSync(buffer.readyFence);
+            if (gl && buffer.releaseFence) gl->glDeleteSync(buffer.releaseFence);
+            delete buffer.framebuffer;
+            buffer = Buffer();
+        }
+        this->readyIsNew = false;
+    }
+
+    bool FrameRing::acquireFrame(Frame& frame) {
+        QOpenGLFunctions_3_3_Core* gl = currentFunctions();
+        if (!gl) return false;
+
+        GLsync readyFence = 0;
+        {
+            QMutexLocker ml(&this->mutex);
+            if (this->readyIsNew) {
+                // everything the scene graph drew from the old buffer has been issued by now
+                Buffer& released = this->buffers[this->displayed];
+                if (released.framebuffer) {
+                    released.releaseFence = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                    gl->glFlush();
+                }
+                std::swap(this->displayed, this->ready);
+                this->readyIsNew = false;
+                readyFence = this->buffers[this->displayed].readyFence;
+                this->buffers[this->displayed].readyFence = 0;
+            }
+        }
+        waitAndDelete(gl, readyFence);
+
+        // only the scene graph changes the displayed buffer, so it can be read without the lock
+        const Buffer& buffer = this->buffers[this->displayed];
+        if (!buffer.framebuffer) return false;
+        frame.buffer = this->displayed;
+        frame.texture = buffer.framebuffer->texture();
+        frame.size = buffer.framebuffer->size();
+        frame.generation = buffer.generation;
+        return true;
+    }
+
+}
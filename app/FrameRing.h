@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QMutex>
+#include <QSize>
+#include <QtGui/QOpenGLFramebufferObject>
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Hands finished engine frames from the render thread to the Qt Quick scene graph.
+    //
+    // Three color buffers rotate between the two threads: the one the render thread draws
+    // into, the newest finished one and the one on screen. Neither thread ever waits for the
+    // other; a frame finished before the previous one was shown simply replaces it. The
+    // buffers belong to the render thread's context, which shares its textures with the
+    // scene graph's, and fences order the GPU work of the two contexts.
+    class FrameRing final {
+    public:
+        static const Core::UInt32 BufferCount = 3;
+
+        class Frame {
+        public:
+            Frame(): buffer(0), texture(0), generation(0) {}
+
+            Core::UInt32 buffer;
+            GLuint texture;
+            QSize size;
+            Core::UInt64 generation; // changes whenever the buffer's texture is recreated
+        };
+
+        FrameRing();
+        ~FrameRing();
+
+        // render thread, its context current: the buffer to draw the next frame into
+        QOpenGLFramebufferObject* beginFrame(const QSize& size);
+        void publishFrame();
+        void destroy();
+
+        // scene graph thread, its context current: moves to the newest finished frame if there
+        // is one. Returns false until the first frame has been published.
+        bool acquireFrame(Frame& frame);
+
+    private:
+        class Buffer {
+        public:
+            Buffer(): framebuffer(nullptr), readyFence(0), releaseFence(0), generation(0) {}
+
+            QOpenGLFramebufferObject* framebuffer;
+            GLsync readyFence;   // the render thread is done drawing it
+            GLsync releaseFence; // the scene graph is done sampling it
+            Core::UInt64 generation;
+        };
+
+        QMutex mutex;
+        Buffer buffers[BufferCount];
+        Core::UInt32 drawing;
+        Core::UInt32 ready;
+        Core::UInt32 displayed;
+        bool readyIsNew;
+        Core::UInt64 nextGeneration;
+    };
+
+}
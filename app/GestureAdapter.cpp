@@ -1,30 +1,29 @@
 #include <functional>
 
-#include "Core/util/WeakPointer.h"
-
 #include "GestureAdapter.h"
 #include "Util.h"
 
 namespace Modeler {
-    GestureAdapter::GestureAdapter() {
-        mouseEventAdapter = std::make_shared<PipedEventAdapter<MouseAdapter::MouseEvent>>(std::bind(&GestureAdapter::onMouseEvent, this, std::placeholders::_1));
+    GestureAdapter::GestureAdapter(): mouseAdapter(nullptr), mouseSubscription(EventQueue<MouseAdapter::MouseEvent>::InvalidSubscription) {
+
+    }
+
+    GestureAdapter::~GestureAdapter() {
+        if (this->mouseAdapter) this->mouseAdapter->getEvents().off(this->mouseSubscription);
     }
 
     void GestureAdapter::setMouseAdapter(MouseAdapter& mouseAdapter) {
-        mouseAdapter.setPipedEventAdapter(this->mouseEventAdapter);
+        if (this->mouseAdapter == &mouseAdapter) return;
+        if (this->mouseAdapter) this->mouseAdapter->getEvents().off(this->mouseSubscription);
+        this->mouseAdapter = &mouseAdapter;
+        this->mouseSubscription = mouseAdapter.getEvents().on(std::bind(&GestureAdapter::onMouseEvent, this, std::placeholders::_1));
     }
 
-    bool GestureAdapter::setPipedEventAdapter(Core::WeakPointer<PipedEventAdapter<GestureEvent>> adapter) {
-        if(!this->pipedEventAdapter) {
-            this->pipedEventAdapter = adapter;
-            return true;
-        }
-        else {
-            return false;
-        }
+    EventQueue<GestureAdapter::GestureEvent>& GestureAdapter::getEvents() {
+        return this->events;
     }
 
-    void GestureAdapter::onMouseEvent(MouseAdapter::MouseEvent event) {
+    void GestureAdapter::onMouseEvent(const MouseAdapter::MouseEvent& event) {
 
         unsigned int pointerIndex = event.buttons;
         if (pointerIndex >= MAX_POINTERS) return;
@@ -46,18 +45,19 @@ namespace Modeler {
                     gestureEvent.start = pointerState.position;
                     gestureEvent.end = event.position;
                     gestureEvent.pointer = (GesturePointer)pointerIndex;
-                    if (this->pipedEventAdapter) {
-                        this->pipedEventAdapter->accept(gestureEvent);
-                    }
+                    gestureEvent.inputTimeNs = event.inputTimeNs;
+                    this->events.dispatch(gestureEvent);
                     pointerState.position = event.position;
                 }
             break;
             case MouseAdapter::MouseEventType::WheelScroll:
                 GestureEvent gestureEvent(GestureEventType::Scroll);
                 gestureEvent.scrollDistance = event.scrollDelta;
-                if (this->pipedEventAdapter) {
-                    this->pipedEventAdapter->accept(gestureEvent);
-                }
+                // where the wheel was turned, so the scroll can go to the view under the pointer
+                gestureEvent.start = event.position;
+                gestureEvent.end = event.position;
+                gestureEvent.inputTimeNs = event.inputTimeNs;
+                this->events.dispatch(gestureEvent);
             break;
         }
     }
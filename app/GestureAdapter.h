@@ -1,9 +1,8 @@
 #pragma once
 
-#include <memory>
-
 #include "MouseAdapter.h"
-#include "PipedEventAdapter.h"
+#include "Event.h"
+#include "EventQueue.h"
 
 namespace Modeler {
     class GestureAdapter {
@@ -21,22 +20,25 @@ namespace Modeler {
             PrimaryDouble = 3,
         };
 
-        class GestureEvent {
+        class GestureEvent: public Event {
         public:
-            GestureEvent(GestureEventType type): type(type) {}
-            GestureEventType getType() {return  type;}
+            GestureEvent(GestureEventType type): scrollDistance(0.0f), inputTimeNs(0), type(type) {}
+            GestureEventType getType() const {return  type;}
             GesturePointer pointer;
             Core::Vector2i start;
             Core::Vector2i end;
             Core::Real scrollDistance;
+            Core::UInt64 inputTimeNs; // copied from the mouse event, see MouseAdapter::MouseEvent
         private:
             GestureEventType type;
         };
 
         GestureAdapter();
+        ~GestureAdapter();
 
+        // subscribes to the adapter's events; calling it again with the same adapter does nothing
         void setMouseAdapter(MouseAdapter& mouseAdapter);
-        bool setPipedEventAdapter(Core::WeakPointer<PipedEventAdapter<GestureEvent>> adapter);
+        EventQueue<GestureEvent>& getEvents();
 
     private:
         static const unsigned int MAX_POINTERS = 5;
@@ -48,11 +50,12 @@ namespace Modeler {
             Core::Vector2i position;
         };
 
-        void onMouseEvent(MouseAdapter::MouseEvent event);
+        void onMouseEvent(const MouseAdapter::MouseEvent& event);
 
-        std::shared_ptr<PipedEventAdapter<MouseAdapter::MouseEvent>> mouseEventAdapter;
+        MouseAdapter* mouseAdapter;
+        EventQueue<MouseAdapter::MouseEvent>::SubscriptionID mouseSubscription;
         PointerState pointerStates[MAX_POINTERS];
 
-        Core::WeakPointer<PipedEventAdapter<GestureEvent>> pipedEventAdapter;
+        EventQueue<GestureEvent> events;
     };
 }
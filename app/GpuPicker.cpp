@@ -0,0 +1,270 @@
+#include <algorithm>
+
+#include <QDebug>
+#include <QtGui/QOpenGLContext>
+
+#include "GpuPicker.h"
+#include "Profiler.h"
+
+#include "Core/render/Camera.h"
+#include "Core/render/RenderTarget.h"
+#include "Core/image/TextureAttr.h"
+#include "Core/material/BasicColoredMaterial.h"
+#include "Core/material/Shader.h"
+
+static const char idMaterial_vertex[] =
+    "#version 100\n"
+    "attribute vec4 pos;\n"
+    "uniform mat4 projection;\n"
+    "uniform mat4 viewMatrix;\n"
+    "uniform mat4 modelMatrix;\n"
+    "void main() {\n"
+    "    gl_Position = projection * viewMatrix * modelMatrix * pos;\n"
+    "}\n";
+
+static const char idMaterial_fragment[] =
+    "#version 100\n"
+    "precision mediump float;\n"
+    "uniform vec4 objectID;\n"
+    "void main() {\n"
+    "    gl_FragColor = objectID;\n"
+    "}\n";
+
+namespace Modeler {
+
+    // Flat, unlit output of one ID, split into bytes across red, green and blue.
+    class IdMaterial: public Core::BasicColoredMaterial {
+    public:
+        IdMaterial(Core::WeakPointer<Core::Graphics> graphics): BasicColoredMaterial(graphics), objectIDLocation(-1) {
+            this->setObjectID(0);
+        }
+
+        Core::Bool build() override {
+            const std::string& vertexSrc = idMaterial_vertex;
+            const std::string& fragmentSrc = idMaterial_fragment;
+            Core::Bool ready = this->buildFromSource(vertexSrc, fragmentSrc);
+            if (!ready) {
+               return false;
+            }
+            this->bindShaderVarLocations();
+            this->objectIDLocation = this->shader->getUniformLocation("objectID");
+            return true;
+        }
+
+        void sendCustomUniformsToShader() override {
+            this->shader->setUniform4f(this->objectIDLocation, this->objectID[0], this->objectID[1], this->objectID[2], 1.0f);
+        }
+
+        void setObjectID(Core::UInt32 id) {
+            for (unsigned int channel = 0; channel < 3; channel++) {
+                this->objectID[channel] = (Core::Real)((id >> (channel * 8)) & 0xFF) / 255.0f;
+            }
+        }
+
+    private:
+        Core::Real objectID[3];
+        Core::Int32 objectIDLocation;
+    };
+
+    GpuPicker::GpuPicker(Core::WeakPointer<Core::Engine> engine): engine(engine), gl(nullptr), targetWidth(0), targetHeight(0) {
+
+    }
+
+    GpuPicker::~GpuPicker() {
+        // without the context the buffers go away with it anyway
+        if (!this->gl || !QOpenGLContext::currentContext()) return;
+        for (Readback& readback : this->readbacks) {
+            this->gl->glDeleteSync(readback.fence);
+            this->freePixelBuffers.push_back(readback.pixelBuffer);
+        }
+        if (this->freePixelBuffers.size() > 0) {
+            this->gl->glDeleteBuffers((GLsizei)this->freePixelBuffers.size(), this->freePixelBuffers.data());
+        }
+    }
+
+    void GpuPicker::setProxyResolver(ProxyResolver resolver) {
+        this->proxyResolver = resolver;
+    }
+
+    bool GpuPicker::addObject(Core::UInt32 id, Core::WeakPointer<Core::Object3D> object) {
+        if (id == 0 || id > MaxObjectID) {
+            qDebug() << "GpuPicker::addObject() -> ID" << id << "doesn't fit in the ID buffer.";
+            return false;
+        }
+        this->objects.push_back(RegisteredObject(id, object));
+        return true;
+    }
+
+    bool GpuPicker::requestPick(Core::Int32 x, Core::Int32 y, PickCallback callback) {
+        if (this->requests.size() + this->readbacks.size() >= MaxPendingPicks) return false;
+        this->requests.push_back(Request(x, y, callback));
+        return true;
+    }
+
+    bool GpuPicker::hasPendingPicks() const {
+        return this->requests.size() > 0 || this->readbacks.size() > 0;
+    }
+
+    void GpuPicker::render(Core::WeakPointer<Core::Camera> camera) {
+        if (!this->hasPendingPicks()) return;
+        if (!this->gl && !this->initialize()) {
+            for (const Request& request : this->requests) request.callback(0);
+            this->requests.clear();
+            return;
+        }
+
+        this->resolveReadbacks();
+        if (this->requests.size() == 0) return;
+
+        ProfileScope scope("GpuPicker::drawIdPass");
+        this->drawIdPass(camera);
+    }
+
+    bool GpuPicker::initialize() {
+        QOpenGLContext* context = QOpenGLContext::currentContext();
+        QOpenGLFunctions_3_3_Core* functions = context ? context->versionFunctions<QOpenGLFunctions_3_3_Core>() : nullptr;
+        if (!functions || !functions->initializeOpenGLFunctions()) {
+            qDebug() << "GpuPicker::initialize() -> OpenGL 3.3 is required for ID buffer picking.";
+            return false;
+        }
+        this->gl = functions;
+        this->material = this->engine->createMaterial<IdMaterial>();
+        this->material->setLit(false);
+        this->material->setBlendingMode(Core::RenderState::BlendingMode::None);
+        return true;
+    }
+
+    // readbacks finish in the order they were started, so the first unfinished one ends the scan
+    void GpuPicker::resolveReadbacks() {
+        Core::UInt32 resolved = 0;
+        for (; resolved < this->readbacks.size(); resolved++) {
+            Readback& readback = this->readbacks[resolved];
+            GLenum status = this->gl->glClientWaitSync(readback.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+            this->gl->glDeleteSync(readback.fence);
+
+            Core::UInt32 id = 0;
+            GLsizeiptr size = readback.regionWidth * readback.regionHeight * 4;
+            this->gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+            const unsigned char* pixels = (const unsigned char*)this->gl->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+            if (pixels) {
+                id = this->decodeRegion(readback, pixels);
+                this->gl->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            this->gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            this->freePixelBuffers.push_back(readback.pixelBuffer);
+            readback.callback(id);
+        }
+        this->readbacks.erase(this->readbacks.begin(), this->readbacks.begin() + resolved);
+    }
+
+    void GpuPicker::drawIdPass(Core::WeakPointer<Core::Camera> camera) {
+        Core::WeakPointer<Core::Graphics> graphics = this->engine->getGraphicsSystem();
+        Core::WeakPointer<Core::RenderTarget> previousTarget = graphics->getCurrentRenderTarget();
+        // the ID buffer matches the camera's own view, which isn't the current target when
+        // several views are drawn in one frame
+        Core::Vector4u viewport = camera->getRenderTarget()->getViewport();
+        if (!this->target) {
+            Core::TextureAttributes colorAttributes;
+            colorAttributes.Format = Core::TextureFormat::RGBA8;
+            colorAttributes.FilterMode = Core::TextureFilter::Point;
+            colorAttributes.MipLevels = 0;
+            this->target = graphics->createRenderTarget2D(true, true, false, colorAttributes, Core::Vector2u(viewport.z, viewport.w));
+        } else if (viewport.z != this->targetWidth || viewport.w != this->targetHeight) {
+            this->target->setSize(viewport.z, viewport.w);
+        }
+        this->targetWidth = viewport.z;
+        this->targetHeight = viewport.w;
+
+        // the ID pass clears for itself, the camera's own clear would use the scene's color
+        Core::WeakPointer<Core::RenderTarget> cameraTarget = camera->getRenderTarget();
+        camera->setRenderTarget(this->target);
+        camera->setAutoClearRenderBuffer(Core::RenderBufferType::Color, false);
+        camera->setAutoClearRenderBuffer(Core::RenderBufferType::Depth, false);
+        graphics->activateRenderTarget(this->target);
+        this->gl->glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        this->gl->glDepthMask(GL_TRUE);
+        this->gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        auto renderer = graphics->getRenderer();
+        for (auto object = this->objects.rbegin(); object != this->objects.rend(); ++object) {
+            if (!object->object) continue;
+            this->material->setObjectID(object->id);
+            Core::WeakPointer<Core::Object3D> drawn[] = {object->object, this->proxyResolver ? this->proxyResolver(object->object) : Core::WeakPointer<Core::Object3D>()};
+            for (Core::WeakPointer<Core::Object3D> drawObject : drawn) {
+                if (drawObject) renderer->renderObjectBasic(drawObject, camera, this->material);
+            }
+        }
+
+        graphics->activateRenderTarget(this->target);
+        for (const Request& request : this->requests) this->startReadback(request);
+        this->requests.clear();
+
+        camera->setRenderTarget(cameraTarget);
+        camera->setAutoClearRenderBuffer(Core::RenderBufferType::Color, true);
+        camera->setAutoClearRenderBuffer(Core::RenderBufferType::Depth, true);
+        graphics->activateRenderTarget(previousTarget);
+    }
+
+    // the copy into the pixel buffer is queued behind the ID pass and returns right away
+    void GpuPicker::startReadback(const Request& request) {
+        Readback readback;
+        readback.callback = request.callback;
+        readback.cursorX = request.x;
+        readback.cursorY = (Core::Int32)this->targetHeight - 1 - request.y;
+        if (readback.cursorX < 0 || readback.cursorY < 0 ||
+            readback.cursorX >= (Core::Int32)this->targetWidth || readback.cursorY >= (Core::Int32)this->targetHeight) {
+            request.callback(0);
+            return;
+        }
+
+        Core::Int32 minX = std::max(readback.cursorX - ReadbackRadius, 0);
+        Core::Int32 minY = std::max(readback.cursorY - ReadbackRadius, 0);
+        Core::Int32 maxX = std::min(readback.cursorX + ReadbackRadius, (Core::Int32)this->targetWidth - 1);
+        Core::Int32 maxY = std::min(readback.cursorY + ReadbackRadius, (Core::Int32)this->targetHeight - 1);
+        readback.regionX = minX;
+        readback.regionY = minY;
+        readback.regionWidth = maxX - minX + 1;
+        readback.regionHeight = maxY - minY + 1;
+
+        const GLsizeiptr bufferSize = (ReadbackRadius * 2 + 1) * (ReadbackRadius * 2 + 1) * 4;
+        if (this->freePixelBuffers.size() == 0) {
+            GLuint pixelBuffer = 0;
+            this->gl->glGenBuffers(1, &pixelBuffer);
+            this->gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer);
+            this->gl->glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, nullptr, GL_STREAM_READ);
+            this->freePixelBuffers.push_back(pixelBuffer);
+        }
+        readback.pixelBuffer = this->freePixelBuffers.back();
+        this->freePixelBuffers.pop_back();
+
+        this->gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+        this->gl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        this->gl->glReadBuffer(GL_COLOR_ATTACHMENT0);
+        this->gl->glReadPixels(readback.regionX, readback.regionY, readback.regionWidth, readback.regionHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        this->gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readback.fence = this->gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        this->readbacks.push_back(readback);
+    }
+
+    Core::UInt32 GpuPicker::decodeRegion(const Readback& readback, const unsigned char* pixels) const {
+        Core::UInt32 closestID = 0;
+        Core::Int32 closestDistance = 0;
+        for (Core::Int32 y = 0; y < readback.regionHeight; y++) {
+            for (Core::Int32 x = 0; x < readback.regionWidth; x++) {
+                const unsigned char* pixel = pixels + (y * readback.regionWidth + x) * 4;
+                Core::UInt32 id = (Core::UInt32)pixel[0] | ((Core::UInt32)pixel[1] << 8) | ((Core::UInt32)pixel[2] << 16);
+                if (id == 0) continue;
+                Core::Int32 dx = readback.regionX + x - readback.cursorX;
+                Core::Int32 dy = readback.regionY + y - readback.cursorY;
+                Core::Int32 distance = dx * dx + dy * dy;
+                if (closestID == 0 || distance < closestDistance) {
+                    closestID = id;
+                    closestDistance = distance;
+                }
+            }
+        }
+        return closestID;
+    }
+
+}
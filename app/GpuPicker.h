@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+
+#include "Core/Engine.h"
+#include "Core/render/RenderTarget2D.h"
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    class IdMaterial;
+
+    // Picking through an object ID buffer instead of CPU ray casts, so picked meshes don't need
+    // a CPU copy of their triangles. A pick request draws every registered object into an
+    // offscreen target with its ID as the color, copies a small block around the cursor into a
+    // pixel buffer object and resolves it a frame or more later, once the GPU is done with it,
+    // so the render thread never stalls on the read back.
+    //
+    // IDs are packed into the RGB channels of a plain RGBA8 target: the Core shaders are GLSL
+    // 100, which can't write integer targets, and with blending off and no multisampling the
+    // 8-bit channels hold them exactly. ID 0 is the cleared background.
+    //
+    // Everything here runs on the render thread.
+    class GpuPicker {
+    public:
+        static const Core::UInt32 MaxObjectID = 0xFFFFFF;
+        // pixels read back on each side of the cursor; the ID closest to it wins, so clicks just
+        // beside thin geometry still land
+        static const Core::Int32 ReadbackRadius = 2;
+        static const Core::UInt32 MaxPendingPicks = 4;
+
+        // id is 0 when nothing was under the cursor
+        typedef std::function<void(Core::UInt32 id)> PickCallback;
+        // returns an extra object to draw along with a registered one, for geometry that isn't
+        // rendered by the object itself, or an invalid pointer
+        typedef std::function<Core::WeakPointer<Core::Object3D>(Core::WeakPointer<Core::Object3D>)> ProxyResolver;
+
+        GpuPicker(Core::WeakPointer<Core::Engine> engine);
+        ~GpuPicker();
+
+        void setProxyResolver(ProxyResolver resolver);
+        // objects are drawn newest first, so a child registered after its parent keeps its own
+        // ID where the parent's draw covers it too
+        bool addObject(Core::UInt32 id, Core::WeakPointer<Core::Object3D> object);
+
+        // x and y are in viewport coordinates, origin top left. Returns false when too many
+        // picks are in flight.
+        bool requestPick(Core::Int32 x, Core::Int32 y, PickCallback callback);
+        bool hasPendingPicks() const;
+
+        // call from an onRender callback after the scene is drawn: delivers finished read backs,
+        // then draws the ID pass for new requests and starts their read backs
+        void render(Core::WeakPointer<Core::Camera> camera);
+
+    private:
+        class RegisteredObject {
+        public:
+            RegisteredObject(Core::UInt32 id, Core::WeakPointer<Core::Object3D> object): id(id), object(object) {}
+
+            Core::UInt32 id;
+            Core::WeakPointer<Core::Object3D> object;
+        };
+
+        class Readback {
+        public:
+            Readback(): pixelBuffer(0), fence(0), regionX(0), regionY(0), regionWidth(0), regionHeight(0), cursorX(0), cursorY(0) {}
+
+            GLuint pixelBuffer;
+            GLsync fence;
+            // the block that was read, in target coordinates (origin bottom left)
+            Core::Int32 regionX;
+            Core::Int32 regionY;
+            Core::Int32 regionWidth;
+            Core::Int32 regionHeight;
+            Core::Int32 cursorX;
+            Core::Int32 cursorY;
+            PickCallback callback;
+        };
+
+        class Request {
+        public:
+            Request(Core::Int32 x, Core::Int32 y, PickCallback callback): x(x), y(y), callback(callback) {}
+
+            Core::Int32 x;
+            Core::Int32 y;
+            PickCallback callback;
+        };
+
+        bool initialize();
+        void resolveReadbacks();
+        void drawIdPass(Core::WeakPointer<Core::Camera> camera);
+        void startReadback(const Request& request);
+        Core::UInt32 decodeRegion(const Readback& readback, const unsigned char* pixels) const;
+
+        Core::WeakPointer<Core::Engine> engine;
+        QOpenGLFunctions_3_3_Core* gl;
+        Core::WeakPointer<IdMaterial> material;
+        Core::WeakPointer<Core::RenderTarget2D> target;
+        Core::UInt32 targetWidth;
+        Core::UInt32 targetHeight;
+        ProxyResolver proxyResolver;
+        std::vector<RegisteredObject> objects;
+        std::vector<Request> requests;
+        std::vector<Readback> readbacks;
+        std::vector<GLuint> freePixelBuffers;
+    };
+
+}
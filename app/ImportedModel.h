@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "MeshBVH.h"
+
+#include "Core/common/types.h"
+#include "Core/color/Color.h"
+
+namespace Modeler {
+
+    class PackedMesh;
+
+    // CPU-side, GPU-ready geometry produced by the import pipeline. Vertex attributes
+    // use the same layout the engine's attribute arrays expect so they can be stored
+    // directly on the render thread. Material diffuse colors are baked into the
+    // vertex colors. Once the worker stages are done the attributes may be replaced
+    // by their packed form (see VertexPacking), leaving the float arrays empty.
+    class ImportedMesh {
+    public:
+        ImportedMesh(): vertexCount(0), materialIndex(0) {}
+
+        Core::UInt32 vertexCount;
+        Core::UInt32 materialIndex;
+        std::vector<Core::Real> positions;   // x, y, z, w
+        std::vector<Core::Real> normals;     // x, y, z, 0
+        std::vector<Core::Real> faceNormals; // x, y, z, 0
+        std::vector<Core::Real> colors;      // r, g, b, a
+        std::vector<Core::UInt32> indices;
+        std::shared_ptr<PackedMesh> packed;
+    };
+
+    class ImportedMaterial {
+    public:
+        ImportedMaterial(): diffuseColor(1.0f, 1.0f, 1.0f, 1.0f) {}
+
+        Core::Color diffuseColor;
+        std::string diffuseTexture; // as named by the source file, empty if the material has none
+    };
+
+    // Nodes are stored flattened in depth-first pre-order, so a node's parent
+    // always appears before it.
+    class ImportedNode {
+    public:
+        ImportedNode(): parentIndex(-1) {}
+
+        std::string name;
+        Core::Int32 parentIndex;
+        Core::Real localMatrix[16]; // column-major
+        std::vector<Core::UInt32> meshIndices;
+        std::vector<Core::UInt32> batchedMeshIndices; // drawn through ImportedModel::batches
+    };
+
+    class ImportedModel {
+    public:
+        ImportedModel(): totalVertexCount(0), drawnByModelLoader(false) {}
+
+        std::string sourcePath;
+        std::vector<ImportedMesh> meshes;
+        std::vector<ImportedMaterial> materials;
+        std::vector<ImportedNode> nodes;
+        std::vector<ImportedMesh> batches; // pre-transformed into the root node's space
+        std::vector<BVHBounds> batchBounds; // parallel to batches
+        std::vector<std::shared_ptr<MeshBVH>> meshBVHs; // parallel to meshes, used for picking
+        Core::UInt64 totalVertexCount;
+        // textured models are drawn by Core's ModelLoader (see ModelImporter). Such a model only
+        // keeps its root node, and its meshes hold no geometry, just picking BVHs in the root's space.
+        bool drawnByModelLoader;
+    };
+
+}
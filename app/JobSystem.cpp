@@ -0,0 +1,101 @@
+#include <algorithm>
+
+#include "JobSystem.h"
+
+namespace Modeler {
+
+    JobSystem::JobSystem(unsigned int workerCount): shuttingDown(false) {
+        if (workerCount == 0) {
+            unsigned int hardwareThreads = std::thread::hardware_concurrency();
+            // leave one core for the GUI thread and one for the render thread
+            workerCount = hardwareThreads > 2 ? hardwareThreads - 2 : 1;
+        }
+        for (unsigned int i = 0; i < workerCount; i++) {
+            this->workers.push_back(std::thread(&JobSystem::workerLoop, this));
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            QMutexLocker ml(&this->jobMutex);
+            this->shuttingDown = true;
+        }
+        this->jobAvailable.wakeAll();
+        for (std::thread& worker : this->workers) {
+            worker.join();
+        }
+    }
+
+    void JobSystem::submit(Job job) {
+        {
+            QMutexLocker ml(&this->jobMutex);
+            this->jobs.push_back(std::move(job));
+        }
+        this->jobAvailable.wakeOne();
+    }
+
+    void JobSystem::parallelFor(unsigned int count, const std::function<void(unsigned int)>& task) {
+        if (count == 0) return;
+
+        // helpers may only get to run after the caller has finished everything, so the
+        // shared state has to outlive this call
+        class ParallelForState {
+        public:
+            ParallelForState(unsigned int count, const std::function<void(unsigned int)>& task): task(task), count(count), next(0), completed(0) {}
+
+            void run() {
+                unsigned int finished = 0;
+                for (unsigned int i = this->next++; i < this->count; i = this->next++) {
+                    this->task(i);
+                    finished++;
+                }
+                if (finished > 0 && (this->completed += finished) == this->count) {
+                    QMutexLocker ml(&this->mutex);
+                    this->done.wakeAll();
+                }
+            }
+
+            std::function<void(unsigned int)> task;
+            unsigned int count;
+            std::atomic<unsigned int> next;
+            std::atomic<unsigned int> completed;
+            QMutex mutex;
+            QWaitCondition done;
+        };
+
+        std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>(count, task);
+        unsigned int helperCount = std::min(count - 1, this->getWorkerCount());
+        for (unsigned int i = 0; i < helperCount; i++) {
+            this->submit([state]() {
+                state->run();
+            });
+        }
+        state->run();
+
+        QMutexLocker ml(&state->mutex);
+        while (state->completed < count) {
+            state->done.wait(&state->mutex);
+        }
+    }
+
+    unsigned int JobSystem::getWorkerCount() const {
+        return (unsigned int)this->workers.size();
+    }
+
+    void JobSystem::workerLoop() {
+        while (true) {
+            Job job;
+            {
+                QMutexLocker ml(&this->jobMutex);
+                while (this->jobs.empty() && !this->shuttingDown) {
+                    this->jobAvailable.wait(&this->jobMutex);
+                }
+                if (this->jobs.empty()) return;
+                job = std::move(this->jobs.front());
+                this->jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+}
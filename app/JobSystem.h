@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+#include <QMutex>
+#include <QWaitCondition>
+
+namespace Modeler {
+
+    class JobSystem final {
+    public:
+        typedef std::function<void()> Job;
+
+        JobSystem(unsigned int workerCount = 0);
+        ~JobSystem();
+
+        void submit(Job job);
+        // runs task(i) for every i in [0, count) on the workers and the calling thread, and returns
+        // once all of them are done. Indices are handed out one at a time, so uneven tasks balance
+        // themselves. Safe to call from a worker.
+        void parallelFor(unsigned int count, const std::function<void(unsigned int)>& task);
+        unsigned int getWorkerCount() const;
+
+    private:
+        void workerLoop();
+
+        bool shuttingDown;
+        std::vector<std::thread> workers;
+        std::deque<Job> jobs;
+        QMutex jobMutex;
+        QWaitCondition jobAvailable;
+    };
+
+}
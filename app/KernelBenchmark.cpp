@@ -0,0 +1,162 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "KernelBenchmark.h"
+#include "SimdKernels.h"
+
+namespace Modeler {
+
+    namespace {
+
+        typedef std::chrono::steady_clock Clock;
+
+        const Core::UInt32 MatrixCount = 4096;
+        const Core::UInt32 PointCount = 1 << 20;
+        const Core::UInt32 PacketCount = 1 << 14;
+        const Core::UInt32 RayCount = 64;
+
+        double elapsedMilliseconds(Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        class KernelResult {
+        public:
+            KernelResult(): time(0.0), maxError(0.0), hitCount(0) {}
+
+            double time;
+            double maxError;
+            Core::UInt64 hitCount;
+        };
+
+        class Inputs {
+        public:
+            std::vector<Core::Real> matrices;
+            std::vector<Core::Real> points;
+            std::vector<SimdKernels::TrianglePacket> packets;
+            std::vector<BVHRay> rays;
+        };
+
+        Core::Real maxDifference(const std::vector<Core::Real>& a, const std::vector<Core::Real>& b) {
+            Core::Real difference = 0.0f;
+            for (size_t i = 0; i < a.size(); i++) difference = std::max(difference, std::fabs(a[i] - b[i]));
+            return difference;
+        }
+
+        void runKernels(const Inputs& inputs, Core::UInt32 iterations, bool runPackets, KernelResult* results,
+                        std::vector<Core::Real>& matrixOutput, std::vector<Core::Real>& pointOutput) {
+            Clock::time_point start = Clock::now();
+            for (Core::UInt32 i = 0; i < iterations * 16; i++) {
+                for (Core::UInt32 m = 0; m + 1 < MatrixCount; m++) {
+                    SimdKernels::multiplyMatrices(&inputs.matrices[m * 16], &inputs.matrices[(m + 1) * 16], &matrixOutput[m * 16]);
+                }
+            }
+            results[0].time = elapsedMilliseconds(start);
+
+            start = Clock::now();
+            for (Core::UInt32 i = 0; i < iterations; i++) {
+                SimdKernels::transformPoints(&inputs.matrices[0], inputs.points.data(), PointCount, pointOutput.data());
+            }
+            results[1].time = elapsedMilliseconds(start);
+            if (!runPackets) return;
+
+            start = Clock::now();
+            for (Core::UInt32 i = 0; i < iterations; i++) {
+                results[2].hitCount = 0;
+                for (const BVHRay& ray : inputs.rays) {
+                    for (const SimdKernels::TrianglePacket& packet : inputs.packets) {
+                        Core::Real t, u, v;
+                        if (SimdKernels::intersectPacket(packet, ray, 100.0f, t, u, v) >= 0) results[2].hitCount++;
+                    }
+                }
+            }
+            results[2].time = elapsedMilliseconds(start);
+        }
+
+    }
+
+    void KernelBenchmark::run(Core::UInt32 iterations) {
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<Core::Real> unit(-1.0f, 1.0f);
+
+        Inputs inputs;
+        inputs.matrices.resize(MatrixCount * 16);
+        for (Core::UInt32 m = 0; m < MatrixCount; m++) {
+            Core::Real* matrix = &inputs.matrices[m * 16];
+            for (unsigned int i = 0; i < 16; i++) matrix[i] = unit(random);
+            matrix[3] = matrix[7] = matrix[11] = 0.0f;
+            matrix[15] = 1.0f;
+        }
+        inputs.points.resize(PointCount * 4);
+        for (Core::UInt32 p = 0; p < PointCount; p++) {
+            for (unsigned int i = 0; i < 3; i++) inputs.points[p * 4 + i] = unit(random) * 10.0f;
+            inputs.points[p * 4 + 3] = 1.0f;
+        }
+        // small triangles scattered through a cube, rays from outside it through the middle
+        inputs.packets.resize(PacketCount);
+        for (SimdKernels::TrianglePacket& packet : inputs.packets) {
+            for (Core::UInt32 lane = 0; lane < SimdKernels::PacketWidth; lane++) {
+                Core::Real corners[3][3];
+                for (unsigned int i = 0; i < 3; i++) corners[0][i] = unit(random);
+                for (unsigned int c = 1; c < 3; c++) {
+                    for (unsigned int i = 0; i < 3; i++) corners[c][i] = corners[0][i] + unit(random) * 0.5f;
+                }
+                packet.setTriangle(lane, corners[0], corners[1], corners[2]);
+            }
+        }
+        for (Core::UInt32 r = 0; r < RayCount; r++) {
+            Core::Real origin[3] = {unit(random) * 0.2f, unit(random) * 0.2f, -5.0f};
+            Core::Real direction[3] = {unit(random) * 0.1f, unit(random) * 0.1f, 1.0f};
+            inputs.rays.push_back(BVHRay(origin, direction));
+        }
+
+        const char* kernelNames[3] = {"4x4 multiply", "transform points", "ray vs packet"};
+        Core::UInt64 kernelWork[3] = {(Core::UInt64)iterations * 16 * (MatrixCount - 1), (Core::UInt64)iterations * PointCount,
+                                      (Core::UInt64)iterations * RayCount * PacketCount * SimdKernels::PacketWidth};
+        const char* workUnits[3] = {"multiplies", "points", "ray-triangle tests"};
+
+        SimdKernels::InstructionSet previous = SimdKernels::getInstructionSet();
+        SimdKernels::InstructionSet supported = SimdKernels::getSupportedInstructionSet();
+        std::vector<Core::Real> scalarMatrices(MatrixCount * 16), scalarPoints(PointCount * 4);
+        std::vector<Core::Real> matrixOutput(MatrixCount * 16), pointOutput(PointCount * 4);
+        KernelResult scalarResults[3];
+
+        std::cout << "Kernel benchmark (" << SimdKernels::getName(supported) << " supported)" << std::endl;
+        for (int set = (int)SimdKernels::InstructionSet::Scalar; set <= (int)supported; set++) {
+            SimdKernels::setInstructionSet((SimdKernels::InstructionSet)set);
+            KernelResult results[3];
+            bool scalar = set == (int)SimdKernels::InstructionSet::Scalar;
+            // a set that reuses a lower set's packet kernel would only time that kernel again
+            SimdKernels::InstructionSet packetSet = SimdKernels::getPacketInstructionSet((SimdKernels::InstructionSet)set);
+            bool ownPackets = packetSet == (SimdKernels::InstructionSet)set;
+            runKernels(inputs, iterations, ownPackets, results, scalar ? scalarMatrices : matrixOutput, scalar ? scalarPoints : pointOutput);
+            if (scalar) {
+                for (unsigned int k = 0; k < 3; k++) scalarResults[k] = results[k];
+            } else {
+                results[0].maxError = maxDifference(matrixOutput, scalarMatrices);
+                results[1].maxError = maxDifference(pointOutput, scalarPoints);
+            }
+
+            std::cout << "  " << SimdKernels::getName((SimdKernels::InstructionSet)set) << std::endl;
+            for (unsigned int k = 0; k < 3; k++) {
+                if (k == 2 && !ownPackets) {
+                    std::cout << "    " << kernelNames[k] << ": uses the " << SimdKernels::getName(packetSet) << " kernel" << std::endl;
+                    continue;
+                }
+                std::cout << "    " << kernelNames[k] << ": " << results[k].time << " ms, "
+                          << kernelWork[k] / (results[k].time * 1000.0) << " M " << workUnits[k] << "/s";
+                if (!scalar) {
+                    std::cout << ", " << scalarResults[k].time / results[k].time << "x scalar";
+                    if (k < 2) std::cout << ", max difference " << results[k].maxError;
+                    else std::cout << ", hits " << results[k].hitCount << " (scalar " << scalarResults[k].hitCount << ")";
+                }
+                std::cout << std::endl;
+            }
+        }
+        SimdKernels::setInstructionSet(previous);
+    }
+
+}
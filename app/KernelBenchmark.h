@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Times every SimdKernels kernel under each instruction set the CPU supports and reports
+    // the speedup over the scalar versions, along with how far their results drift from scalar.
+    // Run with: Modeler --benchmark-kernels
+    class KernelBenchmark {
+    public:
+        static void run(Core::UInt32 iterations = 20);
+
+    private:
+        KernelBenchmark();
+    };
+
+}
@@ -1,3 +1,5 @@
+#include <string>
+
 #include <QGuiApplication>
 #include <QtQuick/QQuickView>
 #include <QQmlApplicationEngine>
@@ -6,10 +8,78 @@
 
 #include "RenderSurface.h"
 #include "ModelerApp.h"
-#include "TreeModel.h"
+#include "PickingBenchmark.h"
+#include "KernelBenchmark.h"
+#include "BenchmarkHarness.h"
+#include "ProfilerOverlay.h"
 
 int main(int argc, char **argv) {
 
+    QString benchmarkScript;
+    QString benchmarkReport;
+    Core::UInt64 streamBudgetMB = 0;
+    QStringList importPaths;
+    // the same options as the load controls, applied to every --import path
+    QString importScale("1");
+    QString importSmoothing("80");
+    bool importZUp = true;
+    bool importLods = false;
+    bool importOptimize = false;
+    bool importPacked = false;
+    bool importStream = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--benchmark-picking") {
+            Modeler::PickingBenchmark::run();
+            return 0;
+        }
+        else if (arg == "--benchmark-kernels") {
+            Modeler::KernelBenchmark::run();
+            return 0;
+        }
+        else if (arg == "--benchmark" && i + 1 < argc) {
+            benchmarkScript = QString::fromLocal8Bit(argv[++i]);
+        }
+        else if (arg == "--report" && i + 1 < argc) {
+            benchmarkReport = QString::fromLocal8Bit(argv[++i]);
+        }
+        else if (arg == "--import" && i + 1 < argc) {
+            importPaths.append(QString::fromLocal8Bit(argv[++i]));
+        }
+        else if (arg == "--import-scale" && i + 1 < argc) {
+            importScale = QString::fromLocal8Bit(argv[++i]);
+        }
+        else if (arg == "--import-smoothing" && i + 1 < argc) {
+            importSmoothing = QString::fromLocal8Bit(argv[++i]);
+        }
+        else if (arg == "--import-y-up") {
+            importZUp = false;
+        }
+        else if (arg == "--import-lods") {
+            importLods = true;
+        }
+        else if (arg == "--import-optimize") {
+            importOptimize = true;
+        }
+        else if (arg == "--import-compact") {
+            importPacked = true;
+        }
+        else if (arg == "--import-stream") {
+            importStream = true;
+        }
+        else if (arg == "--stream-budget-mb" && i + 1 < argc) {
+            streamBudgetMB = QString::fromLocal8Bit(argv[++i]).toULongLong();
+        }
+        else if (arg == "--software-gl") {
+            QCoreApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
+        }
+    }
+
+    // benchmarks run headless unless a platform is forced through the environment
+    if (!benchmarkScript.isEmpty() && !qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     QGuiApplication app(argc, argv);
 
     // Specify an OpenGL 3.3 format using the Core profile.
@@ -20,25 +90,38 @@ int main(int argc, char **argv) {
     glFormat.setSampleBuffers( true );*/
 
 
-    qmlRegisterType<TreeModel>("TreeModel", 1, 0, "TreeModel" );
     qmlRegisterType<Modeler::RenderSurface>("RenderSurface", 1, 0, "RenderSurface");
 
-    TreeModel model;
-    //model.addItem("Test item", "nothing");
-   // engine.rootContext()->setContextProperty("theModel", &model);
+    Modeler::ProfilerOverlay profilerOverlay;
 
     QQuickView view;
     view.setResizeMode(QQuickView::SizeRootObjectToView);
+    view.rootContext()->setContextProperty("_profiler", QVariant::fromValue(&profilerOverlay));
     view.setSource(QUrl("qrc:///qml/main.qml"));
     view.show();
 
     Modeler::ModelerApp modelerApp;
+    if (streamBudgetMB > 0) modelerApp.setStreamingMemoryBudget(streamBudgetMB * 1024ull * 1024ull);
     modelerApp.initialize(&view);
     modelerApp.addLoadedWindow("render_surface", Modeler::ModelerApp::AppWindowType::RenderSurface);
 
-    view.rootContext()->setContextProperty("theModel", QVariant::fromValue(&model));
+    view.rootContext()->setContextProperty("_outliner", QVariant::fromValue(modelerApp.getOutliner()));
     view.rootContext()->setContextProperty("_modelerApp",  QVariant::fromValue(&modelerApp));
 
+    // files and folders given with --import are loaded as one batch as soon as the engine is up
+    if (!importPaths.isEmpty()) {
+        QObject::connect(&modelerApp, &Modeler::ModelerApp::engineStarted, &modelerApp,
+                         [&modelerApp, importPaths, importScale, importSmoothing, importZUp, importLods, importOptimize, importPacked, importStream]() {
+            modelerApp.loadModels(importPaths, importScale, importSmoothing, importZUp, importLods, importOptimize, importPacked, importStream);
+        }, Qt::QueuedConnection);
+    }
+
+    if (!benchmarkScript.isEmpty()) {
+        // owned by the view, so it outlives the render thread's last frame
+        Modeler::BenchmarkHarness* harness = new Modeler::BenchmarkHarness(&view, &modelerApp);
+        if (!harness->start(benchmarkScript, benchmarkReport)) return 1;
+    }
+
     return app.exec();
 
  }
@@ -0,0 +1,194 @@
+#include <utility>
+
+#include "MeshBVH.h"
+
+namespace Modeler {
+
+    namespace {
+
+        // clips the triangle against every plane in turn (Sutherland-Hodgman) and reports
+        // whether anything is left
+        bool triangleInVolume(const Core::Real* v0, const Core::Real* v1, const Core::Real* v2,
+                              const Core::Real* planes, Core::UInt32 planeCount) {
+            const Core::Real* corners[3] = {v0, v1, v2};
+            bool allInside = true;
+            for (Core::UInt32 p = 0; p < planeCount; p++) {
+                const Core::Real* plane = planes + p * 4;
+                unsigned int insideCount = 0;
+                for (unsigned int c = 0; c < 3; c++) {
+                    const Core::Real* corner = corners[c];
+                    if (plane[0] * corner[0] + plane[1] * corner[1] + plane[2] * corner[2] + plane[3] >= 0.0f) insideCount++;
+                }
+                if (insideCount == 0) return false;
+                if (insideCount < 3) allInside = false;
+            }
+            if (allInside) return true;
+
+            const Core::UInt32 MaxClipVertices = 3 + MeshBVH::MaxVolumePlanes;
+            Core::Real buffers[2][MaxClipVertices * 3];
+            Core::Real* polygon = buffers[0];
+            Core::Real* clipped = buffers[1];
+            Core::UInt32 vertexCount = 3;
+            for (unsigned int c = 0; c < 3; c++) {
+                for (unsigned int axis = 0; axis < 3; axis++) polygon[c * 3 + axis] = corners[c][axis];
+            }
+            for (Core::UInt32 p = 0; p < planeCount; p++) {
+                const Core::Real* plane = planes + p * 4;
+                Core::UInt32 clippedCount = 0;
+                for (Core::UInt32 i = 0; i < vertexCount; i++) {
+                    const Core::Real* current = polygon + i * 3;
+                    const Core::Real* next = polygon + ((i + 1) % vertexCount) * 3;
+                    Core::Real currentDistance = plane[0] * current[0] + plane[1] * current[1] + plane[2] * current[2] + plane[3];
+                    Core::Real nextDistance = plane[0] * next[0] + plane[1] * next[1] + plane[2] * next[2] + plane[3];
+                    if (currentDistance >= 0.0f) {
+                        for (unsigned int axis = 0; axis < 3; axis++) clipped[clippedCount * 3 + axis] = current[axis];
+                        clippedCount++;
+                    }
+                    if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+                        Core::Real f = currentDistance / (currentDistance - nextDistance);
+                        for (unsigned int axis = 0; axis < 3; axis++) {
+                            clipped[clippedCount * 3 + axis] = current[axis] + (next[axis] - current[axis]) * f;
+                        }
+                        clippedCount++;
+                    }
+                }
+                if (clippedCount == 0) return false;
+                std::swap(polygon, clipped);
+                vertexCount = clippedCount;
+            }
+            return true;
+        }
+
+    }
+
+    MeshBVH::MeshBVH(const Core::Real* positions, Core::UInt32 positionStride, Core::UInt32 vertexCount,
+                     const Core::UInt32* indices, Core::UInt32 indexCount) {
+        Core::UInt32 triangleCount = indices ? indexCount / 3 : vertexCount / 3;
+        this->triangleCount = triangleCount;
+
+        std::vector<BVHBounds> triangleBounds(triangleCount);
+        for (Core::UInt32 t = 0; t < triangleCount; t++) {
+            for (unsigned int c = 0; c < 3; c++) {
+                Core::UInt32 vertex = indices ? indices[t * 3 + c] : t * 3 + c;
+                triangleBounds[t].grow(positions + vertex * positionStride);
+            }
+        }
+
+        std::vector<Core::UInt32> triangleOrder;
+        BVHBuilder::build(triangleBounds, MaxLeafTriangles, this->nodes, triangleOrder);
+
+        // store each leaf's triangles as packets, so a leaf touches one contiguous block and is
+        // tested a packet at a time
+        for (BVHNode& node : this->nodes) {
+            if (!node.isLeaf()) continue;
+            Core::UInt32 firstPacket = (Core::UInt32)this->packets.size();
+            for (Core::UInt32 i = 0; i < node.primitiveCount; i++) {
+                Core::UInt32 lane = i % SimdKernels::PacketWidth;
+                if (lane == 0) {
+                    this->packets.push_back(SimdKernels::TrianglePacket());
+                    this->triangleIDs.resize(this->triangleIDs.size() + SimdKernels::PacketWidth, 0);
+                }
+
+                Core::UInt32 source = triangleOrder[node.firstPrimitive + i];
+                const Core::Real* corners[3];
+                for (unsigned int c = 0; c < 3; c++) {
+                    Core::UInt32 vertex = indices ? indices[source * 3 + c] : source * 3 + c;
+                    corners[c] = positions + vertex * positionStride;
+                }
+                this->packets.back().setTriangle(lane, corners[0], corners[1], corners[2]);
+                this->triangleIDs[this->triangleIDs.size() - SimdKernels::PacketWidth + lane] = source;
+            }
+            node.firstPrimitive = firstPacket;
+        }
+
+        if (this->nodes.size() > 0) {
+            this->bounds = this->nodes[0].bounds;
+        }
+    }
+
+    MeshBVH::MeshBVH(const Core::Real* positions, Core::UInt32 positionStride, Core::UInt32 vertexCount, Core::UInt32 triangleCount) {
+        this->triangleCount = triangleCount;
+        for (Core::UInt32 v = 0; v < vertexCount; v++) {
+            this->bounds.grow(positions + v * positionStride);
+        }
+    }
+
+    bool MeshBVH::intersect(const BVHRay& ray, Hit& hit) const {
+        if (this->nodes.size() == 0) return false;
+        if (ray.intersect(this->nodes[0].bounds, hit.t) < 0.0f) return false;
+
+        bool found = false;
+        BVHTraversalStack stack;
+        stack.push(0);
+        while (!stack.isEmpty()) {
+            const BVHNode& node = this->nodes[stack.pop()];
+            if (node.isLeaf()) {
+                Core::UInt32 packetCount = (node.primitiveCount + SimdKernels::PacketWidth - 1) / SimdKernels::PacketWidth;
+                for (Core::UInt32 p = node.firstPrimitive; p < node.firstPrimitive + packetCount; p++) {
+                    Core::Int32 lane = SimdKernels::intersectPacket(this->packets[p], ray, hit.t, hit.t, hit.u, hit.v);
+                    if (lane >= 0) {
+                        hit.triangle = this->triangleIDs[p * SimdKernels::PacketWidth + lane];
+                        found = true;
+                    }
+                }
+                continue;
+            }
+
+            // visit the nearer child first so farther subtrees are culled by the shrinking hit.t
+            Core::UInt32 nearChild = node.firstChild;
+            Core::UInt32 farChild = node.firstChild + 1;
+            Core::Real nearT = ray.intersect(this->nodes[nearChild].bounds, hit.t);
+            Core::Real farT = ray.intersect(this->nodes[farChild].bounds, hit.t);
+            if (farT >= 0.0f && (nearT < 0.0f || farT < nearT)) {
+                std::swap(nearChild, farChild);
+                std::swap(nearT, farT);
+            }
+            if (farT >= 0.0f) stack.push(farChild);
+            if (nearT >= 0.0f) stack.push(nearChild);
+        }
+        return found;
+    }
+
+    bool MeshBVH::intersectsVolume(const Core::Real* planes, Core::UInt32 planeCount) const {
+        if (planeCount > MaxVolumePlanes) return false;
+        if (this->nodes.size() == 0) return !this->bounds.isEmpty() && this->bounds.classify(planes, planeCount) >= 0;
+
+        BVHTraversalStack stack;
+        stack.push(0);
+        while (!stack.isEmpty()) {
+            const BVHNode& node = this->nodes[stack.pop()];
+            Core::Int32 classification = node.bounds.classify(planes, planeCount);
+            if (classification < 0) continue;
+            if (classification > 0) return true;
+
+            if (!node.isLeaf()) {
+                stack.push(node.firstChild);
+                stack.push(node.firstChild + 1);
+                continue;
+            }
+
+            // the last packet of a leaf may have padding lanes, which are not real triangles
+            for (Core::UInt32 i = 0; i < node.primitiveCount; i++) {
+                const SimdKernels::TrianglePacket& packet = this->packets[node.firstPrimitive + i / SimdKernels::PacketWidth];
+                Core::UInt32 lane = i % SimdKernels::PacketWidth;
+                Core::Real corners[3][3];
+                for (unsigned int axis = 0; axis < 3; axis++) {
+                    corners[0][axis] = packet.v0[axis][lane];
+                    corners[1][axis] = packet.v0[axis][lane] + packet.edge1[axis][lane];
+                    corners[2][axis] = packet.v0[axis][lane] + packet.edge2[axis][lane];
+                }
+                if (triangleInVolume(corners[0], corners[1], corners[2], planes, planeCount)) return true;
+            }
+        }
+        return false;
+    }
+
+    const BVHBounds& MeshBVH::getBounds() const {
+        return this->bounds;
+    }
+
+    Core::UInt32 MeshBVH::getTriangleCount() const {
+        return this->triangleCount;
+    }
+
+}
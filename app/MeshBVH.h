@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include "BVH.h"
+#include "SimdKernels.h"
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Bottom level of the picking hierarchy: a triangle BVH in mesh-local space.
+    // Triangle data is copied, so the source buffers may be released after construction.
+    class MeshBVH {
+    public:
+        static const Core::UInt32 MaxLeafTriangles = 4;
+        static const Core::UInt32 MaxVolumePlanes = 8;
+
+        class Hit {
+        public:
+            Hit(): t(0.0f), triangle(0), u(0.0f), v(0.0f) {}
+
+            Core::Real t;
+            Core::UInt32 triangle;
+            Core::Real u;
+            Core::Real v;
+        };
+
+        // positions are read with the given stride (in Reals); indices may be null for non-indexed meshes
+        MeshBVH(const Core::Real* positions, Core::UInt32 positionStride, Core::UInt32 vertexCount,
+                const Core::UInt32* indices, Core::UInt32 indexCount);
+        // bounds only: no triangles are kept, so rays never hit it and volume queries stop at
+        // its bounds. For meshes picked through the GPU ID buffer, where the triangle copy
+        // would only cost memory.
+        MeshBVH(const Core::Real* positions, Core::UInt32 positionStride, Core::UInt32 vertexCount, Core::UInt32 triangleCount);
+
+        // only hits closer than hit.t are reported, so hit.t must be initialized to the max distance
+        bool intersect(const BVHRay& ray, Hit& hit) const;
+
+        // true if any triangle is at least partly inside the convex volume bounded by planes
+        // (a, b, c, d), inside where a x + b y + c z + d >= 0, given in mesh-local space
+        bool intersectsVolume(const Core::Real* planes, Core::UInt32 planeCount) const;
+
+        const BVHBounds& getBounds() const;
+        Core::UInt32 getTriangleCount() const;
+
+    private:
+        // leaf triangles are grouped into packets, so a leaf's firstPrimitive is the index of its
+        // first packet rather than of its first triangle
+        std::vector<SimdKernels::TrianglePacket> packets;
+        std::vector<Core::UInt32> triangleIDs; // SimdKernels::PacketWidth per packet
+        std::vector<BVHNode> nodes;
+        BVHBounds bounds;
+        Core::UInt32 triangleCount;
+    };
+
+}
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "MeshBatcher.h"
+#include "SimdKernels.h"
+
+namespace Modeler {
+
+    namespace {
+
+        void setIdentity(Core::Real* m) {
+            for (unsigned int i = 0; i < 16; i++) m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+        }
+
+        // cofactor matrix of the upper 3x3 (column-major, 3x3): proportional to the inverse
+        // transpose, which is all normals need since they are renormalized afterwards
+        void normalMatrix(const Core::Real* m, Core::Real* out) {
+            out[0] = m[5] * m[10] - m[6] * m[9];
+            out[1] = m[6] * m[8] - m[4] * m[10];
+            out[2] = m[4] * m[9] - m[5] * m[8];
+            out[3] = m[2] * m[9] - m[1] * m[10];
+            out[4] = m[0] * m[10] - m[2] * m[8];
+            out[5] = m[1] * m[8] - m[0] * m[9];
+            out[6] = m[1] * m[6] - m[2] * m[5];
+            out[7] = m[2] * m[4] - m[0] * m[6];
+            out[8] = m[0] * m[5] - m[1] * m[4];
+
+            // mirroring transforms flip the cofactors, so restore the orientation
+            Core::Real determinant = m[0] * out[0] + m[1] * out[1] + m[2] * out[2];
+            if (determinant < 0.0f) {
+                for (unsigned int i = 0; i < 9; i++) out[i] = -out[i];
+            }
+        }
+
+        void transformNormal(const Core::Real* n, const Core::Real* source, Core::Real* dest) {
+            // n holds the cofactors column by column: n[column * 3 + row]
+            Core::Real x = n[0] * source[0] + n[3] * source[1] + n[6] * source[2];
+            Core::Real y = n[1] * source[0] + n[4] * source[1] + n[7] * source[2];
+            Core::Real z = n[2] * source[0] + n[5] * source[1] + n[8] * source[2];
+            Core::Real length = std::sqrt(x * x + y * y + z * z);
+            Core::Real scale = length > 0.0f ? 1.0f / length : 0.0f;
+            dest[0] = x * scale;
+            dest[1] = y * scale;
+            dest[2] = z * scale;
+            dest[3] = 0.0f;
+        }
+
+        Core::UInt64 hashMesh(const ImportedMesh& mesh) {
+            // FNV-1a over the geometry; attributes are fully compared on a hash match
+            Core::UInt64 hash = 14695981039346656037ull;
+            auto mix = [&hash](const void* data, size_t size) {
+                const unsigned char* bytes = static_cast<const unsigned char*>(data);
+                for (size_t i = 0; i < size; i++) {
+                    hash ^= bytes[i];
+                    hash *= 1099511628211ull;
+                }
+            };
+            mix(&mesh.vertexCount, sizeof(mesh.vertexCount));
+            mix(mesh.positions.data(), mesh.positions.size() * sizeof(Core::Real));
+            mix(mesh.indices.data(), mesh.indices.size() * sizeof(Core::UInt32));
+            return hash;
+        }
+
+        bool sameMesh(const ImportedMesh& a, const ImportedMesh& b) {
+            return a.vertexCount == b.vertexCount && a.positions == b.positions && a.normals == b.normals &&
+                   a.colors == b.colors && a.indices == b.indices;
+        }
+
+    }
+
+    void MeshBatcher::batchRepeatedMeshes(ImportedModel& model) {
+        mergeDuplicateMeshes(model);
+        if (model.nodes.size() == 0) return;
+
+        std::vector<Core::UInt32> referenceCounts(model.meshes.size(), 0);
+        for (const ImportedNode& node : model.nodes) {
+            for (Core::UInt32 meshIndex : node.meshIndices) referenceCounts[meshIndex]++;
+        }
+
+        std::vector<Core::UInt32> candidates;
+        for (Core::UInt32 i = 0; i < model.meshes.size(); i++) {
+            Core::UInt32 vertexCount = model.meshes[i].vertexCount;
+            if (referenceCounts[i] >= MinInstanceCount && vertexCount > 0 && vertexCount <= MaxBatchedMeshVertices) candidates.push_back(i);
+        }
+        std::sort(candidates.begin(), candidates.end(), [&model](Core::UInt32 a, Core::UInt32 b) {
+            return model.meshes[a].vertexCount < model.meshes[b].vertexCount;
+        });
+
+        // how many references of each mesh get baked
+        std::vector<Core::UInt32> bakeCounts(model.meshes.size(), 0);
+        Core::UInt32 remainingVertices = MaxBakedVertices;
+        bool anyBatched = false;
+        for (Core::UInt32 meshIndex : candidates) {
+            Core::UInt32 vertexCount = model.meshes[meshIndex].vertexCount;
+            Core::UInt32 bakeCount = std::min(referenceCounts[meshIndex], remainingVertices / vertexCount);
+            if (bakeCount < MinInstanceCount) break;
+            bakeCounts[meshIndex] = bakeCount;
+            remainingVertices -= bakeCount * vertexCount;
+            anyBatched = true;
+        }
+        if (!anyBatched) return;
+
+        // batch vertices live in the root node's space, since batch objects are parented to it
+        std::vector<Core::Real> rootRelativeMatrices(model.nodes.size() * 16);
+        setIdentity(&rootRelativeMatrices[0]);
+        for (Core::UInt32 i = 1; i < model.nodes.size(); i++) {
+            const ImportedNode& node = model.nodes[i];
+            SimdKernels::multiplyMatrices(&rootRelativeMatrices[node.parentIndex * 16], node.localMatrix, &rootRelativeMatrices[i * 16]);
+        }
+
+        ImportedMesh* batch = nullptr;
+        for (Core::UInt32 n = 0; n < model.nodes.size(); n++) {
+            ImportedNode& node = model.nodes[n];
+            const Core::Real* matrix = &rootRelativeMatrices[n * 16];
+            Core::Real normals[9];
+            normalMatrix(matrix, normals);
+
+            std::vector<Core::UInt32> keptMeshIndices;
+            for (Core::UInt32 meshIndex : node.meshIndices) {
+                if (bakeCounts[meshIndex] == 0) {
+                    keptMeshIndices.push_back(meshIndex);
+                    continue;
+                }
+                bakeCounts[meshIndex]--;
+                node.batchedMeshIndices.push_back(meshIndex);
+
+                const ImportedMesh& mesh = model.meshes[meshIndex];
+                if (!batch || batch->vertexCount + mesh.vertexCount > BatchVertexLimit) {
+                    model.batches.push_back(ImportedMesh());
+                    batch = &model.batches.back();
+                }
+
+                Core::UInt32 baseVertex = batch->vertexCount;
+                size_t offset = batch->positions.size();
+                batch->positions.resize(offset + mesh.vertexCount * 4);
+                batch->normals.resize(offset + mesh.vertexCount * 4);
+                batch->faceNormals.resize(offset + mesh.vertexCount * 4);
+                batch->colors.insert(batch->colors.end(), mesh.colors.begin(), mesh.colors.end());
+                // node matrices are affine, so w comes out as 1
+                SimdKernels::transformPoints(matrix, mesh.positions.data(), mesh.vertexCount, &batch->positions[offset]);
+                for (Core::UInt32 v = 0; v < mesh.vertexCount; v++) {
+                    transformNormal(normals, &mesh.normals[v * 4], &batch->normals[offset + v * 4]);
+                    transformNormal(normals, &mesh.faceNormals[v * 4], &batch->faceNormals[offset + v * 4]);
+                }
+                for (Core::UInt32 index : mesh.indices) {
+                    batch->indices.push_back(baseVertex + index);
+                }
+                batch->vertexCount += mesh.vertexCount;
+            }
+            node.meshIndices.swap(keptMeshIndices);
+        }
+
+        for (const ImportedMesh& batchMesh : model.batches) {
+            model.totalVertexCount += batchMesh.vertexCount;
+            BVHBounds bounds;
+            for (Core::UInt32 v = 0; v < batchMesh.vertexCount; v++) bounds.grow(&batchMesh.positions[v * 4]);
+            model.batchBounds.push_back(bounds);
+        }
+    }
+
+    void MeshBatcher::mergeDuplicateMeshes(ImportedModel& model) {
+        std::unordered_map<Core::UInt64, std::vector<Core::UInt32>> meshesByHash;
+        std::vector<Core::UInt32> remap(model.meshes.size());
+        std::vector<ImportedMesh> uniqueMeshes;
+        bool merged = false;
+
+        for (Core::UInt32 i = 0; i < model.meshes.size(); i++) {
+            ImportedMesh& mesh = model.meshes[i];
+            std::vector<Core::UInt32>& candidates = meshesByHash[hashMesh(mesh)];
+            Core::UInt32 match = (Core::UInt32)uniqueMeshes.size();
+            for (Core::UInt32 candidate : candidates) {
+                if (sameMesh(uniqueMeshes[candidate], mesh)) {
+                    match = candidate;
+                    break;
+                }
+            }
+            if (match == uniqueMeshes.size()) {
+                candidates.push_back(match);
+                uniqueMeshes.push_back(std::move(mesh));
+            }
+            else {
+                model.totalVertexCount -= mesh.vertexCount;
+                merged = true;
+            }
+            remap[i] = match;
+        }
+
+        model.meshes.swap(uniqueMeshes);
+        if (!merged) return;
+        for (ImportedNode& node : model.nodes) {
+            for (Core::UInt32& meshIndex : node.meshIndices) meshIndex = remap[meshIndex];
+        }
+    }
+
+}
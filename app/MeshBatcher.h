@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ImportedModel.h"
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Import-time instancing for scenes that reference the same small mesh many times.
+    // The engine has no instanced draw path, so repeated meshes are merged into a few
+    // pre-transformed batch meshes (static batching). The nodes keep the references in
+    // ImportedNode::batchedMeshIndices, which is enough for per-instance picking and
+    // selection highlighting.
+    //
+    // Baking stores one copy of the mesh per reference, so its memory is bounded per model
+    // rather than per mesh: at most MaxBakedVertices baked vertices (128 MB at 64 bytes per
+    // vertex), handed out smallest mesh first, since those save the most draws per byte. A mesh
+    // with MinInstanceCount or more references and at most MaxBatchedMeshVertices vertices has
+    // as many of its references baked as the budget allows, however many it has; the rest keep
+    // the shared mesh and a draw each. Batches are split at BatchVertexLimit vertices.
+    class MeshBatcher {
+    public:
+        static const Core::UInt32 MinInstanceCount = 4;
+        static const Core::UInt32 MaxBatchedMeshVertices = 1024;
+        static const Core::UInt32 MaxBakedVertices = 2097152;
+        static const Core::UInt32 BatchVertexLimit = 262144;
+
+        // merges meshes with identical data, then batches the repeated ones.
+        // Must run before the model's picking BVHs are built.
+        static void batchRepeatedMeshes(ImportedModel& model);
+
+    private:
+        MeshBatcher();
+
+        static void mergeDuplicateMeshes(ImportedModel& model);
+    };
+
+}
@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshOptimizer.h"
+
+namespace Modeler {
+
+    namespace {
+
+        // a cluster is split once its running miss ratio gets within this factor of the whole cluster's
+        const Core::Real OverdrawCacheThreshold = 1.05f;
+
+        class CacheSimulator {
+        public:
+            CacheSimulator(Core::UInt32 vertexCount, Core::UInt32 cacheSize): cacheSize(cacheSize), timestamp(cacheSize + 1), times(vertexCount, 0) {}
+
+            // returns true on a miss
+            bool access(Core::UInt32 vertex) {
+                if (this->timestamp - this->times[vertex] <= this->cacheSize) return false;
+                this->times[vertex] = this->timestamp++;
+                return true;
+            }
+
+            void flush() {
+                this->timestamp += this->cacheSize + 1;
+            }
+
+        private:
+            Core::UInt32 cacheSize;
+            Core::UInt32 timestamp;
+            std::vector<Core::UInt32> times;
+        };
+
+        Core::UInt64 hashVertex(const ImportedMesh& mesh, Core::UInt32 vertex) {
+            Core::UInt64 hash = 14695981039346656037ull;
+            const std::vector<Core::Real>* attributes[] = {&mesh.positions, &mesh.normals, &mesh.faceNormals, &mesh.colors};
+            for (const std::vector<Core::Real>* attribute : attributes) {
+                const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&(*attribute)[vertex * 4]);
+                for (size_t i = 0; i < sizeof(Core::Real) * 4; i++) {
+                    hash ^= bytes[i];
+                    hash *= 1099511628211ull;
+                }
+            }
+            return hash;
+        }
+
+        bool sameVertex(const ImportedMesh& mesh, Core::UInt32 a, Core::UInt32 b) {
+            const std::vector<Core::Real>* attributes[] = {&mesh.positions, &mesh.normals, &mesh.faceNormals, &mesh.colors};
+            for (const std::vector<Core::Real>* attribute : attributes) {
+                if (std::memcmp(&(*attribute)[a * 4], &(*attribute)[b * 4], sizeof(Core::Real) * 4) != 0) return false;
+            }
+            return true;
+        }
+
+        // rebuilds every attribute array so that new vertex i is old vertex sources[i]
+        void gatherVertices(ImportedMesh& mesh, const std::vector<Core::UInt32>& sources) {
+            std::vector<Core::Real>* attributes[] = {&mesh.positions, &mesh.normals, &mesh.faceNormals, &mesh.colors};
+            for (std::vector<Core::Real>* attribute : attributes) {
+                std::vector<Core::Real> gathered(sources.size() * 4);
+                for (Core::UInt32 i = 0; i < sources.size(); i++) {
+                    std::memcpy(&gathered[i * 4], &(*attribute)[sources[i] * 4], sizeof(Core::Real) * 4);
+                }
+                attribute->swap(gathered);
+            }
+            mesh.vertexCount = (Core::UInt32)sources.size();
+        }
+
+    }
+
+    Core::Real MeshOptimizer::Stats::getAcmrBefore() const {
+        return this->triangleCount > 0 ? (Core::Real)this->missesBefore / (Core::Real)this->triangleCount : 0.0f;
+    }
+
+    Core::Real MeshOptimizer::Stats::getAcmrAfter() const {
+        return this->triangleCount > 0 ? (Core::Real)this->missesAfter / (Core::Real)this->triangleCount : 0.0f;
+    }
+
+    void MeshOptimizer::Stats::add(const Stats& other) {
+        this->triangleCount += other.triangleCount;
+        this->verticesBefore += other.verticesBefore;
+        this->verticesAfter += other.verticesAfter;
+        this->missesBefore += other.missesBefore;
+        this->missesAfter += other.missesAfter;
+    }
+
+    MeshOptimizer::Stats MeshOptimizer::optimize(ImportedMesh& mesh) {
+        Stats stats;
+        stats.triangleCount = mesh.indices.size() / 3;
+        stats.verticesBefore = mesh.vertexCount;
+        stats.missesBefore = countCacheMisses(mesh.indices, mesh.vertexCount);
+
+        if (mesh.indices.size() >= 3) {
+            weldVertices(mesh);
+            optimizeVertexCache(mesh);
+            optimizeOverdraw(mesh);
+            optimizeVertexFetch(mesh);
+        }
+
+        stats.verticesAfter = mesh.vertexCount;
+        stats.missesAfter = countCacheMisses(mesh.indices, mesh.vertexCount);
+        return stats;
+    }
+
+    Core::UInt64 MeshOptimizer::countCacheMisses(const std::vector<Core::UInt32>& indices, Core::UInt32 vertexCount) {
+        CacheSimulator cache(vertexCount, CacheSize);
+        Core::UInt64 misses = 0;
+        for (Core::UInt32 index : indices) {
+            if (cache.access(index)) misses++;
+        }
+        return misses;
+    }
+
+    void MeshOptimizer::weldVertices(ImportedMesh& mesh) {
+        std::unordered_map<Core::UInt64, std::vector<Core::UInt32>> verticesByHash;
+        std::vector<Core::UInt32> remap(mesh.vertexCount);
+        std::vector<Core::UInt32> sources;
+        for (Core::UInt32 v = 0; v < mesh.vertexCount; v++) {
+            std::vector<Core::UInt32>& candidates = verticesByHash[hashVertex(mesh, v)];
+            Core::UInt32 match = (Core::UInt32)sources.size();
+            for (Core::UInt32 candidate : candidates) {
+                if (sameVertex(mesh, sources[candidate], v)) {
+                    match = candidate;
+                    break;
+                }
+            }
+            if (match == sources.size()) {
+                candidates.push_back(match);
+                sources.push_back(v);
+            }
+            remap[v] = match;
+        }
+        if (sources.size() == mesh.vertexCount) return;
+
+        gatherVertices(mesh, sources);
+        for (Core::UInt32& index : mesh.indices) index = remap[index];
+    }
+
+    void MeshOptimizer::optimizeVertexCache(ImportedMesh& mesh) {
+        Core::UInt32 vertexCount = mesh.vertexCount;
+        Core::UInt32 triangleCount = (Core::UInt32)(mesh.indices.size() / 3);
+        const std::vector<Core::UInt32>& indices = mesh.indices;
+
+        // vertex -> triangle adjacency, compressed into one array
+        std::vector<Core::UInt32> liveCounts(vertexCount, 0);
+        for (Core::UInt32 index : indices) liveCounts[index]++;
+        std::vector<Core::UInt32> offsets(vertexCount + 1, 0);
+        for (Core::UInt32 v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + liveCounts[v];
+        std::vector<Core::UInt32> adjacency(indices.size());
+        std::vector<Core::UInt32> fill(offsets.begin(), offsets.end() - 1);
+        for (Core::UInt32 i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = i / 3;
+
+        std::vector<Core::UInt32> cacheTimes(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<Core::UInt32> deadEnds;
+        std::vector<Core::UInt32> candidates;
+        std::vector<Core::UInt32> output;
+        output.reserve(indices.size());
+        Core::UInt32 timestamp = CacheSize + 1;
+        Core::UInt32 cursor = 0;
+
+        // falls back to recently touched vertices first, then to the next unfinished vertex in order
+        auto skipDeadEnd = [&]() -> Core::Int32 {
+            while (deadEnds.size() > 0) {
+                Core::UInt32 vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveCounts[vertex] > 0) return (Core::Int32)vertex;
+            }
+            while (cursor < vertexCount) {
+                if (liveCounts[cursor] > 0) return (Core::Int32)cursor;
+                cursor++;
+            }
+            return -1;
+        };
+
+        Core::Int32 fanning = skipDeadEnd();
+        while (fanning >= 0) {
+            candidates.clear();
+            for (Core::UInt32 a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+                Core::UInt32 triangle = adjacency[a];
+                if (emitted[triangle]) continue;
+                emitted[triangle] = true;
+                for (unsigned int c = 0; c < 3; c++) {
+                    Core::UInt32 vertex = indices[triangle * 3 + c];
+                    output.push_back(vertex);
+                    deadEnds.push_back(vertex);
+                    candidates.push_back(vertex);
+                    liveCounts[vertex]--;
+                    if (timestamp - cacheTimes[vertex] > CacheSize) cacheTimes[vertex] = timestamp++;
+                }
+            }
+
+            // prefer the oldest candidate that will still be in the cache after its whole fan is emitted
+            Core::Int32 next = -1;
+            Core::Int32 bestPriority = -1;
+            for (Core::UInt32 vertex : candidates) {
+                if (liveCounts[vertex] == 0) continue;
+                Core::Int32 priority = 0;
+                Core::UInt32 age = timestamp - cacheTimes[vertex];
+                if (age + 2 * liveCounts[vertex] <= CacheSize) priority = (Core::Int32)age;
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    next = (Core::Int32)vertex;
+                }
+            }
+            fanning = next >= 0 ? next : skipDeadEnd();
+        }
+
+        mesh.indices.swap(output);
+    }
+
+    void MeshOptimizer::optimizeOverdraw(ImportedMesh& mesh) {
+        std::vector<Core::UInt32>& indices = mesh.indices;
+        Core::UInt32 triangleCount = (Core::UInt32)(indices.size() / 3);
+
+        // hard boundaries: triangles that miss on all three vertices start from a cold cache anyway
+        std::vector<Core::UInt32> hardStarts;
+        CacheSimulator hardCache(mesh.vertexCount, CacheSize);
+        for (Core::UInt32 t = 0; t < triangleCount; t++) {
+            Core::UInt32 misses = 0;
+            for (unsigned int c = 0; c < 3; c++) misses += hardCache.access(indices[t * 3 + c]) ? 1 : 0;
+            if (t == 0 || misses == 3) hardStarts.push_back(t);
+        }
+        hardStarts.push_back(triangleCount);
+
+        // soft boundaries: split clusters further wherever that doesn't cost noticeably more cache misses
+        std::vector<Core::UInt32> clusterStarts;
+        CacheSimulator softCache(mesh.vertexCount, CacheSize);
+        for (Core::UInt32 h = 0; h + 1 < hardStarts.size(); h++) {
+            Core::UInt32 start = hardStarts[h], end = hardStarts[h + 1];
+            softCache.flush();
+            Core::UInt32 clusterMisses = 0;
+            for (Core::UInt32 t = start; t < end; t++) {
+                for (unsigned int c = 0; c < 3; c++) clusterMisses += softCache.access(indices[t * 3 + c]) ? 1 : 0;
+            }
+            Core::Real clusterAcmr = (Core::Real)clusterMisses / (Core::Real)(end - start);
+
+            softCache.flush();
+            Core::UInt32 subStart = start;
+            Core::UInt32 subMisses = 0;
+            clusterStarts.push_back(start);
+            for (Core::UInt32 t = start; t < end; t++) {
+                for (unsigned int c = 0; c < 3; c++) subMisses += softCache.access(indices[t * 3 + c]) ? 1 : 0;
+                Core::Real subAcmr = (Core::Real)subMisses / (Core::Real)(t - subStart + 1);
+                if (t + 1 < end && subAcmr <= clusterAcmr * OverdrawCacheThreshold) {
+                    subStart = t + 1;
+                    subMisses = 0;
+                    softCache.flush();
+                    clusterStarts.push_back(subStart);
+                }
+            }
+        }
+        clusterStarts.push_back(triangleCount);
+        Core::UInt32 clusterCount = (Core::UInt32)clusterStarts.size() - 1;
+        if (clusterCount < 2) return;
+
+        Core::Real meshCentroid[3] = {0.0f, 0.0f, 0.0f};
+        for (Core::UInt32 v = 0; v < mesh.vertexCount; v++) {
+            for (unsigned int axis = 0; axis < 3; axis++) meshCentroid[axis] += mesh.positions[v * 4 + axis];
+        }
+        for (unsigned int axis = 0; axis < 3; axis++) meshCentroid[axis] /= (Core::Real)mesh.vertexCount;
+
+        // clusters on the outside, facing away from the center, are the likeliest occluders
+        std::vector<Core::Real> sortKeys(clusterCount);
+        for (Core::UInt32 cluster = 0; cluster < clusterCount; cluster++) {
+            Core::Real centroid[3] = {0.0f, 0.0f, 0.0f};
+            Core::Real normal[3] = {0.0f, 0.0f, 0.0f};
+            Core::Real totalArea = 0.0f;
+            for (Core::UInt32 t = clusterStarts[cluster]; t < clusterStarts[cluster + 1]; t++) {
+                const Core::Real* p0 = &mesh.positions[indices[t * 3] * 4];
+                const Core::Real* p1 = &mesh.positions[indices[t * 3 + 1] * 4];
+                const Core::Real* p2 = &mesh.positions[indices[t * 3 + 2] * 4];
+                Core::Real e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+                Core::Real e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+                Core::Real n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+                Core::Real area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                for (unsigned int axis = 0; axis < 3; axis++) {
+                    centroid[axis] += (p0[axis] + p1[axis] + p2[axis]) * (area / 3.0f);
+                    normal[axis] += n[axis];
+                }
+                totalArea += area;
+            }
+
+            Core::Real normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            Core::Real key = 0.0f;
+            if (totalArea > 0.0f && normalLength > 0.0f) {
+                for (unsigned int axis = 0; axis < 3; axis++) {
+                    key += (centroid[axis] / totalArea - meshCentroid[axis]) * normal[axis] / normalLength;
+                }
+            }
+            sortKeys[cluster] = key;
+        }
+
+        std::vector<Core::UInt32> clusterOrder(clusterCount);
+        for (Core::UInt32 i = 0; i < clusterCount; i++) clusterOrder[i] = i;
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](Core::UInt32 a, Core::UInt32 b) {
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        std::vector<Core::UInt32> sorted;
+        sorted.reserve(indices.size());
+        for (Core::UInt32 cluster : clusterOrder) {
+            sorted.insert(sorted.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+        }
+        indices.swap(sorted);
+    }
+
+    void MeshOptimizer::optimizeVertexFetch(ImportedMesh& mesh) {
+        const Core::UInt32 Unassigned = 0xFFFFFFFF;
+        std::vector<Core::UInt32> remap(mesh.vertexCount, Unassigned);
+        std::vector<Core::UInt32> sources;
+        sources.reserve(mesh.vertexCount);
+        for (Core::UInt32& index : mesh.indices) {
+            if (remap[index] == Unassigned) {
+                remap[index] = (Core::UInt32)sources.size();
+                sources.push_back(index);
+            }
+            index = remap[index];
+        }
+        gatherVertices(mesh, sources);
+    }
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include "ImportedModel.h"
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Import-time reordering of mesh data for the GPU:
+    //   1. weld vertices whose attributes are bit-identical
+    //   2. reorder triangles for post-transform cache locality (Tipsify, Sander et al. 2007)
+    //   3. sort the resulting triangle clusters so outward facing ones draw first (less overdraw)
+    //   4. reorder vertex memory by first use for fetch locality
+    // Triangle sets and shading are unchanged, only their order and the vertex numbering.
+    class MeshOptimizer {
+    public:
+        // simulated FIFO post-transform cache, used both for ordering and for reporting
+        static const Core::UInt32 CacheSize = 16;
+
+        class Stats {
+        public:
+            Stats(): triangleCount(0), verticesBefore(0), verticesAfter(0), missesBefore(0), missesAfter(0) {}
+
+            // average cache miss ratio: transformed vertices per triangle
+            Core::Real getAcmrBefore() const;
+            Core::Real getAcmrAfter() const;
+            void add(const Stats& other);
+
+            Core::UInt64 triangleCount;
+            Core::UInt64 verticesBefore;
+            Core::UInt64 verticesAfter;
+            Core::UInt64 missesBefore;
+            Core::UInt64 missesAfter;
+        };
+
+        static Stats optimize(ImportedMesh& mesh);
+        static Core::UInt64 countCacheMisses(const std::vector<Core::UInt32>& indices, Core::UInt32 vertexCount);
+
+    private:
+        MeshOptimizer();
+
+        static void weldVertices(ImportedMesh& mesh);
+        static void optimizeVertexCache(ImportedMesh& mesh);
+        static void optimizeOverdraw(ImportedMesh& mesh);
+        static void optimizeVertexFetch(ImportedMesh& mesh);
+    };
+
+}
@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+
+#include "MeshSimplifier.h"
+
+namespace Modeler {
+
+    namespace {
+
+        // boundary edges get a perpendicular constraint plane so open borders don't shrink
+        const double BoundaryWeight = 100.0;
+        // collapses that turn a neighbouring face further than this (cosine) are rejected
+        const double MinNormalAgreement = 0.2;
+        // corners moving onto another vertex share its attributes when the normals agree this well (cosine),
+        // anything further apart is a crease or seam and keeps its own
+        const double MinAttributeAgreement = 0.9;
+
+        class Quadric {
+        public:
+            Quadric() {
+                for (unsigned int i = 0; i < 10; i++) this->m[i] = 0.0;
+            }
+
+            void addPlane(double a, double b, double c, double d, double weight) {
+                this->m[0] += weight * a * a; this->m[1] += weight * a * b; this->m[2] += weight * a * c; this->m[3] += weight * a * d;
+                this->m[4] += weight * b * b; this->m[5] += weight * b * c; this->m[6] += weight * b * d;
+                this->m[7] += weight * c * c; this->m[8] += weight * c * d;
+                this->m[9] += weight * d * d;
+            }
+
+            void add(const Quadric& other) {
+                for (unsigned int i = 0; i < 10; i++) this->m[i] += other.m[i];
+            }
+
+            double evaluate(const double* p) const {
+                double x = p[0], y = p[1], z = p[2];
+                return this->m[0] * x * x + 2.0 * this->m[1] * x * y + 2.0 * this->m[2] * x * z + 2.0 * this->m[3] * x +
+                       this->m[4] * y * y + 2.0 * this->m[5] * y * z + 2.0 * this->m[6] * y +
+                       this->m[7] * z * z + 2.0 * this->m[8] * z + this->m[9];
+            }
+
+            // minimizer of the quadric, if the system is well conditioned
+            bool solve(double* p) const {
+                double a = this->m[0], b = this->m[1], c = this->m[2];
+                double d = this->m[4], e = this->m[5], f = this->m[7];
+                double det = a * (d * f - e * e) - b * (b * f - c * e) + c * (b * e - c * d);
+                double scale = std::abs(a) + std::abs(d) + std::abs(f);
+                if (std::abs(det) <= 1e-9 * scale * scale * scale) return false;
+
+                double rx = -this->m[3], ry = -this->m[6], rz = -this->m[8];
+                p[0] = (rx * (d * f - e * e) - b * (ry * f - rz * e) + c * (ry * e - rz * d)) / det;
+                p[1] = (a * (ry * f - rz * e) - rx * (b * f - c * e) + c * (b * rz - c * ry)) / det;
+                p[2] = (a * (d * rz - e * ry) - b * (b * rz - c * ry) + rx * (b * e - c * d)) / det;
+                return true;
+            }
+
+            double m[10];
+        };
+
+        class Triangle {
+        public:
+            Core::UInt32 vertices[3];   // welded vertex IDs
+            Core::UInt32 attributes[3]; // source vertex that supplies each corner's attributes
+            bool removed;
+        };
+
+        class Collapse {
+        public:
+            double cost;
+            Core::UInt32 from;
+            Core::UInt32 to;
+            Core::UInt32 fromVersion;
+            Core::UInt32 toVersion;
+            double position[3];
+
+            bool operator<(const Collapse& other) const {
+                return this->cost > other.cost;
+            }
+        };
+
+        void cross(const double* a, const double* b, double* out) {
+            out[0] = a[1] * b[2] - a[2] * b[1];
+            out[1] = a[2] * b[0] - a[0] * b[2];
+            out[2] = a[0] * b[1] - a[1] * b[0];
+        }
+
+        void faceNormal(const double* p0, const double* p1, const double* p2, double* normal) {
+            double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            cross(e1, e2, normal);
+        }
+
+        Core::UInt64 edgeKey(Core::UInt32 a, Core::UInt32 b) {
+            return a < b ? ((Core::UInt64)a << 32) | b : ((Core::UInt64)b << 32) | a;
+        }
+
+        class Simplifier {
+        public:
+            Simplifier(const ImportedMesh& source): source(source), liveTriangleCount(0) {
+                this->weldVertices();
+                this->buildTriangles();
+                this->buildQuadrics();
+            }
+
+            void run(Core::UInt32 targetTriangleCount) {
+                for (const Triangle& triangle : this->triangles) {
+                    for (unsigned int i = 0; i < 3; i++) {
+                        Core::UInt32 a = triangle.vertices[i], b = triangle.vertices[(i + 1) % 3];
+                        if (a < b) this->pushCollapse(a, b);
+                        else this->pushCollapse(b, a);
+                    }
+                }
+
+                while (this->liveTriangleCount > targetTriangleCount && !this->heap.empty()) {
+                    Collapse collapse = this->heap.top();
+                    this->heap.pop();
+                    if (this->removed[collapse.from] || this->removed[collapse.to]) continue;
+                    if (this->versions[collapse.from] != collapse.fromVersion || this->versions[collapse.to] != collapse.toVersion) continue;
+                    if (this->flipsTriangle(collapse.from, collapse.to, collapse.position) ||
+                        this->flipsTriangle(collapse.to, collapse.from, collapse.position)) continue;
+                    this->apply(collapse);
+                }
+            }
+
+            bool write(ImportedMesh& result) const {
+                if (this->liveTriangleCount * 3 >= this->source.indices.size()) return false;
+
+                result = ImportedMesh();
+                result.materialIndex = this->source.materialIndex;
+                std::map<std::pair<Core::UInt32, Core::UInt32>, Core::UInt32> outputVertices;
+                for (const Triangle& triangle : this->triangles) {
+                    if (triangle.removed) continue;
+                    for (unsigned int i = 0; i < 3; i++) {
+                        std::pair<Core::UInt32, Core::UInt32> key(triangle.vertices[i], triangle.attributes[i]);
+                        auto found = outputVertices.find(key);
+                        if (found == outputVertices.end()) {
+                            found = outputVertices.insert(std::make_pair(key, result.vertexCount++)).first;
+                            const double* position = &this->positions[key.first * 3];
+                            Core::UInt32 attribute = key.second;
+                            result.positions.insert(result.positions.end(), {(Core::Real)position[0], (Core::Real)position[1], (Core::Real)position[2], 1.0f});
+                            result.normals.insert(result.normals.end(), &this->source.normals[attribute * 4], &this->source.normals[attribute * 4] + 4);
+                            result.colors.insert(result.colors.end(), &this->source.colors[attribute * 4], &this->source.colors[attribute * 4] + 4);
+                        }
+                        result.indices.push_back(found->second);
+                    }
+                }
+
+                // like the importer, shared vertices keep the normal of the last face that references them
+                result.faceNormals.resize(result.vertexCount * 4, 0.0f);
+                for (size_t i = 0; i < result.indices.size(); i += 3) {
+                    const Core::UInt32* corner = &result.indices[i];
+                    double p[3][3];
+                    for (unsigned int c = 0; c < 3; c++) {
+                        for (unsigned int axis = 0; axis < 3; axis++) p[c][axis] = result.positions[corner[c] * 4 + axis];
+                    }
+                    double normal[3];
+                    faceNormal(p[0], p[1], p[2], normal);
+                    double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                    double scale = length > 0.0 ? 1.0 / length : 0.0;
+                    for (unsigned int c = 0; c < 3; c++) {
+                        for (unsigned int axis = 0; axis < 3; axis++) result.faceNormals[corner[c] * 4 + axis] = (Core::Real)(normal[axis] * scale);
+                    }
+                }
+                return true;
+            }
+
+        private:
+            void weldVertices() {
+                std::vector<Core::UInt32> order(this->source.vertexCount);
+                for (Core::UInt32 i = 0; i < order.size(); i++) order[i] = i;
+                const Core::Real* p = this->source.positions.data();
+                std::sort(order.begin(), order.end(), [p](Core::UInt32 a, Core::UInt32 b) {
+                    return std::lexicographical_compare(p + a * 4, p + a * 4 + 3, p + b * 4, p + b * 4 + 3);
+                });
+
+                this->welded.resize(this->source.vertexCount);
+                for (Core::UInt32 i = 0; i < order.size(); i++) {
+                    Core::UInt32 vertex = order[i];
+                    bool same = i > 0 && std::equal(p + vertex * 4, p + vertex * 4 + 3, p + order[i - 1] * 4);
+                    if (!same) {
+                        this->positions.insert(this->positions.end(), {p[vertex * 4], p[vertex * 4 + 1], p[vertex * 4 + 2]});
+                    }
+                    this->welded[vertex] = (Core::UInt32)(this->positions.size() / 3 - 1);
+                }
+
+                Core::UInt32 weldedCount = (Core::UInt32)(this->positions.size() / 3);
+                this->removed.resize(weldedCount, false);
+                this->versions.resize(weldedCount, 0);
+                this->quadrics.resize(weldedCount);
+                this->vertexTriangles.resize(weldedCount);
+                this->attributeVariants.resize(weldedCount);
+            }
+
+            void buildTriangles() {
+                for (size_t i = 0; i + 2 < this->source.indices.size(); i += 3) {
+                    Triangle triangle;
+                    triangle.removed = false;
+                    for (unsigned int c = 0; c < 3; c++) {
+                        triangle.attributes[c] = this->source.indices[i + c];
+                        triangle.vertices[c] = this->welded[triangle.attributes[c]];
+                    }
+                    // degenerate after welding
+                    if (triangle.vertices[0] == triangle.vertices[1] || triangle.vertices[1] == triangle.vertices[2] ||
+                        triangle.vertices[0] == triangle.vertices[2]) continue;
+
+                    Core::UInt32 index = (Core::UInt32)this->triangles.size();
+                    this->triangles.push_back(triangle);
+                    for (unsigned int c = 0; c < 3; c++) {
+                        this->vertexTriangles[triangle.vertices[c]].push_back(index);
+                        std::vector<Core::UInt32>& variants = this->attributeVariants[triangle.vertices[c]];
+                        if (std::find(variants.begin(), variants.end(), triangle.attributes[c]) == variants.end()) {
+                            variants.push_back(triangle.attributes[c]);
+                        }
+                    }
+                }
+                this->liveTriangleCount = (Core::UInt32)this->triangles.size();
+            }
+
+            void buildQuadrics() {
+                std::unordered_map<Core::UInt64, Core::UInt32> edgeUseCounts;
+                for (const Triangle& triangle : this->triangles) {
+                    for (unsigned int i = 0; i < 3; i++) {
+                        edgeUseCounts[edgeKey(triangle.vertices[i], triangle.vertices[(i + 1) % 3])]++;
+                    }
+                }
+
+                for (const Triangle& triangle : this->triangles) {
+                    const double* p0 = &this->positions[triangle.vertices[0] * 3];
+                    const double* p1 = &this->positions[triangle.vertices[1] * 3];
+                    const double* p2 = &this->positions[triangle.vertices[2] * 3];
+                    double normal[3];
+                    faceNormal(p0, p1, p2, normal);
+                    double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                    if (length <= 0.0) continue;
+                    for (unsigned int axis = 0; axis < 3; axis++) normal[axis] /= length;
+                    double d = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+
+                    // area weighted, so large faces dominate the error
+                    Quadric quadric;
+                    quadric.addPlane(normal[0], normal[1], normal[2], d, length * 0.5);
+                    for (unsigned int c = 0; c < 3; c++) this->quadrics[triangle.vertices[c]].add(quadric);
+
+                    for (unsigned int i = 0; i < 3; i++) {
+                        Core::UInt32 a = triangle.vertices[i], b = triangle.vertices[(i + 1) % 3];
+                        if (edgeUseCounts[edgeKey(a, b)] != 1) continue;
+                        const double* pa = &this->positions[a * 3];
+                        const double* pb = &this->positions[b * 3];
+                        double edge[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+                        double constraint[3];
+                        cross(edge, normal, constraint);
+                        double constraintLength = std::sqrt(constraint[0] * constraint[0] + constraint[1] * constraint[1] + constraint[2] * constraint[2]);
+                        if (constraintLength <= 0.0) continue;
+                        for (unsigned int axis = 0; axis < 3; axis++) constraint[axis] /= constraintLength;
+                        double constraintD = -(constraint[0] * pa[0] + constraint[1] * pa[1] + constraint[2] * pa[2]);
+                        Quadric boundary;
+                        boundary.addPlane(constraint[0], constraint[1], constraint[2], constraintD, BoundaryWeight * constraintLength);
+                        this->quadrics[a].add(boundary);
+                        this->quadrics[b].add(boundary);
+                    }
+                }
+            }
+
+            void pushCollapse(Core::UInt32 a, Core::UInt32 b) {
+                Quadric quadric = this->quadrics[a];
+                quadric.add(this->quadrics[b]);
+
+                const double* pa = &this->positions[a * 3];
+                const double* pb = &this->positions[b * 3];
+                double candidates[4][3] = {
+                    {pa[0], pa[1], pa[2]},
+                    {pb[0], pb[1], pb[2]},
+                    {(pa[0] + pb[0]) * 0.5, (pa[1] + pb[1]) * 0.5, (pa[2] + pb[2]) * 0.5},
+                };
+                unsigned int candidateCount = quadric.solve(candidates[3]) ? 4 : 3;
+
+                Collapse collapse;
+                collapse.cost = -1.0;
+                for (unsigned int i = 0; i < candidateCount; i++) {
+                    double cost = quadric.evaluate(candidates[i]);
+                    if (collapse.cost < 0.0 || cost < collapse.cost) {
+                        collapse.cost = std::max(cost, 0.0);
+                        for (unsigned int axis = 0; axis < 3; axis++) collapse.position[axis] = candidates[i][axis];
+                    }
+                }
+                collapse.from = a;
+                collapse.to = b;
+                collapse.fromVersion = this->versions[a];
+                collapse.toVersion = this->versions[b];
+                this->heap.push(collapse);
+            }
+
+            // would moving `vertex` to position turn one of its faces (not shared with `other`) over?
+            bool flipsTriangle(Core::UInt32 vertex, Core::UInt32 other, const double* position) const {
+                for (Core::UInt32 triangleIndex : this->vertexTriangles[vertex]) {
+                    const Triangle& triangle = this->triangles[triangleIndex];
+                    if (triangle.removed) continue;
+                    const double* corners[3];
+                    const double* moved[3];
+                    bool sharesEdge = false;
+                    for (unsigned int c = 0; c < 3; c++) {
+                        Core::UInt32 v = triangle.vertices[c];
+                        sharesEdge = sharesEdge || v == other;
+                        corners[c] = &this->positions[v * 3];
+                        moved[c] = v == vertex ? position : corners[c];
+                    }
+                    if (sharesEdge) continue;
+
+                    double before[3], after[3];
+                    faceNormal(corners[0], corners[1], corners[2], before);
+                    faceNormal(moved[0], moved[1], moved[2], after);
+                    double beforeLength = std::sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]);
+                    double afterLength = std::sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+                    if (afterLength <= 0.0) return true;
+                    if (beforeLength <= 0.0) continue;
+                    double agreement = (before[0] * after[0] + before[1] * after[1] + before[2] * after[2]) / (beforeLength * afterLength);
+                    if (agreement < MinNormalAgreement) return true;
+                }
+                return false;
+            }
+
+            void apply(const Collapse& collapse) {
+                Core::UInt32 from = collapse.from, to = collapse.to;
+                for (unsigned int axis = 0; axis < 3; axis++) this->positions[to * 3 + axis] = collapse.position[axis];
+                this->quadrics[to].add(this->quadrics[from]);
+                this->removed[from] = true;
+                this->versions[to]++;
+                std::vector<std::pair<Core::UInt32, Core::UInt32>> attributeRemap = this->mergeAttributeVariants(from, to);
+
+                for (Core::UInt32 triangleIndex : this->vertexTriangles[from]) {
+                    Triangle& triangle = this->triangles[triangleIndex];
+                    if (triangle.removed) continue;
+                    bool hasTo = triangle.vertices[0] == to || triangle.vertices[1] == to || triangle.vertices[2] == to;
+                    if (hasTo) {
+                        triangle.removed = true;
+                        this->liveTriangleCount--;
+                        continue;
+                    }
+                    for (unsigned int c = 0; c < 3; c++) {
+                        if (triangle.vertices[c] != from) continue;
+                        triangle.vertices[c] = to;
+                        for (const std::pair<Core::UInt32, Core::UInt32>& remap : attributeRemap) {
+                            if (remap.first == triangle.attributes[c]) triangle.attributes[c] = remap.second;
+                        }
+                    }
+                    this->vertexTriangles[to].push_back(triangleIndex);
+                }
+                std::vector<Core::UInt32>().swap(this->vertexTriangles[from]);
+
+                // drop dead references and queue the edges around the merged vertex again
+                std::vector<Core::UInt32>& adjacent = this->vertexTriangles[to];
+                adjacent.erase(std::remove_if(adjacent.begin(), adjacent.end(), [this](Core::UInt32 index) {
+                    return this->triangles[index].removed;
+                }), adjacent.end());
+                for (Core::UInt32 triangleIndex : adjacent) {
+                    const Triangle& triangle = this->triangles[triangleIndex];
+                    for (unsigned int c = 0; c < 3; c++) {
+                        Core::UInt32 v = triangle.vertices[c];
+                        if (v == to) continue;
+                        if (v < to) this->pushCollapse(v, to);
+                        else this->pushCollapse(to, v);
+                    }
+                }
+            }
+
+            // maps each attribute variant of `from` onto a matching variant of `to`, or adds it to `to` as a new one
+            std::vector<std::pair<Core::UInt32, Core::UInt32>> mergeAttributeVariants(Core::UInt32 from, Core::UInt32 to) {
+                std::vector<std::pair<Core::UInt32, Core::UInt32>> remap;
+                std::vector<Core::UInt32>& toVariants = this->attributeVariants[to];
+                Core::UInt32 originalToCount = (Core::UInt32)toVariants.size();
+                for (Core::UInt32 variant : this->attributeVariants[from]) {
+                    const Core::Real* normal = &this->source.normals[variant * 4];
+                    const Core::Real* color = &this->source.colors[variant * 4];
+                    Core::UInt32 match = variant;
+                    double bestAgreement = MinAttributeAgreement;
+                    for (Core::UInt32 i = 0; i < originalToCount; i++) {
+                        Core::UInt32 candidate = toVariants[i];
+                        if (!std::equal(color, color + 4, &this->source.colors[candidate * 4])) continue;
+                        const Core::Real* candidateNormal = &this->source.normals[candidate * 4];
+                        double agreement = normal[0] * candidateNormal[0] + normal[1] * candidateNormal[1] + normal[2] * candidateNormal[2];
+                        if (agreement >= bestAgreement) {
+                            bestAgreement = agreement;
+                            match = candidate;
+                        }
+                    }
+                    if (match == variant) toVariants.push_back(variant);
+                    else remap.push_back(std::make_pair(variant, match));
+                }
+                std::vector<Core::UInt32>().swap(this->attributeVariants[from]);
+                return remap;
+            }
+
+            const ImportedMesh& source;
+            std::vector<Core::UInt32> welded;
+            std::vector<double> positions; // per welded vertex
+            std::vector<bool> removed;
+            std::vector<Core::UInt32> versions;
+            std::vector<Quadric> quadrics;
+            std::vector<std::vector<Core::UInt32>> vertexTriangles;
+            std::vector<std::vector<Core::UInt32>> attributeVariants; // source vertices used by each welded vertex's corners
+            std::vector<Triangle> triangles;
+            Core::UInt32 liveTriangleCount;
+            std::priority_queue<Collapse> heap;
+        };
+
+    }
+
+    std::vector<ImportedMesh> MeshSimplifier::buildLodChain(const ImportedMesh& mesh) {
+        std::vector<ImportedMesh> levels;
+        levels.reserve(MaxLodLevels);
+        const ImportedMesh* previous = &mesh;
+        for (Core::UInt32 level = 0; level < MaxLodLevels; level++) {
+            Core::UInt32 previousTriangles = (Core::UInt32)(previous->indices.size() / 3);
+            Core::UInt32 targetTriangles = previousTriangles / LodReductionFactor;
+            if (targetTriangles < MinLodTriangles) break;
+
+            ImportedMesh simplified;
+            if (!simplify(*previous, targetTriangles, simplified)) break;
+            // a level that barely shrinks (flip checks, locked borders) isn't worth a switch
+            if (simplified.indices.size() / 3 > previousTriangles * 3 / 4) break;
+            levels.push_back(std::move(simplified));
+            previous = &levels.back();
+        }
+        return levels;
+    }
+
+    bool MeshSimplifier::simplify(const ImportedMesh& source, Core::UInt32 targetTriangleCount, ImportedMesh& result) {
+        if (source.vertexCount == 0 || source.indices.size() < 3) return false;
+        Simplifier simplifier(source);
+        simplifier.run(targetTriangleCount);
+        return simplifier.write(result);
+    }
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+#include "ImportedModel.h"
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Quadric error metric edge-collapse simplification (Garland & Heckbert) used to
+    // build distance LODs. Vertices are welded by position before simplifying, so
+    // normal and color seams survive: every output vertex keeps the attributes of
+    // the source vertex its corner came from.
+    class MeshSimplifier {
+    public:
+        static const Core::UInt32 MaxLodLevels = 3;
+        // each LOD level targets this fraction (1 / n) of the previous level's triangles
+        static const Core::UInt32 LodReductionFactor = 4;
+        static const Core::UInt32 MinLodTriangles = 64;
+
+        // coarser levels only, level 0 is the source mesh itself; may be empty
+        static std::vector<ImportedMesh> buildLodChain(const ImportedMesh& mesh);
+        // returns false when nothing could be collapsed
+        static bool simplify(const ImportedMesh& source, Core::UInt32 targetTriangleCount, ImportedMesh& result);
+
+    private:
+        MeshSimplifier();
+    };
+
+}
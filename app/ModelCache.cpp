@@ -0,0 +1,389 @@
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "ModelCache.h"
+
+namespace Modeler {
+
+    namespace {
+
+        const Core::UInt32 CacheMagic = 0x434d4d51; // "QMMC"
+
+        // Fixed-size prefix of every entry. All sections that follow are 4-byte aligned.
+        class CacheHeader {
+        public:
+            Core::UInt32 magic;
+            Core::UInt32 version;
+            Core::UInt32 meshCount;
+            Core::UInt32 materialCount;
+            Core::UInt32 nodeCount;
+            Core::UInt32 vertexFormat;
+            Core::UInt64 totalVertexCount;
+            Core::UInt64 nodesOffset;
+        };
+
+        // one per mesh, right after the materials; dataOffset is from the start of the entry
+        class MeshRecord {
+        public:
+            Core::UInt32 vertexCount;
+            Core::UInt32 materialIndex;
+            Core::UInt32 indexCount;
+            Core::UInt32 padding;
+            Core::UInt64 dataOffset;
+            Core::Real boundsMin[3];
+            Core::Real boundsMax[3];
+        };
+
+        class NodeHeader {
+        public:
+            Core::Int32 parentIndex;
+            Core::UInt32 meshIndexCount;
+            Core::UInt32 nameLength;
+            Core::Real localMatrix[16];
+        };
+
+        // sizes stay 64-bit all the way to the file, so no section is limited to 2 GB
+        template <typename T>
+        bool write(QIODevice& file, const T* data, size_t count) {
+            qint64 byteCount = (qint64)(sizeof(T) * count);
+            return byteCount == 0 || file.write(reinterpret_cast<const char*>(data), byteCount) == byteCount;
+        }
+
+        // bounds-checked cursor over the mapped entry
+        class Reader {
+        public:
+            Reader(const uchar* data, qint64 size): data(data), size(size), offset(0) {}
+
+            template <typename T>
+            bool read(T* dest, size_t count) {
+                qint64 byteCount = (qint64)(sizeof(T) * count);
+                if (byteCount > this->size - this->offset) return false;
+                if (byteCount > 0) std::memcpy(dest, this->data + this->offset, byteCount);
+                this->offset += byteCount;
+                return true;
+            }
+
+            template <typename T>
+            bool read(std::vector<T>& dest, size_t count) {
+                dest.resize(count);
+                return this->read(dest.data(), count);
+            }
+
+            bool skip(qint64 byteCount) {
+                if (byteCount > this->size - this->offset) return false;
+                this->offset += byteCount;
+                return true;
+            }
+
+        private:
+            const uchar* data;
+            qint64 size;
+            qint64 offset;
+        };
+
+        Core::UInt32 paddedLength(Core::UInt32 length) {
+            return (length + 3) & ~3u;
+        }
+
+        void addSettings(QCryptographicHash& hash, Core::Real scale, Core::UInt32 smoothingThreshold, bool zUp, VertexFormat vertexFormat) {
+            Core::UInt32 version = ModelCache::FormatVersion;
+            Core::UInt32 zUpFlag = zUp ? 1 : 0;
+            Core::UInt32 format = (Core::UInt32)vertexFormat;
+            hash.addData(reinterpret_cast<const char*>(&version), sizeof(version));
+            hash.addData(reinterpret_cast<const char*>(&scale), sizeof(scale));
+            hash.addData(reinterpret_cast<const char*>(&smoothingThreshold), sizeof(smoothingThreshold));
+            hash.addData(reinterpret_cast<const char*>(&zUpFlag), sizeof(zUpFlag));
+            hash.addData(reinterpret_cast<const char*>(&format), sizeof(format));
+        }
+
+    }
+
+    ModelCache::StreamEntry::StreamEntry(): data(nullptr), size(0), vertexFormat(VertexFormat::Float), corrupt(false) {
+
+    }
+
+    // a mesh found corrupt while streaming only takes its entry with it once nothing reads it
+    ModelCache::StreamEntry::~StreamEntry() {
+        if (this->data) this->file.unmap(const_cast<uchar*>(this->data));
+        if (this->corrupt) ModelCache::discardEntry(this->file);
+    }
+
+    std::shared_ptr<ImportedModel> ModelCache::StreamEntry::getModel() const {
+        return this->model;
+    }
+
+    const BVHBounds& ModelCache::StreamEntry::getMeshBounds(Core::UInt32 meshIndex) const {
+        return this->meshBounds[meshIndex];
+    }
+
+    Core::UInt32 ModelCache::StreamEntry::getIndexCount(Core::UInt32 meshIndex) const {
+        return this->indexCounts[meshIndex];
+    }
+
+    bool ModelCache::StreamEntry::loadMesh(Core::UInt32 meshIndex, ImportedMesh& mesh) const {
+        if (meshIndex >= this->meshOffsets.size()) return false;
+
+        const ImportedMesh& source = this->model->meshes[meshIndex];
+        mesh.vertexCount = source.vertexCount;
+        mesh.materialIndex = source.materialIndex;
+        qint64 offset = (qint64)this->meshOffsets[meshIndex];
+        Reader reader(this->data + offset, this->size - offset);
+        size_t vertexCount = source.vertexCount;
+        bool valid = false;
+        if (this->vertexFormat == VertexFormat::Packed) {
+            PackedMesh packed;
+            valid = reader.read(packed.positions, vertexCount * 3) && reader.read(packed.normals, vertexCount) &&
+                    reader.read(packed.faceNormals, vertexCount) && reader.read(packed.colors, vertexCount);
+            if (valid) VertexPacking::unpack(packed, mesh);
+        }
+        else {
+            valid = reader.read(mesh.positions, vertexCount * 4) && reader.read(mesh.normals, vertexCount * 4) &&
+                    reader.read(mesh.faceNormals, vertexCount * 4) && reader.read(mesh.colors, vertexCount * 4);
+        }
+        valid = valid && reader.read(mesh.indices, this->indexCounts[meshIndex]);
+        for (Core::UInt32 i = 0; i < mesh.indices.size() && valid; i++) {
+            valid = mesh.indices[i] < source.vertexCount;
+        }
+        if (!valid) this->corrupt = true;
+        return valid;
+    }
+
+    ModelCache::ModelCache(): ModelCache(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/models") {
+
+    }
+
+    ModelCache::ModelCache(const QString& directory): directory(directory) {
+
+    }
+
+    QString ModelCache::computeKey(const std::string& path, Core::Real scale, Core::UInt32 smoothingThreshold, bool zUp, VertexFormat vertexFormat) const {
+        QFile file(QString::fromStdString(path));
+        if (!file.open(QIODevice::ReadOnly)) return QString();
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        if (!hash.addData(&file)) return QString();
+        addSettings(hash, scale, smoothingThreshold, zUp, vertexFormat);
+        return QString::fromLatin1(hash.result().toHex());
+    }
+
+    QString ModelCache::computeQuickKey(const std::string& path, Core::Real scale, Core::UInt32 smoothingThreshold, bool zUp, VertexFormat vertexFormat) const {
+        QFileInfo fileInfo(QString::fromStdString(path));
+        if (!fileInfo.isFile() || !fileInfo.isReadable()) return QString();
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(fileInfo.absoluteFilePath().toUtf8());
+        qint64 fileSize = fileInfo.size();
+        qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+        hash.addData(reinterpret_cast<const char*>(&fileSize), sizeof(fileSize));
+        hash.addData(reinterpret_cast<const char*>(&modified), sizeof(modified));
+        addSettings(hash, scale, smoothingThreshold, zUp, vertexFormat);
+        return QString::fromLatin1(hash.result().toHex());
+    }
+
+    std::shared_ptr<ImportedModel> ModelCache::load(const QString& key, const std::string& sourcePath) const {
+        std::shared_ptr<StreamEntry> entry = this->open(key, sourcePath);
+        if (!entry) return std::shared_ptr<ImportedModel>();
+
+        // a failed mesh marks the entry corrupt, and it is discarded as it goes out of scope
+        std::shared_ptr<ImportedModel> model = entry->getModel();
+        for (Core::UInt32 i = 0; i < model->meshes.size(); i++) {
+            if (!entry->loadMesh(i, model->meshes[i])) return std::shared_ptr<ImportedModel>();
+        }
+        return model;
+    }
+
+    std::shared_ptr<ModelCache::StreamEntry> ModelCache::open(const QString& key, const std::string& sourcePath) const {
+        if (key.isEmpty()) return std::shared_ptr<StreamEntry>();
+
+        std::shared_ptr<StreamEntry> entry(new StreamEntry());
+        entry->file.setFileName(this->getEntryPath(key));
+        if (!entry->file.open(QIODevice::ReadOnly)) return std::shared_ptr<StreamEntry>();
+
+        entry->size = entry->file.size();
+        entry->data = entry->file.map(0, entry->size);
+        if (!entry->data) return std::shared_ptr<StreamEntry>();
+
+        Reader reader(entry->data, entry->size);
+        std::shared_ptr<ImportedModel> model = std::make_shared<ImportedModel>();
+        model->sourcePath = sourcePath;
+        entry->model = model;
+
+        // counts are checked against what the file could hold before anything is sized by them
+        CacheHeader header;
+        bool valid = reader.read(&header, 1) && header.magic == CacheMagic && header.version == FormatVersion &&
+                     header.vertexFormat <= (Core::UInt32)VertexFormat::Packed &&
+                     (qint64)header.materialCount * (qint64)sizeof(Core::Real) * 4 <= entry->size &&
+                     (qint64)header.meshCount * (qint64)sizeof(MeshRecord) <= entry->size &&
+                     (qint64)header.nodeCount * (qint64)sizeof(NodeHeader) <= entry->size;
+        if (valid) {
+            entry->vertexFormat = (VertexFormat)header.vertexFormat;
+            model->totalVertexCount = header.totalVertexCount;
+            model->materials.resize(header.materialCount);
+            for (Core::UInt32 i = 0; i < header.materialCount && valid; i++) {
+                Core::Real color[4];
+                valid = reader.read(color, 4);
+                model->materials[i].diffuseColor = Core::Color(color[0], color[1], color[2], color[3]);
+            }
+        }
+        if (valid) {
+            model->meshes.resize(header.meshCount);
+            entry->meshOffsets.resize(header.meshCount);
+            entry->indexCounts.resize(header.meshCount);
+            entry->meshBounds.resize(header.meshCount);
+            for (Core::UInt32 i = 0; i < header.meshCount && valid; i++) {
+                MeshRecord record;
+                valid = reader.read(&record, 1) && record.dataOffset <= (Core::UInt64)entry->size &&
+                        record.materialIndex < header.materialCount;
+                if (!valid) break;
+                model->meshes[i].vertexCount = record.vertexCount;
+                model->meshes[i].materialIndex = record.materialIndex;
+                entry->meshOffsets[i] = record.dataOffset;
+                entry->indexCounts[i] = record.indexCount;
+                for (unsigned int axis = 0; axis < 3; axis++) {
+                    entry->meshBounds[i].min[axis] = record.boundsMin[axis];
+                    entry->meshBounds[i].max[axis] = record.boundsMax[axis];
+                }
+            }
+        }
+        if (valid) {
+            valid = header.nodesOffset <= (Core::UInt64)entry->size;
+        }
+        if (valid) {
+            Reader nodeReader(entry->data + header.nodesOffset, entry->size - (qint64)header.nodesOffset);
+            model->nodes.resize(header.nodeCount);
+            for (Core::UInt32 i = 0; i < header.nodeCount && valid; i++) {
+                ImportedNode& node = model->nodes[i];
+                NodeHeader nodeHeader;
+                valid = nodeReader.read(&nodeHeader, 1) && nodeHeader.parentIndex >= -1 && nodeHeader.parentIndex < (Core::Int32)i;
+                if (!valid) break;
+                node.parentIndex = nodeHeader.parentIndex;
+                std::memcpy(node.localMatrix, nodeHeader.localMatrix, sizeof(node.localMatrix));
+                std::vector<char> name;
+                valid = nodeReader.read(node.meshIndices, nodeHeader.meshIndexCount) && nodeReader.read(name, nodeHeader.nameLength) &&
+                        nodeReader.skip(paddedLength(nodeHeader.nameLength) - nodeHeader.nameLength);
+                node.name.assign(name.begin(), name.end());
+                for (Core::UInt32 meshIndex : node.meshIndices) {
+                    valid = valid && meshIndex < header.meshCount;
+                }
+            }
+            valid = valid && header.nodeCount > 0;
+        }
+
+        if (!valid) {
+            entry->corrupt = true;
+            return std::shared_ptr<StreamEntry>();
+        }
+        return entry;
+    }
+
+    bool ModelCache::store(const QString& key, const ImportedModel& model, VertexFormat vertexFormat) const {
+        return this->store(key, model, [&model](Core::UInt32 meshIndex, ImportedMesh&) -> const ImportedMesh& {
+            return model.meshes[meshIndex];
+        }, vertexFormat);
+    }
+
+    // Sections are written straight to the file as they are produced, so storing never holds
+    // more than one mesh and its packed copy. The mesh table is written with placeholders first
+    // and rewritten once the mesh data is in place.
+    bool ModelCache::store(const QString& key, const ImportedModel& model, MeshSource meshSource, VertexFormat vertexFormat) const {
+        if (key.isEmpty() || !QDir().mkpath(this->directory)) return false;
+
+        CacheHeader header;
+        header.magic = CacheMagic;
+        header.version = FormatVersion;
+        header.meshCount = (Core::UInt32)model.meshes.size();
+        header.materialCount = (Core::UInt32)model.materials.size();
+        header.nodeCount = (Core::UInt32)model.nodes.size();
+        header.vertexFormat = (Core::UInt32)vertexFormat;
+        header.totalVertexCount = model.totalVertexCount;
+        header.nodesOffset = 0;
+
+        MeshRecord emptyRecord;
+        std::memset(&emptyRecord, 0, sizeof(emptyRecord));
+        std::vector<MeshRecord> records(model.meshes.size(), emptyRecord);
+
+        // QSaveFile renames into place on commit, so concurrent loads never see a partial entry
+        QSaveFile file(this->getEntryPath(key));
+        bool written = file.open(QIODevice::WriteOnly) && write(file, &header, 1);
+        for (const ImportedMaterial& material : model.materials) {
+            Core::Real color[4] = {material.diffuseColor.r, material.diffuseColor.g, material.diffuseColor.b, material.diffuseColor.a};
+            written = written && write(file, color, 4);
+        }
+        qint64 recordsOffset = file.pos();
+        written = written && write(file, records.data(), records.size());
+
+        ImportedMesh scratch;
+        for (Core::UInt32 i = 0; i < model.meshes.size() && written; i++) {
+            const ImportedMesh& mesh = meshSource(i, scratch);
+            MeshRecord& record = records[i];
+            record.vertexCount = mesh.vertexCount;
+            record.materialIndex = mesh.materialIndex;
+            record.indexCount = (Core::UInt32)mesh.indices.size();
+            record.dataOffset = (Core::UInt64)file.pos();
+            BVHBounds bounds;
+            for (Core::UInt32 v = 0; v < mesh.vertexCount; v++) bounds.grow(&mesh.positions[v * 4]);
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                record.boundsMin[axis] = bounds.min[axis];
+                record.boundsMax[axis] = bounds.max[axis];
+            }
+            if (vertexFormat == VertexFormat::Packed) {
+                PackedMesh packed;
+                VertexPacking::pack(mesh, packed);
+                written = write(file, packed.positions.data(), packed.positions.size()) &&
+                          write(file, packed.normals.data(), packed.normals.size()) &&
+                          write(file, packed.faceNormals.data(), packed.faceNormals.size()) &&
+                          write(file, packed.colors.data(), packed.colors.size());
+            }
+            else {
+                written = write(file, mesh.positions.data(), mesh.positions.size()) && write(file, mesh.normals.data(), mesh.normals.size()) &&
+                          write(file, mesh.faceNormals.data(), mesh.faceNormals.size()) && write(file, mesh.colors.data(), mesh.colors.size());
+            }
+            written = written && write(file, mesh.indices.data(), mesh.indices.size());
+        }
+
+        header.nodesOffset = (Core::UInt64)file.pos();
+        static const char namePadding[4] = {0, 0, 0, 0};
+        for (const ImportedNode& node : model.nodes) {
+            if (!written) break;
+            NodeHeader nodeHeader;
+            nodeHeader.parentIndex = node.parentIndex;
+            nodeHeader.meshIndexCount = (Core::UInt32)node.meshIndices.size();
+            nodeHeader.nameLength = (Core::UInt32)node.name.size();
+            std::memcpy(nodeHeader.localMatrix, node.localMatrix, sizeof(nodeHeader.localMatrix));
+            written = write(file, &nodeHeader, 1) && write(file, node.meshIndices.data(), node.meshIndices.size()) &&
+                      write(file, node.name.data(), node.name.size()) &&
+                      write(file, namePadding, paddedLength(nodeHeader.nameLength) - nodeHeader.nameLength);
+        }
+
+        written = written && file.seek(0) && write(file, &header, 1) &&
+                  file.seek(recordsOffset) && write(file, records.data(), records.size());
+        if (!written || !file.commit()) {
+            qDebug() << "Unable to write model cache entry: " << file.fileName();
+            return false;
+        }
+        return true;
+    }
+
+    const QString& ModelCache::getDirectory() const {
+        return this->directory;
+    }
+
+    QString ModelCache::getEntryPath(const QString& key) const {
+        return this->directory + "/" + key + ".qmc";
+    }
+
+    void ModelCache::discardEntry(QFile& file) {
+        qDebug() << "Discarding corrupt model cache entry: " << file.fileName();
+        file.close();
+        file.remove();
+    }
+
+}
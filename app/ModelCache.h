@@ -0,0 +1,93 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <QString>
+#include <QFile>
+
+#include "ImportedModel.h"
+#include "VertexPacking.h"
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // On-disk cache of processed imports. Entries are keyed by a hash of the source
+    // file's contents plus every import setting that changes the processed data, and
+    // store the ImportedModel in a flat binary layout that is read back through a
+    // memory mapping, so a warm load never touches Assimp.
+    //
+    // Picking BVHs are not stored; they are rebuilt from the cached positions.
+    // Entries written with VertexFormat::Packed hold packed vertex streams and are
+    // decoded on load, so they take a little over a third of the space.
+    //
+    // A table of mesh offsets and bounds follows the materials, so an entry can also
+    // be opened for streaming and its meshes read one at a time.
+    class ModelCache {
+    public:
+        static const Core::UInt32 FormatVersion = 5;
+
+        // An entry opened for random access. The materials, hierarchy and mesh bounds are
+        // read when it is opened; mesh data only by loadMesh(), straight from the mapping,
+        // so the memory it takes doesn't grow with the size of the file.
+        class StreamEntry {
+        public:
+            ~StreamEntry();
+
+            // the model without geometry: its meshes only have vertexCount and materialIndex
+            std::shared_ptr<ImportedModel> getModel() const;
+            const BVHBounds& getMeshBounds(Core::UInt32 meshIndex) const;
+            Core::UInt32 getIndexCount(Core::UInt32 meshIndex) const;
+            // thread-safe; the mesh comes back with float attributes. Data that doesn't check out
+            // (truncated, or indices past the vertices) fails the load, and the entry is
+            // deleted once it is let go of.
+            bool loadMesh(Core::UInt32 meshIndex, ImportedMesh& mesh) const;
+
+        private:
+            friend class ModelCache;
+            StreamEntry();
+
+            QFile file;
+            const uchar* data;
+            qint64 size;
+            VertexFormat vertexFormat;
+            std::shared_ptr<ImportedModel> model;
+            std::vector<Core::UInt64> meshOffsets;
+            std::vector<Core::UInt32> indexCounts;
+            std::vector<BVHBounds> meshBounds;
+            mutable std::atomic<bool> corrupt;
+        };
+
+        // hands out one mesh at a time for storing: either a mesh that outlives the call or
+        // scratch filled with it, which is overwritten by the next call
+        typedef std::function<const ImportedMesh&(Core::UInt32 meshIndex, ImportedMesh& scratch)> MeshSource;
+
+        ModelCache();
+        explicit ModelCache(const QString& directory);
+
+        // an empty key means the source file could not be read
+        QString computeKey(const std::string& path, Core::Real scale, Core::UInt32 smoothingThreshold, bool zUp, VertexFormat vertexFormat) const;
+        // keyed by the file's path, size and modification time instead of its contents, which
+        // would take longer to hash than a streamed load may take to show up
+        QString computeQuickKey(const std::string& path, Core::Real scale, Core::UInt32 smoothingThreshold, bool zUp, VertexFormat vertexFormat) const;
+        std::shared_ptr<ImportedModel> load(const QString& key, const std::string& sourcePath) const;
+        std::shared_ptr<StreamEntry> open(const QString& key, const std::string& sourcePath) const;
+        bool store(const QString& key, const ImportedModel& model, VertexFormat vertexFormat) const;
+        // model supplies the materials, the hierarchy and the mesh count, meshSource the geometry,
+        // so a model never has to be held in memory as a whole to be stored
+        bool store(const QString& key, const ImportedModel& model, MeshSource meshSource, VertexFormat vertexFormat) const;
+
+        const QString& getDirectory() const;
+
+    private:
+        QString getEntryPath(const QString& key) const;
+        static void discardEntry(QFile& file);
+
+        QString directory;
+    };
+
+}
@@ -0,0 +1,800 @@
+#include <algorithm>
+#include <cstring>
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <assimp/config.h>
+
+#include "ModelImporter.h"
+#include "Profiler.h"
+#include "MeshBatcher.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "SimdKernels.h"
+
+#include "Core/asset/ModelLoader.h"
+#include "Core/geometry/Mesh.h"
+#include "Core/material/StandardAttributes.h"
+#include "Core/render/RenderableContainer.h"
+#include "Core/render/MeshRenderer.h"
+#include "Core/math/Matrix4x4.h"
+#include "Core/scene/Transform.h"
+
+using MeshContainer = Core::RenderableContainer<Core::Mesh>;
+
+namespace Modeler {
+
+    namespace {
+
+        void copyAssimpMatrix(const aiMatrix4x4& src, Core::Real* dest) {
+            // Assimp matrices are row-major, the engine's are column-major
+            dest[0] = src.a1; dest[4] = src.a2; dest[8] = src.a3;  dest[12] = src.a4;
+            dest[1] = src.b1; dest[5] = src.b2; dest[9] = src.b3;  dest[13] = src.b4;
+            dest[2] = src.c1; dest[6] = src.c2; dest[10] = src.c3; dest[14] = src.c4;
+            dest[3] = src.d1; dest[7] = src.d2; dest[11] = src.d3; dest[15] = src.d4;
+        }
+
+        void flattenNodes(const aiNode* node, Core::Int32 parentIndex, std::vector<ImportedNode>& nodes) {
+            Core::Int32 nodeIndex = (Core::Int32)nodes.size();
+            nodes.push_back(ImportedNode());
+            ImportedNode& importedNode = nodes.back();
+            importedNode.name = node->mName.C_Str();
+            importedNode.parentIndex = parentIndex;
+            copyAssimpMatrix(node->mTransformation, importedNode.localMatrix);
+            for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+                importedNode.meshIndices.push_back(node->mMeshes[i]);
+            }
+            for (unsigned int i = 0; i < node->mNumChildren; i++) {
+                flattenNodes(node->mChildren[i], nodeIndex, nodes);
+            }
+        }
+
+        void convertMesh(const aiMesh* srcMesh, const ImportedMaterial& material, ImportedMesh& mesh) {
+            mesh.vertexCount = srcMesh->mNumVertices;
+            mesh.positions.resize(mesh.vertexCount * 4);
+            mesh.normals.resize(mesh.vertexCount * 4);
+            mesh.faceNormals.resize(mesh.vertexCount * 4, 0.0f);
+            mesh.colors.resize(mesh.vertexCount * 4);
+
+            const Core::Color& diffuse = material.diffuseColor;
+            for (unsigned int v = 0; v < srcMesh->mNumVertices; v++) {
+                const aiVector3D& position = srcMesh->mVertices[v];
+                mesh.positions[v * 4] = position.x;
+                mesh.positions[v * 4 + 1] = position.y;
+                mesh.positions[v * 4 + 2] = position.z;
+                mesh.positions[v * 4 + 3] = 1.0f;
+
+                if (srcMesh->HasNormals()) {
+                    const aiVector3D& normal = srcMesh->mNormals[v];
+                    mesh.normals[v * 4] = normal.x;
+                    mesh.normals[v * 4 + 1] = normal.y;
+                    mesh.normals[v * 4 + 2] = normal.z;
+                }
+                mesh.normals[v * 4 + 3] = 0.0f;
+
+                Core::Color color = diffuse;
+                if (srcMesh->HasVertexColors(0)) {
+                    const aiColor4D& vertexColor = srcMesh->mColors[0][v];
+                    color = Core::Color(color.r * vertexColor.r, color.g * vertexColor.g, color.b * vertexColor.b, color.a * vertexColor.a);
+                }
+                mesh.colors[v * 4] = color.r;
+                mesh.colors[v * 4 + 1] = color.g;
+                mesh.colors[v * 4 + 2] = color.b;
+                mesh.colors[v * 4 + 3] = color.a;
+            }
+
+            mesh.indices.reserve(srcMesh->mNumFaces * 3);
+            for (unsigned int f = 0; f < srcMesh->mNumFaces; f++) {
+                const aiFace& face = srcMesh->mFaces[f];
+                if (face.mNumIndices != 3) continue;
+                Core::UInt32 a = face.mIndices[0], b = face.mIndices[1], c = face.mIndices[2];
+                mesh.indices.push_back(a);
+                mesh.indices.push_back(b);
+                mesh.indices.push_back(c);
+
+                // face normals are only used for shadow biasing, so shared vertices
+                // simply keep the normal of the last face that references them
+                aiVector3D faceNormal = (srcMesh->mVertices[b] - srcMesh->mVertices[a]) ^ (srcMesh->mVertices[c] - srcMesh->mVertices[a]);
+                faceNormal.NormalizeSafe();
+                for (Core::UInt32 index : {a, b, c}) {
+                    mesh.faceNormals[index * 4] = faceNormal.x;
+                    mesh.faceNormals[index * 4 + 1] = faceNormal.y;
+                    mesh.faceNormals[index * 4 + 2] = faceNormal.z;
+                }
+            }
+        }
+
+        Core::UInt64 getMeshBytes(const ImportedMesh& mesh) {
+            Core::UInt64 bytes = (mesh.positions.size() + mesh.normals.size() + mesh.faceNormals.size() + mesh.colors.size()) * sizeof(Core::Real) +
+                                 mesh.indices.size() * sizeof(Core::UInt32);
+            if (mesh.packed) {
+                const PackedMesh& packed = *mesh.packed;
+                bytes += packed.positions.size() * sizeof(Core::Real);
+                bytes += (packed.normals.size() + packed.faceNormals.size() + packed.colors.size()) * sizeof(Core::UInt32);
+            }
+            return bytes;
+        }
+
+        // what a parsed model holds until it's uploaded
+        Core::UInt64 getParsedBytes(const ImportedModel& model) {
+            Core::UInt64 bytes = 0;
+            for (const ImportedMesh& mesh : model.meshes) bytes += getMeshBytes(mesh);
+            for (const ImportedMesh& mesh : model.batches) bytes += getMeshBytes(mesh);
+            return bytes;
+        }
+
+        Core::UInt32 countTexturedMaterials(const ImportedModel& model) {
+            Core::UInt32 count = 0;
+            for (const ImportedMaterial& material : model.materials) {
+                if (material.diffuseTexture.size() > 0) count++;
+            }
+            return count;
+        }
+
+        // LODs are only built for childless nodes, which is what the visibility culler can switch
+        std::vector<bool> findLodNodes(const ImportedModel& model) {
+            std::vector<bool> lodNodes(model.nodes.size(), true);
+            for (Core::UInt32 n = 0; n < model.nodes.size(); n++) {
+                const ImportedNode& node = model.nodes[n];
+                if (node.parentIndex < 0 || node.meshIndices.size() == 0) lodNodes[n] = false;
+                if (node.parentIndex >= 0) lodNodes[node.parentIndex] = false;
+            }
+            return lodNodes;
+        }
+
+    }
+
+    ModelImporter::ModelImporter(Core::WeakPointer<Core::Engine> engine, std::shared_ptr<JobSystem> jobSystem):
+        engine(engine), jobSystem(jobSystem), outstandingJobs(0), parsesInFlight(0), parsedBytes(0) {
+
+    }
+
+    ModelImporter::~ModelImporter() {
+        QMutexLocker ml(&this->incomingMutex);
+        this->queued.clear();
+        while (this->outstandingJobs > 0) {
+            this->jobsDone.wait(&this->incomingMutex);
+        }
+    }
+
+    void ModelImporter::importModel(const ImportSettings& settings, CommitCallback onCommit, LodCallback onLodsReady) {
+        std::shared_ptr<PendingImport> pending = std::make_shared<PendingImport>();
+        pending->settings = settings;
+        pending->onCommit = onCommit;
+        pending->onLodsReady = onLodsReady;
+        this->queueImport(pending);
+    }
+
+    void ModelImporter::importModels(const std::vector<ImportSettings>& settings, CommitCallback onCommit, LodCallback onLodsReady, BatchCallback onFinished) {
+        if (settings.size() == 0) return;
+
+        std::shared_ptr<ImportBatch> batch = std::make_shared<ImportBatch>();
+        batch->count = (Core::UInt32)settings.size();
+        batch->onFinished = onFinished;
+        batch->parseFailed.resize(settings.size(), false);
+        batch->timer.start();
+        {
+            QMutexLocker ml(&this->incomingMutex);
+            this->batches.push_back(batch);
+        }
+
+        for (Core::UInt32 i = 0; i < settings.size(); i++) {
+            std::shared_ptr<PendingImport> pending = std::make_shared<PendingImport>();
+            pending->settings = settings[i];
+            pending->onCommit = onCommit;
+            pending->onLodsReady = onLodsReady;
+            pending->batch = batch;
+            pending->batchIndex = i;
+            this->queueImport(pending);
+        }
+    }
+
+    void ModelImporter::queueImport(std::shared_ptr<PendingImport> pending) {
+        emit importProgress(QString::fromStdString(pending->settings.path), 0.0);
+        QMutexLocker ml(&this->incomingMutex);
+        this->queued.push_back(pending);
+        this->dispatchImports();
+    }
+
+    // incomingMutex must be held
+    void ModelImporter::dispatchImports() {
+        // one parse per worker: Assimp is single-threaded, so more would only add memory
+        Core::UInt32 maxParses = std::max(this->jobSystem->getWorkerCount(), 1u);
+        while (this->queued.size() > 0 && this->parsesInFlight < maxParses && this->parsedBytes < ParsedMemoryBudget) {
+            std::shared_ptr<PendingImport> pending = this->queued.front();
+            this->queued.pop_front();
+            this->parsesInFlight++;
+            this->outstandingJobs++;
+            this->jobSystem->submit([this, pending]() {
+                this->runImport(pending);
+            });
+        }
+    }
+
+    void ModelImporter::runImport(std::shared_ptr<PendingImport> pending) {
+        if (pending->settings.streaming) {
+            bool textured = false;
+            pending->stream = this->openModelStream(pending->settings, textured);
+            // textured models are imported whole instead (see the class comment)
+            if (textured) pending->settings.streaming = false;
+        }
+        if (pending->settings.streaming) {
+            if (pending->stream) pending->model = pending->stream->getModel();
+            pending->stage = UploadStage::Nodes;
+        }
+        else {
+            pending->model = this->loadModelData(pending->settings);
+            if (pending->model && pending->model->drawnByModelLoader) pending->stage = UploadStage::Nodes;
+        }
+        if (pending->model) pending->parsedBytes = getParsedBytes(*pending->model);
+        QString path = QString::fromStdString(pending->settings.path);
+
+        QMutexLocker ml(&this->incomingMutex);
+        this->parsesInFlight--;
+        if (pending->model) {
+            this->parsedBytes += pending->parsedBytes;
+            this->incoming.push_back(pending);
+            emit importProgress(path, 0.5);
+        }
+        else {
+            if (pending->batch) pending->batch->parseFailed[pending->batchIndex] = true;
+            emit importFinished(path, false);
+        }
+        this->dispatchImports();
+        this->outstandingJobs--;
+        this->jobsDone.wakeAll();
+        if (this->requestFrame) this->requestFrame();
+    }
+
+    bool ModelImporter::isReadyToCommit(const PendingImport& pending) const {
+        return !pending.batch || pending.batchIndex == pending.batch->nextCommit;
+    }
+
+    // steps every batch past the models that failed to parse and reports the batches that are done
+    void ModelImporter::finishBatches() {
+        std::vector<std::shared_ptr<ImportBatch>> finished;
+        {
+            QMutexLocker ml(&this->incomingMutex);
+            for (auto batch = this->batches.begin(); batch != this->batches.end();) {
+                ImportBatch& importBatch = **batch;
+                while (importBatch.nextCommit < importBatch.count && importBatch.parseFailed[importBatch.nextCommit]) {
+                    importBatch.nextCommit++;
+                    importBatch.failed++;
+                }
+                if (importBatch.nextCommit >= importBatch.count) {
+                    finished.push_back(*batch);
+                    batch = this->batches.erase(batch);
+                }
+                else {
+                    ++batch;
+                }
+            }
+        }
+
+        for (std::shared_ptr<ImportBatch> batch : finished) {
+            qint64 elapsed = batch->timer.elapsed();
+            qDebug() << "Imported a batch of" << batch->count << "models in" << elapsed << "ms," << batch->failed << "failed";
+            if (batch->onFinished) batch->onFinished(batch->succeeded, batch->failed, elapsed);
+        }
+    }
+
+    void ModelImporter::setFrameRequestCallback(FrameRequestCallback callback) {
+        this->requestFrame = callback;
+    }
+
+    std::shared_ptr<ImportedModel> ModelImporter::loadModelData(const ImportSettings& settings) {
+        ProfileScope scope("ModelImporter::loadModelData");
+        QElapsedTimer timer;
+        timer.start();
+
+        QString cacheKey = this->modelCache.computeKey(settings.path, settings.scale, settings.smoothingThreshold, settings.zUp, settings.vertexFormat);
+        std::shared_ptr<ImportedModel> model = this->modelCache.load(cacheKey, settings.path);
+        bool cached = model != nullptr;
+        if (!cached) {
+            model = ModelImporter::parseModel(settings);
+            if (!model) return model;
+            Core::UInt32 texturedMaterials = countTexturedMaterials(*model);
+            if (texturedMaterials > 0) {
+                qDebug() << "ModelImporter:" << texturedMaterials << "materials in" << settings.path.c_str()
+                         << "are textured, so it is drawn through Core's ModelLoader and not cached";
+                emit importNotice(QString::fromStdString(settings.path), tr("Textured model: loading it the slow way to keep its textures"));
+                ModelImporter::prepareModelLoaderFallback(*model, settings.boundsOnlyPicking);
+                return model;
+            }
+            // cold and warm loads must produce the same data, so snap to the packed precision up front
+            if (settings.vertexFormat == VertexFormat::Packed) {
+                for (ImportedMesh& mesh : model->meshes) VertexPacking::quantize(mesh);
+            }
+            this->modelCache.store(cacheKey, *model, settings.vertexFormat);
+        }
+        qint64 loadTime = timer.elapsed();
+
+        MeshBatcher::batchRepeatedMeshes(*model);
+        if (settings.optimizeMeshes) {
+            ProfileScope optimizeScope("ModelImporter::optimizeMeshes");
+            MeshOptimizer::Stats stats;
+            for (ImportedMesh& mesh : model->meshes) stats.add(MeshOptimizer::optimize(mesh));
+            for (ImportedMesh& mesh : model->batches) stats.add(MeshOptimizer::optimize(mesh));
+            model->totalVertexCount -= stats.verticesBefore - stats.verticesAfter;
+            qDebug() << "Optimized" << settings.path.c_str() << "- ACMR:" << stats.getAcmrBefore() << "->" << stats.getAcmrAfter()
+                     << ", vertices:" << stats.verticesBefore << "->" << stats.verticesAfter;
+        }
+        qint64 prepareTime = timer.elapsed() - loadTime;
+
+        for (const ImportedMesh& mesh : model->meshes) {
+            if (settings.boundsOnlyPicking) {
+                Core::UInt32 triangleCount = mesh.indices.size() > 0 ? (Core::UInt32)mesh.indices.size() / 3 : mesh.vertexCount / 3;
+                model->meshBVHs.push_back(std::make_shared<MeshBVH>(mesh.positions.data(), 4, mesh.vertexCount, triangleCount));
+            } else {
+                model->meshBVHs.push_back(std::make_shared<MeshBVH>(mesh.positions.data(), 4, mesh.vertexCount,
+                                                                    mesh.indices.data(), (Core::UInt32)mesh.indices.size()));
+            }
+        }
+
+        // nothing on the worker needs the float attributes anymore; uploads and LOD jobs decode on demand
+        if (settings.vertexFormat == VertexFormat::Packed) {
+            for (ImportedMesh& mesh : model->meshes) VertexPacking::compact(mesh);
+            for (ImportedMesh& mesh : model->batches) VertexPacking::compact(mesh);
+        }
+
+        qDebug() << "Loaded" << settings.path.c_str() << (cached ? "from cache (warm):" : "from source (cold):") << loadTime << "ms,"
+                 << "batching/optimizing:" << prepareTime << "ms, picking BVHs:" << timer.elapsed() - loadTime - prepareTime << "ms";
+        return model;
+    }
+
+    std::shared_ptr<ModelCache::StreamEntry> ModelImporter::openModelStream(const ImportSettings& settings, bool& textured) {
+        ProfileScope scope("ModelImporter::openModelStream");
+        QElapsedTimer timer;
+        timer.start();
+
+        QString cacheKey = this->modelCache.computeQuickKey(settings.path, settings.scale, settings.smoothingThreshold, settings.zUp, settings.vertexFormat);
+        std::shared_ptr<ModelCache::StreamEntry> stream = this->modelCache.open(cacheKey, settings.path);
+        bool cached = stream != nullptr;
+        if (!cached) {
+            // Assimp can't read the source formats piecemeal, so the first streamed load of a file
+            // still parses all of it, and the Assimp scene has to fit in memory. Its meshes are then
+            // converted and written to a cache entry one at a time, and streaming reads from that.
+            qDebug() << "Streaming" << settings.path.c_str() << "for the first time: the whole file is parsed into memory once"
+                     << "to build its cache entry";
+            emit importNotice(QString::fromStdString(settings.path), tr("First streamed load: reading the whole file once"));
+            Assimp::Importer importer;
+            const aiScene* scene = ModelImporter::readScene(importer, settings);
+            if (!scene) return stream;
+            std::shared_ptr<ImportedModel> layout = ModelImporter::readModelLayout(scene, settings);
+            textured = countTexturedMaterials(*layout) > 0;
+            if (textured) {
+                qDebug() << "ModelImporter: streaming isn't available for" << settings.path.c_str() << "since it is textured";
+                return stream;
+            }
+            auto convertSceneMesh = [scene, &layout, &settings](Core::UInt32 meshIndex, ImportedMesh& scratch) -> const ImportedMesh& {
+                scratch = layout->meshes[meshIndex];
+                convertMesh(scene->mMeshes[meshIndex], layout->materials[scratch.materialIndex], scratch);
+                if (settings.vertexFormat == VertexFormat::Packed) VertexPacking::quantize(scratch);
+                return scratch;
+            };
+            if (!this->modelCache.store(cacheKey, *layout, convertSceneMesh, settings.vertexFormat)) return stream;
+            importer.FreeScene();
+            stream = this->modelCache.open(cacheKey, settings.path);
+            if (!stream) return stream;
+        }
+
+        // picking and culling get the bounds up front, the triangles never leave the cache
+        ImportedModel& model = *stream->getModel();
+        for (Core::UInt32 i = 0; i < model.meshes.size(); i++) {
+            const BVHBounds& bounds = stream->getMeshBounds(i);
+            Core::Real corners[8] = {bounds.min[0], bounds.min[1], bounds.min[2], 1.0f, bounds.max[0], bounds.max[1], bounds.max[2], 1.0f};
+            model.meshBVHs.push_back(std::make_shared<MeshBVH>(corners, 4, bounds.isEmpty() ? 0 : 2, stream->getIndexCount(i) / 3));
+        }
+
+        qDebug() << "Opened" << settings.path.c_str() << "for streaming" << (cached ? "(warm):" : "(cold):") << timer.elapsed() << "ms,"
+                 << model.nodes.size() << "nodes," << model.meshes.size() << "meshes";
+        return stream;
+    }
+
+    std::shared_ptr<ImportedModel> ModelImporter::parseModel(const ImportSettings& settings) {
+        ProfileScope scope("ModelImporter::parseModel");
+        Assimp::Importer importer;
+        const aiScene* scene = ModelImporter::readScene(importer, settings);
+        if (!scene) return std::shared_ptr<ImportedModel>();
+
+        std::shared_ptr<ImportedModel> model = ModelImporter::readModelLayout(scene, settings);
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            convertMesh(scene->mMeshes[i], model->materials[model->meshes[i].materialIndex], model->meshes[i]);
+        }
+        return model;
+    }
+
+    const aiScene* ModelImporter::readScene(Assimp::Importer& importer, const ImportSettings& settings) {
+        // normals are always regenerated so the smoothing threshold applies uniformly
+        importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, aiComponent_NORMALS);
+        importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, (float)settings.smoothingThreshold);
+        importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+
+        const aiScene* scene = importer.ReadFile(settings.path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices |
+                                                 aiProcess_RemoveComponent | aiProcess_GenSmoothNormals | aiProcess_SortByPType);
+        if (!scene || !scene->mRootNode || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)) {
+            qDebug() << "Unable to import model (" << settings.path.c_str() << "): " << importer.GetErrorString();
+            return nullptr;
+        }
+        return scene;
+    }
+
+    std::shared_ptr<ImportedModel> ModelImporter::readModelLayout(const aiScene* scene, const ImportSettings& settings) {
+        std::shared_ptr<ImportedModel> model = std::make_shared<ImportedModel>();
+        model->sourcePath = settings.path;
+
+        model->materials.resize(scene->mNumMaterials);
+        for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+            aiColor4D diffuse;
+            if (scene->mMaterials[i]->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse) == AI_SUCCESS) {
+                model->materials[i].diffuseColor = Core::Color(diffuse.r, diffuse.g, diffuse.b, diffuse.a);
+            }
+            aiString texturePath;
+            if (scene->mMaterials[i]->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS) {
+                model->materials[i].diffuseTexture = texturePath.C_Str();
+            }
+        }
+
+        // meshes pointing past the materials get a default one appended for them
+        Core::UInt32 defaultMaterialIndex = (Core::UInt32)model->materials.size();
+        model->meshes.resize(scene->mNumMeshes);
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            const aiMesh* srcMesh = scene->mMeshes[i];
+            model->meshes[i].vertexCount = srcMesh->mNumVertices;
+            model->meshes[i].materialIndex = srcMesh->mMaterialIndex < defaultMaterialIndex ? srcMesh->mMaterialIndex : defaultMaterialIndex;
+            model->totalVertexCount += srcMesh->mNumVertices;
+        }
+        if (std::any_of(model->meshes.begin(), model->meshes.end(),
+                        [defaultMaterialIndex](const ImportedMesh& mesh) { return mesh.materialIndex == defaultMaterialIndex; })) {
+            model->materials.push_back(ImportedMaterial());
+        }
+
+        flattenNodes(scene->mRootNode, -1, model->nodes);
+
+        // apply the import scale to the root so the whole hierarchy picks it up
+        Core::Real* rootMatrix = model->nodes[0].localMatrix;
+        for (unsigned int column = 0; column < 4; column++) {
+            for (unsigned int row = 0; row < 3; row++) {
+                rootMatrix[column * 4 + row] *= settings.scale;
+            }
+        }
+
+        return model;
+    }
+
+    // Core's ModelLoader builds its own hierarchy, which the import can't map its nodes onto, so
+    // the model is reduced to one node that ModelLoader's root is parented to. Every mesh instance
+    // becomes a picking BVH in that node's space.
+    void ModelImporter::prepareModelLoaderFallback(ImportedModel& model, bool boundsOnlyPicking) {
+        std::vector<Core::Real> modelMatrices(model.nodes.size() * 16);
+        std::memcpy(&modelMatrices[0], model.nodes[0].localMatrix, sizeof(model.nodes[0].localMatrix));
+        for (Core::UInt32 i = 1; i < model.nodes.size(); i++) {
+            const ImportedNode& node = model.nodes[i];
+            SimdKernels::multiplyMatrices(&modelMatrices[node.parentIndex * 16], node.localMatrix, &modelMatrices[i * 16]);
+        }
+
+        ImportedNode root;
+        root.name = model.nodes[0].name;
+        for (unsigned int i = 0; i < 16; i++) root.localMatrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+        std::vector<Core::Real> positions;
+        for (Core::UInt32 n = 0; n < model.nodes.size(); n++) {
+            for (Core::UInt32 meshIndex : model.nodes[n].meshIndices) {
+                const ImportedMesh& mesh = model.meshes[meshIndex];
+                positions.resize(mesh.positions.size());
+                SimdKernels::transformPoints(&modelMatrices[n * 16], mesh.positions.data(), mesh.vertexCount, positions.data());
+                if (boundsOnlyPicking) {
+                    model.meshBVHs.push_back(std::make_shared<MeshBVH>(positions.data(), 4, mesh.vertexCount, (Core::UInt32)mesh.indices.size() / 3));
+                } else {
+                    model.meshBVHs.push_back(std::make_shared<MeshBVH>(positions.data(), 4, mesh.vertexCount,
+                                                                       mesh.indices.data(), (Core::UInt32)mesh.indices.size()));
+                }
+                root.meshIndices.push_back((Core::UInt32)root.meshIndices.size());
+            }
+        }
+
+        model.meshes.assign(root.meshIndices.size(), ImportedMesh());
+        model.nodes.assign(1, root);
+        model.totalVertexCount = 0;
+        model.drawnByModelLoader = true;
+    }
+
+    void ModelImporter::processUploads() {
+        {
+            QMutexLocker ml(&this->incomingMutex);
+            if (this->incoming.size() > 0) {
+                this->active.insert(this->active.end(), this->incoming.begin(), this->incoming.end());
+                this->incoming.clear();
+            }
+            if (this->incomingLods.size() > 0) {
+                this->activeLods.insert(this->activeLods.end(), this->incomingLods.begin(), this->incomingLods.end());
+                this->incomingLods.clear();
+            }
+        }
+        this->finishBatches();
+        if (this->active.size() == 0 && this->activeLods.size() == 0) return;
+
+        Core::UInt32 vertexBudget = UploadVertexBudgetPerFrame;
+        Core::UInt32 nodeBudget = NodeBudgetPerFrame;
+
+        if (!this->material) {
+            this->material = this->engine->createMaterial<Core::BasicLitMaterial>();
+            this->material->build();
+        }
+
+        // imports are finished one at a time in the order they were parsed, except that batch
+        // members wait for the ones requested before them
+        auto isReady = [this](const std::shared_ptr<PendingImport>& pending) { return this->isReadyToCommit(*pending); };
+        while (vertexBudget > 0 && nodeBudget > 0) {
+            auto next = std::find_if(this->active.begin(), this->active.end(), isReady);
+            if (next == this->active.end()) break;
+            PendingImport& pending = **next;
+            ImportedModel& model = *pending.model;
+
+            if (pending.stage == UploadStage::Meshes) {
+                // at least one mesh is uploaded per frame, even if it exceeds the budget on its own;
+                // batches are uploaded after the regular meshes
+                Core::UInt32 totalMeshCount = (Core::UInt32)(model.meshes.size() + model.batches.size());
+                while (pending.nextMesh < totalMeshCount && vertexBudget > 0) {
+                    bool isBatch = pending.nextMesh >= model.meshes.size();
+                    const ImportedMesh& importedMesh = isBatch ? model.batches[pending.nextMesh - model.meshes.size()] : model.meshes[pending.nextMesh];
+                    if (isBatch) pending.batchMeshes.push_back(ModelImporter::uploadMesh(this->engine, importedMesh));
+                    else pending.meshes.push_back(ModelImporter::uploadMesh(this->engine, importedMesh));
+                    pending.uploadedVertexCount += importedMesh.vertexCount;
+                    vertexBudget = importedMesh.vertexCount >= vertexBudget ? 0 : vertexBudget - importedMesh.vertexCount;
+                    pending.nextMesh++;
+                }
+                if (pending.nextMesh >= totalMeshCount) {
+                    pending.stage = UploadStage::Nodes;
+                }
+            }
+            else if (pending.stage == UploadStage::Nodes) {
+                while (pending.nextNode < model.nodes.size() && nodeBudget > 0) {
+                    pending.nodeObjects.push_back(this->buildNode(pending, model.nodes[pending.nextNode]));
+                    pending.nextNode++;
+                    nodeBudget--;
+                }
+                if (pending.nextNode >= model.nodes.size()) {
+                    // blocks the frame for the whole load, as every import did before this pipeline
+                    if (model.drawnByModelLoader) {
+                        ProfileScope loaderScope("ModelImporter::loadThroughModelLoader");
+                        Core::WeakPointer<Core::Object3D> loadedRoot = this->engine->getModelLoader().loadModel(pending.settings.path, pending.settings.scale,
+                                                                                                               pending.settings.smoothingThreshold, false, false, true);
+                        if (loadedRoot) pending.nodeObjects[0]->addChild(loadedRoot);
+                    }
+                    std::vector<Core::WeakPointer<Core::Object3D>> batchObjects;
+                    for (Core::WeakPointer<Core::Mesh> batchMesh : pending.batchMeshes) {
+                        Core::WeakPointer<MeshContainer> batchContainer(this->engine->createObject3D<MeshContainer>());
+                        this->engine->createRenderer<Core::MeshRenderer>(this->material, batchContainer);
+                        batchContainer->addRenderable(batchMesh);
+                        pending.nodeObjects[0]->addChild(batchContainer);
+                        batchObjects.push_back(batchContainer);
+                    }
+                    if (pending.onCommit) {
+                        ImportResult result;
+                        result.rootObject = pending.nodeObjects[0];
+                        result.model = pending.model;
+                        result.meshes = pending.meshes;
+                        result.nodeObjects = pending.nodeObjects;
+                        result.batchObjects = batchObjects;
+                        result.material = this->material;
+                        result.stream = pending.stream;
+                        pending.onCommit(result);
+                    }
+                    if (pending.settings.generateLods && pending.onLodsReady && !pending.stream && !model.drawnByModelLoader) {
+                        this->generateLods(pending);
+                    }
+                    emit importFinished(QString::fromStdString(pending.settings.path), true);
+
+                    // the parsed geometry is on the GPU now, which may let queued imports start
+                    {
+                        QMutexLocker ml(&this->incomingMutex);
+                        this->parsedBytes -= pending.parsedBytes;
+                        this->dispatchImports();
+                    }
+                    std::shared_ptr<ImportBatch> batch = pending.batch;
+                    this->active.erase(next);
+                    if (batch) {
+                        batch->nextCommit++;
+                        batch->succeeded++;
+                        this->finishBatches();
+                    }
+                    continue;
+                }
+            }
+            this->reportProgress(pending);
+        }
+
+        // LOD uploads only get what the imports left over
+        this->processLodUploads(vertexBudget);
+
+        // imports waiting on an earlier batch member get a frame requested when it's parsed
+        bool importsReady = std::any_of(this->active.begin(), this->active.end(), isReady);
+        if ((importsReady || this->activeLods.size() > 0) && this->requestFrame) {
+            this->requestFrame();
+        }
+    }
+
+    void ModelImporter::generateLods(const PendingImport& pending) {
+        std::shared_ptr<PendingLods> lods = std::make_shared<PendingLods>();
+        lods->onLodsReady = pending.onLodsReady;
+        lods->model = pending.model;
+        lods->material = this->material;
+        lods->meshes = pending.meshes;
+        lods->optimizeMeshes = pending.settings.optimizeMeshes;
+        lods->nodeObjects = pending.nodeObjects;
+        lods->meshLods.resize(pending.model->meshes.size());
+
+        const ImportedModel& model = *pending.model;
+        std::vector<bool> lodNodes = findLodNodes(model);
+        std::vector<bool> lodMeshes(model.meshes.size(), false);
+        for (Core::UInt32 n = 0; n < model.nodes.size(); n++) {
+            if (!lodNodes[n]) continue;
+            for (Core::UInt32 meshIndex : model.nodes[n].meshIndices) lodMeshes[meshIndex] = true;
+        }
+        for (Core::UInt32 i = 0; i < model.meshes.size(); i++) {
+            if (lodMeshes[i] && model.meshes[i].indices.size() / 3 >= MeshSimplifier::MinLodTriangles * MeshSimplifier::LodReductionFactor) {
+                lods->lodMeshIndices.push_back(i);
+            }
+        }
+        if (lods->lodMeshIndices.size() == 0) return;
+
+        {
+            QMutexLocker ml(&this->incomingMutex);
+            this->outstandingJobs += (Core::UInt32)lods->lodMeshIndices.size();
+            lods->remainingJobs = (Core::UInt32)lods->lodMeshIndices.size();
+        }
+
+        // meshes are independent, so each one is simplified by its own job
+        for (Core::UInt32 meshIndex : lods->lodMeshIndices) {
+            this->jobSystem->submit([this, lods, meshIndex]() {
+                {
+                    ProfileScope scope("ModelImporter::buildLodChain");
+                    ImportedMesh scratch;
+                    const ImportedMesh& mesh = VertexPacking::resolve(lods->model->meshes[meshIndex], scratch);
+                    lods->meshLods[meshIndex] = MeshSimplifier::buildLodChain(mesh);
+                    if (lods->optimizeMeshes) {
+                        for (ImportedMesh& lodMesh : lods->meshLods[meshIndex]) MeshOptimizer::optimize(lodMesh);
+                    }
+                }
+
+                QMutexLocker ml(&this->incomingMutex);
+                lods->remainingJobs--;
+                if (lods->remainingJobs == 0) {
+                    this->incomingLods.push_back(lods);
+                    if (this->requestFrame) this->requestFrame();
+                }
+                this->outstandingJobs--;
+                this->jobsDone.wakeAll();
+            });
+        }
+    }
+
+    void ModelImporter::processLodUploads(Core::UInt32 vertexBudget) {
+        while (this->activeLods.size() > 0 && vertexBudget > 0) {
+            PendingLods& lods = *this->activeLods.front();
+            const ImportedModel& model = *lods.model;
+
+            lods.uploadedLods.resize(model.meshes.size());
+            while (lods.nextMesh < lods.lodMeshIndices.size() && vertexBudget > 0) {
+                Core::UInt32 meshIndex = lods.lodMeshIndices[lods.nextMesh];
+                for (const ImportedMesh& lodMesh : lods.meshLods[meshIndex]) {
+                    lods.uploadedLods[meshIndex].push_back(ModelImporter::uploadMesh(this->engine, lodMesh));
+                    vertexBudget = lodMesh.vertexCount >= vertexBudget ? 0 : vertexBudget - lodMesh.vertexCount;
+                }
+                lods.nextMesh++;
+            }
+            if (lods.nextMesh < lods.lodMeshIndices.size()) return;
+
+            LodResult result;
+            result.model = lods.model;
+            result.nodeObjects = lods.nodeObjects;
+            result.nodeLods.resize(model.nodes.size());
+            std::vector<bool> lodNodes = findLodNodes(model);
+            for (Core::UInt32 n = 0; n < model.nodes.size(); n++) {
+                if (!lodNodes[n]) continue;
+                const ImportedNode& node = model.nodes[n];
+                Core::UInt32 levelCount = 0;
+                for (Core::UInt32 meshIndex : node.meshIndices) {
+                    levelCount = std::max(levelCount, (Core::UInt32)lods.uploadedLods[meshIndex].size());
+                }
+
+                // meshes with a shorter chain (or none) stay at their coarsest level
+                for (Core::UInt32 level = 0; level < levelCount; level++) {
+                    Core::WeakPointer<MeshContainer> lodContainer(this->engine->createObject3D<MeshContainer>());
+                    this->engine->createRenderer<Core::MeshRenderer>(lods.material, lodContainer);
+                    for (Core::UInt32 meshIndex : node.meshIndices) {
+                        const std::vector<Core::WeakPointer<Core::Mesh>>& chain = lods.uploadedLods[meshIndex];
+                        if (chain.size() == 0) lodContainer->addRenderable(lods.meshes[meshIndex]);
+                        else lodContainer->addRenderable(chain[std::min(level, (Core::UInt32)chain.size() - 1)]);
+                    }
+                    lodContainer->getTransform().getLocalMatrix().copy(node.localMatrix);
+                    lodContainer->setActive(false);
+                    lods.nodeObjects[node.parentIndex]->addChild(lodContainer);
+                    result.nodeLods[n].push_back(lodContainer);
+                }
+            }
+
+            lods.onLodsReady(result);
+            this->activeLods.erase(this->activeLods.begin());
+        }
+    }
+
+    Core::WeakPointer<Core::Mesh> ModelImporter::uploadMesh(Core::WeakPointer<Core::Engine> engine, const ImportedMesh& sourceMesh) {
+        // the engine's attribute arrays only take floats, so packed meshes are decoded here
+        ImportedMesh scratch;
+        const ImportedMesh& importedMesh = VertexPacking::resolve(sourceMesh, scratch);
+
+        Core::UInt32 indexCount = (Core::UInt32)importedMesh.indices.size();
+        Core::WeakPointer<Core::Mesh> mesh(engine->createMesh(importedMesh.vertexCount, indexCount));
+        mesh->init();
+
+        mesh->enableAttribute(Core::StandardAttribute::Position);
+        Core::Bool positionInited = mesh->initVertexPositions();
+        ASSERT(positionInited, "Unable to initialize imported mesh vertex positions.");
+        mesh->getVertexPositions()->store(importedMesh.positions.data());
+
+        mesh->enableAttribute(Core::StandardAttribute::Color);
+        Core::Bool colorInited = mesh->initVertexColors();
+        ASSERT(colorInited, "Unable to initialize imported mesh vertex colors.");
+        mesh->getVertexColors()->store(importedMesh.colors.data());
+
+        mesh->enableAttribute(Core::StandardAttribute::Normal);
+        Core::Bool normalInited = mesh->initVertexNormals();
+        ASSERT(normalInited, "Unable to initialize imported mesh vertex normals.");
+        mesh->getVertexNormals()->store(importedMesh.normals.data());
+
+        mesh->enableAttribute(Core::StandardAttribute::FaceNormal);
+        Core::Bool faceNormalInited = mesh->initVertexFaceNormals();
+        ASSERT(faceNormalInited, "Unable to initialize imported mesh vertex face normals.");
+        mesh->getVertexFaceNormals()->store(importedMesh.faceNormals.data());
+
+        if (indexCount > 0) {
+            mesh->getIndexBuffer()->setIndices(importedMesh.indices.data());
+        }
+
+        mesh->calculateBoundingBox();
+        return mesh;
+    }
+
+    bool ModelImporter::isSupportedFile(const std::string& path) {
+        size_t extensionStart = path.find_last_of('.');
+        if (extensionStart == std::string::npos) return false;
+        static const Assimp::Importer importer;
+        return importer.IsExtensionSupported(path.substr(extensionStart));
+    }
+
+    Core::WeakPointer<Core::Object3D> ModelImporter::buildNode(PendingImport& pending, const ImportedNode& node) {
+        Core::WeakPointer<Core::Object3D> object;
+        if (node.meshIndices.size() > 0 && !pending.stream && !pending.model->drawnByModelLoader) {
+            Core::WeakPointer<MeshContainer> meshContainer(this->engine->createObject3D<MeshContainer>());
+            this->engine->createRenderer<Core::MeshRenderer>(this->material, meshContainer);
+            for (Core::UInt32 meshIndex : node.meshIndices) {
+                meshContainer->addRenderable(pending.meshes[meshIndex]);
+            }
+            object = meshContainer;
+        }
+        else {
+            object = this->engine->createObject3D<Core::Object3D>();
+        }
+
+        object->getTransform().getLocalMatrix().copy(node.localMatrix);
+        if (node.parentIndex >= 0) {
+            pending.nodeObjects[node.parentIndex]->addChild(object);
+        }
+        return object;
+    }
+
+    void ModelImporter::reportProgress(const PendingImport& pending) {
+        const ImportedModel& model = *pending.model;
+        Core::UInt64 vertexWork = pending.stream ? 0 : model.totalVertexCount;
+        Core::Real totalWork = (Core::Real)(vertexWork + model.nodes.size());
+        Core::Real completedWork = (Core::Real)(pending.uploadedVertexCount + pending.nextNode);
+        qreal progress = totalWork > 0.0f ? 0.5 + 0.5 * completedWork / totalWork : 1.0;
+        emit importProgress(QString::fromStdString(pending.settings.path), progress);
+    }
+
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <string>
+
+#include <QObject>
+#include <QString>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+
+#include "ImportedModel.h"
+#include "ModelCache.h"
+#include "VertexPacking.h"
+#include "JobSystem.h"
+
+#include "Core/Engine.h"
+#include "Core/geometry/Mesh.h"
+#include "Core/material/BasicLitMaterial.h"
+
+struct aiScene;
+namespace Assimp {
+    class Importer;
+}
+
+namespace Modeler {
+
+    // Staged model import:
+    //   1. parse + post-process (Assimp, smoothing normals, scale)  -> worker thread
+    //      (skipped when ModelCache has a processed copy of the file)
+    //   2. convert to GPU-ready ImportedModel buffers, batch repeated meshes,
+    //      optionally reorder them for the GPU (MeshOptimizer),
+    //      build picking BVHs, optionally pack the vertex data     -> worker thread
+    //   3. upload meshes and build the object hierarchy             -> render thread, sliced per frame
+    //   4. commit the finished hierarchy to the scene               -> render thread
+    //   5. optionally simplify leaf meshes into LOD chains          -> worker threads, one job per mesh
+    //   6. upload the LOD meshes and build their objects            -> render thread, sliced per frame
+    //
+    // Streamed imports only open the model's cache entry in stage 1 (converting the file
+    // into one first if needed) and skip straight to building the bare hierarchy; their
+    // geometry is paged in afterwards by ModelStreamer. Batching, mesh optimization and
+    // LODs don't apply to them. Converting a file still needs its whole Assimp scene in
+    // memory; only the converted copy is written a mesh at a time.
+    //
+    // Imports wait in a queue until a worker is free and the parsed models waiting for the
+    // render thread fit in ParsedMemoryBudget, so a large batch keeps every core busy without
+    // holding all of its geometry in memory at once. All imports draw with one shared material.
+    //
+    // Material textures are not imported: only each material's diffuse color is kept, baked
+    // into the vertex colors, and no UVs are carried. Until UVs go through ImportedMesh, the
+    // cache and the upload, with a textured material per texture, models with textured
+    // materials are still drawn through Core's ModelLoader. They are parsed here for picking
+    // only, loaded by ModelLoader on the render thread at commit (stalling that frame), and
+    // picked, culled and moved as a single node. They aren't cached, streamed, batched or LODed.
+    class ModelImporter: public QObject {
+
+        Q_OBJECT
+
+    public:
+
+        // per-frame budgets for the render-thread stages
+        static const Core::UInt32 UploadVertexBudgetPerFrame = 65536;
+        static const Core::UInt32 NodeBudgetPerFrame = 512;
+        // CPU-side geometry of parsed models that haven't been committed yet; more parses only
+        // start while the total is below this, and at least one always can
+        static const Core::UInt64 ParsedMemoryBudget = 1024ull * 1024ull * 1024ull;
+
+        class ImportSettings {
+        public:
+            ImportSettings(): scale(1.0f), smoothingThreshold(80), zUp(false), generateLods(false), optimizeMeshes(false),
+                              vertexFormat(VertexFormat::Float), boundsOnlyPicking(false),
+                              streaming(false) {}
+
+            std::string path;
+            Core::Real scale;
+            Core::UInt32 smoothingThreshold;
+            bool zUp;
+            bool generateLods;
+            bool optimizeMeshes;
+            // Packed keeps the CPU-side copy and the cache entry compact; VRAM use is the same as Float
+            VertexFormat vertexFormat;
+            // the model is picked through the GPU ID buffer, so its picking BVHs keep no triangles
+            bool boundsOnlyPicking;
+            // commit the hierarchy first and leave the geometry to ModelStreamer
+            bool streaming;
+        };
+
+        class ImportResult {
+        public:
+            Core::WeakPointer<Core::Object3D> rootObject;
+            std::shared_ptr<ImportedModel> model;
+            std::vector<Core::WeakPointer<Core::Mesh>> meshes; // parallel to model->meshes
+            std::vector<Core::WeakPointer<Core::Object3D>> nodeObjects; // parallel to model->nodes
+            std::vector<Core::WeakPointer<Core::Object3D>> batchObjects; // parallel to model->batches
+            Core::WeakPointer<Core::BasicLitMaterial> material;
+            // streamed imports only: where the geometry is read from. Their model has no mesh
+            // data, and meshes is empty.
+            std::shared_ptr<ModelCache::StreamEntry> stream;
+        };
+
+        class LodResult {
+        public:
+            std::shared_ptr<ImportedModel> model;
+            std::vector<Core::WeakPointer<Core::Object3D>> nodeObjects; // parallel to model->nodes
+            // per node, coarser stand-ins finest first; siblings of the node object, created inactive
+            std::vector<std::vector<Core::WeakPointer<Core::Object3D>>> nodeLods;
+        };
+
+        typedef std::function<void(const ImportResult&)> CommitCallback;
+        typedef std::function<void(const LodResult&)> LodCallback;
+        typedef std::function<void()> FrameRequestCallback;
+        // render thread, once every model of a batch is committed or has failed
+        typedef std::function<void(Core::UInt32 succeeded, Core::UInt32 failed, qint64 elapsedMs)> BatchCallback;
+
+        ModelImporter(Core::WeakPointer<Core::Engine> engine, std::shared_ptr<JobSystem> jobSystem);
+        ~ModelImporter();
+
+        // onLodsReady runs on the render thread once the LODs of a committed import are in the scene
+        void importModel(const ImportSettings& settings, CommitCallback onCommit, LodCallback onLodsReady = LodCallback());
+        // parses the models concurrently, but commits them in the order given
+        void importModels(const std::vector<ImportSettings>& settings, CommitCallback onCommit, LodCallback onLodsReady = LodCallback(),
+                          BatchCallback onFinished = BatchCallback());
+        void processUploads();
+        // invoked whenever the pipeline has render-thread work waiting for the next frame
+        void setFrameRequestCallback(FrameRequestCallback callback);
+
+        // render thread
+        static Core::WeakPointer<Core::Mesh> uploadMesh(Core::WeakPointer<Core::Engine> engine, const ImportedMesh& sourceMesh);
+        // whether Assimp has a loader for the file's extension
+        static bool isSupportedFile(const std::string& path);
+
+    signals:
+        void importProgress(const QString& path, qreal progress);
+        void importFinished(const QString& path, bool success);
+        // something about an import worth telling the user while it runs
+        void importNotice(const QString& path, const QString& message);
+
+    private:
+
+        enum class UploadStage {
+            Meshes = 0,
+            Nodes = 1,
+        };
+
+        class ImportBatch {
+        public:
+            ImportBatch(): count(0), nextCommit(0), succeeded(0), failed(0) {}
+
+            Core::UInt32 count;
+            BatchCallback onFinished;
+            QElapsedTimer timer;
+            // guarded by incomingMutex
+            std::vector<bool> parseFailed;
+            // render thread
+            Core::UInt32 nextCommit;
+            Core::UInt32 succeeded;
+            Core::UInt32 failed;
+        };
+
+        class PendingImport {
+        public:
+            PendingImport(): batchIndex(0), parsedBytes(0), stage(UploadStage::Meshes), nextMesh(0), nextNode(0), uploadedVertexCount(0) {}
+
+            ImportSettings settings;
+            CommitCallback onCommit;
+            LodCallback onLodsReady;
+            std::shared_ptr<ImportBatch> batch;
+            Core::UInt32 batchIndex;
+            Core::UInt64 parsedBytes;
+            std::shared_ptr<ImportedModel> model;
+            std::shared_ptr<ModelCache::StreamEntry> stream;
+            UploadStage stage;
+            Core::UInt32 nextMesh;
+            Core::UInt32 nextNode;
+            Core::UInt64 uploadedVertexCount;
+            std::vector<Core::WeakPointer<Core::Mesh>> meshes;
+            std::vector<Core::WeakPointer<Core::Mesh>> batchMeshes;
+            std::vector<Core::WeakPointer<Core::Object3D>> nodeObjects;
+        };
+
+        class PendingLods {
+        public:
+            PendingLods(): optimizeMeshes(false), remainingJobs(0), nextMesh(0) {}
+
+            LodCallback onLodsReady;
+            std::shared_ptr<ImportedModel> model;
+            Core::WeakPointer<Core::BasicLitMaterial> material;
+            std::vector<Core::WeakPointer<Core::Mesh>> meshes;
+            std::vector<Core::WeakPointer<Core::Object3D>> nodeObjects;
+            std::vector<Core::UInt32> lodMeshIndices;            // meshes drawn by leaf nodes
+            std::vector<std::vector<ImportedMesh>> meshLods;     // parallel to model->meshes, filled by the jobs
+            std::vector<std::vector<Core::WeakPointer<Core::Mesh>>> uploadedLods;
+            bool optimizeMeshes;
+            Core::UInt32 remainingJobs;
+            Core::UInt32 nextMesh;
+        };
+
+        void queueImport(std::shared_ptr<PendingImport> pending);
+        void dispatchImports();
+        void runImport(std::shared_ptr<PendingImport> pending);
+        bool isReadyToCommit(const PendingImport& pending) const;
+        void finishBatches();
+        std::shared_ptr<ImportedModel> loadModelData(const ImportSettings& settings);
+        // textured is set if the model can't be streamed because it needs Core's ModelLoader
+        std::shared_ptr<ModelCache::StreamEntry> openModelStream(const ImportSettings& settings, bool& textured);
+        void generateLods(const PendingImport& pending);
+        void processLodUploads(Core::UInt32 vertexBudget);
+        static std::shared_ptr<ImportedModel> parseModel(const ImportSettings& settings);
+        // the scene is owned by importer; null if the file couldn't be imported
+        static const aiScene* readScene(Assimp::Importer& importer, const ImportSettings& settings);
+        // materials, hierarchy and mesh counts, without any geometry
+        static std::shared_ptr<ImportedModel> readModelLayout(const aiScene* scene, const ImportSettings& settings);
+        static void prepareModelLoaderFallback(ImportedModel& model, bool boundsOnlyPicking);
+        Core::WeakPointer<Core::Object3D> buildNode(PendingImport& pending, const ImportedNode& node);
+        void reportProgress(const PendingImport& pending);
+
+        Core::WeakPointer<Core::Engine> engine;
+        std::shared_ptr<JobSystem> jobSystem;
+        ModelCache modelCache;
+        FrameRequestCallback requestFrame;
+        QMutex incomingMutex;
+        QWaitCondition jobsDone;
+        Core::UInt32 outstandingJobs;
+        // waiting for a free worker or for parsed models to be committed
+        std::deque<std::shared_ptr<PendingImport>> queued;
+        Core::UInt32 parsesInFlight;
+        Core::UInt64 parsedBytes;
+        std::vector<std::shared_ptr<PendingImport>> incoming;
+        std::vector<std::shared_ptr<PendingImport>> active;
+        std::vector<std::shared_ptr<PendingLods>> incomingLods;
+        std::vector<std::shared_ptr<PendingLods>> activeLods;
+        std::vector<std::shared_ptr<ImportBatch>> batches;
+        Core::WeakPointer<Core::BasicLitMaterial> material;
+    };
+
+}
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QDebug>
+
+#include "ModelStreamer.h"
+#include "ModelImporter.h"
+#include "Profiler.h"
+
+#include "Core/render/RenderableContainer.h"
+#include "Core/render/MeshRenderer.h"
+
+using MeshContainer = Core::RenderableContainer<Core::Mesh>;
+
+namespace Modeler {
+
+    namespace {
+
+        // four float4 attributes per uploaded vertex, see ModelImporter::uploadMesh()
+        const Core::UInt64 VertexBytes = 64;
+
+    }
+
+    ModelStreamer::ModelStreamer(Core::WeakPointer<Core::Engine> engine, std::shared_ptr<JobSystem> jobSystem):
+        engine(engine), jobSystem(jobSystem), memoryBudget(DefaultMemoryBudget), residentBytes(0), loadingBytes(0),
+        loadsInFlight(0), residentNodeCount(0), rankingValid(false), outstandingJobs(0) {
+        for (unsigned int i = 0; i < 16; i++) this->lastViewProjection[i] = 0.0f;
+        this->clock.start();
+    }
+
+    ModelStreamer::~ModelStreamer() {
+        QMutexLocker ml(&this->loadedMutex);
+        while (this->outstandingJobs > 0) {
+            this->jobsDone.wait(&this->loadedMutex);
+        }
+    }
+
+    void ModelStreamer::setMemoryBudget(Core::UInt64 bytes) {
+        this->memoryBudget = bytes;
+    }
+
+    void ModelStreamer::setFrameRequestCallback(FrameRequestCallback callback) {
+        this->requestFrame = callback;
+    }
+
+    void ModelStreamer::addModel(std::shared_ptr<ModelCache::StreamEntry> entry, Core::WeakPointer<Core::BasicLitMaterial> material,
+                                 const std::vector<Core::WeakPointer<Core::Object3D>>& nodeObjects, const std::vector<const Core::Real*>& worldMatrices) {
+        const ImportedModel& skeleton = *entry->getModel();
+        if (nodeObjects.size() != skeleton.nodes.size() || worldMatrices.size() != skeleton.nodes.size()) {
+            qDebug() << "ModelStreamer::addModel() -> Node counts don't match.";
+            return;
+        }
+
+        Core::UInt32 modelIndex = (Core::UInt32)this->models.size();
+        StreamedModel model;
+        model.entry = entry;
+        model.material = material;
+        model.meshes.resize(skeleton.meshes.size());
+        model.meshUsers.resize(skeleton.meshes.size(), 0);
+        this->models.push_back(model);
+
+        for (Core::UInt32 n = 0; n < skeleton.nodes.size(); n++) {
+            const ImportedNode& node = skeleton.nodes[n];
+            if (node.meshIndices.size() == 0) continue;
+
+            StreamedNode streamed;
+            streamed.model = modelIndex;
+            streamed.node = n;
+            streamed.object = nodeObjects[n];
+            BVHBounds localBounds;
+            for (Core::UInt32 meshIndex : node.meshIndices) {
+                localBounds.grow(entry->getMeshBounds(meshIndex));
+                streamed.estimatedBytes += ModelStreamer::getMeshBytes(*entry, meshIndex);
+            }
+            if (localBounds.isEmpty()) continue;
+            localBounds.transform(worldMatrices[n], streamed.worldBounds);
+            this->nodes.push_back(streamed);
+        }
+        this->rankingValid = false;
+    }
+
+    void ModelStreamer::update(const Core::Real* viewProjection, const Core::Real* cameraPosition) {
+        if (this->nodes.size() == 0) return;
+        ProfileScope scope("ModelStreamer::update");
+
+        this->uploadLoadedNodes();
+        if (!this->rankingValid || std::memcmp(viewProjection, this->lastViewProjection, sizeof(this->lastViewProjection)) != 0) {
+            this->rank(viewProjection, cameraPosition);
+            std::memcpy(this->lastViewProjection, viewProjection, sizeof(this->lastViewProjection));
+            this->rankingValid = true;
+        }
+        this->scheduleLoads();
+    }
+
+    Core::UInt64 ModelStreamer::getResidentBytes() const {
+        return this->residentBytes;
+    }
+
+    Core::UInt32 ModelStreamer::getResidentNodeCount() const {
+        return this->residentNodeCount;
+    }
+
+    bool ModelStreamer::ranksBefore(Core::UInt32 a, Core::UInt32 b) const {
+        const StreamedNode& nodeA = this->nodes[a];
+        const StreamedNode& nodeB = this->nodes[b];
+        if (nodeA.visible != nodeB.visible) return nodeA.visible;
+        return nodeA.distance < nodeB.distance;
+    }
+
+    void ModelStreamer::rank(const Core::Real* viewProjection, const Core::Real* cameraPosition) {
+        // Gribb/Hartmann extraction from the rows of the view-projection matrix
+        const Core::Real* m = viewProjection;
+        Core::Real planes[6 * 4];
+        for (unsigned int i = 0; i < 3; i++) {
+            for (unsigned int j = 0; j < 4; j++) {
+                Core::Real w = m[j * 4 + 3];
+                Core::Real r = m[j * 4 + i];
+                planes[i * 8 + j] = w + r;
+                planes[i * 8 + 4 + j] = w - r;
+            }
+        }
+
+        for (StreamedNode& node : this->nodes) {
+            node.visible = node.worldBounds.classify(planes, 6) >= 0;
+            Core::Real squaredDistance = 0.0f;
+            Core::Real squaredRadius = 0.0f;
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                Core::Real halfExtent = (node.worldBounds.max[axis] - node.worldBounds.min[axis]) * 0.5f;
+                Core::Real offset = node.worldBounds.min[axis] + halfExtent - cameraPosition[axis];
+                squaredDistance += offset * offset;
+                squaredRadius += halfExtent * halfExtent;
+            }
+            node.distance = std::max(std::sqrt(squaredDistance) - std::sqrt(squaredRadius), 0.0f);
+        }
+    }
+
+    void ModelStreamer::uploadLoadedNodes() {
+        {
+            QMutexLocker ml(&this->loadedMutex);
+            this->pendingUploads.insert(this->pendingUploads.end(), this->loaded.begin(), this->loaded.end());
+            this->loaded.clear();
+        }
+        if (this->pendingUploads.size() == 0) return;
+
+        // at least one node is uploaded per frame, even if it exceeds the budget on its own
+        Core::UInt32 vertexBudget = UploadVertexBudgetPerFrame;
+        Core::UInt32 uploadedCount = 0;
+        while (uploadedCount < this->pendingUploads.size() && vertexBudget > 0) {
+            const LoadedNode& loadedNode = *this->pendingUploads[uploadedCount++];
+            StreamedNode& node = this->nodes[loadedNode.streamedNode];
+            StreamedModel& model = this->models[node.model];
+            bool readFailed = false;
+            for (const ImportedMesh& mesh : loadedNode.meshes) readFailed = readFailed || mesh.vertexCount == 0;
+            if (readFailed) {
+                this->failLoad(loadedNode.streamedNode);
+                continue;
+            }
+
+            for (Core::UInt32 i = 0; i < loadedNode.meshIndices.size(); i++) {
+                Core::UInt32 meshIndex = loadedNode.meshIndices[i];
+                const ImportedMesh& mesh = loadedNode.meshes[i];
+                if (model.meshes[meshIndex] || mesh.vertexCount == 0) continue;
+                model.meshes[meshIndex] = ModelImporter::uploadMesh(this->engine, mesh);
+                this->residentBytes += ModelStreamer::getMeshBytes(*model.entry, meshIndex);
+                vertexBudget = mesh.vertexCount >= vertexBudget ? 0 : vertexBudget - mesh.vertexCount;
+            }
+
+            Core::WeakPointer<MeshContainer> geometry(this->engine->createObject3D<MeshContainer>());
+            this->engine->createRenderer<Core::MeshRenderer>(model.material, geometry);
+            for (Core::UInt32 meshIndex : model.entry->getModel()->nodes[node.node].meshIndices) {
+                if (model.meshes[meshIndex]) geometry->addRenderable(model.meshes[meshIndex]);
+            }
+            node.object->addChild(geometry);
+            node.geometry = geometry;
+            node.state = NodeState::Resident;
+            node.failedLoads = 0;
+            this->residentNodeCount++;
+            this->loadsInFlight--;
+            this->loadingBytes -= node.estimatedBytes;
+        }
+        this->pendingUploads.erase(this->pendingUploads.begin(), this->pendingUploads.begin() + uploadedCount);
+        if (this->pendingUploads.size() > 0 && this->requestFrame) this->requestFrame();
+    }
+
+    void ModelStreamer::scheduleLoads() {
+        if (this->loadsInFlight >= MaxLoadsInFlight) return;
+
+        std::vector<Core::UInt32> candidates;
+        std::vector<Core::UInt32> residents;
+        qint64 now = this->clock.elapsed();
+        for (Core::UInt32 i = 0; i < this->nodes.size(); i++) {
+            const StreamedNode& node = this->nodes[i];
+            if (node.state == NodeState::Unloaded) candidates.push_back(i);
+            else if (node.state == NodeState::Resident) residents.push_back(i);
+            else if (node.state == NodeState::Failed && node.failedLoads < MaxLoadAttempts && now >= node.retryTime) candidates.push_back(i);
+        }
+        if (candidates.size() == 0) return;
+
+        auto ranksBefore = [this](Core::UInt32 a, Core::UInt32 b) { return this->ranksBefore(a, b); };
+        Core::UInt32 slots = std::min(MaxLoadsInFlight - this->loadsInFlight, (Core::UInt32)candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + slots, candidates.end(), ranksBefore);
+
+        // residents are only sorted (worst first) once something actually has to go
+        bool residentsSorted = false;
+        Core::UInt32 nextVictim = 0;
+        Core::UInt64 budget = this->memoryBudget;
+        for (Core::UInt32 c = 0; c < slots; c++) {
+            Core::UInt32 candidate = candidates[c];
+            Core::UInt64 needed = this->nodes[candidate].estimatedBytes;
+            while (this->residentBytes + this->loadingBytes + needed > budget) {
+                if (!residentsSorted) {
+                    std::sort(residents.begin(), residents.end(), [this](Core::UInt32 a, Core::UInt32 b) { return this->ranksBefore(b, a); });
+                    residentsSorted = true;
+                }
+                if (nextVictim >= residents.size() || !this->ranksBefore(candidate, residents[nextVictim])) break;
+                this->evict(residents[nextVictim++]);
+            }
+            if (this->residentBytes + this->loadingBytes + needed > budget) continue;
+            this->startLoad(candidate);
+        }
+    }
+
+    // meshes that are already uploaded are counted as used right away, so evicting their other
+    // users while this load is in flight can't free them
+    void ModelStreamer::startLoad(Core::UInt32 streamedNode) {
+        StreamedNode& node = this->nodes[streamedNode];
+        StreamedModel& model = this->models[node.model];
+        node.state = NodeState::Loading;
+        this->loadsInFlight++;
+        this->loadingBytes += node.estimatedBytes;
+
+        std::shared_ptr<LoadedNode> loadedNode = std::make_shared<LoadedNode>();
+        loadedNode->streamedNode = streamedNode;
+        for (Core::UInt32 meshIndex : model.entry->getModel()->nodes[node.node].meshIndices) {
+            if (!model.meshes[meshIndex]) loadedNode->meshIndices.push_back(meshIndex);
+            model.meshUsers[meshIndex]++;
+        }
+
+        {
+            QMutexLocker ml(&this->loadedMutex);
+            this->outstandingJobs++;
+        }
+        std::shared_ptr<ModelCache::StreamEntry> entry = model.entry;
+        this->jobSystem->submit([this, entry, loadedNode]() {
+            {
+                ProfileScope scope("ModelStreamer::loadNode");
+                loadedNode->meshes.resize(loadedNode->meshIndices.size());
+                for (Core::UInt32 i = 0; i < loadedNode->meshIndices.size(); i++) {
+                    if (!entry->loadMesh(loadedNode->meshIndices[i], loadedNode->meshes[i])) {
+                        qDebug() << "ModelStreamer: unable to read mesh" << loadedNode->meshIndices[i] << "of" << entry->getModel()->sourcePath.c_str();
+                        loadedNode->meshes[i] = ImportedMesh();
+                    }
+                }
+            }
+
+            QMutexLocker ml(&this->loadedMutex);
+            this->loaded.push_back(loadedNode);
+            this->outstandingJobs--;
+            this->jobsDone.wakeAll();
+            if (this->requestFrame) this->requestFrame();
+        });
+    }
+
+    void ModelStreamer::evict(Core::UInt32 streamedNode) {
+        StreamedNode& node = this->nodes[streamedNode];
+        node.object->removeChild(node.geometry);
+        Core::Engine::safeReleaseObject(node.geometry);
+        node.geometry = Core::WeakPointer<Core::Object3D>();
+        node.state = NodeState::Unloaded;
+        this->residentNodeCount--;
+        this->releaseMeshes(streamedNode);
+    }
+
+    // meshes that did load are dropped along with the rest, the retry reads the node as a whole
+    void ModelStreamer::failLoad(Core::UInt32 streamedNode) {
+        StreamedNode& node = this->nodes[streamedNode];
+        node.state = NodeState::Failed;
+        node.failedLoads++;
+        qint64 delay = LoadRetryDelay << (node.failedLoads - 1);
+        node.retryTime = this->clock.elapsed() + delay;
+        this->loadsInFlight--;
+        this->loadingBytes -= node.estimatedBytes;
+        this->releaseMeshes(streamedNode);
+
+        const std::string& sourcePath = this->models[node.model].entry->getModel()->sourcePath;
+        if (node.failedLoads < MaxLoadAttempts) {
+            qDebug() << "ModelStreamer: loading node" << node.node << "of" << sourcePath.c_str() << "failed, retrying in" << delay << "ms";
+        }
+        else {
+            qDebug() << "ModelStreamer: giving up on node" << node.node << "of" << sourcePath.c_str() << "after" << node.failedLoads << "failed loads";
+        }
+    }
+
+    void ModelStreamer::releaseMeshes(Core::UInt32 streamedNode) {
+        StreamedNode& node = this->nodes[streamedNode];
+        StreamedModel& model = this->models[node.model];
+        for (Core::UInt32 meshIndex : model.entry->getModel()->nodes[node.node].meshIndices) {
+            model.meshUsers[meshIndex]--;
+            if (model.meshUsers[meshIndex] > 0 || !model.meshes[meshIndex]) continue;
+            Core::Engine::safeReleaseObject(model.meshes[meshIndex]);
+            model.meshes[meshIndex] = Core::WeakPointer<Core::Mesh>();
+            this->residentBytes -= ModelStreamer::getMeshBytes(*model.entry, meshIndex);
+        }
+    }
+
+    Core::UInt64 ModelStreamer::getMeshBytes(const ModelCache::StreamEntry& entry, Core::UInt32 meshIndex) {
+        return entry.getModel()->meshes[meshIndex].vertexCount * VertexBytes + entry.getIndexCount(meshIndex) * sizeof(Core::UInt32);
+    }
+
+}
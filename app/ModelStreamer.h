@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "ModelCache.h"
+#include "JobSystem.h"
+#include "BVH.h"
+
+#include "Core/Engine.h"
+#include "Core/geometry/Mesh.h"
+#include "Core/material/BasicLitMaterial.h"
+
+namespace Modeler {
+
+    // Pages the geometry of streamed imports in and out, one node at a time.
+    //
+    // A streamed import is committed as its bare hierarchy; the nodes that reference meshes
+    // get their geometry later, as a child container that this class adds and removes. Every
+    // frame the nodes are ranked (inside the view frustum first, then nearest to the camera)
+    // and the best ones that aren't resident are read from the cache entry by worker jobs.
+    // When the meshes on the GPU would exceed the memory budget, resident nodes that rank
+    // worse than the one waiting are evicted to make room; a node that can only fit by
+    // pushing out better ones waits until the view changes.
+    //
+    // Meshes shared by several nodes are uploaded once and freed with the last node using them.
+    //
+    // A node whose meshes can't be read is left without geometry and tried again after a delay
+    // that doubles with every failure, up to MaxLoadAttempts reads in all.
+    class ModelStreamer {
+    public:
+        static const Core::UInt64 DefaultMemoryBudget = 1024ull * 1024ull * 1024ull;
+        static const Core::UInt32 MaxLoadsInFlight = 8;
+        static const Core::UInt32 UploadVertexBudgetPerFrame = 65536;
+        static const Core::UInt32 MaxLoadAttempts = 5;
+        static const qint64 LoadRetryDelay = 500; // milliseconds, before the first retry
+
+        typedef std::function<void()> FrameRequestCallback;
+
+        ModelStreamer(Core::WeakPointer<Core::Engine> engine, std::shared_ptr<JobSystem> jobSystem);
+        ~ModelStreamer();
+
+        // GPU bytes the streamed meshes may take, thread-safe
+        void setMemoryBudget(Core::UInt64 bytes);
+        // invoked whenever loads finish and need a frame to be uploaded
+        void setFrameRequestCallback(FrameRequestCallback callback);
+
+        // nodeObjects and worldMatrices (column-major) are parallel to the entry's nodes
+        void addModel(std::shared_ptr<ModelCache::StreamEntry> entry, Core::WeakPointer<Core::BasicLitMaterial> material,
+                      const std::vector<Core::WeakPointer<Core::Object3D>>& nodeObjects, const std::vector<const Core::Real*>& worldMatrices);
+
+        // render thread, once per frame: uploads finished loads, re-ranks the nodes, evicts
+        // down to the budget and starts new loads. viewProjection is column-major.
+        void update(const Core::Real* viewProjection, const Core::Real* cameraPosition);
+
+        Core::UInt64 getResidentBytes() const;
+        Core::UInt32 getResidentNodeCount() const;
+
+    private:
+        enum class NodeState {
+            Unloaded = 0,
+            Loading = 1,
+            Resident = 2,
+            Failed = 3, // the last read failed, see retryTime
+        };
+
+        class StreamedModel {
+        public:
+            std::shared_ptr<ModelCache::StreamEntry> entry;
+            Core::WeakPointer<Core::BasicLitMaterial> material;
+            std::vector<Core::WeakPointer<Core::Mesh>> meshes; // parallel to the entry's meshes, set while uploaded
+            std::vector<Core::UInt32> meshUsers;               // resident and loading nodes using each mesh
+        };
+
+        class StreamedNode {
+        public:
+            StreamedNode(): model(0), node(0), state(NodeState::Unloaded), estimatedBytes(0), visible(false), distance(0.0f),
+                            failedLoads(0), retryTime(0) {}
+
+            Core::UInt32 model;
+            Core::UInt32 node;
+            Core::WeakPointer<Core::Object3D> object;
+            Core::WeakPointer<Core::Object3D> geometry;
+            BVHBounds worldBounds;
+            NodeState state;
+            Core::UInt64 estimatedBytes;
+            bool visible;
+            Core::Real distance;
+            Core::UInt32 failedLoads;
+            qint64 retryTime; // on clock
+        };
+
+        // what a load job hands back to the render thread: the node's meshes that weren't
+        // uploaded when the load started
+        class LoadedNode {
+        public:
+            Core::UInt32 streamedNode;
+            std::vector<Core::UInt32> meshIndices;
+            std::vector<ImportedMesh> meshes; // parallel to meshIndices, vertexCount 0 if the read failed
+        };
+
+        bool ranksBefore(Core::UInt32 a, Core::UInt32 b) const;
+        void rank(const Core::Real* viewProjection, const Core::Real* cameraPosition);
+        void uploadLoadedNodes();
+        void scheduleLoads();
+        void startLoad(Core::UInt32 streamedNode);
+        void evict(Core::UInt32 streamedNode);
+        void failLoad(Core::UInt32 streamedNode);
+        void releaseMeshes(Core::UInt32 streamedNode);
+        static Core::UInt64 getMeshBytes(const ModelCache::StreamEntry& entry, Core::UInt32 meshIndex);
+
+        Core::WeakPointer<Core::Engine> engine;
+        std::shared_ptr<JobSystem> jobSystem;
+        FrameRequestCallback requestFrame;
+        std::vector<StreamedModel> models;
+        std::vector<StreamedNode> nodes;
+        std::vector<std::shared_ptr<LoadedNode>> pendingUploads;
+        std::atomic<Core::UInt64> memoryBudget;
+        Core::UInt64 residentBytes;
+        Core::UInt64 loadingBytes;
+        Core::UInt32 loadsInFlight;
+        Core::UInt32 residentNodeCount;
+        Core::Real lastViewProjection[16];
+        bool rankingValid;
+        QElapsedTimer clock;
+
+        QMutex loadedMutex;
+        QWaitCondition jobsDone;
+        Core::UInt32 outstandingJobs;
+        std::vector<std::shared_ptr<LoadedNode>> loaded;
+    };
+
+}
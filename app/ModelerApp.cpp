@@ -1,12 +1,21 @@
 #include <memory>
 #include <exception>
+#include <algorithm>
+#include <unordered_set>
+#include <cstdlib>
 
 #include <QGuiApplication>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QDir>
+#include <QFileInfo>
 #include <QtQuick/QQuickView>
 
 #include "ModelerApp.h"
 #include "RenderSurface.h"
 #include "Util.h"
+#include "Profiler.h"
+#include "MeshOptimizer.h"
 
 #include "Core/util/Time.h"
 #include "Core/scene/Scene.h"
@@ -32,7 +41,6 @@
 #include "Core/image/CubeTexture.h"
 #include "Core/image/Texture2D.h"
 #include "Core/util/WeakPointer.h"
-#include "Core/asset/ModelLoader.h"
 #include "Core/image/RawImage.h"
 #include "Core/image/ImagePainter.h"
 #include "Core/material/BasicTexturedMaterial.h"
@@ -48,11 +56,81 @@ using MeshContainer = Core::RenderableContainer<Core::Mesh>;
 
 namespace Modeler {
 
-    ModelerApp::ModelerApp(QObject *parent) : QObject(parent), engineReady(false),  orbitControls(nullptr), renderSurface(nullptr), coreSync(nullptr) {}
+    namespace {
+
+        // paths from QML file dialogs come as file:// URLs
+        std::string toLocalPath(const QString& path) {
+            std::string localPath = path.toStdString();
+            std::string filePrefix("file://");
+            if (localPath.substr(0, 7) == filePrefix) {
+                localPath = localPath.substr(7);
+            }
+            return localPath;
+        }
+
+        // twice the signed area of the screen triangle abc
+        double signedArea(const Core::Int32* a, const Core::Int32* b, const Core::Int32* c) {
+            return (double)(b[0] - a[0]) * (c[1] - a[1]) - (double)(b[1] - a[1]) * (c[0] - a[0]);
+        }
+
+        // Ear clipping of a closed outline given as x, y pairs; triangles index its points.
+        // A self-intersecting outline may run out of ears, in which case the rest is dropped.
+        void triangulateOutline(const std::vector<Core::Int32>& outline, std::vector<Core::UInt32>& triangles) {
+            Core::UInt32 pointCount = (Core::UInt32)outline.size() / 2;
+            if (pointCount < 3) return;
+
+            double area = 0.0;
+            for (Core::UInt32 i = 0; i < pointCount; i++) {
+                const Core::Int32* a = &outline[i * 2];
+                const Core::Int32* b = &outline[((i + 1) % pointCount) * 2];
+                area += (double)a[0] * b[1] - (double)b[0] * a[1];
+            }
+            if (area == 0.0) return;
+            double orientation = area > 0.0 ? 1.0 : -1.0;
+
+            std::vector<Core::UInt32> remaining(pointCount);
+            for (Core::UInt32 i = 0; i < pointCount; i++) remaining[i] = i;
+            Core::UInt32 position = 0;
+            Core::UInt32 failures = 0;
+            while (remaining.size() > 3 && failures < remaining.size()) {
+                Core::UInt32 size = (Core::UInt32)remaining.size();
+                position %= size;
+                const Core::Int32* a = &outline[remaining[(position + size - 1) % size] * 2];
+                const Core::Int32* b = &outline[remaining[position] * 2];
+                const Core::Int32* c = &outline[remaining[(position + 1) % size] * 2];
+
+                bool ear = signedArea(a, b, c) * orientation > 0.0;
+                for (Core::UInt32 other = 0; ear && other < size; other++) {
+                    const Core::Int32* p = &outline[remaining[other] * 2];
+                    if (p == a || p == b || p == c) continue;
+                    ear = !(signedArea(a, b, p) * orientation >= 0.0 && signedArea(b, c, p) * orientation >= 0.0 && signedArea(c, a, p) * orientation >= 0.0);
+                }
+                if (!ear) {
+                    position++;
+                    failures++;
+                    continue;
+                }
+
+                triangles.push_back(remaining[(position + size - 1) % size]);
+                triangles.push_back(remaining[position]);
+                triangles.push_back(remaining[(position + 1) % size]);
+                remaining.erase(remaining.begin() + position);
+                failures = 0;
+            }
+            if (remaining.size() == 3) {
+                triangles.insert(triangles.end(), remaining.begin(), remaining.end());
+            }
+        }
+
+    }
+
+    ModelerApp::ModelerApp(QObject *parent) : QObject(parent), engineReady(false), lightAnimationEnabled(true), lightAnimationChosen(false), lightRotationAngle(0.0f), lightTransformValid(false), lightAnimationRunning(false), gpuPickingEnabled(false), streamingMemoryBudget(ModelStreamer::DefaultMemoryBudget), unbatchedDrawCount(0), batchedDrawCount(0), focusedViewport(0), renderSurface(nullptr), coreSync(nullptr), nextPickableID(1), pickCycleIndex(0), lastPickX(0), lastPickY(0), lastPickViewport(0), gpuPickViewport(0), selectionDragActive(false), selectionDragLasso(false), selectionDragViewport(0) {}
 
     void ModelerApp::initialize(QQuickView* rootView) {
         this->rootView = rootView;
-        pipedGestureAdapter = std::make_shared<PipedEventAdapter<GestureAdapter::GestureEvent>>(std::bind(&ModelerApp::onGesture, this, std::placeholders::_1));
+        this->jobSystem = std::make_shared<JobSystem>();
+        this->transforms = std::make_shared<TransformHierarchy>(this->jobSystem);
+        this->sceneBVH.setJobSystem(this->jobSystem);
         for (unsigned int i = 0; i < MaxWindows; i++) this->liveWindows[i] = nullptr;
     }
 
@@ -72,20 +150,38 @@ namespace Modeler {
         if (type == AppWindowType::RenderSurface) {
             GestureAdapter* gestureAdapter = window->getGestureAdapter();
             if (gestureAdapter) {
-                gestureAdapter->setPipedEventAdapter(pipedGestureAdapter);
+                gestureAdapter->getEvents().on(std::bind(&ModelerApp::onGesture, this, std::placeholders::_1));
+            }
+            MouseAdapter* mouseAdapter = window->getMouseAdapter();
+            if (mouseAdapter) {
+                mouseAdapter->getEvents().on(std::bind(&ModelerApp::onMouseEvent, this, std::placeholders::_1));
             }
 
             RenderSurface* renderSurface = dynamic_cast<RenderSurface*>(window);
             if (renderSurface) {
                 this->renderSurface = renderSurface;
+                QTimer::singleShot(StartupLightAnimationDuration, this, SLOT(endStartupLightAnimation()));
                 RendererGL::LifeCycleEventCallback initer = [this](RendererGL* renderer) {
                     this->engine = renderer->getEngine();
                     this->coreSync = std::make_shared<CoreSync>(this->renderSurface);
+                    this->modelImporter = std::make_shared<ModelImporter>(this->engine, this->jobSystem);
+                    this->modelImporter->setFrameRequestCallback([renderer]() {
+                        renderer->requestFrame();
+                    });
+                    this->modelStreamer = std::make_shared<ModelStreamer>(this->engine, this->jobSystem);
+                    this->modelStreamer->setFrameRequestCallback([renderer]() {
+                        renderer->requestFrame();
+                    });
+                    connect(this->modelImporter.get(), &ModelImporter::importProgress, this, &ModelerApp::importProgress);
+                    connect(this->modelImporter.get(), &ModelImporter::importFinished, this, &ModelerApp::importFinished);
+                    connect(this->modelImporter.get(), &ModelImporter::importNotice, this, &ModelerApp::importNotice);
                     this->onEngineReady(engine);
-                    this->orbitControls = std::make_shared<OrbitControls>(this->engine, this->renderCamera, this->coreSync);
-
-                    MouseAdapter* mouseAdapter = this->renderSurface->getMouseAdapter();
-                    mouseAdapter->onMouseButtonPressed(std::bind(&ModelerApp::onMouseButtonAction, this, std::placeholders::_1,  std::placeholders::_2,  std::placeholders::_3, std::placeholders::_4));
+                    for (Viewport& viewport : this->viewports) {
+                        viewport.orbitControls = std::make_shared<OrbitControls>(this->engine, viewport.camera, this->coreSync);
+                    }
+                    this->coreSync->setCommandHandler(std::bind(&ModelerApp::onRenderCommand, this, std::placeholders::_1));
+                    renderer->setRenderMode(RendererGL::RenderMode::OnDemand);
+                    emit this->engineStarted();
                 };
                 renderSurface->getRenderer().onInit(initer);
             }
@@ -110,153 +206,670 @@ namespace Modeler {
         return true;
     }
 
-    void ModelerApp::loadModel(const QString& path, const QString& scaleText, const QString& smoothingThresholdText, const bool zUp) {
+    void ModelerApp::loadModel(const QString& path, const QString& scaleText, const QString& smoothingThresholdText, const bool zUp,
+                               const bool generateLods, const bool optimizeMeshes, const bool packVertices, const bool stream) {
         if (this->engineReady) {
-            std::string sPath = path.toStdString();
-            std::string filePrefix("file://");
-            std::string pathPrefix = sPath.substr(0, 7) ;
-            if (pathPrefix == filePrefix) {
-                sPath = sPath.substr(7);
-            }
+            ModelImporter::ImportSettings settings = this->getImportSettings(toLocalPath(path), scaleText, smoothingThresholdText, zUp,
+                                                                             generateLods, optimizeMeshes, packVertices, stream);
+            this->modelImporter->importModel(settings, this->getCommitCallback(zUp), this->getLodCallback());
+        }
+    }
 
-            std::string _scaleText = scaleText.toStdString();
-            float scale = 1.0f;
-            try {
-                scale = std::stof(_scaleText);
+    void ModelerApp::loadModels(const QStringList& paths, const QString& scaleText, const QString& smoothingThresholdText, const bool zUp,
+                                const bool generateLods, const bool optimizeMeshes, const bool packVertices, const bool stream) {
+        if (!this->engineReady) return;
+
+        // folders contribute the model files directly inside them, in name order
+        std::vector<std::string> files;
+        for (const QString& path : paths) {
+            std::string localPath = toLocalPath(path);
+            QFileInfo info(QString::fromStdString(localPath));
+            if (!info.isDir()) {
+                files.push_back(localPath);
+                continue;
             }
-            catch (const std::invalid_argument& ia) {
-                scale = 1.0f;
+            for (const QFileInfo& entry : QDir(info.filePath()).entryInfoList(QDir::Files, QDir::Name)) {
+                std::string entryPath = entry.filePath().toStdString();
+                if (ModelImporter::isSupportedFile(entryPath)) files.push_back(entryPath);
             }
+        }
+
+        // the same file twice would be parsed twice and race on its cache entry
+        std::vector<ModelImporter::ImportSettings> settings;
+        std::unordered_set<std::string> seen;
+        for (const std::string& file : files) {
+            if (!seen.insert(file).second) continue;
+            settings.push_back(this->getImportSettings(file, scaleText, smoothingThresholdText, zUp, generateLods, optimizeMeshes, packVertices, stream));
+        }
+        if (settings.size() == 0) {
+            qDebug() << "ModelerApp::loadModels() -> No model files found.";
+            emit batchImportFinished(0, 0, 0.0);
+            return;
+        }
+
+        ModelImporter::BatchCallback onFinished = [this](Core::UInt32 succeeded, Core::UInt32 failed, qint64 elapsedMs) {
+            emit batchImportFinished((int)succeeded, (int)failed, (qreal)elapsedMs / 1000.0);
+        };
+        this->modelImporter->importModels(settings, this->getCommitCallback(zUp), this->getLodCallback(), onFinished);
+    }
+
+    ModelImporter::ImportSettings ModelerApp::getImportSettings(const std::string& path, const QString& scaleText, const QString& smoothingThresholdText, bool zUp,
+                                                                bool generateLods, bool optimizeMeshes, bool packVertices, bool stream) const {
+        std::string _scaleText = scaleText.toStdString();
+        float scale = 1.0f;
+        try {
+            scale = std::stof(_scaleText);
+        }
+        catch (const std::invalid_argument& ia) {
+            scale = 1.0f;
+        }
 
-            std::string _smoothingThresholdText = smoothingThresholdText.toStdString();
-            int smoothingThreshold = 80;
-            try {
-                smoothingThreshold = std::stoi(_smoothingThresholdText);
+        std::string _smoothingThresholdText = smoothingThresholdText.toStdString();
+        int smoothingThreshold = 80;
+        try {
+            smoothingThreshold = std::stoi(_smoothingThresholdText);
+        }
+        catch (const std::invalid_argument& ia) {
+            smoothingThreshold = 80;
+        }
+        if (smoothingThreshold < 0 ) smoothingThreshold = 0;
+        if (smoothingThreshold >= 90) smoothingThreshold = 90;
+
+        ModelImporter::ImportSettings settings;
+        settings.path = path;
+        settings.scale = scale;
+        settings.smoothingThreshold = (Core::UInt32)smoothingThreshold;
+        settings.zUp = zUp;
+        settings.generateLods = generateLods;
+        settings.optimizeMeshes = optimizeMeshes;
+        settings.vertexFormat = packVertices ? VertexFormat::Packed : VertexFormat::Float;
+        settings.boundsOnlyPicking = this->gpuPickingEnabled;
+        settings.streaming = stream;
+        return settings;
+    }
+
+    ModelImporter::CommitCallback ModelerApp::getCommitCallback(bool zUp) {
+        // runs on the render thread once the import pipeline has uploaded the whole hierarchy
+        return [this, zUp](const ModelImporter::ImportResult& result) {
+            if (!this->registerModelRoot(result)) return;
+            if (zUp) {
+                result.rootObject->getTransform().rotate(1.0f, 0.0f, 0.0f, -Core::Math::PI / 2.0);
+                this->syncLocalMatrix(result.rootObject);
             }
-            catch (const std::invalid_argument& ia) {
-                smoothingThreshold = 80;
+            this->outliner.addHierarchy(result.model);
+        };
+    }
+
+    // Every imported hierarchy enters the scene here. It is mirrored into transforms right away,
+    // so later changes to its local matrices are tracked, but picking, culling and streaming
+    // only take it on in the next updateTransforms(), once its world matrices exist.
+    bool ModelerApp::registerModelRoot(const ModelImporter::ImportResult& result) {
+        this->sceneRoot->addChild(result.rootObject);
+
+        const ImportedModel& model = *result.model;
+        std::vector<Core::Int32> parentIndices(model.nodes.size());
+        std::vector<const Core::Real*> localMatrices(model.nodes.size());
+        for (Core::UInt32 n = 0; n < model.nodes.size(); n++) {
+            parentIndices[n] = model.nodes[n].parentIndex;
+            localMatrices[n] = model.nodes[n].localMatrix;
+        }
+        Core::Matrix4x4 rootLocalMatrix = result.rootObject->getTransform().getLocalMatrix();
+        localMatrices[0] = rootLocalMatrix.getData();
+        Core::UInt32 rootNode = this->transforms->addHierarchy(parentIndices, localMatrices);
+        if (rootNode == TransformHierarchy::InvalidIndex) return false;
+
+        for (Core::UInt32 n = 0; n < model.nodes.size(); n++) {
+            this->transformNodes[result.nodeObjects[n]->getObjectID()] = rootNode + n;
+        }
+        this->transformUsers.resize(this->transforms->getNodeCount());
+        this->pendingModelRoots.push_back(PendingModelRoot(result, rootNode));
+
+        Core::UInt64 unbatchedDraws = 0;
+        Core::UInt64 batchedDraws = model.batches.size();
+        for (const ImportedNode& node : model.nodes) {
+            unbatchedDraws += node.meshIndices.size() + node.batchedMeshIndices.size();
+            batchedDraws += node.meshIndices.size();
+        }
+        this->unbatchedDrawCount += unbatchedDraws;
+        this->batchedDrawCount += batchedDraws;
+        return true;
+    }
+
+    void ModelerApp::registerModelNodes(const ModelImporter::ImportResult& result, Core::UInt32 rootNode) {
+        // batched meshes are drawn by the import's batch objects, but stay pickable per node
+        const ImportedModel& model = *result.model;
+        for (Core::UInt32 n = 0; n < model.nodes.size(); n++) {
+            Core::WeakPointer<Core::Object3D> nodeObject = result.nodeObjects[n];
+            const Core::Real* worldMatrix = this->transforms->getWorldMatrix(rootNode + n);
+            std::vector<Core::UInt64>& pickableIDs = this->transformUsers[rootNode + n].pickableIDs;
+            for (Core::UInt32 meshIndex : model.nodes[n].meshIndices) {
+                pickableIDs.push_back(this->addPickableMesh(nodeObject, model.meshBVHs[meshIndex], worldMatrix));
+            }
+            for (Core::UInt32 meshIndex : model.nodes[n].batchedMeshIndices) {
+                pickableIDs.push_back(this->addPickableMesh(nodeObject, model.meshBVHs[meshIndex], worldMatrix));
+                this->batchedMeshes[nodeObject->getObjectID()].push_back(result.meshes[meshIndex]);
             }
-            if (smoothingThreshold < 0 ) smoothingThreshold = 0;
-            if (smoothingThreshold >= 90) smoothingThreshold = 90;
+            if (pickableIDs.size() > 0 && pickableIDs[0] <= GpuPicker::MaxObjectID) {
+                this->gpuPicker->addObject((Core::UInt32)pickableIDs[0], nodeObject);
+            }
+        }
 
-            CoreSync::Runnable runnable = [this, sPath, scale, smoothingThreshold, zUp](Core::WeakPointer<Core::Engine> engine) {
-                Core::ModelLoader& modelLoader = engine->getModelLoader();
-                Core::WeakPointer<Core::Object3D> rootObject = modelLoader.loadModel(sPath, scale, smoothingThreshold, false, false, true);
-                this->sceneRoot->addChild(rootObject);
+        // deactivating an object hides its children too, so only childless nodes are culled
+        std::vector<bool> hasChildren(model.nodes.size(), false);
+        for (const ImportedNode& node : model.nodes) {
+            if (node.parentIndex >= 0) hasChildren[node.parentIndex] = true;
+        }
+        for (Core::UInt32 n = 0; n < model.nodes.size(); n++) {
+            if (hasChildren[n] || model.nodes[n].meshIndices.size() == 0) continue;
+            BVHBounds bounds;
+            for (Core::UInt32 meshIndex : model.nodes[n].meshIndices) {
+                bounds.grow(model.meshBVHs[meshIndex]->getBounds());
+            }
+            this->culler.addObject(result.nodeObjects[n], bounds, this->transforms->getWorldMatrix(rootNode + n));
+            this->transformUsers[rootNode + n].culledObjects.push_back(result.nodeObjects[n]);
+        }
+        // batch objects sit directly under the root with an identity transform, so they follow
+        // the root only; their vertices are baked relative to it
+        for (Core::UInt32 b = 0; b < model.batches.size(); b++) {
+            this->culler.addObject(result.batchObjects[b], model.batchBounds[b], this->transforms->getWorldMatrix(rootNode));
+            this->transformUsers[rootNode].culledObjects.push_back(result.batchObjects[b]);
+        }
 
-                Core::WeakPointer<Core::Scene> scene = engine->getActiveScene();
-                scene->visitScene(rootObject, [this, &rootObject](Core::WeakPointer<Core::Object3D> obj){
-                    Core::WeakPointer<Core::RenderableContainer<Core::Mesh>> meshContainer =
-                            Core::WeakPointer<Core::Object3D>::dynamicPointerCast<Core::RenderableContainer<Core::Mesh>>(obj);
-                    if (meshContainer) {
-                        std::vector<Core::WeakPointer<Core::Mesh>> meshes = meshContainer->getRenderables();
-                        for (Core::WeakPointer<Core::Mesh> mesh : meshes) {
-                            this->rayCaster.addObject(obj, mesh);
-                            this->meshToObjectMap[mesh->getObjectID()] = obj;
-                        }
-                    }
-                });
+        if (result.stream) {
+            std::vector<const Core::Real*> worldMatrices(model.nodes.size());
+            for (Core::UInt32 n = 0; n < model.nodes.size(); n++) {
+                worldMatrices[n] = this->transforms->getWorldMatrix(rootNode + n);
+            }
+            this->modelStreamer->addModel(result.stream, result.material, result.nodeObjects, worldMatrices);
+        }
+    }
+
+    void ModelerApp::syncLocalMatrix(Core::WeakPointer<Core::Object3D> object) {
+        auto transformNode = this->transformNodes.find(object->getObjectID());
+        if (transformNode == this->transformNodes.end()) return;
+        this->transforms->setLocalMatrix(transformNode->second, object->getTransform().getLocalMatrix().getData());
+    }
 
-                if (zUp) {
-                    rootObject->getTransform().rotate(1.0f, 0.0f, 0.0f, -Core::Math::PI / 2.0);
+    // Only the subtrees whose local matrices changed are recomputed, and only their nodes'
+    // instances are refit in the picking and culling BVHs.
+    void ModelerApp::updateTransforms() {
+        this->transforms->update();
+        for (const TransformHierarchy::Range& range : this->transforms->getUpdatedRanges()) {
+            for (Core::UInt32 node = range.begin; node < range.end; node++) {
+                // nodes of hierarchies still waiting to be registered have no users yet
+                const TransformUsers& users = this->transformUsers[node];
+                const Core::Real* worldMatrix = this->transforms->getWorldMatrix(node);
+                for (Core::UInt64 pickableID : users.pickableIDs) {
+                    this->sceneBVH.updateInstanceTransform(pickableID, worldMatrix);
+                }
+                for (Core::WeakPointer<Core::Object3D> object : users.culledObjects) {
+                    this->culler.updateObjectTransform(object, worldMatrix);
                 }
-            };
-            this->coreSync->run(runnable);
+            }
+        }
+
+        std::vector<PendingModelRoot> modelRoots;
+        modelRoots.swap(this->pendingModelRoots);
+        for (const PendingModelRoot& modelRoot : modelRoots) {
+            this->registerModelNodes(modelRoot.result, modelRoot.rootNode);
+        }
+    }
+
+    ModelImporter::LodCallback ModelerApp::getLodCallback() {
+        return [this](const ModelImporter::LodResult& result) {
+            for (Core::UInt32 n = 0; n < result.nodeLods.size(); n++) {
+                if (result.nodeLods[n].size() == 0) continue;
+                this->culler.setLodObjects(result.nodeObjects[n], result.nodeLods[n]);
+            }
+        };
+    }
+
+    bool ModelerApp::postRenderCommand(const RenderCommand& command) {
+        if (!this->coreSync || command.viewport >= RendererGL::MaxViewports) return false;
+        std::shared_ptr<OrbitControls> orbitControls = this->viewports[command.viewport].orbitControls;
+        if (!orbitControls) return false;
+        // scripted camera moves go through the same latch as live input
+        Core::UInt64 now = Profiler::instance().now();
+        switch(command.type) {
+            case RenderCommand::Type::CameraDrag:
+                orbitControls->queueDrag((GestureAdapter::GesturePointer)command.pointer, command.startX, command.startY, command.endX, command.endY, now);
+            return true;
+            case RenderCommand::Type::CameraScroll:
+                orbitControls->queueScroll(command.scrollDistance, now);
+            return true;
+            default:
+            break;
+        }
+        return this->coreSync->post(command);
+    }
+
+    // the render thread starts or stops the renderer's animation when it next updates the light
+    void ModelerApp::setLightAnimationEnabled(bool enabled) {
+        this->lightAnimationChosen = true;
+        if (this->lightAnimationEnabled.exchange(enabled) == enabled) return;
+        emit this->lightAnimationChanged(enabled);
+        if (this->renderSurface) this->renderSurface->getRenderer().requestFrame();
+    }
+
+    void ModelerApp::endStartupLightAnimation() {
+        if (this->lightAnimationChosen) return;
+        this->setLightAnimationEnabled(false);
+    }
+
+    void ModelerApp::setStreamingMemoryBudget(Core::UInt64 bytes) {
+        this->streamingMemoryBudget = bytes;
+    }
+
+    OutlinerModel* ModelerApp::getOutliner() {
+        return &this->outliner;
+    }
+
+    Core::UInt64 ModelerApp::getUnbatchedDrawCount() const {
+        return this->unbatchedDrawCount;
+    }
+
+    Core::UInt64 ModelerApp::getBatchedDrawCount() const {
+        return this->batchedDrawCount;
+    }
+
+    void ModelerApp::setGpuPickingEnabled(bool enabled) {
+        this->gpuPickingEnabled = enabled;
+    }
+
+    void ModelerApp::setQuadViewEnabled(bool enabled) {
+        if (!this->renderSurface) return;
+        this->renderSurface->getRenderer().setViewportLayout(enabled ? RendererGL::ViewportLayout::Quad : RendererGL::ViewportLayout::Single);
+        if (!enabled) this->focusedViewport = 0;
+    }
+
+    void ModelerApp::onMouseEvent(const MouseAdapter::MouseEvent& event) {
+        MouseAdapter::MouseEventType type = event.getType();
+        // a drag stays with the view it started in, even when it crosses into another one
+        if (type == MouseAdapter::MouseEventType::ButtonPress && this->renderSurface) {
+            this->focusedViewport = this->renderSurface->getRenderer().getViewportAt(event.position.x, event.position.y);
+        }
+        if (type == MouseAdapter::MouseEventType::ButtonPress || type == MouseAdapter::MouseEventType::ButtonRelease) {
+            this->onMouseButtonAction(type, event.button, (Core::UInt32)event.position.x, (Core::UInt32)event.position.y);
         }
     }
 
     void ModelerApp::onMouseButtonAction(MouseAdapter::MouseEventType type, Core::UInt32 button, Core::UInt32 x, Core::UInt32 y) {
+        if (button != 1) return;
         switch(type) {
             case MouseAdapter::MouseEventType::ButtonPress:
             {
-                Core::Point3r pos((Core::Real)x, (Core::Real)y, (Core::Real)-1.0f);
-                if (button == 1) {
-                    CoreSync::Runnable runnable = [this, pos](Core::WeakPointer<Core::Engine> engine) {
-
-                        Core::WeakPointer<Core::Graphics> graphics = this->engine->getGraphicsSystem();
-                        Core::WeakPointer<Core::Renderer> rendererPtr = graphics->getRenderer();
-                        Core::Vector4u viewport = graphics->getViewport();
-
-                        Core::Real ndcX = (Core::Real)pos.x / (Core::Real)viewport.z * 2.0f - 1.0f;
-                        Core::Real ndcY = -((Core::Real)pos.y / (Core::Real)viewport.w * 2.0f - 1.0f);
-                        Core::Point3r ndcPos(ndcX, ndcY, -1.0);
-                        this->renderCamera->unProject(ndcPos);
-                        Core::Transform& camTransform = this->renderCamera->getOwner()->getTransform();
-                        camTransform.updateWorldMatrix();
-                        Core::Matrix4x4 camMat = camTransform.getWorldMatrix();
-                        Core::Matrix4x4 camMatInverse = camMat;
-                        camMatInverse.invert();
-
-                        Core::Point3r worldPos = ndcPos;
-                        camMat.transform(worldPos);
-                        Core::Point3r origin;
-                        camMat.transform(origin);
-                        Core::Vector3r rayDir = worldPos - origin;
-                        rayDir.normalize();
-                        Core::Ray ray(origin, rayDir);
-
-                        std::vector<Core::Hit> hits;
-                        Core::Bool hit = this->rayCaster.castRay(ray, hits);
-
-                       // std::cerr << "Hit count: " << hits.size() << std::endl;
-                        if (hits.size() > 0) {
-                            Core::Hit& hit = hits[0];
-                            Core::WeakPointer<Core::Mesh> hitObject = hit.Object;
-                            Core::WeakPointer<Core::Object3D> rootObject =this->meshToObjectMap[hitObject->getObjectID()];
-                            this->selectedObject = rootObject;
-                            if (this->selectedObject) {
-                                // std::cerr << "Selected: " << this->selectedObject->getObjectID() << std::endl;
-                            }
+                this->selectionDragActive = true;
+                this->selectionDragViewport = this->focusedViewport;
+                // holding Ctrl when the drag starts draws a lasso instead of a rectangle
+                this->selectionDragLasso = (QGuiApplication::keyboardModifiers() & Qt::ControlModifier) != 0;
+                this->selectionDragPath.clear();
+                this->selectionDragPath.push_back((Core::Int32)x);
+                this->selectionDragPath.push_back((Core::Int32)y);
+                break;
+            }
+            case MouseAdapter::MouseEventType::ButtonRelease:
+            {
+                if (!this->selectionDragActive) break;
+                this->selectionDragActive = false;
+                emit selectionMarqueeChanged(0, 0, 0, 0, false);
+                if (!this->coreSync) break;
+
+                // the render thread works in the coordinates of the view the drag started in
+                Core::UInt32 viewport = this->selectionDragViewport;
+                QRect viewportRect = this->renderSurface->getRenderer().getViewportRect(viewport);
+                Core::Int32 startX = this->selectionDragPath[0] - viewportRect.x();
+                Core::Int32 startY = this->selectionDragPath[1] - viewportRect.y();
+                Core::Int32 endX = (Core::Int32)x - viewportRect.x();
+                Core::Int32 endY = (Core::Int32)y - viewportRect.y();
+                if (std::abs(endX - startX) <= ClickTolerance && std::abs(endY - startY) <= ClickTolerance) {
+                    this->coreSync->post(RenderCommand::pick(endX, endY, viewport));
+                }
+                else if (this->selectionDragLasso) {
+                    {
+                        QMutexLocker ml(&this->lassoMutex);
+                        this->pendingLasso = this->selectionDragPath;
+                        for (size_t i = 0; i < this->pendingLasso.size(); i += 2) {
+                            this->pendingLasso[i] -= viewportRect.x();
+                            this->pendingLasso[i + 1] -= viewportRect.y();
                         }
-
-                    };
-                    if (this->coreSync) {
-                        this->coreSync->run(runnable);
                     }
+                    this->coreSync->post(RenderCommand::lassoSelect(viewport));
+                }
+                else {
+                    this->coreSync->post(RenderCommand::areaSelect(startX, startY, endX, endY, viewport));
                 }
-
                 break;
             }
+            default: break;
+        }
+    }
+
+    void ModelerApp::trackSelectionDrag(Core::Int32 x, Core::Int32 y) {
+        if (!this->selectionDragActive) return;
+
+        Core::Int32 startX = this->selectionDragPath[0];
+        Core::Int32 startY = this->selectionDragPath[1];
+        if (!this->selectionDragLasso) {
+            emit selectionMarqueeChanged(std::min(x, startX), std::min(y, startY), std::abs(x - startX), std::abs(y - startY), true);
+            return;
+        }
+
+        // the outline is thinned out as it is drawn, which keeps its triangulation cheap
+        size_t pointCount = this->selectionDragPath.size() / 2;
+        Core::Int32 lastX = this->selectionDragPath[pointCount * 2 - 2];
+        Core::Int32 lastY = this->selectionDragPath[pointCount * 2 - 1];
+        if (pointCount >= MaxLassoPoints) return;
+        if (std::abs(x - lastX) < LassoPointSpacing && std::abs(y - lastY) < LassoPointSpacing) return;
+        this->selectionDragPath.push_back(x);
+        this->selectionDragPath.push_back(y);
+    }
+
+    void ModelerApp::pick(Core::UInt32 viewport, Core::Int32 x, Core::Int32 y) {
+        if (this->gpuPickingEnabled) {
+            this->pickIdBuffer(viewport, x, y);
+            return;
+        }
+
+        ProfileScope scope("ModelerApp::pick");
+        QElapsedTimer pickTimer;
+        pickTimer.start();
+
+        Core::Real rayOrigin[3], rayDirection[3];
+        this->screenRay(viewport, x, y, rayOrigin, rayDirection);
+
+        // every object under the cursor, nearest first; an object with several meshes counts once
+        std::vector<SceneBVH::Hit> hits;
+        this->sceneBVH.castRayAll(rayOrigin, rayDirection, MaxPickHits, hits);
+        std::vector<Core::UInt64> hitObjects;
+        std::vector<Core::UInt64> hitPickables;
+        for (const SceneBVH::Hit& hit : hits) {
+            auto object = this->meshToObjectMap.find(hit.id);
+            if (object == this->meshToObjectMap.end() || !object->second) continue;
+            Core::UInt64 objectID = object->second->getObjectID();
+            if (std::find(hitObjects.begin(), hitObjects.end(), objectID) != hitObjects.end()) continue;
+            hitObjects.push_back(objectID);
+            hitPickables.push_back(hit.id);
+        }
+
+        // clicking the same spot again steps to the next object behind the previous one
+        bool sameSpot = viewport == this->lastPickViewport && std::abs(x - this->lastPickX) <= ClickTolerance && std::abs(y - this->lastPickY) <= ClickTolerance;
+        if (sameSpot && hitObjects.size() > 0 && hitObjects == this->lastPickObjects) {
+            this->pickCycleIndex = (this->pickCycleIndex + 1) % (Core::UInt32)hitObjects.size();
+        }
+        else {
+            this->pickCycleIndex = 0;
+        }
+        this->lastPickObjects = hitObjects;
+        this->lastPickX = x;
+        this->lastPickY = y;
+        this->lastPickViewport = viewport;
+
+        bool hitFound = hitObjects.size() > 0;
+        if (hitFound) {
+            this->setSelection(std::vector<Core::UInt64>(1, hitPickables[this->pickCycleIndex]));
+        }
+        emit pickCompleted(pickTimer.nsecsElapsed() / 1000000.0, hitFound);
+    }
+
+    // Only the frontmost object can be read from the ID buffer, so there's no stepping through
+    // the ones behind it. The result arrives with a later frame.
+    void ModelerApp::pickIdBuffer(Core::UInt32 viewport, Core::Int32 x, Core::Int32 y) {
+        QElapsedTimer pickTimer;
+        pickTimer.start();
+        this->lastPickObjects.clear();
+        this->pickCycleIndex = 0;
+        // requests made in one frame share an ID pass, which is drawn from the latest view clicked
+        this->gpuPickViewport = viewport;
+
+        bool requested = this->gpuPicker->requestPick(x, y, [this, pickTimer](Core::UInt32 id) {
+            bool hitFound = id != 0;
+            if (hitFound) {
+                this->setSelection(std::vector<Core::UInt64>(1, id));
+                this->renderSurface->getRenderer().requestFrame();
+            }
+            emit pickCompleted(pickTimer.nsecsElapsed() / 1000000.0, hitFound);
+        });
+        if (!requested) {
+            emit pickCompleted(pickTimer.nsecsElapsed() / 1000000.0, false);
+        }
+    }
+
+    void ModelerApp::selectArea(Core::UInt32 viewport, Core::Int32 startX, Core::Int32 startY, Core::Int32 endX, Core::Int32 endY) {
+        ProfileScope scope("ModelerApp::selectArea");
+        QElapsedTimer selectTimer;
+        selectTimer.start();
+
+        std::vector<Core::UInt64> pickableIDs;
+        if (startX != endX && startY != endY) {
+            Core::Int32 minX = std::min(startX, endX), maxX = std::max(startX, endX);
+            Core::Int32 minY = std::min(startY, endY), maxY = std::max(startY, endY);
+            Core::Int32 corners[8] = {minX, minY, maxX, minY, maxX, maxY, minX, maxY};
+            Core::Real planes[4 * 4];
+            Core::UInt32 planeCount = this->screenVolume(viewport, corners, 4, planes);
+            this->sceneBVH.queryVolume(planes, planeCount, pickableIDs);
         }
+        this->setSelection(pickableIDs);
+        emit pickCompleted(selectTimer.nsecsElapsed() / 1000000.0, pickableIDs.size() > 0);
     }
 
-    void ModelerApp::onGesture(GestureAdapter::GestureEvent event) {
+    void ModelerApp::selectLasso(Core::UInt32 viewport) {
+        ProfileScope scope("ModelerApp::selectLasso");
+        QElapsedTimer selectTimer;
+        selectTimer.start();
+
+        std::vector<Core::Int32> outline;
+        {
+            QMutexLocker ml(&this->lassoMutex);
+            outline.swap(this->pendingLasso);
+        }
+
+        // the lasso is usually concave, so it is cut into triangles and each one queried as its
+        // own volume; setSelection() drops the duplicates
+        std::vector<Core::UInt32> triangles;
+        triangulateOutline(outline, triangles);
+        std::vector<Core::UInt64> pickableIDs;
+        std::vector<Core::UInt64> triangleIDs;
+        for (Core::UInt32 t = 0; t < triangles.size(); t += 3) {
+            Core::Int32 corners[6];
+            for (unsigned int c = 0; c < 3; c++) {
+                corners[c * 2] = outline[triangles[t + c] * 2];
+                corners[c * 2 + 1] = outline[triangles[t + c] * 2 + 1];
+            }
+            Core::Real planes[3 * 4];
+            Core::UInt32 planeCount = this->screenVolume(viewport, corners, 3, planes);
+            this->sceneBVH.queryVolume(planes, planeCount, triangleIDs);
+            pickableIDs.insert(pickableIDs.end(), triangleIDs.begin(), triangleIDs.end());
+        }
+        this->setSelection(pickableIDs);
+        emit pickCompleted(selectTimer.nsecsElapsed() / 1000000.0, pickableIDs.size() > 0);
+    }
+
+    void ModelerApp::screenRay(Core::UInt32 viewport, Core::Int32 x, Core::Int32 y, Core::Real* origin, Core::Real* direction) {
+        Core::WeakPointer<Core::Camera> camera = this->viewports[viewport].camera;
+        Core::Vector4u viewportRect = camera->getRenderTarget()->getViewport();
+
+        Core::Real ndcX = (Core::Real)x / (Core::Real)viewportRect.z * 2.0f - 1.0f;
+        Core::Real ndcY = -((Core::Real)y / (Core::Real)viewportRect.w * 2.0f - 1.0f);
+        Core::Point3r ndcPos(ndcX, ndcY, -1.0);
+        camera->unProject(ndcPos);
+        Core::Transform& camTransform = camera->getOwner()->getTransform();
+        camTransform.updateWorldMatrix();
+        Core::Matrix4x4 camMat = camTransform.getWorldMatrix();
+
+        Core::Point3r worldPos = ndcPos;
+        camMat.transform(worldPos);
+        Core::Point3r cameraOrigin;
+        camMat.transform(cameraOrigin);
+        Core::Vector3r rayDir = worldPos - cameraOrigin;
+        rayDir.normalize();
+        origin[0] = cameraOrigin.x; origin[1] = cameraOrigin.y; origin[2] = cameraOrigin.z;
+        direction[0] = rayDir.x; direction[1] = rayDir.y; direction[2] = rayDir.z;
+    }
+
+    Core::UInt32 ModelerApp::screenVolume(Core::UInt32 viewport, const Core::Int32* points, Core::UInt32 pointCount, Core::Real* planes) {
+        if (pointCount > SceneBVH::MaxVolumePlanes) pointCount = SceneBVH::MaxVolumePlanes;
+        Core::Real origin[3];
+        Core::Real directions[SceneBVH::MaxVolumePlanes][3];
+        Core::Real center[3] = {0.0f, 0.0f, 0.0f};
+        for (Core::UInt32 i = 0; i < pointCount; i++) {
+            this->screenRay(viewport, points[i * 2], points[i * 2 + 1], origin, directions[i]);
+            for (unsigned int axis = 0; axis < 3; axis++) center[axis] += directions[i][axis];
+        }
+
+        // each side plane contains the camera position and two neighbouring corner rays, and is
+        // flipped if needed so the polygon's middle is on its inner side
+        for (Core::UInt32 i = 0; i < pointCount; i++) {
+            const Core::Real* a = directions[i];
+            const Core::Real* b = directions[(i + 1) % pointCount];
+            Core::Real* plane = planes + i * 4;
+            plane[0] = a[1] * b[2] - a[2] * b[1];
+            plane[1] = a[2] * b[0] - a[0] * b[2];
+            plane[2] = a[0] * b[1] - a[1] * b[0];
+            if (plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] < 0.0f) {
+                for (unsigned int axis = 0; axis < 3; axis++) plane[axis] = -plane[axis];
+            }
+            plane[3] = -(plane[0] * origin[0] + plane[1] * origin[1] + plane[2] * origin[2]);
+        }
+        return pointCount;
+    }
+
+    void ModelerApp::setSelection(const std::vector<Core::UInt64>& pickableIDs) {
+        this->selectedObjects.clear();
+        std::unordered_set<Core::UInt64> selectedIDs;
+        for (Core::UInt64 pickableID : pickableIDs) {
+            auto object = this->meshToObjectMap.find(pickableID);
+            if (object == this->meshToObjectMap.end() || !object->second) continue;
+            Core::UInt64 objectID = object->second->getObjectID();
+            if (!selectedIDs.insert(objectID).second) continue;
+            this->selectedObjects.push_back(object->second);
+        }
+    }
+
+    void ModelerApp::onRenderCommand(const RenderCommand& command) {
+        if (command.viewport >= RendererGL::MaxViewports) return;
+        switch(command.type) {
+            case RenderCommand::Type::Pick:
+                this->pick(command.viewport, command.endX, command.endY);
+            break;
+            case RenderCommand::Type::AreaSelect:
+                this->selectArea(command.viewport, command.startX, command.startY, command.endX, command.endY);
+            break;
+            case RenderCommand::Type::LassoSelect:
+                this->selectLasso(command.viewport);
+            break;
+            default: break;
+        }
+    }
+
+    Core::UInt64 ModelerApp::addPickableMesh(Core::WeakPointer<Core::Object3D> object, std::shared_ptr<MeshBVH> meshBVH) {
+        object->getTransform().updateWorldMatrix();
+        Core::Matrix4x4 worldMatrix = object->getTransform().getWorldMatrix();
+        return this->addPickableMesh(object, meshBVH, worldMatrix.getData());
+    }
+
+    Core::UInt64 ModelerApp::addPickableMesh(Core::WeakPointer<Core::Object3D> object, std::shared_ptr<MeshBVH> meshBVH, const Core::Real* worldMatrix) {
+        // a shared mesh can be referenced by many objects, so every reference gets its own ID
+        Core::UInt64 pickableID = this->nextPickableID++;
+        this->sceneBVH.addInstance(pickableID, meshBVH, worldMatrix);
+        this->meshToObjectMap[pickableID] = object;
+        return pickableID;
+    }
+
+    Core::WeakPointer<Core::Object3D> ModelerApp::getHighlightProxy(Core::WeakPointer<Core::Object3D> object) {
+        auto batched = this->batchedMeshes.find(object->getObjectID());
+        if (batched == this->batchedMeshes.end()) return Core::WeakPointer<Core::Object3D>();
+
+        Core::WeakPointer<Core::Object3D>& proxy = this->highlightProxies[object->getObjectID()];
+        if (!proxy) {
+            Core::WeakPointer<MeshContainer> proxyContainer(this->engine->createObject3D<MeshContainer>());
+            this->engine->createRenderer<Core::MeshRenderer>(this->proxyMaterial, proxyContainer);
+            for (Core::WeakPointer<Core::Mesh> mesh : batched->second) {
+                proxyContainer->addRenderable(mesh);
+            }
+            proxy = proxyContainer;
+        }
+
+        // the proxy is never part of the scene, so it carries the instance's world transform directly
+        auto transformNode = this->transformNodes.find(object->getObjectID());
+        if (transformNode != this->transformNodes.end()) {
+            proxy->getTransform().getLocalMatrix().copy(this->transforms->getWorldMatrix(transformNode->second));
+        } else {
+            object->getTransform().updateWorldMatrix();
+            proxy->getTransform().getLocalMatrix().copy(object->getTransform().getWorldMatrix());
+        }
+        proxy->getTransform().updateWorldMatrix();
+        return proxy;
+    }
+
+    void ModelerApp::onGesture(const GestureAdapter::GestureEvent& event) {
         if (this->engineReady) {
+            RendererGL& renderer = this->renderSurface->getRenderer();
             GestureAdapter::GestureEventType eventType = event.getType();
             switch(eventType) {
                 case GestureAdapter::GestureEventType::Drag:
+                    // the left button selects, the camera is driven by the others
+                    if (event.pointer == GestureAdapter::GesturePointer::Primary) {
+                        this->trackSelectionDrag(event.end.x, event.end.y);
+                        return;
+                    }
+                break;
                 case GestureAdapter::GestureEventType::Scroll:
-                    this->orbitControls->handleGesture((event));
+                    this->focusedViewport = renderer.getViewportAt(event.end.x, event.end.y);
                 break;
             }
+
+            // the camera controls work in the coordinates of their own view
+            Core::UInt32 viewport = this->focusedViewport;
+            QRect viewportRect = renderer.getViewportRect(viewport);
+            GestureAdapter::GestureEvent localEvent = event;
+            localEvent.start = Core::Vector2i(event.start.x - viewportRect.x(), event.start.y - viewportRect.y());
+            localEvent.end = Core::Vector2i(event.end.x - viewportRect.x(), event.end.y - viewportRect.y());
+            this->viewports[viewport].orbitControls->handleGesture(localEvent);
         }
     }
 
     void ModelerApp::onEngineReady(Core::WeakPointer<Core::Engine> engine) {
         this->engineReady = true;
 
+        // batched instances have no renderables of their own, so they are drawn through a proxy
+        this->gpuPicker = std::make_shared<GpuPicker>(engine);
+        this->gpuPicker->setProxyResolver(std::bind(&ModelerApp::getHighlightProxy, this, std::placeholders::_1));
+        this->selectionHighlighter = std::make_shared<SelectionHighlighter>(engine);
+        this->selectionHighlighter->setProxyResolver(std::bind(&ModelerApp::getHighlightProxy, this, std::placeholders::_1));
+
         Core::WeakPointer<Core::Scene> scene(engine->createScene());
         engine->setActiveScene(scene);
         this->sceneRoot = scene->getRoot();
 
         // ====== initial camera setup ====================
-        Core::WeakPointer<Core::Object3D> cameraObj = engine->createObject3D<Core::Object3D>();
-        this->renderCamera = engine->createPerspectiveCamera(cameraObj, Core::Camera::DEFAULT_FOV, Core::Camera::DEFAULT_ASPECT_RATIO, 0.1f, 100);
-        this->sceneRoot->addChild(cameraObj);
-
-        Core::Quaternion qA;
-        qA.fromAngleAxis(0.0, 0, 1, 0);
-        Core::Matrix4x4 rotationMatrixA;
-        qA.rotationMatrix(rotationMatrixA);
-
-        Core::Matrix4x4 worldMatrix;
-        worldMatrix.multiply(rotationMatrixA);
-        worldMatrix.translate(0, 0, 12);
-        worldMatrix.translate(0, 5, 0);
-
-        cameraObj->getTransform().getLocalMatrix().copy(worldMatrix);
-        cameraObj->getTransform().updateWorldMatrix();
-        cameraObj->getTransform().lookAt(Core::Point3r(0, 0, 0));
+        // one camera per renderer viewport: the main view, then the top, front and side views
+        // of the quad layout. Each renders into its viewport's target, which the render surface
+        // shows; cameras of views the layout hides are deactivated.
+        static const Core::Real cameraPositions[RendererGL::MaxViewports][3] = {
+            {0.0f, 5.0f, 12.0f},
+            {0.0f, 12.0f, 0.01f},
+            {0.0f, 0.0f, 12.0f},
+            {12.0f, 0.0f, 0.0f},
+        };
+        for (Core::UInt32 i = 0; i < RendererGL::MaxViewports; i++) {
+            Core::WeakPointer<Core::Object3D> cameraObj = engine->createObject3D<Core::Object3D>();
+            Core::WeakPointer<Core::Camera> camera = engine->createPerspectiveCamera(cameraObj, Core::Camera::DEFAULT_FOV, Core::Camera::DEFAULT_ASPECT_RATIO, 0.1f, 100);
+            camera->setRenderTarget(this->renderSurface->getRenderer().getViewportTarget(i));
+            this->sceneRoot->addChild(cameraObj);
+
+            Core::Matrix4x4 worldMatrix;
+            worldMatrix.translate(cameraPositions[i][0], cameraPositions[i][1], cameraPositions[i][2]);
+            cameraObj->getTransform().getLocalMatrix().copy(worldMatrix);
+            cameraObj->getTransform().updateWorldMatrix();
+            cameraObj->getTransform().lookAt(Core::Point3r(0, 0, 0));
+            cameraObj->setActive(i < this->renderSurface->getRenderer().getViewportCount());
+            this->viewports[i].camera = camera;
+
+            Core::WeakPointer<Core::Object3D> maskCameraObj = engine->createObject3D<Core::Object3D>();
+            Core::WeakPointer<Core::Camera> maskCamera = engine->createPerspectiveCamera(maskCameraObj, Core::Camera::DEFAULT_FOV, Core::Camera::DEFAULT_ASPECT_RATIO, 0.1f, 100);
+            SelectionHighlighter::setupMaskCamera(maskCamera);
+            this->viewports[i].maskCamera = maskCamera;
+        }
 
 
         // ====== model platform vertex attributes ====================
@@ -329,26 +942,37 @@ namespace Modeler {
 
 
         // ======= model platform objects ===============
-        Core::WeakPointer<Core::Mesh> slab(engine->createMesh(36, false));
+        // the cube arrays are unindexed, so weld them into an indexed mesh
+        ImportedMesh slabData;
+        slabData.vertexCount = 36;
+        slabData.positions.assign(cubeVertexPositions, cubeVertexPositions + 36 * 4);
+        slabData.normals.assign(cubeVertexNormals, cubeVertexNormals + 36 * 4);
+        slabData.faceNormals.assign(36 * 4, 0.0f);
+        slabData.colors.assign(cubeVertexColors, cubeVertexColors + 36 * 4);
+        for (Core::UInt32 i = 0; i < 36; i++) slabData.indices.push_back(i);
+        MeshOptimizer::optimize(slabData);
+
+        Core::WeakPointer<Core::Mesh> slab(engine->createMesh(slabData.vertexCount, (Core::UInt32)slabData.indices.size()));
         slab->init();
         slab->enableAttribute(Core::StandardAttribute::Position);
         Core::Bool positionInited = slab->initVertexPositions();
         ASSERT(positionInited, "Unable to initialize slab mesh vertex positions.");
-        slab->getVertexPositions()->store(cubeVertexPositions);
+        slab->getVertexPositions()->store(slabData.positions.data());
 
         slab->enableAttribute(Core::StandardAttribute::Color);
         Core::Bool colorInited = slab->initVertexColors();
         ASSERT(colorInited, "Unable to initialize slab mesh vertex colors.");
-        slab->getVertexColors()->store(cubeVertexColors);
+        slab->getVertexColors()->store(slabData.colors.data());
 
         slab->enableAttribute(Core::StandardAttribute::Normal);
         Core::Bool normalInited = slab->initVertexNormals();
         ASSERT(normalInited, "Unable to initialize slab mesh vertex normals.");
-        slab->getVertexNormals()->store(cubeVertexNormals);
+        slab->getVertexNormals()->store(slabData.normals.data());
 
         slab->enableAttribute(Core::StandardAttribute::FaceNormal);
         Core::Bool faceNormalInited = slab->initVertexFaceNormals();
 
+        slab->getIndexBuffer()->setIndices(slabData.indices.data());
         slab->calculateBoundingBox();
         slab->calculateNormals(75.0f);
 
@@ -356,15 +980,21 @@ namespace Modeler {
         Core::WeakPointer<Core::MeshRenderer> bottomSlabRenderer(engine->createRenderer<Core::MeshRenderer>(cubeMaterial, bottomSlabObj));
         bottomSlabObj->addRenderable(slab);
         sceneRoot->addChild(bottomSlabObj);
-        this->rayCaster.addObject(bottomSlabObj, slab);
-        this->meshToObjectMap[slab->getObjectID()] = bottomSlabObj;
-        // this->meshToObjectMap[slab->getObjectID()] = Core::WeakPointer<MeshContainer>::dynamicPointerCast<Core::Object3D>( bottomSlabObj);
         bottomSlabObj->getTransform().getLocalMatrix().scale(15.0f, 1.0f, 15.0f);
         bottomSlabObj->getTransform().getLocalMatrix().preTranslate(Core::Vector3r(0.0f, -1.0f, 0.0f));
         bottomSlabObj->getTransform().getLocalMatrix().preRotate(0.0f, 1.0f, 0.0f,Core::Math::PI / 4.0f);
+        std::shared_ptr<MeshBVH> slabBVH = std::make_shared<MeshBVH>(slabData.positions.data(), 4, slabData.vertexCount,
+                                                                     slabData.indices.data(), (Core::UInt32)slabData.indices.size());
+        this->gpuPicker->addObject((Core::UInt32)this->addPickableMesh(bottomSlabObj, slabBVH), bottomSlabObj);
+        this->culler.addObject(bottomSlabObj, slabBVH->getBounds());
 
 
         // ========== lights ============================
+        // Shadow maps aren't cached: Core renders both of them inside its renderer on every
+        // frame that is drawn, and exposes no shadow pass or target to keep one from an earlier
+        // frame. While the point light animates (by default for the first seconds, see
+        // StartupLightAnimationDuration) every frame redraws its shadow cube. The light's matrix
+        // is only written while it moves, so a still light doesn't look changed to Core.
         Core::WeakPointer<Core::Object3D> ambientLightObject = engine->createObject3D();
         this->sceneRoot->addChild(ambientLightObject);
         Core::WeakPointer<Core::AmbientLight> ambientLight = engine->createLight<Core::AmbientLight>(ambientLightObject);
@@ -385,14 +1015,30 @@ namespace Modeler {
         directionalLightObject->getTransform().lookAt(Core::Point3r(1.0f, -1.0f, 1.0f));
 
         engine->onUpdate([this, pointLightObject]() {
+            ProfileScope scope("ModelerApp::updateLight");
+
+            // only this thread begins and ends the animation, so toggles can't pair up wrongly
+            bool animate = this->lightAnimationEnabled;
+            if (animate != this->lightAnimationRunning) {
+                this->lightAnimationRunning = animate;
+                if (animate) this->renderSurface->getRenderer().beginAnimation();
+                else this->renderSurface->getRenderer().endAnimation();
+            }
 
-            static Core::Real rotationAngle = 0.0;
             if (Core::WeakPointer<Core::Object3D>::isValid(pointLightObject)) {
-                rotationAngle += 0.6 * Core::Time::getDeltaTime();
-                if (rotationAngle >= Core::Math::TwoPI) rotationAngle -= Core::Math::TwoPI;
+                // only touch the light when it actually moves, otherwise its transform (and
+                // anything keyed off it, like the shadow cube) looks changed every frame
+                if (this->lightTransformValid && !animate) return;
+
+                // frames can be far apart in on-demand mode, so clamp the step
+                if (animate) {
+                    this->lightRotationAngle += 0.6 * std::min((Core::Real)Core::Time::getDeltaTime(), 0.1f);
+                }
+                if (this->lightRotationAngle >= Core::Math::TwoPI) this->lightRotationAngle -= Core::Math::TwoPI;
+                this->lightTransformValid = true;
 
                 Core::Quaternion qA;
-                qA.fromAngleAxis(rotationAngle, 0, 1, 0);
+                qA.fromAngleAxis(this->lightRotationAngle, 0, 1, 0);
                 Core::Matrix4x4 rotationMatrixA;
                 qA.rotationMatrix(rotationMatrixA);
 
@@ -409,41 +1055,103 @@ namespace Modeler {
 
                 Core::WeakPointer<Core::Object3D> lightObjectPtr = pointLightObject;
                 lightObjectPtr->getTransform().getLocalMatrix().copy(worldMatrix);
+            }
+        }, true);
 
-                auto vp = Core::Engine::instance()->getGraphicsSystem()->getCurrentRenderTarget()->getViewport();
-                this->renderCamera->setAspectRatioFromDimensions(vp.z, vp.w);
-
+        // picks and the culling in the latch see this frame's imports and world matrices
+        engine->onUpdate([this]() {
+            {
+                ProfileScope scope("ModelImporter::processUploads");
+                this->modelImporter->processUploads();
+            }
+            {
+                ProfileScope scope("ModelerApp::updateTransforms");
+                this->updateTransforms();
+            }
+            {
+                ProfileScope scope("ModelerApp::processCommands");
+                this->coreSync->processCommands();
             }
         }, true);
 
+        // the camera is only final once the latest input has been latched, so culling and
+        // streaming run from the latch as well, right before the frame is drawn
+        this->renderSurface->getRenderer().setLatchCallback([this, pointLightObject](RendererGL* renderer) -> Core::UInt64 {
+            // every view's input is latched, and the oldest of it is what the frame reports
+            Core::UInt64 inputNs = 0;
+            Core::UInt32 viewportCount = renderer->getViewportCount();
+            for (Core::UInt32 i = 0; i < RendererGL::MaxViewports; i++) {
+                Viewport& viewport = this->viewports[i];
+                viewport.camera->getOwner()->setActive(i < viewportCount);
+                Core::Vector4u viewportRect = viewport.camera->getRenderTarget()->getViewport();
+                if ((int)viewportRect.z != viewport.aspectWidth || (int)viewportRect.w != viewport.aspectHeight) {
+                    viewport.camera->setAspectRatioFromDimensions(viewportRect.z, viewportRect.w);
+                    viewport.maskCamera->setAspectRatioFromDimensions(viewportRect.z, viewportRect.w);
+                    viewport.aspectWidth = viewportRect.z;
+                    viewport.aspectHeight = viewportRect.w;
+                }
+                viewport.orbitControls->setViewportSize(viewportRect.z, viewportRect.w);
+                Core::UInt64 viewportInputNs = viewport.orbitControls->latch();
+                if (viewportInputNs != 0 && (inputNs == 0 || viewportInputNs < inputNs)) inputNs = viewportInputNs;
+            }
+            ProfileScope scope("ModelerApp::cull");
+
+            // all views are culled in one pass over the BVH; the shared active set is drawn by each
+            Core::Matrix4x4 viewProjections[RendererGL::MaxViewports];
+            Core::Real viewPositions[RendererGL::MaxViewports][3];
+            VisibilityCuller::View views[RendererGL::MaxViewports];
+            for (Core::UInt32 i = 0; i < viewportCount; i++) {
+                Core::WeakPointer<Core::Camera> camera = this->viewports[i].camera;
+                Core::Transform& camTransform = camera->getOwner()->getTransform();
+                camTransform.updateWorldMatrix();
+                Core::Matrix4x4 viewMatrix = camTransform.getWorldMatrix();
+                viewMatrix.invert();
+                viewProjections[i] = camera->getProjectionMatrix();
+                viewProjections[i].multiply(viewMatrix);
+
+                const Core::Real* cameraMatrix = camTransform.getWorldMatrix().getData();
+                for (unsigned int axis = 0; axis < 3; axis++) viewPositions[i][axis] = cameraMatrix[12 + axis];
+                views[i].viewProjection = viewProjections[i].getData();
+                views[i].cameraPosition = viewPositions[i];
+                views[i].projectionScale = camera->getProjectionMatrix().getData()[5];
+            }
+
+            // shadow casters just outside the view still have to reach the shadow maps
+            static const Core::Real directionalLightDirection[3] = {0.57735f, -0.57735f, 0.57735f};
+            pointLightObject->getTransform().updateWorldMatrix();
+            const Core::Real* lightMatrix = pointLightObject->getTransform().getWorldMatrix().getData();
+            Core::Real pointLightPosition[3] = {lightMatrix[12], lightMatrix[13], lightMatrix[14]};
+            this->culler.clearShadowLights();
+            this->culler.addDirectionalShadowLight(directionalLightDirection);
+            this->culler.addPointShadowLight(pointLightPosition);
 
+            this->culler.cull(views, viewportCount);
+
+            // streamed geometry is ranked for the view being worked in, every frame since it moves
+            Core::UInt32 focused = this->focusedViewport;
+            if (focused >= viewportCount) focused = 0;
+            this->modelStreamer->setMemoryBudget(this->streamingMemoryBudget);
+            this->modelStreamer->update(views[focused].viewProjection, views[focused].cameraPosition);
+            return inputNs;
+        });
+
+        this->proxyMaterial = engine->createMaterial<Core::BasicColoredMaterial>();
+        this->proxyMaterial->setLit(false);
 
-        this->highlightMaterial = engine->createMaterial<Core::BasicColoredMaterial>();
-        this->highlightMaterial->setBlendingMode(Core::RenderState::BlendingMode::Custom);
-        this->highlightMaterial->setSourceBlendingMethod(Core::RenderState::BlendingMethod::SrcAlpha);
-        this->highlightMaterial->setDestBlendingMethod(Core::RenderState::BlendingMethod::OneMinusSrcAlpha);
-        this->highlightMaterial->setLit(false);
         engine->onRender([this]() {
-             Core::Color highlightColor(1.0, 0.65, 0.0, 0.5);
-             Core::Color highlightLineColor(1.0, 0.65, 0.0, 1.0);
-             if (this->selectedObject) {
-                  //  std::cerr << "rendering..." << this->selectedObject->getObjectID() << std::endl;
-                    this->renderCamera->setAutoClearRenderBuffer(Core::RenderBufferType::Color, false);
-                    this->renderCamera->setAutoClearRenderBuffer(Core::RenderBufferType::Depth, false);
-
-                    this->highlightMaterial->setZOffset(-.00005f);
-                    this->highlightMaterial->setColor(highlightColor);
-                    Core::Engine::instance()->getGraphicsSystem()->getRenderer()->renderObjectBasic(this->selectedObject, this->renderCamera, this->highlightMaterial);
-                    this->highlightMaterial->setRenderStyle(Core::RenderStyle::Line);
-                    this->highlightMaterial->setZOffset(-.0001f);
-                    this->highlightMaterial->setColor(highlightLineColor);
-                    Core::Engine::instance()->getGraphicsSystem()->getRenderer()->renderObjectBasic(this->selectedObject, this->renderCamera, this->highlightMaterial);
-                    this->highlightMaterial->setRenderStyle(Core::RenderStyle::Fill);
-                    this->highlightMaterial->setColor(highlightColor);
-
-                    this->renderCamera->setAutoClearRenderBuffer(Core::RenderBufferType::Color, true);
-                    this->renderCamera->setAutoClearRenderBuffer(Core::RenderBufferType::Depth, true);
+            if (this->selectedObjects.size() == 0) return;
+            ProfileScope scope("ModelerApp::renderSelection");
+            Core::UInt32 viewportCount = this->renderSurface->getRenderer().getViewportCount();
+            for (Core::UInt32 i = 0; i < viewportCount; i++) {
+                this->selectionHighlighter->render(this->viewports[i].camera, this->viewports[i].maskCamera, this->selectedObjects);
             }
         }, true);
+
+        engine->onRender([this]() {
+            if (!this->gpuPicker->hasPendingPicks()) return;
+            this->gpuPicker->render(this->viewports[this->gpuPickViewport].camera);
+            // read backs resolve on later frames, which on-demand mode wouldn't otherwise produce
+            if (this->gpuPicker->hasPendingPicks()) this->renderSurface->getRenderer().requestFrame();
+        }, true);
     }
 }
@@ -2,23 +2,35 @@
 
 #include <vector>
 #include <memory>
+#include <atomic>
 
 #include <QGuiApplication>
 #include <QtQuick/QQuickView>
 #include <QObject>
 #include <QString>
+#include <QStringList>
+#include <QMutex>
 
 #include "ModelerAppWindow.h"
 #include "GestureAdapter.h"
-#include "PipedEventAdapter.h"
 #include "OrbitControls.h"
 #include "CoreSync.h"
+#include "JobSystem.h"
+#include "TransformHierarchy.h"
+#include "ModelImporter.h"
+#include "ModelStreamer.h"
+#include "SceneBVH.h"
+#include "MeshBVH.h"
+#include "VisibilityCuller.h"
+#include "GpuPicker.h"
+#include "SelectionHighlighter.h"
+#include "RendererGL.h"
+#include "OutlinerModel.h"
 
 #include "Core/Engine.h"
 #include "Core/material/BasicTexturedMaterial.h"
 #include "Core/material/BasicColoredMaterial.h"
 #include "Core/material/Shader.h"
-#include "Core/scene/RayCaster.h"
 
 static const char gridMaterial_vertex[] =
     "#version 100\n"
@@ -94,6 +106,15 @@ namespace Modeler {
     public:
 
         const static int MaxWindows = 32;
+        // a left-button press and release closer than this (in pixels) is a click, not a marquee
+        const static Core::Int32 ClickTolerance = 4;
+        // repeated clicks on one spot step through at most this many objects behind each other
+        const static Core::UInt32 MaxPickHits = 16;
+        const static Core::Int32 LassoPointSpacing = 4;
+        const static Core::UInt32 MaxLassoPoints = 256;
+        // the light animates at startup, then stops so the idle app stops rendering, unless the
+        // animation was switched on or off in the meantime (milliseconds)
+        const static int StartupLightAnimationDuration = 20000;
 
         enum class AppWindowType {
             None = 0,
@@ -104,30 +125,165 @@ namespace Modeler {
         void initialize(QQuickView* rootView);
         bool addLoadedWindow(ModelerAppWindow* window, AppWindowType type);
         bool addLoadedWindow(const std::string& windowName, AppWindowType type);
+        // thread-safe; returns false before the engine is ready or when the command queue is full
+        bool postRenderCommand(const RenderCommand& command);
+        // GPU memory the geometry of streamed imports may take, thread-safe
+        void setStreamingMemoryBudget(Core::UInt64 bytes);
+        // every imported hierarchy, for the outliner
+        OutlinerModel* getOutliner();
+        // thread-safe: draws the committed imports' meshes would take one per node reference,
+        // and what they take with static batching
+        Core::UInt64 getUnbatchedDrawCount() const;
+        Core::UInt64 getBatchedDrawCount() const;
 
     private:
 
         void onMouseButtonAction(MouseAdapter::MouseEventType type, Core::UInt32 button, Core::UInt32 x, Core::UInt32 y);
-        void onGesture(GestureAdapter::GestureEvent event);
+        void onMouseEvent(const MouseAdapter::MouseEvent& event);
+        void onGesture(const GestureAdapter::GestureEvent& event);
+        void trackSelectionDrag(Core::Int32 x, Core::Int32 y);
         void onEngineReady(Core::WeakPointer<Core::Engine> engine);
+        ModelImporter::ImportSettings getImportSettings(const std::string& path, const QString& scaleText, const QString& smoothingThresholdText, bool zUp,
+                                                        bool generateLods, bool optimizeMeshes, bool packVertices, bool stream) const;
+        ModelImporter::CommitCallback getCommitCallback(bool zUp);
+        ModelImporter::LodCallback getLodCallback();
+        // render thread. The only way model roots are added to the scene.
+        bool registerModelRoot(const ModelImporter::ImportResult& result);
+        void registerModelNodes(const ModelImporter::ImportResult& result, Core::UInt32 rootNode);
+        // render thread: follows every change the app makes to an imported object's local matrix
+        void syncLocalMatrix(Core::WeakPointer<Core::Object3D> object);
+        // render thread, once per frame before picking and culling
+        void updateTransforms();
+        void onRenderCommand(const RenderCommand& command);
+        // positions are local to the viewport
+        void pick(Core::UInt32 viewport, Core::Int32 x, Core::Int32 y);
+        void pickIdBuffer(Core::UInt32 viewport, Core::Int32 x, Core::Int32 y);
+        void selectArea(Core::UInt32 viewport, Core::Int32 startX, Core::Int32 startY, Core::Int32 endX, Core::Int32 endY);
+        void selectLasso(Core::UInt32 viewport);
+        void screenRay(Core::UInt32 viewport, Core::Int32 x, Core::Int32 y, Core::Real* origin, Core::Real* direction);
+        // planes bounding the view volume behind a convex screen polygon, through the camera position
+        Core::UInt32 screenVolume(Core::UInt32 viewport, const Core::Int32* points, Core::UInt32 pointCount, Core::Real* planes);
+        void setSelection(const std::vector<Core::UInt64>& pickableIDs);
+        Core::UInt64 addPickableMesh(Core::WeakPointer<Core::Object3D> object, std::shared_ptr<MeshBVH> meshBVH);
+        Core::UInt64 addPickableMesh(Core::WeakPointer<Core::Object3D> object, std::shared_ptr<MeshBVH> meshBVH, const Core::Real* worldMatrix);
+        Core::WeakPointer<Core::Object3D> getHighlightProxy(Core::WeakPointer<Core::Object3D> object);
 
-        bool engineReady;
+        std::atomic<bool> engineReady; // set on the render thread, read on the GUI thread
+        std::atomic<bool> lightAnimationEnabled;
+        bool lightAnimationChosen;
+        // render thread: the point light's orbit, whether its matrix was ever written, and
+        // whether the renderer is animating for it
+        Core::Real lightRotationAngle;
+        bool lightTransformValid;
+        bool lightAnimationRunning;
+        // clicks go through the ID buffer, and models imported meanwhile keep no picking triangles
+        std::atomic<bool> gpuPickingEnabled;
+        std::atomic<Core::UInt64> streamingMemoryBudget;
+        std::atomic<Core::UInt64> unbatchedDrawCount;
+        std::atomic<Core::UInt64> batchedDrawCount;
         QQuickView* rootView;
         ModelerAppWindow* liveWindows[MaxWindows];
-        std::shared_ptr<OrbitControls> orbitControls;
-        Core::WeakPointer<Core::Camera> renderCamera;
+        // one per renderer viewport, whether or not the current layout shows it
+        class Viewport {
+        public:
+            Viewport(): aspectWidth(0), aspectHeight(0) {}
+
+            Core::WeakPointer<Core::Camera> camera;
+            // outside the scene, draws the view's selection mask
+            Core::WeakPointer<Core::Camera> maskCamera;
+            std::shared_ptr<OrbitControls> orbitControls;
+            // render thread: the size the camera's aspect ratio was last set for
+            int aspectWidth;
+            int aspectHeight;
+        };
+        Viewport viewports[RendererGL::MaxViewports];
+        // the viewport last pressed or scrolled in; streaming ranks geometry by its camera
+        std::atomic<Core::UInt32> focusedViewport;
         Core::WeakPointer<Core::Engine> engine;
-        std::shared_ptr<PipedEventAdapter<GestureAdapter::GestureEvent>> pipedGestureAdapter;
         Core::WeakPointer<Core::Object3D> sceneRoot;
-        Core::RayCaster rayCaster;
+        SceneBVH sceneBVH;
+        VisibilityCuller culler;
         RenderSurface* renderSurface;
         std::shared_ptr<CoreSync> coreSync;
+        std::shared_ptr<JobSystem> jobSystem;
+        // world matrices of every imported node, keyed into by object ID through transformNodes
+        std::shared_ptr<TransformHierarchy> transforms;
+        std::unordered_map<Core::UInt64, Core::UInt32> transformNodes;
+        // per transform node, whatever mirrors its world matrix
+        class TransformUsers {
+        public:
+            std::vector<Core::UInt64> pickableIDs;
+            std::vector<Core::WeakPointer<Core::Object3D>> culledObjects;
+        };
+        std::vector<TransformUsers> transformUsers;
+        // imports added to the scene but not yet to picking, culling and streaming
+        class PendingModelRoot {
+        public:
+            PendingModelRoot(const ModelImporter::ImportResult& result, Core::UInt32 rootNode): result(result), rootNode(rootNode) {}
+
+            ModelImporter::ImportResult result;
+            Core::UInt32 rootNode;
+        };
+        std::vector<PendingModelRoot> pendingModelRoots;
+        std::shared_ptr<ModelImporter> modelImporter;
+        std::shared_ptr<ModelStreamer> modelStreamer;
+        OutlinerModel outliner;
+        // keyed by pickable ID: one per mesh reference, so shared meshes map to each of their objects
         std::unordered_map<Core::UInt64, Core::WeakPointer<Core::Object3D>> meshToObjectMap;
-        Core::WeakPointer<Core::Object3D> selectedObject;
-        Core::WeakPointer<Core::BasicColoredMaterial> highlightMaterial;
+        Core::UInt64 nextPickableID;
+        // draws each object under the ID of its first pickable mesh
+        std::shared_ptr<GpuPicker> gpuPicker;
+        std::unordered_map<Core::UInt64, std::vector<Core::WeakPointer<Core::Mesh>>> batchedMeshes;
+        std::unordered_map<Core::UInt64, Core::WeakPointer<Core::Object3D>> highlightProxies;
+        // render thread
+        std::vector<Core::WeakPointer<Core::Object3D>> selectedObjects;
+        std::vector<Core::UInt64> lastPickObjects;
+        Core::UInt32 pickCycleIndex;
+        Core::Int32 lastPickX;
+        Core::Int32 lastPickY;
+        Core::UInt32 lastPickViewport;
+        Core::UInt32 gpuPickViewport;
+        // GUI thread: the left-button drag in progress, as x, y pairs in surface coordinates
+        bool selectionDragActive;
+        bool selectionDragLasso;
+        Core::UInt32 selectionDragViewport;
+        std::vector<Core::Int32> selectionDragPath;
+        // the last finished lasso, waiting for the render thread, in its viewport's coordinates
+        QMutex lassoMutex;
+        std::vector<Core::Int32> pendingLasso;
+        std::shared_ptr<SelectionHighlighter> selectionHighlighter;
+        // highlight proxies need a material to be created with, but are only ever drawn with
+        // the highlighter's and the picker's
+        Core::WeakPointer<Core::BasicColoredMaterial> proxyMaterial;
+
+    signals:
+        void importProgress(const QString& path, qreal progress);
+        void importFinished(const QString& path, bool success);
+        void importNotice(const QString& path, const QString& message);
+        // emitted on the render thread, or right away when there was nothing to import
+        void batchImportFinished(int succeeded, int failed, qreal seconds);
+        // emitted on the render thread once models can be loaded
+        void engineStarted();
+        // emitted on the render thread
+        void pickCompleted(qreal latencyMs, bool hit);
+        void lightAnimationChanged(bool enabled);
+        // the marquee being dragged out, in render surface coordinates
+        void selectionMarqueeChanged(qreal x, qreal y, qreal width, qreal height, bool active);
 
     public slots:
-        void loadModel(const QString& path, const QString& scaleText, const QString& smoothingThresholdText, const bool zUp);
+        void loadModel(const QString& path, const QString& scaleText, const QString& smoothingThresholdText, const bool zUp,
+                       const bool generateLods = false, const bool optimizeMeshes = false, const bool packVertices = false,
+                       const bool stream = false);
+        // entries may be files or folders; the models are parsed concurrently and added to the
+        // scene in the order given
+        void loadModels(const QStringList& paths, const QString& scaleText, const QString& smoothingThresholdText, const bool zUp,
+                        const bool generateLods = false, const bool optimizeMeshes = false, const bool packVertices = false,
+                        const bool stream = false);
+        void setLightAnimationEnabled(bool enabled);
+        void endStartupLightAnimation();
+        void setGpuPickingEnabled(bool enabled);
+        // splits the render surface into four views: perspective, top, front and side
+        void setQuadViewEnabled(bool enabled);
     };
 }
 
@@ -1,8 +1,9 @@
-#include "Core/util/WeakPointer.h"
+#include <chrono>
 
 #include "MouseAdapter.h"
 #include "Settings.h"
 #include "Util.h"
+#include "Profiler.h"
 
 namespace Modeler {
 
@@ -10,26 +11,21 @@ namespace Modeler {
 
     }
 
-    bool MouseAdapter::setPipedEventAdapter(Core::WeakPointer<PipedEventAdapter<MouseEvent>> adapter) {
-        if(!this->pipedEventAdapter) {
-            this->pipedEventAdapter = adapter;
-            return true;
-        }
-        else {
-            return false;
-        }
+    EventQueue<MouseAdapter::MouseEvent>& MouseAdapter::getEvents() {
+        return this->events;
     }
 
-    void MouseAdapter::onMouseButtonPressed(ButtonEventCallback callback) {
-        this->buttonEventCallbacks[(Core::UInt32)MouseEventType::ButtonPress].push_back(callback);
+    void MouseAdapter::setMoveBatchingEnabled(bool enabled) {
+        this->moveBatchingEnabled = enabled;
+        if (!enabled) this->events.flush();
     }
 
-    void MouseAdapter::onMouseButtonReleased(ButtonEventCallback callback) {
-        this->buttonEventCallbacks[(Core::UInt32)MouseEventType::ButtonRelease].push_back(callback);
+    bool MouseAdapter::hasQueuedEvents() const {
+        return this->events.hasPending();
     }
 
-    void MouseAdapter::onMouseButtonClicked(ButtonEventCallback callback) {
-        this->buttonEventCallbacks[(Core::UInt32)MouseEventType::ButtonClick].push_back(callback);
+    void MouseAdapter::flushEvents() {
+        this->events.flush();
     }
 
     bool MouseAdapter::processEvent(QObject* obj, QEvent* event) {
@@ -47,59 +43,65 @@ namespace Modeler {
             MouseEventType mouseEventType;
             switch(eventType) {
                 case QEvent::MouseButtonPress:
-                {
                     buttonStatuses[buttonIndex].pressed = true;
                     buttonStatuses[buttonIndex].pressedLocation = mousePos;
                     pressedButtonMask |= 1 << (buttonIndex - 1);
                     mouseEventType = MouseEventType::ButtonPress;
-                    std::vector<ButtonEventCallback> pressCallbacks = this->buttonEventCallbacks[(Core::UInt32)MouseEventType::ButtonPress];
-                    for (ButtonEventCallback callback : pressCallbacks) {
-                        callback(MouseEventType::ButtonPress, buttonIndex, mousePos.x, mousePos.y);
-                    }
                     break;
-                }
                 case QEvent::MouseButtonRelease:
-                {
                     buttonStatuses[buttonIndex].pressed = false;
                     pressedButtonMask &= ~(1 << (buttonIndex - 1));
                     mouseEventType = MouseEventType::ButtonRelease;
-                    std::vector<ButtonEventCallback> pressCallbacks = this->buttonEventCallbacks[(Core::UInt32)MouseEventType::ButtonRelease];
-                    for (ButtonEventCallback callback : pressCallbacks) {
-                        callback(MouseEventType::ButtonRelease, buttonIndex, mousePos.x, mousePos.y);
-                    }
                     break;
-                }
-                case QEvent::MouseMove:
+                default:
                     mouseEventType = MouseEventType::MouseMove;
                     break;
-                default: break;
             }
-            if (this->pipedEventAdapter) {
-                MouseEvent event(mouseEventType);
-                event.buttons = pressedButtonMask;
-                event.position = mousePos;
-                Core::WeakPointer<PipedEventAdapter<MouseEvent>> adapterPtr(this->pipedEventAdapter);
-                adapterPtr->accept(event);
+
+            MouseEvent event(mouseEventType);
+            event.button = mouseEventType == MouseEventType::MouseMove ? 0 : buttonIndex;
+            event.buttons = pressedButtonMask;
+            event.position = mousePos;
+            event.inputTimeNs = getInputTime(mouseEvent);
+            // moves without a button held are cheap for every subscriber, so only drags are batched
+            if (mouseEventType == MouseEventType::MouseMove && this->moveBatchingEnabled && pressedButtonMask != 0) {
+                // only merged moves are ever queued, so a pending one is what this replaces
+                if (this->events.hasPending()) event.inputTimeNs = this->batchedMoveTimeNs;
+                else this->batchedMoveTimeNs = event.inputTimeNs;
+                this->events.post(event, true);
+            }
+            else {
+                this->events.dispatch(event);
             }
             return true;
         }
         else if (eventType == QEvent::Wheel ) {
 
              const QWheelEvent* const wheelEvent = static_cast<const QWheelEvent*>( event );
-             if (this->pipedEventAdapter) {
-                 MouseEvent event(MouseEventType::WheelScroll);
-                 QPoint pDelta = wheelEvent->angleDelta();
-
-                 event.scrollDelta = (Core::Real)wheelEvent->delta() / 240.0f;
-                 event.buttons = 0;
-                 Core::WeakPointer<PipedEventAdapter<MouseEvent>> adapterPtr(this->pipedEventAdapter);
-                 adapterPtr->accept(event);
-             }
+             MouseEvent event(MouseEventType::WheelScroll);
+             event.scrollDelta = (Core::Real)wheelEvent->delta() / 240.0f;
+             event.buttons = 0;
+             event.position = Core::Vector2i(wheelEvent->pos().x(), wheelEvent->pos().y());
+             event.inputTimeNs = getInputTime(wheelEvent);
+             this->events.dispatch(event);
         }
 
          return false;
     }
 
+    // Qt stamps input events in milliseconds on the platform's input clock, which on most
+    // platforms is the same monotonic clock as steady_clock. The stamp is only trusted when
+    // it's plausibly on that clock; otherwise the time the event is handled is used.
+    Core::UInt64 MouseAdapter::getInputTime(const QInputEvent* event) {
+        Core::UInt64 now = Profiler::instance().now();
+        Core::UInt32 steadyMs = (Core::UInt32)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        Core::UInt32 ageMs = steadyMs - (Core::UInt32)event->timestamp();
+        Core::UInt64 ageNs = (Core::UInt64)ageMs * 1000000ull;
+        if (event->timestamp() != 0 && ageMs < 1000 && ageNs < now) now -= ageNs;
+        // 0 means "no input" to the latch
+        return now > 0 ? now : 1;
+    }
+
     unsigned int MouseAdapter::getMouseButtonIndex(const Qt::MouseButton& button) {
         if(button == Qt::LeftButton) {return 1;}
         else if(button == Qt::RightButton) {return 2;}
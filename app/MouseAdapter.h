@@ -1,21 +1,18 @@
 #pragma once
 
-#include <memory>
-#include <functional>
-#include <vector>
-#include <unordered_map>
-
 #include <QMouseEvent>
 #include <QtQuick/qquickwindow.h>
 #include <QtQuick/QQuickItem>
 
-#include "PipedEventAdapter.h"
+#include "Event.h"
+#include "EventQueue.h"
 
 #include "Core/geometry/Vector2.h"
-#include "Core/util/WeakPointer.h"
 
 namespace Modeler {
 
+    // Turns the Qt mouse events of the render surface into MouseEvents on one channel.
+    // Everything here runs on the GUI thread.
     class MouseAdapter {
     public:
 
@@ -27,27 +24,29 @@ namespace Modeler {
             WheelScroll = 4
         };
 
-        class MouseEvent {
+        class MouseEvent: public Event {
         public:
-            MouseEvent(MouseEventType type): type(type) {}
-            MouseEventType getType() {return  type;}
+            MouseEvent(MouseEventType type): button(0), buttons(0), scrollDelta(0.0f), inputTimeNs(0), type(type) {}
+            MouseEventType getType() const {return  type;}
+            Core::UInt32 button; // the button pressed or released, see getMouseButtonIndex()
             Core::UInt32 buttons;
             Core::Vector2i position;
             Core::Real scrollDelta;
+            Core::UInt64 inputTimeNs; // when the input happened, on the Profiler clock; merged moves keep the oldest
         private:
             MouseEventType type;
         };
 
-        using ButtonEventCallback = std::function<void(MouseEventType, Core::UInt32, Core::UInt32, Core::UInt32)>;
-
         MouseAdapter();
 
         bool processEvent(QObject* obj, QEvent* event);
-        bool setPipedEventAdapter(Core::WeakPointer<PipedEventAdapter<MouseEvent>> adapter);
+        EventQueue<MouseEvent>& getEvents();
 
-        void onMouseButtonPressed(ButtonEventCallback callback);
-        void onMouseButtonReleased(ButtonEventCallback callback);
-        void onMouseButtonClicked(ButtonEventCallback callback);
+        // with batching on, moves made while a button is held are merged and only delivered by
+        // flushEvents(), so a drag costs one event per frame instead of one per input sample
+        void setMoveBatchingEnabled(bool enabled);
+        bool hasQueuedEvents() const;
+        void flushEvents();
 
     private:
         class MouseButtonStatus {
@@ -59,10 +58,12 @@ namespace Modeler {
         static const unsigned int MAX_BUTTONS = 16;
         MouseButtonStatus buttonStatuses[MAX_BUTTONS];
         unsigned int pressedButtonMask = 0;
+        bool moveBatchingEnabled = false;
+        Core::UInt64 batchedMoveTimeNs = 0;
         static unsigned int getMouseButtonIndex(const Qt::MouseButton& button);
+        static Core::UInt64 getInputTime(const QInputEvent* event);
 
-        Core::WeakPointer<PipedEventAdapter<MouseEvent>> pipedEventAdapter;
-        std::unordered_map<Core::UInt32, std::vector<ButtonEventCallback>> buttonEventCallbacks;
+        EventQueue<MouseEvent> events;
     };
 
 }
@@ -9,124 +9,170 @@
 #include "Core/render/Camera.h"
 #include "OrbitControls.h"
 #include "RenderSurface.h"
+#include "Profiler.h"
 
 namespace Modeler {
     OrbitControls::OrbitControls(Core::WeakPointer<Core::Engine> engine, Core::WeakPointer<Core::Camera> targetCamera, Core::WeakPointer<CoreSync> coreSync):
-        engine(engine), targetCamera(targetCamera), coreSync(coreSync) {
+        viewportWidth(1), viewportHeight(1), engine(engine), targetCamera(targetCamera), coreSync(coreSync) {
 
     }
 
-    void OrbitControls::handleGesture(GestureAdapter::GestureEvent event) {
+    void OrbitControls::setViewportSize(Core::UInt32 width, Core::UInt32 height) {
+        this->viewportWidth = width > 0 ? width : 1;
+        this->viewportHeight = height > 0 ? height : 1;
+    }
 
+    void OrbitControls::handleGesture(const GestureAdapter::GestureEvent& event) {
         if (event.getType() == GestureAdapter::GestureEventType::Scroll) {
+            this->queueScroll(event.scrollDistance, event.inputTimeNs);
+        }
+        else if (event.getType() == GestureAdapter::GestureEventType::Drag) {
+            this->queueDrag(event.pointer, event.start.x, event.start.y, event.end.x, event.end.y, event.inputTimeNs);
+        }
+    }
 
-            CoreSync::Runnable runnable = [this, event](Core::WeakPointer<Core::Engine> engine) {
-                Core::WeakPointer<Core::Object3D> cameraObjPtr = this->targetCamera->getOwner();
-                Core::Vector3r cameraVec;
-                cameraVec.set(0, 0, -1);
-                cameraObjPtr->getTransform().transform(cameraVec);
-                cameraVec = cameraVec * event.scrollDistance;
-                cameraObjPtr->getTransform().translate(cameraVec, Core::TransformationSpace::World);
-            };
-            if (this->coreSync) {
-                this->coreSync->run(runnable);
+    void OrbitControls::queueDrag(GestureAdapter::GesturePointer pointer, Core::Int32 startX, Core::Int32 startY, Core::Int32 endX, Core::Int32 endY, Core::UInt64 inputTimeNs) {
+        {
+            QMutexLocker ml(&this->inputMutex);
+            this->noteInput(inputTimeNs);
+            // contiguous segments collapse into one spanning drag, the orbit math only needs its ends
+            if (this->pending.dragCount > 0) {
+                DragSegment& last = this->pending.drags[this->pending.dragCount - 1];
+                bool contiguous = last.pointer == pointer && last.endX == startX && last.endY == startY;
+                if (contiguous || this->pending.dragCount == MaxPendingDrags) {
+                    last.endX = endX;
+                    last.endY = endY;
+                    return;
+                }
             }
-
+            DragSegment& segment = this->pending.drags[this->pending.dragCount++];
+            segment.pointer = pointer;
+            segment.startX = startX;
+            segment.startY = startY;
+            segment.endX = endX;
+            segment.endY = endY;
         }
-        else if (event.getType() == GestureAdapter::GestureEventType::Drag) {
+        if (this->coreSync) this->coreSync->requestFrame();
+    }
 
-            Core::Int32 eventStartX = event.start.x;
-            Core::Int32 eventStartY = event.start.y;
-            Core::Int32 eventEndX = event.end.x;
-            Core::Int32 eventEndY = event.end.y;
-            GestureAdapter::GesturePointer eventPointer = event.pointer;
+    void OrbitControls::queueScroll(Core::Real scrollDistance, Core::UInt64 inputTimeNs) {
+        {
+            QMutexLocker ml(&this->inputMutex);
+            this->noteInput(inputTimeNs);
+            this->pending.scrollDistance += scrollDistance;
+        }
+        if (this->coreSync) this->coreSync->requestFrame();
+    }
 
-            CoreSync::Runnable runnable = [this, eventStartX, eventStartY, eventEndX, eventEndY, eventPointer](Core::WeakPointer<Core::Engine> engine) {
+    // inputMutex must be held
+    void OrbitControls::noteInput(Core::UInt64 inputTimeNs) {
+        if (this->pending.oldestInputNs == 0 || inputTimeNs < this->pending.oldestInputNs) {
+            this->pending.oldestInputNs = inputTimeNs;
+        }
+    }
 
-                Core::WeakPointer<Core::Graphics> graphics = this->engine->getGraphicsSystem();
-                Core::WeakPointer<Core::Renderer> rendererPtr = graphics->getRenderer();
+    Core::UInt64 OrbitControls::latch() {
+        PendingInput input;
+        {
+            QMutexLocker ml(&this->inputMutex);
+            if (this->pending.dragCount == 0 && this->pending.scrollDistance == 0.0f) return 0;
+            input = this->pending;
+            this->pending = PendingInput();
+        }
 
-                Core::Vector4u viewport = graphics->getViewport();
-                Core::Real ndcStartX = (Core::Real)eventStartX / (Core::Real)viewport.z * 2.0f - 1.0f;
-                Core::Real ndcStartY = (Core::Real)eventStartY / (Core::Real)viewport.w * 2.0f - 1.0f;
-                Core::Real ndcEndX = (Core::Real)eventEndX / (Core::Real)viewport.z * 2.0f - 1.0f;
-                Core::Real ndcEndY = (Core::Real)eventEndY / (Core::Real)viewport.w * 2.0f - 1.0f;
+        ProfileScope scope("OrbitControls::latch");
+        for (Core::UInt32 i = 0; i < input.dragCount; i++) {
+            const DragSegment& drag = input.drags[i];
+            this->applyDrag(drag.pointer, drag.startX, drag.startY, drag.endX, drag.endY);
+        }
+        if (input.scrollDistance != 0.0f) this->applyScroll(input.scrollDistance);
+        return input.oldestInputNs;
+    }
 
-                Core::Point3r viewStartP(ndcStartX, ndcEndY, 0.25f);
-                Core::Point3r viewEndP(ndcEndX, ndcStartY, 0.25f);
-                this->targetCamera->unProject(viewStartP);
-                this->targetCamera->unProject(viewEndP);
+    void OrbitControls::applyScroll(Core::Real scrollDistance) {
+        Core::WeakPointer<Core::Object3D> cameraObjPtr = this->targetCamera->getOwner();
+        Core::Vector3r cameraVec;
+        cameraVec.set(0, 0, -1);
+        cameraObjPtr->getTransform().transform(cameraVec);
+        cameraVec = cameraVec * scrollDistance;
+        cameraObjPtr->getTransform().translate(cameraVec, Core::TransformationSpace::World);
+    }
 
-                Core::WeakPointer<Core::Object3D> cameraObjPtr = this->targetCamera->getOwner();
+    void OrbitControls::applyDrag(GestureAdapter::GesturePointer eventPointer, Core::Int32 eventStartX, Core::Int32 eventStartY, Core::Int32 eventEndX, Core::Int32 eventEndY) {
+        Core::Real ndcStartX = (Core::Real)eventStartX / (Core::Real)this->viewportWidth * 2.0f - 1.0f;
+        Core::Real ndcStartY = (Core::Real)eventStartY / (Core::Real)this->viewportHeight * 2.0f - 1.0f;
+        Core::Real ndcEndX = (Core::Real)eventEndX / (Core::Real)this->viewportWidth * 2.0f - 1.0f;
+        Core::Real ndcEndY = (Core::Real)eventEndY / (Core::Real)this->viewportHeight * 2.0f - 1.0f;
 
-                Core::Matrix4x4 viewMat = cameraObjPtr->getTransform().getWorldMatrix();
-                viewMat.transform(viewStartP);
-                viewMat.transform(viewEndP);
+        Core::Point3r viewStartP(ndcStartX, ndcEndY, 0.25f);
+        Core::Point3r viewEndP(ndcEndX, ndcStartY, 0.25f);
+        this->targetCamera->unProject(viewStartP);
+        this->targetCamera->unProject(viewEndP);
 
-                Core::Vector3r viewStart(viewStartP.x, viewStartP.y, viewStartP.z);
-                Core::Vector3r viewEnd(viewEndP.x, viewEndP.y, viewEndP.z);
+        Core::WeakPointer<Core::Object3D> cameraObjPtr = this->targetCamera->getOwner();
 
-                viewStart = Core::Point3r(viewStart.x, viewStart.y, viewStart.z) - this->origin;
-                viewEnd = Core::Point3r(viewEnd.x, viewEnd.y, viewEnd.z) - this->origin;
+        Core::Matrix4x4 viewMat = cameraObjPtr->getTransform().getWorldMatrix();
+        viewMat.transform(viewStartP);
+        viewMat.transform(viewEndP);
 
-                Core::Vector3r viewStartN = Core::Vector3r(viewStart.x, viewStart.y, viewStart.z);
-                viewStartN.normalize();
+        Core::Vector3r viewStart(viewStartP.x, viewStartP.y, viewStartP.z);
+        Core::Vector3r viewEnd(viewEndP.x, viewEndP.y, viewEndP.z);
 
-                Core::Vector3r viewEndN = Core::Vector3r(viewEnd.x, viewEnd.y, viewEnd.z);
-                viewEndN.normalize();
+        viewStart = Core::Point3r(viewStart.x, viewStart.y, viewStart.z) - this->origin;
+        viewEnd = Core::Point3r(viewEnd.x, viewEnd.y, viewEnd.z) - this->origin;
 
-                Core::Real dot = Core::Vector3r::dot(viewStartN, viewEndN);
-                 Core::Real angle = 0.0f;
-                if (dot < 1.0f && dot > -1.0f) {
-                    angle = Core::Math::aCos(dot);
-                }
-                else if (dot <= -1.0f) {
-                    angle = 180.0f;
-                }
+        Core::Vector3r viewStartN = Core::Vector3r(viewStart.x, viewStart.y, viewStart.z);
+        viewStartN.normalize();
 
-                Core::Vector3r rotAxis;
-                Core::Vector3r::cross(viewEnd, viewStart, rotAxis);
-                rotAxis.normalize();
-
-                Core::Point3r cameraPos;
-                cameraPos.set(0, 0, 0);
-                cameraObjPtr->getTransform().transform(cameraPos);
-                cameraPos.set(cameraPos.x - this->origin.x, cameraPos.y - this->origin.y, cameraPos.z - this->origin.z);
-                Core::Real distanceFromOrigin = cameraPos.magnitude();
-
-                using GesturePointer = GestureAdapter::GesturePointer;
-                if (eventPointer == GesturePointer::Secondary) {
-
-                    Core::Real rotationScaleFactor = Core::Math::max(distanceFromOrigin, 1.0f);
-                    Core::Quaternion qA;
-                    qA.fromAngleAxis(angle * rotationScaleFactor, rotAxis);
-                    Core::Matrix4x4 rot = qA.rotationMatrix();
-
-                    Core::Vector3r orgVec(this->origin.x, this->origin.y, this->origin.z);
-                    orgVec.invert();
-                    Core::Matrix4x4 worldTransformation;
-                    worldTransformation.setIdentity();
-                    worldTransformation.preTranslate(orgVec);
-                    worldTransformation.preMultiply(rot);
-                    orgVec.invert();
-                    worldTransformation.preTranslate(orgVec);
-                    cameraObjPtr->getTransform().transformBy(worldTransformation, Core::TransformationSpace::World);
-                    cameraObjPtr->getTransform().lookAt(this->origin);
+        Core::Vector3r viewEndN = Core::Vector3r(viewEnd.x, viewEnd.y, viewEnd.z);
+        viewEndN.normalize();
 
-                }
-                else if (eventPointer == GesturePointer::Tertiary) {
-                    Core::Real translationScaleFactor = distanceFromOrigin;
-                    Core::Vector3r viewDragVector = viewEnd - viewStart;
-                    viewDragVector.invert();
-                    viewDragVector = viewDragVector * translationScaleFactor;
-                    this->origin = this->origin + viewDragVector;
-                    cameraObjPtr->getTransform().translate(viewDragVector, Core::TransformationSpace::World);
-                }
-           };
-           if (this->coreSync) {
-               this->coreSync->run(runnable);
-           }
+        Core::Real dot = Core::Vector3r::dot(viewStartN, viewEndN);
+         Core::Real angle = 0.0f;
+        if (dot < 1.0f && dot > -1.0f) {
+            angle = Core::Math::aCos(dot);
+        }
+        else if (dot <= -1.0f) {
+            angle = 180.0f;
         }
 
+        Core::Vector3r rotAxis;
+        Core::Vector3r::cross(viewEnd, viewStart, rotAxis);
+        rotAxis.normalize();
+
+        Core::Point3r cameraPos;
+        cameraPos.set(0, 0, 0);
+        cameraObjPtr->getTransform().transform(cameraPos);
+        cameraPos.set(cameraPos.x - this->origin.x, cameraPos.y - this->origin.y, cameraPos.z - this->origin.z);
+        Core::Real distanceFromOrigin = cameraPos.magnitude();
+
+        using GesturePointer = GestureAdapter::GesturePointer;
+        if (eventPointer == GesturePointer::Secondary) {
+
+            Core::Real rotationScaleFactor = Core::Math::max(distanceFromOrigin, 1.0f);
+            Core::Quaternion qA;
+            qA.fromAngleAxis(angle * rotationScaleFactor, rotAxis);
+            Core::Matrix4x4 rot = qA.rotationMatrix();
+
+            Core::Vector3r orgVec(this->origin.x, this->origin.y, this->origin.z);
+            orgVec.invert();
+            Core::Matrix4x4 worldTransformation;
+            worldTransformation.setIdentity();
+            worldTransformation.preTranslate(orgVec);
+            worldTransformation.preMultiply(rot);
+            orgVec.invert();
+            worldTransformation.preTranslate(orgVec);
+            cameraObjPtr->getTransform().transformBy(worldTransformation, Core::TransformationSpace::World);
+            cameraObjPtr->getTransform().lookAt(this->origin);
+
+        }
+        else if (eventPointer == GesturePointer::Tertiary) {
+            Core::Real translationScaleFactor = distanceFromOrigin;
+            Core::Vector3r viewDragVector = viewEnd - viewStart;
+            viewDragVector.invert();
+            viewDragVector = viewDragVector * translationScaleFactor;
+            this->origin = this->origin + viewDragVector;
+            cameraObjPtr->getTransform().translate(viewDragVector, Core::TransformationSpace::World);
+        }
     }
 }
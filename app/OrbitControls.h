@@ -1,5 +1,7 @@
 #pragma once
 
+#include <QMutex>
+
 #include "GestureAdapter.h"
 #include "Core/Engine.h"
 #include "Core/geometry/Vector3.h"
@@ -10,13 +12,58 @@ namespace Modeler {
     // forward declarations
     class RenderSurface;
 
+    // Camera input is late-latched: gestures only accumulate into the pending input, and the
+    // render thread applies all of it in one go through latch(), called right before the
+    // frame's camera is used. Input that arrives while a frame is being prepared is picked
+    // up by that frame instead of waiting for the next one's command processing.
     class OrbitControls {
     public:
+        // non-contiguous drags within one frame beyond this many are folded into the last one
+        static const Core::UInt32 MaxPendingDrags = 8;
+
         OrbitControls(Core::WeakPointer<Core::Engine> engine, Core::WeakPointer<Core::Camera> targetCamera, Core::WeakPointer<CoreSync> coreSync);
-        void handleGesture(GestureAdapter::GestureEvent event);
+
+        // thread-safe. inputTimeNs is when the input arrived, on the Profiler clock.
+        void handleGesture(const GestureAdapter::GestureEvent& event);
+        void queueDrag(GestureAdapter::GesturePointer pointer, Core::Int32 startX, Core::Int32 startY, Core::Int32 endX, Core::Int32 endY, Core::UInt64 inputTimeNs);
+        void queueScroll(Core::Real scrollDistance, Core::UInt64 inputTimeNs);
+
+        // render thread only. Drags are in the coordinates of the camera's viewport, which can be
+        // smaller than the engine's current one when several views share the render surface.
+        void setViewportSize(Core::UInt32 width, Core::UInt32 height);
+        // render thread only: applies everything queued since the last latch and returns when the
+        // oldest of it arrived, or 0 if nothing was queued
+        Core::UInt64 latch();
+        void applyDrag(GestureAdapter::GesturePointer pointer, Core::Int32 startX, Core::Int32 startY, Core::Int32 endX, Core::Int32 endY);
+        void applyScroll(Core::Real scrollDistance);
 
     private:
+        class DragSegment {
+        public:
+            GestureAdapter::GesturePointer pointer;
+            Core::Int32 startX;
+            Core::Int32 startY;
+            Core::Int32 endX;
+            Core::Int32 endY;
+        };
+
+        class PendingInput {
+        public:
+            PendingInput(): dragCount(0), scrollDistance(0.0f), oldestInputNs(0) {}
+
+            DragSegment drags[MaxPendingDrags];
+            Core::UInt32 dragCount;
+            Core::Real scrollDistance;
+            Core::UInt64 oldestInputNs;
+        };
+
+        void noteInput(Core::UInt64 inputTimeNs);
+
+        QMutex inputMutex;
+        PendingInput pending;
         Core::Point3r origin;
+        Core::UInt32 viewportWidth;
+        Core::UInt32 viewportHeight;
         Core::WeakPointer<Core::Engine> engine;
         Core::WeakPointer<Core::Camera> targetCamera;
         Core::WeakPointer<CoreSync> coreSync;
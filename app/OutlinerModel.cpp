@@ -0,0 +1,208 @@
+#include <algorithm>
+
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include "OutlinerModel.h"
+
+namespace Modeler {
+
+    OutlinerModel::OutlinerModel(QObject* parent): QAbstractItemModel(parent), nodeCount(0), fetchContinuationScheduled(false), addScheduled(false) {
+
+    }
+
+    void OutlinerModel::addHierarchy(std::shared_ptr<const ImportedModel> model) {
+        if (!model || model->nodes.size() == 0) return;
+        QMutexLocker ml(&this->pendingMutex);
+        this->pendingModels.push_back(model);
+        if (this->addScheduled) return;
+        this->addScheduled = true;
+        QMetaObject::invokeMethod(this, "addPendingHierarchies", Qt::QueuedConnection);
+    }
+
+    void OutlinerModel::addPendingHierarchies() {
+        std::vector<std::shared_ptr<const ImportedModel>> models;
+        {
+            QMutexLocker ml(&this->pendingMutex);
+            models.swap(this->pendingModels);
+            this->addScheduled = false;
+        }
+        if (models.size() == 0) return;
+
+        // every import of the batch in one insertion, so views lay themselves out once
+        int firstRow = (int)this->hierarchies.size();
+        this->beginInsertRows(QModelIndex(), firstRow, firstRow + (int)models.size() - 1);
+        for (const std::shared_ptr<const ImportedModel>& model : models) {
+            this->hierarchies.push_back(std::unique_ptr<Hierarchy>(this->buildHierarchy(*model)));
+        }
+        this->endInsertRows();
+    }
+
+    OutlinerModel::Hierarchy* OutlinerModel::buildHierarchy(const ImportedModel& model) {
+        const std::vector<ImportedNode>& nodes = model.nodes;
+        Core::UInt32 count = (Core::UInt32)nodes.size();
+        Hierarchy* hierarchy = new Hierarchy();
+        hierarchy->row = (Core::UInt32)this->hierarchies.size();
+        hierarchy->firstNode = this->nodeCount;
+        this->nodeCount += count;
+
+        hierarchy->title = QFileInfo(QString::fromStdString(model.sourcePath)).fileName();
+        if (hierarchy->title.isEmpty()) hierarchy->title = QString::fromStdString(nodes[0].name);
+
+        size_t nameLength = 0;
+        for (const ImportedNode& node : nodes) nameLength += node.name.size();
+        hierarchy->names.reserve(nameLength);
+        hierarchy->nameOffsets.resize(count + 1);
+        hierarchy->parents.resize(count);
+        for (Core::UInt32 n = 0; n < count; n++) {
+            hierarchy->nameOffsets[n] = (Core::UInt32)hierarchy->names.size();
+            hierarchy->names.append(nodes[n].name);
+            // anything without a usable parent is shown under the root
+            Core::Int32 parentIndex = nodes[n].parentIndex;
+            hierarchy->parents[n] = n == 0 ? 0 : (parentIndex >= 0 && (Core::UInt32)parentIndex < count ? (Core::UInt32)parentIndex : 0);
+        }
+        hierarchy->nameOffsets[count] = (Core::UInt32)hierarchy->names.size();
+
+        // children grouped by parent with a counting sort, which keeps them in import order
+        hierarchy->firstChild.assign(count + 1, 0);
+        for (Core::UInt32 n = 1; n < count; n++) hierarchy->firstChild[hierarchy->parents[n] + 1]++;
+        for (Core::UInt32 n = 0; n < count; n++) hierarchy->firstChild[n + 1] += hierarchy->firstChild[n];
+        std::vector<Core::UInt32> nextChild(hierarchy->firstChild.begin(), hierarchy->firstChild.end() - 1);
+        hierarchy->children.resize(count > 0 ? count - 1 : 0);
+        hierarchy->rows.assign(count, 0);
+        for (Core::UInt32 n = 1; n < count; n++) {
+            Core::UInt32 parent = hierarchy->parents[n];
+            hierarchy->rows[n] = nextChild[parent] - hierarchy->firstChild[parent];
+            hierarchy->children[nextChild[parent]++] = n;
+        }
+        hierarchy->fetchedCounts.assign(count, 0);
+        return hierarchy;
+    }
+
+    OutlinerModel::Hierarchy* OutlinerModel::findHierarchy(Core::UInt32 node, Core::UInt32& localNode) const {
+        auto found = std::upper_bound(this->hierarchies.begin(), this->hierarchies.end(), node, [](Core::UInt32 value, const std::unique_ptr<Hierarchy>& hierarchy) {
+            return value < hierarchy->firstNode;
+        });
+        if (found == this->hierarchies.begin()) return nullptr;
+        --found;
+        localNode = node - (*found)->firstNode;
+        if (localNode >= (*found)->parents.size()) return nullptr;
+        return found->get();
+    }
+
+    QModelIndex OutlinerModel::nodeIndex(Core::UInt32 node) const {
+        Core::UInt32 localNode = 0;
+        Hierarchy* hierarchy = this->findHierarchy(node, localNode);
+        if (!hierarchy) return QModelIndex();
+        Core::UInt32 row = localNode == 0 ? hierarchy->row : hierarchy->rows[localNode];
+        return this->createIndex((int)row, 0, (quintptr)node);
+    }
+
+    QModelIndex OutlinerModel::index(int row, int column, const QModelIndex& parent) const {
+        if (row < 0 || column != 0) return QModelIndex();
+        if (!parent.isValid()) {
+            if ((size_t)row >= this->hierarchies.size()) return QModelIndex();
+            return this->createIndex(row, 0, (quintptr)this->hierarchies[row]->firstNode);
+        }
+
+        Core::UInt32 localNode = 0;
+        Hierarchy* hierarchy = this->findHierarchy((Core::UInt32)parent.internalId(), localNode);
+        if (!hierarchy || (Core::UInt32)row >= hierarchy->fetchedCounts[localNode]) return QModelIndex();
+        Core::UInt32 child = hierarchy->children[hierarchy->firstChild[localNode] + row];
+        return this->createIndex(row, 0, (quintptr)(hierarchy->firstNode + child));
+    }
+
+    QModelIndex OutlinerModel::parent(const QModelIndex& index) const {
+        if (!index.isValid()) return QModelIndex();
+        Core::UInt32 localNode = 0;
+        Hierarchy* hierarchy = this->findHierarchy((Core::UInt32)index.internalId(), localNode);
+        if (!hierarchy || localNode == 0) return QModelIndex();
+        return this->nodeIndex(hierarchy->firstNode + hierarchy->parents[localNode]);
+    }
+
+    int OutlinerModel::rowCount(const QModelIndex& parent) const {
+        if (parent.column() > 0) return 0;
+        if (!parent.isValid()) return (int)this->hierarchies.size();
+        Core::UInt32 localNode = 0;
+        Hierarchy* hierarchy = this->findHierarchy((Core::UInt32)parent.internalId(), localNode);
+        return hierarchy ? (int)hierarchy->fetchedCounts[localNode] : 0;
+    }
+
+    int OutlinerModel::columnCount(const QModelIndex& parent) const {
+        Q_UNUSED(parent);
+        return 1;
+    }
+
+    // answered without fetching, so collapsed nodes still show that they can be expanded
+    bool OutlinerModel::hasChildren(const QModelIndex& parent) const {
+        if (parent.column() > 0) return false;
+        if (!parent.isValid()) return this->hierarchies.size() > 0;
+        Core::UInt32 localNode = 0;
+        Hierarchy* hierarchy = this->findHierarchy((Core::UInt32)parent.internalId(), localNode);
+        return hierarchy && hierarchy->firstChild[localNode + 1] > hierarchy->firstChild[localNode];
+    }
+
+    bool OutlinerModel::canFetchMore(const QModelIndex& parent) const {
+        if (!parent.isValid()) return false;
+        Core::UInt32 localNode = 0;
+        Hierarchy* hierarchy = this->findHierarchy((Core::UInt32)parent.internalId(), localNode);
+        if (!hierarchy) return false;
+        Core::UInt32 childCount = hierarchy->firstChild[localNode + 1] - hierarchy->firstChild[localNode];
+        return hierarchy->fetchedCounts[localNode] < childCount;
+    }
+
+    void OutlinerModel::fetchMore(const QModelIndex& parent) {
+        if (!parent.isValid()) return;
+        Core::UInt32 node = (Core::UInt32)parent.internalId();
+        Core::UInt32 localNode = 0;
+        Hierarchy* hierarchy = this->findHierarchy(node, localNode);
+        if (!hierarchy) return;
+
+        Core::UInt32 childCount = hierarchy->firstChild[localNode + 1] - hierarchy->firstChild[localNode];
+        Core::UInt32 fetched = hierarchy->fetchedCounts[localNode];
+        if (fetched >= childCount) return;
+        Core::UInt32 batch = std::min(childCount - fetched, (Core::UInt32)FetchBatchSize);
+        this->beginInsertRows(parent, (int)fetched, (int)(fetched + batch - 1));
+        hierarchy->fetchedCounts[localNode] = fetched + batch;
+        this->endInsertRows();
+
+        // views ask once per expansion, so the rest is handed out a batch per event loop pass
+        if (fetched + batch < childCount) {
+            this->pendingFetches.push_back(node);
+            if (!this->fetchContinuationScheduled) {
+                this->fetchContinuationScheduled = true;
+                QMetaObject::invokeMethod(this, "continueFetches", Qt::QueuedConnection);
+            }
+        }
+    }
+
+    void OutlinerModel::continueFetches() {
+        this->fetchContinuationScheduled = false;
+        std::vector<Core::UInt32> nodes;
+        nodes.swap(this->pendingFetches);
+        for (Core::UInt32 node : nodes) {
+            this->fetchMore(this->nodeIndex(node));
+        }
+    }
+
+    QVariant OutlinerModel::data(const QModelIndex& index, int role) const {
+        if (!index.isValid() || (role != NameRole && role != Qt::DisplayRole)) return QVariant();
+        Core::UInt32 localNode = 0;
+        Hierarchy* hierarchy = this->findHierarchy((Core::UInt32)index.internalId(), localNode);
+        if (!hierarchy) return QVariant();
+        if (localNode == 0) return hierarchy->title;
+
+        // names only become QStrings for the rows a view actually shows
+        Core::UInt32 offset = hierarchy->nameOffsets[localNode];
+        Core::UInt32 length = hierarchy->nameOffsets[localNode + 1] - offset;
+        if (length == 0) return QString("(unnamed)");
+        return QString::fromUtf8(hierarchy->names.data() + offset, (int)length);
+    }
+
+    QHash<int, QByteArray> OutlinerModel::roleNames() const {
+        QHash<int, QByteArray> roles;
+        roles[NameRole] = "name";
+        return roles;
+    }
+
+}
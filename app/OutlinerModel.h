@@ -0,0 +1,89 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QAbstractItemModel>
+#include <QMutex>
+#include <QString>
+
+#include "ImportedModel.h"
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // The outliner's tree of imported nodes.
+    //
+    // The engine's scene graph belongs to the render thread, so the model keeps its own copy
+    // of what the outliner shows: each import's node names and parent links in flat arrays,
+    // without an object per row. Imports committed close together are added as one batch, as
+    // one top-level row each. A node's children are only handed to views when it is expanded,
+    // FetchBatchSize at a time through canFetchMore()/fetchMore(), with the rest following on
+    // later passes of the event loop, so even a node with 100k children doesn't stall the UI.
+    //
+    // GUI thread only, apart from addHierarchy().
+    class OutlinerModel : public QAbstractItemModel {
+        Q_OBJECT
+
+    public:
+        enum Roles {
+            NameRole = Qt::UserRole + 1,
+        };
+
+        static const int FetchBatchSize = 256;
+
+        explicit OutlinerModel(QObject* parent = 0);
+
+        // thread-safe. The model's nodes must not change afterwards; they are copied on the
+        // GUI thread, and the model is let go of then.
+        void addHierarchy(std::shared_ptr<const ImportedModel> model);
+
+        QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+        QModelIndex parent(const QModelIndex& index) const override;
+        int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+        int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+        bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+        bool canFetchMore(const QModelIndex& parent) const override;
+        void fetchMore(const QModelIndex& parent) override;
+        QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+        QHash<int, QByteArray> roleNames() const override;
+
+    private slots:
+        void addPendingHierarchies();
+        void continueFetches();
+
+    private:
+        // one import. Node 0 is its root, the children of each node are stored together in
+        // import order.
+        class Hierarchy {
+        public:
+            QString title;
+            Core::UInt32 row;       // among the top-level rows
+            Core::UInt32 firstNode; // in the model-wide numbering the indexes carry
+            std::string names;      // every node's name back to back
+            std::vector<Core::UInt32> nameOffsets; // per node, plus one past the end
+            std::vector<Core::UInt32> parents;     // the root's is its own index
+            std::vector<Core::UInt32> rows;        // position under the parent
+            std::vector<Core::UInt32> firstChild;  // per node, plus one past the end, into children
+            std::vector<Core::UInt32> children;
+            std::vector<Core::UInt32> fetchedCounts; // children handed to views so far
+        };
+
+        Hierarchy* buildHierarchy(const ImportedModel& model);
+        Hierarchy* findHierarchy(Core::UInt32 node, Core::UInt32& localNode) const;
+        QModelIndex nodeIndex(Core::UInt32 node) const;
+
+        std::vector<std::unique_ptr<Hierarchy>> hierarchies; // in top-level row order
+        Core::UInt32 nodeCount;
+        // nodes with children left to hand out, by model-wide number
+        std::vector<Core::UInt32> pendingFetches;
+        bool fetchContinuationScheduled;
+
+        QMutex pendingMutex;
+        std::vector<std::shared_ptr<const ImportedModel>> pendingModels;
+        bool addScheduled;
+    };
+
+}
@@ -0,0 +1,162 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <memory>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "PickingBenchmark.h"
+#include "SceneBVH.h"
+#include "MeshBVH.h"
+#include "JobSystem.h"
+
+namespace Modeler {
+
+    namespace {
+
+        typedef std::chrono::steady_clock Clock;
+
+        double elapsedMilliseconds(Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        // a bumpy, indexed height-field patch in [-1, 1] x [-1, 1]
+        std::shared_ptr<MeshBVH> buildPatch(Core::UInt32 triangleCount, std::mt19937& random) {
+            Core::UInt32 cells = std::max(1u, (Core::UInt32)std::sqrt(triangleCount / 2.0f));
+            std::uniform_real_distribution<Core::Real> height(-0.2f, 0.2f);
+
+            std::vector<Core::Real> positions;
+            for (Core::UInt32 y = 0; y <= cells; y++) {
+                for (Core::UInt32 x = 0; x <= cells; x++) {
+                    positions.push_back((Core::Real)x / cells * 2.0f - 1.0f);
+                    positions.push_back(height(random));
+                    positions.push_back((Core::Real)y / cells * 2.0f - 1.0f);
+                    positions.push_back(1.0f);
+                }
+            }
+
+            std::vector<Core::UInt32> indices;
+            for (Core::UInt32 y = 0; y < cells; y++) {
+                for (Core::UInt32 x = 0; x < cells; x++) {
+                    Core::UInt32 i = y * (cells + 1) + x;
+                    indices.push_back(i); indices.push_back(i + 1); indices.push_back(i + cells + 1);
+                    indices.push_back(i + 1); indices.push_back(i + cells + 2); indices.push_back(i + cells + 1);
+                }
+            }
+            return std::make_shared<MeshBVH>(positions.data(), 4, (Core::UInt32)positions.size() / 4, indices.data(), (Core::UInt32)indices.size());
+        }
+
+        void translationMatrix(Core::Real x, Core::Real y, Core::Real z, Core::Real* m) {
+            for (unsigned int i = 0; i < 16; i++) m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+            m[12] = x; m[13] = y; m[14] = z;
+        }
+
+    }
+
+    void PickingBenchmark::run(Core::UInt32 meshCount, Core::UInt32 trianglesPerMesh, Core::UInt32 rayCount) {
+        std::mt19937 random(1234);
+        const Core::UInt32 uniquePatches = 64;
+        Core::UInt32 gridSize = (Core::UInt32)std::ceil(std::sqrt((Core::Real)meshCount));
+
+        Clock::time_point start = Clock::now();
+        std::vector<std::shared_ptr<MeshBVH>> patches;
+        for (Core::UInt32 i = 0; i < uniquePatches; i++) {
+            patches.push_back(buildPatch(trianglesPerMesh, random));
+        }
+        double meshBuildTime = elapsedMilliseconds(start);
+
+        SceneBVH sceneBVH;
+        Core::Real matrix[16];
+        for (Core::UInt32 i = 0; i < meshCount; i++) {
+            translationMatrix((Core::Real)(i % gridSize) * 2.5f, 0.0f, (Core::Real)(i / gridSize) * 2.5f, matrix);
+            sceneBVH.addInstance(i, patches[i % uniquePatches], matrix);
+        }
+
+        // the first query triggers the top-level build
+        Core::Real origin[3] = {0.0f, 10.0f, 0.0f};
+        Core::Real down[3] = {0.0f, -1.0f, 0.0f};
+        SceneBVH::Hit hit;
+        start = Clock::now();
+        sceneBVH.castRay(origin, down, hit);
+        double topLevelBuildTime = elapsedMilliseconds(start);
+
+        // move 1% of the instances and measure the refit
+        for (Core::UInt32 i = 0; i < meshCount; i += 100) {
+            translationMatrix((Core::Real)(i % gridSize) * 2.5f, 0.5f, (Core::Real)(i / gridSize) * 2.5f, matrix);
+            sceneBVH.updateInstanceTransform(i, matrix);
+        }
+        start = Clock::now();
+        sceneBVH.castRay(origin, down, hit);
+        double refitTime = elapsedMilliseconds(start);
+
+        // rays from a camera above the grid towards random points on it
+        Core::Real extent = gridSize * 2.5f;
+        std::uniform_real_distribution<Core::Real> target(0.0f, extent);
+        Core::Real eye[3] = {extent * 0.5f, extent * 0.5f, -extent * 0.25f};
+        std::vector<Core::Real> directions(rayCount * 3);
+        for (Core::UInt32 r = 0; r < rayCount; r++) {
+            directions[r * 3] = target(random) - eye[0];
+            directions[r * 3 + 1] = -eye[1];
+            directions[r * 3 + 2] = target(random) - eye[2];
+        }
+
+        Core::UInt32 hitCount = 0;
+        double worstRayTime = 0.0;
+        start = Clock::now();
+        for (Core::UInt32 r = 0; r < rayCount; r++) {
+            Clock::time_point rayStart = Clock::now();
+            if (sceneBVH.castRay(eye, &directions[r * 3], hit)) hitCount++;
+            worstRayTime = std::max(worstRayTime, elapsedMilliseconds(rayStart));
+        }
+        double totalRayTime = elapsedMilliseconds(start);
+
+        // the same rays as one batch, spread over the workers
+        std::shared_ptr<JobSystem> jobSystem = std::make_shared<JobSystem>();
+        sceneBVH.setJobSystem(jobSystem);
+        std::vector<Core::Real> origins(rayCount * 3);
+        for (Core::UInt32 r = 0; r < rayCount; r++) {
+            for (unsigned int i = 0; i < 3; i++) origins[r * 3 + i] = eye[i];
+        }
+        std::vector<SceneBVH::Hit> batchHits;
+        start = Clock::now();
+        sceneBVH.castRays(origins.data(), directions.data(), rayCount, batchHits);
+        double batchRayTime = elapsedMilliseconds(start);
+        Core::UInt32 batchHitCount = 0;
+        for (const SceneBVH::Hit& batchHit : batchHits) {
+            if (batchHit.t >= 0.0f) batchHitCount++;
+        }
+
+        // everything along a ray grazing the grid
+        std::vector<SceneBVH::Hit> allHits;
+        Core::Real grazingOrigin[3] = {-1.0f, 0.0f, 0.1f};
+        Core::Real grazingDirection[3] = {1.0f, 0.0f, 0.0f};
+        start = Clock::now();
+        sceneBVH.castRayAll(grazingOrigin, grazingDirection, 16, allHits);
+        double multiHitTime = elapsedMilliseconds(start);
+
+        // box select straight down over the middle half of the grid
+        Core::Real low = extent * 0.25f;
+        Core::Real high = extent * 0.75f;
+        Core::Real planes[4 * 4] = {1.0f, 0.0f, 0.0f, -low,  -1.0f, 0.0f, 0.0f, high,
+                                    0.0f, 0.0f, 1.0f, -low,  0.0f, 0.0f, -1.0f, high};
+        std::vector<Core::UInt64> selectedIDs;
+        start = Clock::now();
+        sceneBVH.queryVolume(planes, 4, selectedIDs);
+        double boxSelectTime = elapsedMilliseconds(start);
+
+        std::cout << "Picking benchmark" << std::endl;
+        std::cout << "  instances:            " << sceneBVH.getInstanceCount() << std::endl;
+        std::cout << "  triangles:            " << sceneBVH.getTriangleCount() << std::endl;
+        std::cout << "  mesh BVH build:       " << meshBuildTime << " ms (" << uniquePatches << " unique meshes)" << std::endl;
+        std::cout << "  top-level build:      " << topLevelBuildTime << " ms" << std::endl;
+        std::cout << "  refit (1% moved):     " << refitTime << " ms" << std::endl;
+        std::cout << "  rays:                 " << rayCount << " (" << hitCount << " hits)" << std::endl;
+        std::cout << "  average pick latency: " << totalRayTime / rayCount << " ms" << std::endl;
+        std::cout << "  worst pick latency:   " << worstRayTime << " ms" << std::endl;
+        std::cout << "  batched rays:         " << batchRayTime << " ms (" << batchHitCount << " hits, " << jobSystem->getWorkerCount() << " workers)" << std::endl;
+        std::cout << "  multi-hit ray:        " << multiHitTime << " ms (" << allHits.size() << " hits)" << std::endl;
+        std::cout << "  box select:           " << boxSelectTime << " ms (" << selectedIDs.size() << " instances)" << std::endl;
+    }
+
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Builds a synthetic scene directly into a SceneBVH (no GL context required) and
+    // reports build, refit and ray-cast timings. Run with: Modeler --benchmark-picking
+    class PickingBenchmark {
+    public:
+        static void run(Core::UInt32 meshCount = 10000, Core::UInt32 trianglesPerMesh = 1000, Core::UInt32 rayCount = 10000);
+
+    private:
+        PickingBenchmark();
+    };
+
+}
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "Profiler.h"
+
+namespace Modeler {
+
+    std::atomic<bool> Profiler::enabled(false);
+
+    Profiler::Profiler(): epochNs(0), eventCount(0), frameThreadID(0), frameCount(0), timedFrameCount(0) {
+        this->epochNs = this->now();
+        this->events.resize(EventCapacity);
+        for (Core::UInt32 i = 0; i < FrameHistory; i++) {
+            this->cpuHistory[i] = 0.0;
+            this->gpuHistory[i] = -1.0;
+            this->inputLatencyHistory[i] = -1.0;
+        }
+    }
+
+    Profiler& Profiler::instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    void Profiler::setEnabled(bool enable) {
+        QMutexLocker ml(&this->mutex);
+        if (enable && !enabled) {
+            // start every session with a clean history
+            this->eventCount = 0;
+            this->stages.clear();
+            this->stageLookup.clear();
+            this->frameCount = 0;
+            this->timedFrameCount = 0;
+        }
+        enabled = enable;
+    }
+
+    Core::UInt64 Profiler::now() const {
+        Core::UInt64 ticks = (Core::UInt64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        return ticks - this->epochNs;
+    }
+
+    void Profiler::record(const char* name, Core::UInt64 startNs, Core::UInt64 endNs) {
+        Core::UInt32 threadID = getThreadID();
+        QMutexLocker ml(&this->mutex);
+        Event& event = this->events[this->eventCount % EventCapacity];
+        event.name = name;
+        event.threadID = threadID;
+        event.startNs = startNs;
+        event.durationNs = endNs - startNs;
+        this->eventCount++;
+        if (threadID != this->frameThreadID) return;
+
+        Stage*& stage = this->stageLookup[name];
+        if (!stage) stage = &this->stages[name];
+        stage->current += (endNs - startNs) / 1000000.0;
+    }
+
+    void Profiler::endFrame() {
+        Core::UInt32 threadID = getThreadID();
+        QMutexLocker ml(&this->mutex);
+        this->frameThreadID = threadID;
+        Core::UInt32 slot = this->frameCount % FrameHistory;
+        for (auto& entry : this->stages) {
+            entry.second.history[slot] = entry.second.current;
+            entry.second.current = 0.0;
+        }
+        this->frameCount++;
+    }
+
+    void Profiler::recordFrameTiming(double cpuMilliseconds, double gpuMilliseconds, double inputLatencyMilliseconds) {
+        QMutexLocker ml(&this->mutex);
+        Core::UInt32 slot = this->timedFrameCount % FrameHistory;
+        this->cpuHistory[slot] = cpuMilliseconds;
+        this->gpuHistory[slot] = gpuMilliseconds;
+        this->inputLatencyHistory[slot] = inputLatencyMilliseconds;
+        this->timedFrameCount++;
+    }
+
+    Profiler::FrameSummary Profiler::getFrameSummary() const {
+        QMutexLocker ml(&this->mutex);
+        FrameSummary summary;
+
+        Core::UInt32 timedFrames = (Core::UInt32)std::min<Core::UInt64>(this->timedFrameCount, FrameHistory);
+        summary.frameCount = timedFrames;
+        if (timedFrames > 0) {
+            double cpuTotal = 0.0, gpuTotal = 0.0, inputLatencyTotal = 0.0;
+            bool gpuValid = true;
+            Core::UInt32 inputFrames = 0;
+            for (Core::UInt32 i = 0; i < timedFrames; i++) {
+                cpuTotal += this->cpuHistory[i];
+                summary.maxCpuMilliseconds = std::max(summary.maxCpuMilliseconds, this->cpuHistory[i]);
+                gpuValid = gpuValid && this->gpuHistory[i] >= 0.0;
+                gpuTotal += this->gpuHistory[i];
+                if (this->inputLatencyHistory[i] >= 0.0) {
+                    inputLatencyTotal += this->inputLatencyHistory[i];
+                    summary.maxInputLatencyMilliseconds = std::max(summary.maxInputLatencyMilliseconds, this->inputLatencyHistory[i]);
+                    inputFrames++;
+                }
+            }
+            summary.averageCpuMilliseconds = cpuTotal / timedFrames;
+            summary.averageGpuMilliseconds = gpuValid ? gpuTotal / timedFrames : -1.0;
+            if (inputFrames > 0) summary.averageInputLatencyMilliseconds = inputLatencyTotal / inputFrames;
+        }
+
+        Core::UInt32 frames = (Core::UInt32)std::min<Core::UInt64>(this->frameCount, FrameHistory);
+        for (const auto& entry : this->stages) {
+            StageSummary stage;
+            stage.name = entry.first;
+            stage.averageMilliseconds = 0.0;
+            stage.maxMilliseconds = 0.0;
+            for (Core::UInt32 i = 0; i < frames; i++) {
+                stage.averageMilliseconds += entry.second.history[i];
+                stage.maxMilliseconds = std::max(stage.maxMilliseconds, entry.second.history[i]);
+            }
+            if (frames > 0) stage.averageMilliseconds /= frames;
+            summary.stages.push_back(stage);
+        }
+        std::sort(summary.stages.begin(), summary.stages.end(), [](const StageSummary& a, const StageSummary& b) {
+            return a.averageMilliseconds > b.averageMilliseconds;
+        });
+        return summary;
+    }
+
+    bool Profiler::exportChromeTrace(const std::string& path) const {
+        std::vector<Event> snapshot;
+        {
+            QMutexLocker ml(&this->mutex);
+            Core::UInt64 first = this->eventCount > EventCapacity ? this->eventCount - EventCapacity : 0;
+            for (Core::UInt64 i = first; i < this->eventCount; i++) {
+                snapshot.push_back(this->events[i % EventCapacity]);
+            }
+        }
+
+        FILE* file = std::fopen(path.c_str(), "w");
+        if (!file) return false;
+        std::fprintf(file, "{\"traceEvents\":[\n");
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            const Event& event = snapshot[i];
+            // scope names are code literals, so they never need escaping
+            std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+                         event.name, event.threadID, event.startNs / 1000.0, event.durationNs / 1000.0,
+                         i + 1 < snapshot.size() ? "," : "");
+        }
+        std::fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+        return std::fclose(file) == 0;
+    }
+
+    Core::UInt32 Profiler::getThreadID() {
+        static std::atomic<Core::UInt32> nextThreadID(1);
+        thread_local Core::UInt32 threadID = nextThreadID++;
+        return threadID;
+    }
+
+}
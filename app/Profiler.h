@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <QMutex>
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Low-overhead CPU instrumentation. Scopes from every thread are recorded into a fixed ring
+    // of events (for Chrome trace export). Scopes on the thread that calls endFrame() are also
+    // accumulated per frame (for the overlay); worker scopes don't belong to any one frame and
+    // only show up in the trace. Frame stages are keyed by name, so the same name used in
+    // several places is one stage. While the profiler is disabled a ProfileScope costs a single
+    // relaxed atomic load.
+    //
+    // Scope names must be string literals: events keep the pointer, not a copy.
+    class Profiler final {
+    public:
+        static const Core::UInt32 EventCapacity = 65536;
+        static const Core::UInt32 FrameHistory = 120;
+
+        class StageSummary {
+        public:
+            std::string name;
+            double averageMilliseconds;
+            double maxMilliseconds;
+        };
+
+        class FrameSummary {
+        public:
+            FrameSummary(): frameCount(0), averageCpuMilliseconds(0.0), maxCpuMilliseconds(0.0), averageGpuMilliseconds(-1.0),
+                            averageInputLatencyMilliseconds(-1.0), maxInputLatencyMilliseconds(-1.0) {}
+
+            Core::UInt32 frameCount;
+            double averageCpuMilliseconds;
+            double maxCpuMilliseconds;
+            double averageGpuMilliseconds; // -1 when GPU timer queries are unavailable
+            double averageInputLatencyMilliseconds; // over the frames that latched input, -1 if none did
+            double maxInputLatencyMilliseconds;
+            std::vector<StageSummary> stages;
+        };
+
+        static Profiler& instance();
+
+        static bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        void setEnabled(bool enable);
+        Core::UInt64 now() const;
+        void record(const char* name, Core::UInt64 startNs, Core::UInt64 endNs);
+        // render thread: closes the per-frame stage accumulators, and makes the calling thread
+        // the one whose scopes are accumulated
+        void endFrame();
+        // inputLatencyMilliseconds is -1 for frames that latched no input
+        void recordFrameTiming(double cpuMilliseconds, double gpuMilliseconds, double inputLatencyMilliseconds);
+
+        FrameSummary getFrameSummary() const;
+        bool exportChromeTrace(const std::string& path) const;
+
+    private:
+        class Event {
+        public:
+            const char* name;
+            Core::UInt32 threadID;
+            Core::UInt64 startNs;
+            Core::UInt64 durationNs;
+        };
+
+        class Stage {
+        public:
+            Stage(): current(0.0) {
+                for (Core::UInt32 i = 0; i < FrameHistory; i++) history[i] = 0.0;
+            }
+
+            double current;
+            double history[FrameHistory];
+        };
+
+        Profiler();
+        static Core::UInt32 getThreadID();
+
+        static std::atomic<bool> enabled;
+
+        mutable QMutex mutex;
+        Core::UInt64 epochNs;
+        std::vector<Event> events;
+        Core::UInt64 eventCount;
+        std::unordered_map<std::string, Stage> stages;
+        // resolves literals to their stage without building a string per scope
+        std::unordered_map<const char*, Stage*> stageLookup;
+        Core::UInt32 frameThreadID;
+        Core::UInt64 frameCount;
+        double cpuHistory[FrameHistory];
+        double gpuHistory[FrameHistory];
+        double inputLatencyHistory[FrameHistory];
+        Core::UInt64 timedFrameCount;
+    };
+
+    class ProfileScope final {
+    public:
+        explicit ProfileScope(const char* name) {
+            if (Profiler::isEnabled()) {
+                this->name = name;
+                this->startNs = Profiler::instance().now();
+            }
+            else {
+                this->name = nullptr;
+                this->startNs = 0;
+            }
+        }
+
+        ~ProfileScope() {
+            if (this->name) Profiler::instance().record(this->name, this->startNs, Profiler::instance().now());
+        }
+
+    private:
+        ProfileScope(const ProfileScope&);
+        ProfileScope& operator=(const ProfileScope&);
+
+        const char* name;
+        Core::UInt64 startNs;
+    };
+
+}
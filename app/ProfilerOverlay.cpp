@@ -0,0 +1,59 @@
+#include <QDebug>
+#include <QUrl>
+
+#include "ProfilerOverlay.h"
+#include "Profiler.h"
+
+namespace Modeler {
+
+    ProfilerOverlay::ProfilerOverlay(QObject* parent): QObject(parent) {
+        connect(&this->refreshTimer, &QTimer::timeout, this, &ProfilerOverlay::refresh);
+    }
+
+    bool ProfilerOverlay::isEnabled() const {
+        return Profiler::isEnabled();
+    }
+
+    void ProfilerOverlay::setEnabled(bool enabled) {
+        if (enabled == Profiler::isEnabled()) return;
+        Profiler::instance().setEnabled(enabled);
+        if (enabled) this->refreshTimer.start(RefreshIntervalMs);
+        else this->refreshTimer.stop();
+        emit enabledChanged();
+    }
+
+    QString ProfilerOverlay::getReport() const {
+        return this->report;
+    }
+
+    bool ProfilerOverlay::exportTrace(const QString& path) {
+        QString localPath = path.startsWith("file:") ? QUrl(path).toLocalFile() : path;
+        if (!Profiler::instance().exportChromeTrace(localPath.toStdString())) {
+            qDebug() << "Unable to write profiler trace: " << localPath;
+            return false;
+        }
+        return true;
+    }
+
+    void ProfilerOverlay::refresh() {
+        Profiler::FrameSummary summary = Profiler::instance().getFrameSummary();
+
+        QString text = QString("frame  cpu %1 ms (max %2)").arg(summary.averageCpuMilliseconds, 0, 'f', 2).arg(summary.maxCpuMilliseconds, 0, 'f', 2);
+        if (summary.averageGpuMilliseconds >= 0.0) {
+            text += QString("  gpu %1 ms").arg(summary.averageGpuMilliseconds, 0, 'f', 2);
+        }
+        if (summary.averageInputLatencyMilliseconds >= 0.0) {
+            text += QString("\ninput to submit %1 ms (max %2)").arg(summary.averageInputLatencyMilliseconds, 0, 'f', 2)
+                                                              .arg(summary.maxInputLatencyMilliseconds, 0, 'f', 2);
+        }
+        for (const Profiler::StageSummary& stage : summary.stages) {
+            text += QString("\n%1 %2 ms (max %3)").arg(QString::fromStdString(stage.name), -36)
+                                                   .arg(stage.averageMilliseconds, 6, 'f', 2)
+                                                   .arg(stage.maxMilliseconds, 0, 'f', 2);
+        }
+
+        this->report = text;
+        emit reportChanged();
+    }
+
+}
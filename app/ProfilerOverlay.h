@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+namespace Modeler {
+
+    // QML-facing view of the Profiler: toggles instrumentation, and periodically
+    // formats the averaged frame and stage timings for the overlay.
+    class ProfilerOverlay: public QObject {
+
+        Q_OBJECT
+        Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+        Q_PROPERTY(QString report READ getReport NOTIFY reportChanged)
+
+    public:
+        static const int RefreshIntervalMs = 250;
+
+        ProfilerOverlay(QObject* parent = 0);
+
+        bool isEnabled() const;
+        void setEnabled(bool enabled);
+        QString getReport() const;
+
+        Q_INVOKABLE bool exportTrace(const QString& path);
+
+    signals:
+        void enabledChanged();
+        void reportChanged();
+
+    private slots:
+        void refresh();
+
+    private:
+        QTimer refreshTimer;
+        QString report;
+    };
+
+}
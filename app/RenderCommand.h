@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Allocation-free command sent from the GUI thread to the render thread through
+    // CoreSync. Camera drags and scrolls never reach the queue: ModelerApp::postRenderCommand()
+    // hands them to the viewport's OrbitControls, which latches them right before the frame is
+    // drawn. Coordinates are local to the command's viewport.
+    class RenderCommand {
+    public:
+
+        enum class Type {
+            None = 0,
+            CameraDrag = 1,
+            CameraScroll = 2,
+            Pick = 3,
+            AreaSelect = 4,
+            // the lasso outline is too big for a command and is handed over separately
+            LassoSelect = 5,
+        };
+
+        RenderCommand(): type(Type::None), viewport(0), pointer(0), startX(0), startY(0), endX(0), endY(0), scrollDistance(0.0f) {}
+
+        static RenderCommand drag(Core::UInt32 pointer, Core::Int32 startX, Core::Int32 startY, Core::Int32 endX, Core::Int32 endY, Core::UInt32 viewport = 0) {
+            RenderCommand command;
+            command.type = Type::CameraDrag;
+            command.viewport = viewport;
+            command.pointer = pointer;
+            command.startX = startX;
+            command.startY = startY;
+            command.endX = endX;
+            command.endY = endY;
+            return command;
+        }
+
+        static RenderCommand scroll(Core::Real distance, Core::UInt32 viewport = 0) {
+            RenderCommand command;
+            command.type = Type::CameraScroll;
+            command.viewport = viewport;
+            command.scrollDistance = distance;
+            return command;
+        }
+
+        static RenderCommand pick(Core::Int32 x, Core::Int32 y, Core::UInt32 viewport = 0) {
+            RenderCommand command;
+            command.type = Type::Pick;
+            command.viewport = viewport;
+            command.endX = x;
+            command.endY = y;
+            return command;
+        }
+
+        static RenderCommand areaSelect(Core::Int32 startX, Core::Int32 startY, Core::Int32 endX, Core::Int32 endY, Core::UInt32 viewport = 0) {
+            RenderCommand command;
+            command.type = Type::AreaSelect;
+            command.viewport = viewport;
+            command.startX = startX;
+            command.startY = startY;
+            command.endX = endX;
+            command.endY = endY;
+            return command;
+        }
+
+        static RenderCommand lassoSelect(Core::UInt32 viewport = 0) {
+            RenderCommand command;
+            command.type = Type::LassoSelect;
+            command.viewport = viewport;
+            return command;
+        }
+
+        Type type;
+        Core::UInt32 viewport;
+        Core::UInt32 pointer;
+        Core::Int32 startX;
+        Core::Int32 startY;
+        Core::Int32 endX;
+        Core::Int32 endY;
+        Core::Real scrollDistance;
+    };
+
+}
@@ -1,10 +1,45 @@
 #include <QtQuick/qquickwindow.h>
+#include <QtQuick/QSGSimpleTextureNode>
+#include <QtGui/QOffscreenSurface>
 #include "RenderSurface.h"
 
 namespace Modeler {
 
-    RenderSurface::RenderSurface(): initialized(false), m_t(0) {
+    namespace {
+
+        // keeps one scene graph texture per ring buffer, so a new frame only swaps textures
+        class FrameNode : public QSGSimpleTextureNode {
+        public:
+            FrameNode() {
+                for (Core::UInt32 i = 0; i < FrameRing::BufferCount; i++) {
+                    this->textures[i] = nullptr;
+                    this->generations[i] = 0;
+                }
+                // GL framebuffers are stored bottom row first
+                this->setTextureCoordinatesTransform(QSGSimpleTextureNode::MirrorVertically);
+            }
+
+            ~FrameNode() {
+                for (Core::UInt32 i = 0; i < FrameRing::BufferCount; i++) {
+                    delete this->textures[i];
+                }
+            }
+
+            QSGTexture* textures[FrameRing::BufferCount];
+            Core::UInt64 generations[FrameRing::BufferCount];
+        };
+
+    }
+
+    RenderSurface::RenderSurface(): initialized(false), inputConnected(false), m_t(0), renderThread(nullptr), renderThreadLaunched(false), renderContext(nullptr) {
+        setFlag(ItemHasContents, true);
         connect(this, &QQuickItem::windowChanged, this, &RenderSurface::handleWindowChanged);
+
+        this->renderThread = new RenderThread(renderer, frameRing);
+        connect(this->renderThread, &RenderThread::frameReady, this, &QQuickItem::update, Qt::QueuedConnection);
+
+        // drags are delivered once per frame, see flushInput()
+        mouseAdapter.setMoveBatchingEnabled(true);
     }
 
     void RenderSurface::setT(qreal t) {
@@ -21,6 +56,8 @@ namespace Modeler {
     bool RenderSurface::eventFilter(QObject* obj, QEvent* event) {
 
         bool customHandling = mouseAdapter.processEvent(obj, event);
+        // queued moves go out with the next frame, so make sure there is one
+        if (mouseAdapter.hasQueuedEvents() && window()) window()->update();
         if (customHandling) return true;
 
         // standard event processing
@@ -43,46 +80,97 @@ namespace Modeler {
 
     void RenderSurface::handleWindowChanged(QQuickWindow *win) {
         if (win) {
+            // The engine's GL objects live in a context shared with the scene graph's and can't
+            // be rebuilt, so the scene graph is asked to stay up while the window is hidden or
+            // moves between screens instead of being torn down and recreated.
+            win->setPersistentOpenGLContext(true);
+            win->setPersistentSceneGraph(true);
             connect(win, &QQuickWindow::beforeSynchronizing, this, &RenderSurface::sync, Qt::DirectConnection);
             connect(win, &QQuickWindow::sceneGraphInvalidated, this, &RenderSurface::cleanup, Qt::DirectConnection);
-            // If we allow QML to do the clearing, they would clear what we paint
-            // and nothing would show.
-            win->setClearBeforeRendering(false);
+            connect(win, &QQuickWindow::afterAnimating, this, &RenderSurface::flushInput);
+            update();
         }
     }
 
-    void RenderSurface::cleanup() {
+    // GUI thread, once per frame before the scene is synchronized
+    void RenderSurface::flushInput() {
+        mouseAdapter.flushEvents();
+    }
 
+    // scene graph thread, with the GUI thread blocked
+    QSGNode* RenderSurface::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) {
+        Q_UNUSED(data);
+
+        // the engine's context has to share with the scene graph's, so it is created here, where
+        // that one is current; the offscreen surface it renders with must come from the GUI thread
+        if (!this->renderThreadLaunched) {
+            this->renderThreadLaunched = true;
+            QOpenGLContext* current = QOpenGLContext::currentContext();
+            this->renderContext = new QOpenGLContext();
+            this->renderContext->setFormat(current->format());
+            this->renderContext->setShareContext(current);
+            this->renderContext->create();
+            this->renderContext->moveToThread(this->renderThread);
+            current->makeCurrent(window());
+            QMetaObject::invokeMethod(this, "startRenderThread", Qt::QueuedConnection);
+        }
+
+        FrameRing::Frame frame;
+        if (!this->frameRing.acquireFrame(frame)) return oldNode;
+
+        FrameNode* node = static_cast<FrameNode*>(oldNode);
+        if (!node) node = new FrameNode();
+        if (!node->textures[frame.buffer] || node->generations[frame.buffer] != frame.generation) {
+            QSGTexture* previous = node->textures[frame.buffer];
+            node->textures[frame.buffer] = window()->createTextureFromId(frame.texture, frame.size);
+            node->generations[frame.buffer] = frame.generation;
+            node->setTexture(node->textures[frame.buffer]);
+            delete previous;
+        }
+        else {
+            node->setTexture(node->textures[frame.buffer]);
+        }
+        node->setRect(boundingRect());
+        // the texture may be the same object with new contents
+        node->markDirty(QSGNode::DirtyMaterial);
+        return node;
     }
 
-    void RenderSurface::sync() {
-        static QQuickWindow* oldWindow = nullptr;
+    // GUI thread
+    void RenderSurface::startRenderThread() {
+        QOffscreenSurface* surface = new QOffscreenSurface();
+        surface->setFormat(this->renderContext->format());
+        surface->create();
+        this->renderThread->launch(this->renderContext, surface);
+        this->renderContext = nullptr;
+    }
 
-        if (initialized) {
-            QQuickWindow* currentWindow = window();
+    // The render thread's context can't outlive the scene graph's it shares with. The scene
+    // graph is persistent (see handleWindowChanged()), so apart from the window closing this
+    // only happens when the platform overrides that; the engine can't carry on in a new context.
+    void RenderSurface::cleanup() {
+        QMetaObject::invokeMethod(this->renderThread, "shutDown", Qt::QueuedConnection);
+    }
 
-            if(renderer.isEngineInitialized()) {
+    void RenderSurface::sync() {
+        if (initialized) {
+            if(!inputConnected && renderer.isEngineInitialized()) {
                 QQuickItem* mouseArea = this->childItems()[0];
                 mouseArea->installEventFilter(this);
                 gestureAdapter.setMouseAdapter(mouseAdapter);
-
-                QSize windowSize = currentWindow->size() * currentWindow->devicePixelRatio();
-                Core::Vector2u engineWidowSize(this->boundingRect().width(), this->boundingRect().height());
-                Core::Vector2u engineWindowOffset(this->x(), this->y());
-                renderer.setRenderSize(engineWidowSize.x, engineWidowSize.y, engineWindowOffset.x, windowSize.height() - engineWidowSize.y - engineWindowOffset.y, engineWidowSize.x, engineWidowSize.y);
-            }
-
-            if (oldWindow != currentWindow) {
-                connect(currentWindow, &QQuickWindow::beforeRendering, &renderer, &RendererGL::paint, Qt::DirectConnection);
-                oldWindow = currentWindow;
+                inputConnected = true;
             }
 
+            renderer.setSurfaceSize(this->boundingRect().width(), this->boundingRect().height());
             renderer.setT(m_t);
-            renderer.setWindow(currentWindow);
         }
     }
 
     RenderSurface::~RenderSurface() {
-
+        if (this->renderThread->isRunning()) {
+            QMetaObject::invokeMethod(this->renderThread, "shutDown", Qt::QueuedConnection);
+            this->renderThread->wait();
+        }
+        delete this->renderThread;
     }
 }
@@ -1,18 +1,23 @@
 #pragma once
 
 #include <QtQuick/QQuickItem>
-#include <QtQuick/QQuickItem>
+#include <QtGui/QOpenGLContext>
 
 #include "Core/Engine.h"
 
 #include "ModelerApp.h"
 #include "ModelerAppWindow.h"
 #include "RendererGL.h"
+#include "RenderThread.h"
+#include "FrameRing.h"
 #include "MouseAdapter.h"
 #include "GestureAdapter.h"
 
 namespace Modeler  {
 
+    // Shows the engine's frames in the Qt Quick scene. The engine renders on its own
+    // RenderThread; this item only puts the newest finished frame on screen when Qt Quick
+    // renders, so each side runs at its own pace.
     class RenderSurface : public ModelerAppWindow {
         Q_OBJECT
         Q_PROPERTY(qreal t READ t WRITE setT NOTIFY tChanged)
@@ -31,6 +36,7 @@ namespace Modeler  {
 
     protected:
         bool eventFilter(QObject* obj, QEvent* event);
+        virtual QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
 
     signals:
         void tChanged();
@@ -41,11 +47,18 @@ namespace Modeler  {
 
     private slots:
         void handleWindowChanged(QQuickWindow *win);
+        void flushInput();
+        void startRenderThread();
 
     private:
         bool initialized;
+        bool inputConnected;
         qreal m_t;
         RendererGL renderer;
+        FrameRing frameRing;
+        RenderThread* renderThread;
+        bool renderThreadLaunched;
+        QOpenGLContext* renderContext; // until it is handed over to the render thread, which deletes it
         MouseAdapter mouseAdapter;
         GestureAdapter gestureAdapter;
     };
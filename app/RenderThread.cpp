@@ -0,0 +1,77 @@
+#include <QtGui/QGuiApplication>
+
+#include "RenderThread.h"
+#include "Profiler.h"
+
+namespace Modeler {
+
+    RenderThread::RenderThread(RendererGL& renderer, FrameRing& frameRing):
+        renderer(renderer), frameRing(frameRing), context(nullptr), surface(nullptr) {
+        this->frameTimer = new QTimer(this);
+        this->frameTimer->setSingleShot(true);
+        connect(this->frameTimer, &QTimer::timeout, this, &RenderThread::renderFrame);
+
+        // the renderer asks for frames from this thread as well, so they must never run inside paint()
+        connect(&renderer, &RendererGL::frameRequested, this, &RenderThread::scheduleFrame, Qt::QueuedConnection);
+        this->moveToThread(this);
+    }
+
+    RenderThread::~RenderThread() {
+
+    }
+
+    // frames requested before this are queued up and rendered as soon as the thread runs
+    void RenderThread::launch(QOpenGLContext* context, QOffscreenSurface* surface) {
+        this->context = context;
+        this->surface = surface;
+        this->start();
+    }
+
+    void RenderThread::scheduleFrame(int delayMs) {
+        if (delayMs <= 0) {
+            this->frameTimer->stop();
+            this->renderFrame();
+        }
+        else if (!this->frameTimer->isActive()) {
+            this->frameTimer->start(delayMs);
+        }
+    }
+
+    void RenderThread::renderFrame() {
+        if (!this->context) return;
+        this->frameTimer->stop();
+
+        // a size change requests a frame of its own, so nothing is lost by skipping
+        QSize size = this->renderer.getSurfaceSize();
+        if (size.isEmpty()) return;
+
+        this->context->makeCurrent(this->surface);
+        QOpenGLFramebufferObject* target;
+        {
+            ProfileScope scope("FrameRing::beginFrame");
+            target = this->frameRing.beginFrame(size);
+        }
+        if (!target) return;
+        this->renderer.paint(target->handle());
+        this->frameRing.publishFrame();
+        emit frameReady();
+    }
+
+    void RenderThread::shutDown() {
+        if (!this->context) return;
+        this->frameTimer->stop();
+        this->context->makeCurrent(this->surface);
+        this->frameRing.destroy();
+        this->context->doneCurrent();
+        delete this->context;
+        this->context = nullptr;
+
+        // the surface belongs to the GUI thread
+        this->surface->deleteLater();
+        this->surface = nullptr;
+
+        this->exit();
+        this->moveToThread(QGuiApplication::instance()->thread());
+    }
+
+}
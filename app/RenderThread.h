@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QThread>
+#include <QTimer>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOffscreenSurface>
+
+#include "RendererGL.h"
+#include "FrameRing.h"
+
+namespace Modeler {
+
+    // Runs the engine on its own thread and OpenGL context, so a slow engine frame no longer
+    // holds up the Qt Quick scene graph (and the rest of the UI with it), and the UI no
+    // longer holds up the engine. Each frame is drawn into the FrameRing, whose newest
+    // buffer the RenderSurface shows whenever Qt Quick renders.
+    //
+    // The object lives on its own thread, so its slots run there.
+    class RenderThread : public QThread {
+        Q_OBJECT
+
+    public:
+        RenderThread(RendererGL& renderer, FrameRing& frameRing);
+        ~RenderThread();
+
+        // GUI thread. The context must share with the scene graph's and already belong to this
+        // thread, the surface must have been created on the GUI thread.
+        void launch(QOpenGLContext* context, QOffscreenSurface* surface);
+
+    signals:
+        // a new buffer has been published to the frame ring
+        void frameReady();
+
+    public slots:
+        void scheduleFrame(int delayMs);
+        void renderFrame();
+        void shutDown();
+
+    private:
+        RendererGL& renderer;
+        FrameRing& frameRing;
+        QOpenGLContext* context;
+        QOffscreenSurface* surface;
+        QTimer* frameTimer;
+    };
+
+}
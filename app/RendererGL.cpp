@@ -1,29 +1,166 @@
+#include <algorithm>
+
 #include "RendererGL.h"
+#include "Profiler.h"
 
-#include <QtQuick/qquickwindow.h>
 #include <QtGui/QOpenGLShaderProgram>
 #include <QtGui/QOpenGLContext>
+#include <QDebug>
 
-namespace Modeler {
+#include "Core/render/RenderTarget.h"
 
-    RendererGL::RendererGL() : m_t(0), m_window(nullptr), initialized(false), engineInitialized(false), engineWindowSizeSet(false), engine(nullptr) {
+namespace Modeler {
 
+    RendererGL::RendererGL() : m_t(0), viewportLayout((int)ViewportLayout::Single), engineLayout(ViewportLayout::Single), initialized(false), engineInitialized(false), engineWindowSizeSet(false),
+                               renderMode((int)RenderMode::Continuous), frameRequestPending(false), activeAnimations(0), engine(nullptr),
+                               frameTimingInitialized(false), frameIndex(0) {
+        for (unsigned int i = 0; i < FrameTimingLatency; i++) {
+            gpuTimers[i] = nullptr;
+            pendingTimingValid[i] = false;
+        }
     }
 
     RendererGL::~RendererGL() {
-
+        for (unsigned int i = 0; i < FrameTimingLatency; i++) {
+            delete gpuTimers[i];
+        }
     }
 
-    void RendererGL::paint() {
+    void RendererGL::paint(GLuint outputFramebuffer) {
+        // requests made while this frame is being produced schedule another one
+        frameRequestPending = false;
+
+        QElapsedTimer cpuTimer;
+        unsigned int timingSlot = frameIndex % FrameTimingLatency;
+        QOpenGLTimerQuery* gpuTimer = nullptr;
+        bool profiling = Profiler::isEnabled();
+        if (frameTimingCallback || profiling) {
+            if (!frameTimingInitialized) initFrameTiming();
+            // the slot's previous query is FrameTimingLatency frames old, so this rarely stalls
+            resolveFrameTiming(timingSlot);
+            gpuTimer = gpuTimers[timingSlot];
+            cpuTimer.start();
+            if (gpuTimer) gpuTimer->begin();
+        }
+
         if (!initialized) {
             init();
             initialized = true;
         }
-        update();
-        this->resolveOnUpdates();
-        this->resolveOnPreRenders();
-        render();
-        m_window->resetOpenGLState();
+        applySurfaceSize();
+        {
+            ProfileScope scope("RendererGL::update");
+            update();
+        }
+        {
+            ProfileScope scope("RendererGL::resolveOnUpdates");
+            this->resolveOnUpdates();
+        }
+        {
+            ProfileScope scope("RendererGL::resolveOnPreRenders");
+            this->resolveOnPreRenders();
+        }
+        Core::UInt64 inputNs = 0;
+        if (latchCallback) {
+            ProfileScope scope("RendererGL::latch");
+            inputNs = latchCallback(this);
+        }
+        {
+            ProfileScope scope("RendererGL::render");
+            render();
+        }
+        {
+            ProfileScope scope("RendererGL::copyViewports");
+            copyViewports(outputFramebuffer);
+        }
+
+        if (cpuTimer.isValid()) {
+            if (gpuTimer) gpuTimer->end();
+            FrameTiming& timing = pendingTimings[timingSlot];
+            timing.frameIndex = frameIndex;
+            timing.cpuMilliseconds = cpuTimer.nsecsElapsed() / 1000000.0;
+            timing.gpuMilliseconds = -1.0;
+            timing.inputLatencyMilliseconds = -1.0;
+            if (inputNs != 0) {
+                Core::UInt64 submitNs = Profiler::instance().now();
+                if (submitNs > inputNs) timing.inputLatencyMilliseconds = (submitNs - inputNs) / 1000000.0;
+            }
+            pendingTimingValid[timingSlot] = true;
+            if (!gpuTimer) resolveFrameTiming(timingSlot);
+        }
+        frameIndex++;
+
+        if (profiling) Profiler::instance().endFrame();
+
+        if (renderMode == (int)RenderMode::Continuous) {
+            emit frameRequested(0);
+        }
+        else if (activeAnimations > 0) {
+            emit frameRequested(AnimationFrameIntervalMs);
+        }
+    }
+
+    void RendererGL::setRenderMode(RenderMode mode) {
+        renderMode = (int)mode;
+        this->requestFrame();
+    }
+
+    RendererGL::RenderMode RendererGL::getRenderMode() const {
+        return (RenderMode)renderMode.load();
+    }
+
+    void RendererGL::requestFrame() {
+        if (!frameRequestPending.exchange(true)) {
+            emit frameRequested(0);
+        }
+    }
+
+    void RendererGL::beginAnimation() {
+        if (activeAnimations++ == 0) {
+            this->requestFrame();
+        }
+    }
+
+    void RendererGL::endAnimation() {
+        if (activeAnimations > 0) activeAnimations--;
+    }
+
+    void RendererGL::setFrameTimingCallback(FrameTimingCallback callback) {
+        frameTimingCallback = callback;
+        for (unsigned int i = 0; i < FrameTimingLatency; i++) {
+            pendingTimingValid[i] = false;
+        }
+    }
+
+    void RendererGL::initFrameTiming() {
+        frameTimingInitialized = true;
+        for (unsigned int i = 0; i < FrameTimingLatency; i++) {
+            gpuTimers[i] = new QOpenGLTimerQuery();
+            if (!gpuTimers[i]->create()) {
+                // timer queries need GL 3.3 or ARB_timer_query; fall back to CPU timings only
+                for (unsigned int j = 0; j <= i; j++) {
+                    delete gpuTimers[j];
+                    gpuTimers[j] = nullptr;
+                }
+                return;
+            }
+        }
+    }
+
+    void RendererGL::resolveFrameTiming(unsigned int slot) {
+        if (!pendingTimingValid[slot]) return;
+        pendingTimingValid[slot] = false;
+
+        FrameTiming& timing = pendingTimings[slot];
+        if (gpuTimers[slot]) {
+            timing.gpuMilliseconds = gpuTimers[slot]->waitForResult() / 1000000.0;
+        }
+        if (frameTimingCallback) frameTimingCallback(timing);
+        if (Profiler::isEnabled()) Profiler::instance().recordFrameTiming(timing.cpuMilliseconds, timing.gpuMilliseconds, timing.inputLatencyMilliseconds);
+    }
+
+    void RendererGL::setLatchCallback(LatchCallback callback) {
+        latchCallback = callback;
     }
 
     Core::WeakPointer<Core::Engine> RendererGL::getEngine() {
@@ -31,13 +168,28 @@ namespace Modeler {
     }
 
     void RendererGL::init() {
+        if (!initializeOpenGLFunctions()) {
+            qDebug() << "RendererGL::init() -> OpenGL 3.3 is required.";
+        }
         if (!engineInitialized) {
           engine = Core::Engine::instance();
+          Core::TextureAttributes colorAttributes;
+          colorAttributes.Format = Core::TextureFormat::RGBA8;
+          colorAttributes.FilterMode = Core::TextureFilter::Point;
+          colorAttributes.MipLevels = 0;
+          for (Core::UInt32 i = 0; i < MaxViewports; i++) {
+              viewportTargets[i] = engine->getGraphicsSystem()->createRenderTarget2D(true, true, false, colorAttributes, Core::Vector2u(1, 1));
+          }
           engineInitialized = true;
         }
         resolveOnInits();
     }
 
+    Core::WeakPointer<Core::RenderTarget2D> RendererGL::getViewportTarget(Core::UInt32 viewport) {
+        if (viewport >= MaxViewports) return Core::WeakPointer<Core::RenderTarget2D>();
+        return viewportTargets[viewport];
+    }
+
     void RendererGL::onInit(LifeCycleEventCallback func) {
         if (engineInitialized) {
             resolveOnInit(func);
@@ -48,13 +200,19 @@ namespace Modeler {
     }
 
     void RendererGL::onPreRender(LifeCycleEventCallback func) {
-        QMutexLocker ml(&this->preRenderMutex);
-        onPreRenders.push_back(func);
+        {
+            QMutexLocker ml(&this->preRenderMutex);
+            onPreRenders.push_back(func);
+        }
+        this->requestFrame();
     }
 
     void RendererGL::onUpdate(LifeCycleEventCallback func) {
-        QMutexLocker ml(&this->updateMutex);
-        onUpdates.push_back(func);
+        {
+            QMutexLocker ml(&this->updateMutex);
+            onUpdates.push_back(func);
+        }
+        this->requestFrame();
     }
 
     void RendererGL::resolveOnInits() {
@@ -69,25 +227,29 @@ namespace Modeler {
     }
 
     void RendererGL::resolveOnUpdates() {
-        if (onUpdates.size() > 0) {
+        // swap the pending callbacks out under the lock so producers are only blocked
+        // for the swap, and callbacks may safely queue further updates
+        {
             QMutexLocker ml(&this->updateMutex);
-            for(std::vector<LifeCycleEventCallback>::iterator itr = onUpdates.begin(); itr != onUpdates.end(); ++itr) {
-                LifeCycleEventCallback func = *itr;
-                func(this);
-            }
-            onUpdates.clear();
+            if (onUpdates.size() == 0) return;
+            resolvingUpdates.swap(onUpdates);
         }
+        for(std::vector<LifeCycleEventCallback>::iterator itr = resolvingUpdates.begin(); itr != resolvingUpdates.end(); ++itr) {
+            (*itr)(this);
+        }
+        resolvingUpdates.clear();
     }
 
     void RendererGL::resolveOnPreRenders() {
-        if (onPreRenders.size() > 0) {
+        {
             QMutexLocker ml(&this->preRenderMutex);
-            for(std::vector<LifeCycleEventCallback>::iterator itr = onPreRenders.begin(); itr != onPreRenders.end(); ++itr) {
-                LifeCycleEventCallback func = *itr;
-                func(this);
-            }
-            onPreRenders.clear();
+            if (onPreRenders.size() == 0) return;
+            resolvingPreRenders.swap(onPreRenders);
+        }
+        for(std::vector<LifeCycleEventCallback>::iterator itr = resolvingPreRenders.begin(); itr != resolvingPreRenders.end(); ++itr) {
+            (*itr)(this);
         }
+        resolvingPreRenders.clear();
     }
 
     bool RendererGL::isEngineInitialized() {
@@ -102,6 +264,105 @@ namespace Modeler {
         engine->render();
     }
 
+    void RendererGL::applySurfaceSize() {
+        QSize size = getSurfaceSize();
+        ViewportLayout layout = getViewportLayout();
+        if ((size == engineSize && layout == engineLayout) || size.isEmpty()) return;
+        engineSize = size;
+        engineLayout = layout;
+        setRenderSize(size.width(), size.height());
+        // targets of unused viewports are shrunk rather than freed, so their cameras keep valid targets
+        for (Core::UInt32 i = 0; i < MaxViewports; i++) {
+            QRect rect = layoutViewport(size, layout, i);
+            viewportTargets[i]->setSize(std::max(rect.width(), 1), std::max(rect.height(), 1));
+        }
+    }
+
+    // Core has no notion of the frame ring's framebuffers, so each viewport is drawn into a
+    // Core target and blitted into place. The draw binding is put back afterwards, Core
+    // assumes the target it activated last is still bound.
+    void RendererGL::copyViewports(GLuint outputFramebuffer) {
+        Core::WeakPointer<Core::Graphics> graphics = engine->getGraphicsSystem();
+        Core::WeakPointer<Core::RenderTarget> previousTarget = graphics->getCurrentRenderTarget();
+        GLint previousFramebuffer = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+        if (engineLayout != ViewportLayout::Single) {
+            // only the gaps between the views are left showing
+            glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        for (Core::UInt32 i = 0; i < MaxViewports; i++) {
+            QRect rect = layoutViewport(engineSize, engineLayout, i);
+            if (rect.isEmpty()) continue;
+            graphics->activateRenderTarget(viewportTargets[i]);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+            // the output is stored bottom row first, like every GL framebuffer
+            GLint bottom = engineSize.height() - rect.y() - rect.height();
+            glBlitFramebuffer(0, 0, rect.width(), rect.height(), rect.x(), bottom, rect.x() + rect.width(), bottom + rect.height(),
+                              GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+
+        if (previousTarget) graphics->activateRenderTarget(previousTarget);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+    }
+
+    void RendererGL::setViewportLayout(ViewportLayout layout) {
+        if (viewportLayout.exchange((int)layout) == (int)layout) return;
+        emit frameRequested(0);
+    }
+
+    RendererGL::ViewportLayout RendererGL::getViewportLayout() const {
+        return (ViewportLayout)viewportLayout.load();
+    }
+
+    Core::UInt32 RendererGL::getViewportCount() const {
+        return getViewportLayout() == ViewportLayout::Single ? 1 : MaxViewports;
+    }
+
+    QRect RendererGL::getViewportRect(Core::UInt32 viewport) {
+        return layoutViewport(getSurfaceSize(), getViewportLayout(), viewport);
+    }
+
+    Core::UInt32 RendererGL::getViewportAt(Core::Int32 x, Core::Int32 y) {
+        if (getViewportLayout() == ViewportLayout::Single) return 0;
+        QSize size = getSurfaceSize();
+        Core::UInt32 column = x * 2 >= size.width() ? 1 : 0;
+        Core::UInt32 row = y * 2 >= size.height() ? 1 : 0;
+        return row * 2 + column;
+    }
+
+    QRect RendererGL::layoutViewport(const QSize& size, ViewportLayout layout, Core::UInt32 viewport) {
+        if (layout == ViewportLayout::Single) return viewport == 0 ? QRect(QPoint(0, 0), size) : QRect();
+        if (viewport >= MaxViewports) return QRect();
+
+        int leftWidth = (size.width() - ViewportGap) / 2;
+        int topHeight = (size.height() - ViewportGap) / 2;
+        bool right = viewport % 2 == 1, bottom = viewport / 2 == 1;
+        int x = right ? leftWidth + ViewportGap : 0;
+        int y = bottom ? topHeight + ViewportGap : 0;
+        int width = right ? size.width() - x : leftWidth;
+        int height = bottom ? size.height() - y : topHeight;
+        return QRect(x, y, std::max(width, 0), std::max(height, 0));
+    }
+
+    void RendererGL::setSurfaceSize(unsigned int width, unsigned int height) {
+        {
+            QMutexLocker ml(&this->sizeMutex);
+            if (surfaceSize.width() == (int)width && surfaceSize.height() == (int)height) return;
+            surfaceSize = QSize(width, height);
+        }
+        // not deduplicated like requestFrame(): frames are skipped while there is no size, so a
+        // request that was already pending may have been used up
+        emit frameRequested(0);
+    }
+
+    QSize RendererGL::getSurfaceSize() {
+        QMutexLocker ml(&this->sizeMutex);
+        return surfaceSize;
+    }
+
     void RendererGL::setT(qreal t) {
         m_t = t;
     }
@@ -128,8 +389,4 @@ namespace Modeler {
             engineWindowSizeSet = true;
         }
     }
-
-    void RendererGL::setWindow(QQuickWindow *window) {
-        m_window = window;
-    }
 }
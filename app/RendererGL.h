@@ -3,22 +3,67 @@
 #include <vector>
 #include <functional>
 #include <memory>
+#include <atomic>
 
 #include <QtGui/QOpenGLShaderProgram>
 #include <QtGui/QOpenGLFunctions_3_3_Core>
-#include <QtQuick/qquickwindow.h>
+#include <QOpenGLTimerQuery>
+#include <QElapsedTimer>
 #include <QMutex>
+#include <QSize>
+#include <QRect>
 
 #include "Core/Engine.h"
 #include "Core/geometry/Vector2.h"
+#include "Core/render/RenderTarget2D.h"
 
 namespace Modeler {
+
+    // Drives the engine one frame at a time. Everything but the thread-safe calls below runs
+    // on the render thread (see RenderThread), with the engine's context current.
+    //
+    // The surface is split into one or more viewports. Each has an offscreen target that the
+    // camera showing it renders to; the engine draws all cameras in one pass, so work that
+    // doesn't depend on the camera (transforms, shadow maps) is shared between viewports.
+    // Each finished frame is assembled from the targets in the framebuffer paint() is given.
     class RendererGL : public QObject, protected QOpenGLFunctions_3_3_Core {
         Q_OBJECT
 
     public:
         typedef std::function<void(RendererGL*)> LifeCycleEventCallback;
 
+        class FrameTiming {
+        public:
+            FrameTiming(): frameIndex(0), cpuMilliseconds(0.0), gpuMilliseconds(-1.0), inputLatencyMilliseconds(-1.0) {}
+
+            Core::UInt64 frameIndex;
+            double cpuMilliseconds;
+            double gpuMilliseconds; // -1 when GPU timer queries are unavailable
+            double inputLatencyMilliseconds; // oldest latched input to draw submission, -1 when the frame latched none
+        };
+
+        typedef std::function<void(const FrameTiming&)> FrameTimingCallback;
+        // returns when the oldest input it applied arrived (Profiler clock), or 0 if it applied none
+        typedef std::function<Core::UInt64(RendererGL*)> LatchCallback;
+
+        enum class RenderMode {
+            Continuous = 0,
+            OnDemand = 1,
+        };
+
+        // Quad: 0 top left, 1 top right, 2 bottom left, 3 bottom right
+        enum class ViewportLayout {
+            Single = 0,
+            Quad = 1,
+        };
+
+        static const Core::UInt32 MaxViewports = 4;
+        // pixels left between the views of the quad layout
+        static const int ViewportGap = 2;
+
+        // frame interval used while an animation is active in on-demand mode
+        static const int AnimationFrameIntervalMs = 33;
+
         RendererGL();
         ~RendererGL();
 
@@ -27,41 +72,93 @@ namespace Modeler {
         void setRenderSize(unsigned int width, unsigned int height, unsigned int hOffset,
                            unsigned int vOffset, unsigned int vpWidth, unsigned int vpHeight);
         void setViewport(unsigned int hOffset, unsigned int vOffset, unsigned int vpWidth, unsigned int vpHeight);
-        void setWindow(QQuickWindow *window);
+        // thread-safe; the engine is resized at the start of the next frame
+        void setSurfaceSize(unsigned int width, unsigned int height);
+        QSize getSurfaceSize();
+        // thread-safe; takes effect with the next frame
+        void setViewportLayout(ViewportLayout layout);
+        ViewportLayout getViewportLayout() const;
+        Core::UInt32 getViewportCount() const;
+        // thread-safe, in surface coordinates (origin top left) for the current size and layout
+        QRect getViewportRect(Core::UInt32 viewport);
+        // the viewport nearest to a point in surface coordinates, thread-safe
+        Core::UInt32 getViewportAt(Core::Int32 x, Core::Int32 y);
 
         Core::WeakPointer<Core::Engine> getEngine();
+        // valid from the init callbacks on
+        Core::WeakPointer<Core::RenderTarget2D> getViewportTarget(Core::UInt32 viewport);
         void onInit(LifeCycleEventCallback func);
         void onUpdate(LifeCycleEventCallback func);
         void onPreRender(LifeCycleEventCallback func);
         bool isEngineInitialized();
 
-    public slots:
-        void paint();
+        void setRenderMode(RenderMode mode);
+        RenderMode getRenderMode() const;
+        // thread-safe; in on-demand mode frames are only produced when requested or while animating
+        void requestFrame();
+        void beginAnimation();
+        void endAnimation();
+        // render thread only. GPU results arrive a few frames late, so each timing is
+        // delivered once its GPU query resolves.
+        void setFrameTimingCallback(FrameTimingCallback callback);
+        // render thread only. Invoked as late as possible, right before the frame is drawn, so
+        // it sees the newest input; anything derived from the camera belongs here as well.
+        void setLatchCallback(LatchCallback callback);
+
+        // render thread only: produces a frame and copies it into outputFramebuffer
+        void paint(GLuint outputFramebuffer);
+
+    signals:
+        void frameRequested(int delayMs);
 
     private:
         qreal m_t;
-        QQuickWindow *m_window;
         QMutex preRenderMutex;
+        QMutex sizeMutex;
+        QSize surfaceSize;
+        QSize engineSize;
+        std::atomic<int> viewportLayout;
+        ViewportLayout engineLayout;
+        Core::WeakPointer<Core::RenderTarget2D> viewportTargets[MaxViewports];
         QMutex updateMutex;
 
         bool initialized;
-        bool engineInitialized;
+        std::atomic<bool> engineInitialized;
         bool engineWindowSizeSet;
+        std::atomic<int> renderMode;
+        std::atomic<bool> frameRequestPending;
+        std::atomic<int> activeAnimations;
         Core::PersistentWeakPointer<Core::Engine> engine;
 
+        static const unsigned int FrameTimingLatency = 4;
+        FrameTimingCallback frameTimingCallback;
+        LatchCallback latchCallback;
+        bool frameTimingInitialized;
+        Core::UInt64 frameIndex;
+        QOpenGLTimerQuery* gpuTimers[FrameTimingLatency];
+        FrameTiming pendingTimings[FrameTimingLatency];
+        bool pendingTimingValid[FrameTimingLatency];
+
         std::vector<LifeCycleEventCallback> onInits;
         std::vector<LifeCycleEventCallback> onUpdates;
+        std::vector<LifeCycleEventCallback> resolvingUpdates;
         std::vector<LifeCycleEventCallback> onPreRenders;
+        std::vector<LifeCycleEventCallback> resolvingPreRenders;
 
         void init();
         void update();
         void render();
+        void applySurfaceSize();
+        void copyViewports(GLuint outputFramebuffer);
+        static QRect layoutViewport(const QSize& size, ViewportLayout layout, Core::UInt32 viewport);
         void testDraw();
 
         void resolveOnInits();
         void resolveOnInit(LifeCycleEventCallback callback);
         void resolveOnUpdates();
         void resolveOnPreRenders();
+        void initFrameTiming();
+        void resolveFrameTiming(unsigned int slot);
 
     };
 }
@@ -0,0 +1,376 @@
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+#include "SceneBVH.h"
+
+namespace Modeler {
+
+    namespace {
+
+        void transformPoint(const Core::Real* m, const Core::Real* p, Core::Real* out) {
+            out[0] = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+            out[1] = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+            out[2] = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+        }
+
+        void transformVector(const Core::Real* m, const Core::Real* v, Core::Real* out) {
+            out[0] = m[0] * v[0] + m[4] * v[1] + m[8] * v[2];
+            out[1] = m[1] * v[0] + m[5] * v[1] + m[9] * v[2];
+            out[2] = m[2] * v[0] + m[6] * v[1] + m[10] * v[2];
+        }
+
+        // inverse of an affine column-major matrix (upper 3x3 + translation)
+        void invertAffine(const Core::Real* m, Core::Real* out) {
+            Core::Real c00 = m[5] * m[10] - m[9] * m[6];
+            Core::Real c01 = m[9] * m[2] - m[1] * m[10];
+            Core::Real c02 = m[1] * m[6] - m[5] * m[2];
+            Core::Real det = m[0] * c00 + m[4] * c01 + m[8] * c02;
+            Core::Real invDet = det != 0.0f ? 1.0f / det : 0.0f;
+
+            out[0] = c00 * invDet;
+            out[1] = c01 * invDet;
+            out[2] = c02 * invDet;
+            out[4] = (m[8] * m[6] - m[4] * m[10]) * invDet;
+            out[5] = (m[0] * m[10] - m[8] * m[2]) * invDet;
+            out[6] = (m[4] * m[2] - m[0] * m[6]) * invDet;
+            out[8] = (m[4] * m[9] - m[8] * m[5]) * invDet;
+            out[9] = (m[8] * m[1] - m[0] * m[9]) * invDet;
+            out[10] = (m[0] * m[5] - m[4] * m[1]) * invDet;
+            out[3] = out[7] = out[11] = 0.0f;
+            out[15] = 1.0f;
+
+            Core::Real translation[3] = {m[12], m[13], m[14]};
+            Core::Real inverseTranslation[3];
+            transformVector(out, translation, inverseTranslation);
+            out[12] = -inverseTranslation[0];
+            out[13] = -inverseTranslation[1];
+            out[14] = -inverseTranslation[2];
+        }
+    }
+
+    SceneBVH::SceneBVH(): needsRebuild(false) {
+
+    }
+
+    void SceneBVH::addInstance(Core::UInt64 id, std::shared_ptr<MeshBVH> meshBVH, const Core::Real* worldMatrix) {
+        if (this->instanceIndices.find(id) != this->instanceIndices.end()) {
+            this->removeInstance(id);
+        }
+        Instance instance;
+        instance.id = id;
+        instance.meshBVH = meshBVH;
+        this->setInstanceTransform(instance, worldMatrix);
+        this->instanceIndices[id] = (Core::UInt32)this->instances.size();
+        this->instances.push_back(instance);
+        this->needsRebuild = true;
+    }
+
+    void SceneBVH::removeInstance(Core::UInt64 id) {
+        auto found = this->instanceIndices.find(id);
+        if (found == this->instanceIndices.end()) return;
+
+        Core::UInt32 index = found->second;
+        Core::UInt32 last = (Core::UInt32)this->instances.size() - 1;
+        if (index != last) {
+            this->instances[index] = this->instances[last];
+            this->instanceIndices[this->instances[index].id] = index;
+        }
+        this->instances.pop_back();
+        this->instanceIndices.erase(id);
+        this->needsRebuild = true;
+    }
+
+    void SceneBVH::updateInstanceTransform(Core::UInt64 id, const Core::Real* worldMatrix) {
+        auto found = this->instanceIndices.find(id);
+        if (found == this->instanceIndices.end()) return;
+        this->setInstanceTransform(this->instances[found->second], worldMatrix);
+        this->dirtyInstances.push_back(found->second);
+    }
+
+    void SceneBVH::clear() {
+        this->instances.clear();
+        this->instanceIndices.clear();
+        this->nodes.clear();
+        this->instanceOrder.clear();
+        this->instanceLeaves.clear();
+        this->nodeParents.clear();
+        this->refitMarks.clear();
+        this->dirtyInstances.clear();
+        this->needsRebuild = false;
+    }
+
+    void SceneBVH::setJobSystem(std::shared_ptr<JobSystem> jobSystem) {
+        this->jobSystem = jobSystem;
+    }
+
+    bool SceneBVH::castRay(const Core::Real* origin, const Core::Real* direction, Hit& hit) {
+        this->prepare();
+        return this->traceRay(origin, direction, hit);
+    }
+
+    Core::UInt32 SceneBVH::castRayAll(const Core::Real* origin, const Core::Real* direction, Core::UInt32 maxHits, std::vector<Hit>& hits) {
+        hits.clear();
+        this->prepare();
+        if (this->nodes.size() == 0 || maxHits == 0) return 0;
+
+        // max-heap on t holding the nearest hits so far; once full, its top bounds the search
+        auto fartherHit = [](const Hit& a, const Hit& b) { return a.t < b.t; };
+        BVHRay ray(origin, direction);
+        Core::Real maxT = std::numeric_limits<Core::Real>::max();
+
+        BVHTraversalStack stack;
+        if (ray.intersect(this->nodes[0].bounds, maxT) >= 0.0f) stack.push(0);
+        while (!stack.isEmpty()) {
+            const BVHNode& node = this->nodes[stack.pop()];
+            if (ray.intersect(node.bounds, maxT) < 0.0f) continue;
+            if (!node.isLeaf()) {
+                stack.push(node.firstChild);
+                stack.push(node.firstChild + 1);
+                continue;
+            }
+
+            for (Core::UInt32 i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                Hit hit;
+                if (!this->intersectInstance(this->instances[this->instanceOrder[i]], ray, maxT, hit)) continue;
+                if (hits.size() == maxHits) {
+                    std::pop_heap(hits.begin(), hits.end(), fartherHit);
+                    hits.pop_back();
+                }
+                hits.push_back(hit);
+                std::push_heap(hits.begin(), hits.end(), fartherHit);
+                if (hits.size() == maxHits) maxT = hits.front().t;
+            }
+        }
+        std::sort_heap(hits.begin(), hits.end(), fartherHit);
+        return (Core::UInt32)hits.size();
+    }
+
+    void SceneBVH::castRays(const Core::Real* origins, const Core::Real* directions, Core::UInt32 rayCount, std::vector<Hit>& hits) {
+        hits.assign(rayCount, Hit());
+        this->prepare();
+
+        auto traceBatch = [this, origins, directions, rayCount, &hits](unsigned int batch) {
+            Core::UInt32 end = std::min(rayCount, (batch + 1) * RayBatchSize);
+            for (Core::UInt32 r = batch * RayBatchSize; r < end; r++) {
+                if (!this->traceRay(origins + r * 3, directions + r * 3, hits[r])) hits[r].t = -1.0f;
+            }
+        };
+        Core::UInt32 batchCount = (rayCount + RayBatchSize - 1) / RayBatchSize;
+        if (this->jobSystem && batchCount > 1) {
+            this->jobSystem->parallelFor(batchCount, traceBatch);
+        } else {
+            for (Core::UInt32 batch = 0; batch < batchCount; batch++) traceBatch(batch);
+        }
+    }
+
+    void SceneBVH::queryVolume(const Core::Real* planes, Core::UInt32 planeCount, std::vector<Core::UInt64>& ids) {
+        ids.clear();
+        this->prepare();
+        if (this->nodes.size() == 0 || planeCount > MaxVolumePlanes) return;
+
+        // bounds tests settle whole subtrees and most instances; only instances straddling the
+        // volume need their triangles checked, and those checks run in parallel
+        std::vector<Core::UInt32> candidates;
+        std::vector<Core::UInt32> stack;
+        std::vector<Core::UInt32> insideStack;
+        stack.push_back(0);
+        while (stack.size() > 0) {
+            Core::UInt32 nodeIndex = stack.back();
+            stack.pop_back();
+            const BVHNode& node = this->nodes[nodeIndex];
+            Core::Int32 classification = node.bounds.classify(planes, planeCount);
+            if (classification < 0) continue;
+
+            if (classification > 0) {
+                insideStack.push_back(nodeIndex);
+                while (insideStack.size() > 0) {
+                    const BVHNode& insideNode = this->nodes[insideStack.back()];
+                    insideStack.pop_back();
+                    if (!insideNode.isLeaf()) {
+                        insideStack.push_back(insideNode.firstChild);
+                        insideStack.push_back(insideNode.firstChild + 1);
+                        continue;
+                    }
+                    for (Core::UInt32 i = insideNode.firstPrimitive; i < insideNode.firstPrimitive + insideNode.primitiveCount; i++) {
+                        ids.push_back(this->instances[this->instanceOrder[i]].id);
+                    }
+                }
+                continue;
+            }
+
+            if (!node.isLeaf()) {
+                stack.push_back(node.firstChild);
+                stack.push_back(node.firstChild + 1);
+                continue;
+            }
+            for (Core::UInt32 i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                const Instance& instance = this->instances[this->instanceOrder[i]];
+                Core::Int32 instanceClassification = instance.worldBounds.classify(planes, planeCount);
+                if (instanceClassification > 0) ids.push_back(instance.id);
+                else if (instanceClassification == 0) candidates.push_back(this->instanceOrder[i]);
+            }
+        }
+
+        std::vector<Core::UInt32> selected(candidates.size(), 0);
+        auto testCandidate = [this, planes, planeCount, &candidates, &selected](unsigned int c) {
+            const Instance& instance = this->instances[candidates[c]];
+            // a world plane p becomes transpose(M) * p in the instance's local space
+            Core::Real localPlanes[MaxVolumePlanes * 4];
+            for (Core::UInt32 p = 0; p < planeCount; p++) {
+                for (unsigned int column = 0; column < 4; column++) {
+                    const Core::Real* m = instance.worldMatrix + column * 4;
+                    localPlanes[p * 4 + column] = m[0] * planes[p * 4] + m[1] * planes[p * 4 + 1] + m[2] * planes[p * 4 + 2] + m[3] * planes[p * 4 + 3];
+                }
+            }
+            selected[c] = instance.meshBVH->intersectsVolume(localPlanes, planeCount) ? 1 : 0;
+        };
+        if (this->jobSystem && candidates.size() > 1) {
+            this->jobSystem->parallelFor((unsigned int)candidates.size(), testCandidate);
+        } else {
+            for (Core::UInt32 c = 0; c < candidates.size(); c++) testCandidate(c);
+        }
+        for (Core::UInt32 c = 0; c < candidates.size(); c++) {
+            if (selected[c]) ids.push_back(this->instances[candidates[c]].id);
+        }
+    }
+
+    Core::UInt32 SceneBVH::getInstanceCount() const {
+        return (Core::UInt32)this->instances.size();
+    }
+
+    Core::UInt64 SceneBVH::getTriangleCount() const {
+        Core::UInt64 triangleCount = 0;
+        for (const Instance& instance : this->instances) {
+            triangleCount += instance.meshBVH->getTriangleCount();
+        }
+        return triangleCount;
+    }
+
+    void SceneBVH::setInstanceTransform(Instance& instance, const Core::Real* worldMatrix) {
+        std::memcpy(instance.worldMatrix, worldMatrix, sizeof(Core::Real) * 16);
+        invertAffine(instance.worldMatrix, instance.inverseWorldMatrix);
+        instance.meshBVH->getBounds().transform(instance.worldMatrix, instance.worldBounds);
+    }
+
+    void SceneBVH::prepare() {
+        if (this->needsRebuild) this->rebuild();
+        else if (this->dirtyInstances.size() > 0) this->refit();
+    }
+
+    bool SceneBVH::traceRay(const Core::Real* origin, const Core::Real* direction, Hit& hit) const {
+        if (this->nodes.size() == 0) return false;
+
+        BVHRay ray(origin, direction);
+        Core::Real closestT = std::numeric_limits<Core::Real>::max();
+        bool found = false;
+
+        BVHTraversalStack stack;
+        if (ray.intersect(this->nodes[0].bounds, closestT) >= 0.0f) stack.push(0);
+        while (!stack.isEmpty()) {
+            const BVHNode& node = this->nodes[stack.pop()];
+            if (node.isLeaf()) {
+                for (Core::UInt32 i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                    if (this->intersectInstance(this->instances[this->instanceOrder[i]], ray, closestT, hit)) {
+                        closestT = hit.t;
+                        found = true;
+                    }
+                }
+                continue;
+            }
+
+            Core::UInt32 nearChild = node.firstChild;
+            Core::UInt32 farChild = node.firstChild + 1;
+            Core::Real nearT = ray.intersect(this->nodes[nearChild].bounds, closestT);
+            Core::Real farT = ray.intersect(this->nodes[farChild].bounds, closestT);
+            if (farT >= 0.0f && (nearT < 0.0f || farT < nearT)) {
+                std::swap(nearChild, farChild);
+                std::swap(nearT, farT);
+            }
+            if (farT >= 0.0f) stack.push(farChild);
+            if (nearT >= 0.0f) stack.push(nearChild);
+        }
+        return found;
+    }
+
+    // only hits closer than maxT are reported
+    bool SceneBVH::intersectInstance(const Instance& instance, const BVHRay& ray, Core::Real maxT, Hit& hit) const {
+        if (ray.intersect(instance.worldBounds, maxT) < 0.0f) return false;
+
+        // the local-space direction is left unnormalized so t stays comparable across instances
+        Core::Real localOrigin[3], localDirection[3];
+        transformPoint(instance.inverseWorldMatrix, ray.origin, localOrigin);
+        transformVector(instance.inverseWorldMatrix, ray.direction, localDirection);
+        BVHRay localRay(localOrigin, localDirection);
+
+        MeshBVH::Hit meshHit;
+        meshHit.t = maxT;
+        if (!instance.meshBVH->intersect(localRay, meshHit)) return false;
+        hit.id = instance.id;
+        hit.t = meshHit.t;
+        hit.triangle = meshHit.triangle;
+        return true;
+    }
+
+    void SceneBVH::rebuild() {
+        std::vector<BVHBounds> instanceBounds(this->instances.size());
+        for (Core::UInt32 i = 0; i < this->instances.size(); i++) {
+            instanceBounds[i] = this->instances[i].worldBounds;
+        }
+        BVHBuilder::build(instanceBounds, MaxLeafInstances, this->nodes, this->instanceOrder);
+
+        this->instanceLeaves.resize(this->instances.size());
+        this->nodeParents.assign(this->nodes.size(), (Core::UInt32)NoParent);
+        this->refitMarks.assign(this->nodes.size(), false);
+        for (Core::UInt32 n = 0; n < this->nodes.size(); n++) {
+            const BVHNode& node = this->nodes[n];
+            if (!node.isLeaf()) {
+                this->nodeParents[node.firstChild] = n;
+                this->nodeParents[node.firstChild + 1] = n;
+                continue;
+            }
+            for (Core::UInt32 i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                this->instanceLeaves[this->instanceOrder[i]] = n;
+            }
+        }
+
+        this->dirtyInstances.clear();
+        this->needsRebuild = false;
+    }
+
+    // Only the moved instances' leaves and their ancestors are refit. Children are stored after
+    // their parent, so going through the collected nodes from the highest index down updates
+    // every child before the parent that grows around it.
+    void SceneBVH::refit() {
+        this->refitNodes.clear();
+        for (Core::UInt32 instanceIndex : this->dirtyInstances) {
+            Core::UInt32 n = this->instanceLeaves[instanceIndex];
+            // a path already collected is shared with everything above it
+            while (n != NoParent && !this->refitMarks[n]) {
+                this->refitMarks[n] = true;
+                this->refitNodes.push_back(n);
+                n = this->nodeParents[n];
+            }
+        }
+        std::sort(this->refitNodes.begin(), this->refitNodes.end(), std::greater<Core::UInt32>());
+
+        for (Core::UInt32 n : this->refitNodes) {
+            BVHNode& node = this->nodes[n];
+            if (node.isLeaf()) {
+                node.bounds.reset();
+                for (Core::UInt32 i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                    node.bounds.grow(this->instances[this->instanceOrder[i]].worldBounds);
+                }
+            }
+            else {
+                node.bounds = this->nodes[node.firstChild].bounds;
+                node.bounds.grow(this->nodes[node.firstChild + 1].bounds);
+            }
+            this->refitMarks[n] = false;
+        }
+        this->dirtyInstances.clear();
+    }
+
+}
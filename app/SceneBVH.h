@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "BVH.h"
+#include "MeshBVH.h"
+#include "JobSystem.h"
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Top level of the picking hierarchy. Each instance pairs a (possibly shared) MeshBVH
+    // with a world transform and is identified by the mesh's object ID. Adding or removing
+    // instances triggers a rebuild on the next query; transform updates only refit the paths
+    // from the moved instances' leaves to the root.
+    // Batched queries (many rays, selection volumes) are spread over the job system when
+    // one is set.
+    class SceneBVH {
+    public:
+        static const Core::UInt32 MaxLeafInstances = 2;
+        static const Core::UInt32 MaxVolumePlanes = MeshBVH::MaxVolumePlanes;
+        // rays per job in castRays()
+        static const Core::UInt32 RayBatchSize = 64;
+        static const Core::UInt32 NoParent = 0xFFFFFFFF;
+
+        class Hit {
+        public:
+            Hit(): id(0), t(0.0f), triangle(0) {}
+
+            Core::UInt64 id;
+            Core::Real t;
+            Core::UInt32 triangle;
+        };
+
+        SceneBVH();
+
+        void setJobSystem(std::shared_ptr<JobSystem> jobSystem);
+
+        // world matrices are column-major 4x4
+        void addInstance(Core::UInt64 id, std::shared_ptr<MeshBVH> meshBVH, const Core::Real* worldMatrix);
+        void removeInstance(Core::UInt64 id);
+        void updateInstanceTransform(Core::UInt64 id, const Core::Real* worldMatrix);
+        void clear();
+
+        // direction does not need to be normalized, hit.t is in units of its length
+        bool castRay(const Core::Real* origin, const Core::Real* direction, Hit& hit);
+        // the nearest hit on each instance along the ray, closest first, at most maxHits of them
+        Core::UInt32 castRayAll(const Core::Real* origin, const Core::Real* direction, Core::UInt32 maxHits, std::vector<Hit>& hits);
+        // independent rays, 3 Reals per origin and direction; misses are left with hit.t < 0
+        void castRays(const Core::Real* origins, const Core::Real* directions, Core::UInt32 rayCount, std::vector<Hit>& hits);
+        // every instance with geometry at least partly inside the convex volume bounded by planes
+        // (a, b, c, d), inside where a x + b y + c z + d >= 0, in world space
+        void queryVolume(const Core::Real* planes, Core::UInt32 planeCount, std::vector<Core::UInt64>& ids);
+
+        Core::UInt32 getInstanceCount() const;
+        Core::UInt64 getTriangleCount() const;
+
+    private:
+        class Instance {
+        public:
+            Core::UInt64 id;
+            std::shared_ptr<MeshBVH> meshBVH;
+            Core::Real worldMatrix[16];
+            Core::Real inverseWorldMatrix[16];
+            BVHBounds worldBounds;
+        };
+
+        void setInstanceTransform(Instance& instance, const Core::Real* worldMatrix);
+        void prepare();
+        void rebuild();
+        void refit();
+        bool traceRay(const Core::Real* origin, const Core::Real* direction, Hit& hit) const;
+        bool intersectInstance(const Instance& instance, const BVHRay& ray, Core::Real maxT, Hit& hit) const;
+
+        std::vector<Instance> instances;
+        std::unordered_map<Core::UInt64, Core::UInt32> instanceIndices;
+        std::vector<BVHNode> nodes;
+        std::vector<Core::UInt32> instanceOrder;
+        std::vector<Core::UInt32> instanceLeaves;
+        std::vector<Core::UInt32> nodeParents; // NoParent for the root
+        std::vector<bool> refitMarks;          // nodes already collected by the current refit
+        std::vector<Core::UInt32> refitNodes;
+        std::vector<Core::UInt32> dirtyInstances;
+        bool needsRebuild;
+        std::shared_ptr<JobSystem> jobSystem;
+    };
+
+}
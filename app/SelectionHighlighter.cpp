@@ -0,0 +1,216 @@
+#include <QDebug>
+#include <QtGui/QOpenGLContext>
+
+#include "SelectionHighlighter.h"
+
+#include "Core/render/Camera.h"
+#include "Core/render/RenderTarget.h"
+#include "Core/scene/Transform.h"
+#include "Core/image/TextureAttr.h"
+#include "Core/color/Color.h"
+
+static const char selectionComposite_vertex[] =
+    "#version 330 core\n"
+    "void main() {\n"
+    "    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+// the mask is sampled texel for texel, the view is drawn from the target's origin
+static const char selectionComposite_fragment[] =
+    "#version 330 core\n"
+    "uniform sampler2D mask;\n"
+    "uniform int outlineWidth;\n"
+    "uniform vec4 tintColor;\n"
+    "uniform vec4 outlineColor;\n"
+    "out vec4 fragColor;\n"
+    "void main() {\n"
+    "    ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+    "    ivec2 maxPixel = textureSize(mask, 0) - 1;\n"
+    "    if (texelFetch(mask, pixel, 0).r > 0.5) {\n"
+    "        fragColor = tintColor;\n"
+    "        return;\n"
+    "    }\n"
+    "    for (int y = -outlineWidth; y <= outlineWidth; y++) {\n"
+    "        for (int x = -outlineWidth; x <= outlineWidth; x++) {\n"
+    "            if (texelFetch(mask, clamp(pixel + ivec2(x, y), ivec2(0), maxPixel), 0).r > 0.5) {\n"
+    "                fragColor = outlineColor;\n"
+    "                return;\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "    discard;\n"
+    "}\n";
+
+namespace Modeler {
+
+    SelectionHighlighter::SelectionHighlighter(Core::WeakPointer<Core::Engine> engine): engine(engine), gl(nullptr), initializeFailed(false),
+        maskWidth(0), maskHeight(0), maskTexture(0), compositeProgram(nullptr), compositeVertexArray(0) {
+
+    }
+
+    SelectionHighlighter::~SelectionHighlighter() {
+        // without the context the GL objects go away with it anyway
+        if (!this->gl || !QOpenGLContext::currentContext()) return;
+        delete this->compositeProgram;
+        this->gl->glDeleteVertexArrays(1, &this->compositeVertexArray);
+    }
+
+    void SelectionHighlighter::setProxyResolver(ProxyResolver resolver) {
+        this->proxyResolver = resolver;
+    }
+
+    void SelectionHighlighter::setupMaskCamera(Core::WeakPointer<Core::Camera> maskCamera) {
+        // the mask pass clears for itself, the camera's own clear would use the scene's color
+        maskCamera->setAutoClearRenderBuffer(Core::RenderBufferType::Color, false);
+        maskCamera->setAutoClearRenderBuffer(Core::RenderBufferType::Depth, false);
+    }
+
+    void SelectionHighlighter::render(Core::WeakPointer<Core::Camera> camera, Core::WeakPointer<Core::Camera> maskCamera,
+                                      const std::vector<Core::WeakPointer<Core::Object3D>>& objects) {
+        if (objects.size() == 0) return;
+        if (!this->gl && (this->initializeFailed || !this->initialize())) return;
+
+        this->drawMask(camera, maskCamera, objects);
+        this->composite(camera);
+    }
+
+    bool SelectionHighlighter::initialize() {
+        this->initializeFailed = true;
+        QOpenGLContext* context = QOpenGLContext::currentContext();
+        QOpenGLFunctions_3_3_Core* functions = context ? context->versionFunctions<QOpenGLFunctions_3_3_Core>() : nullptr;
+        if (!functions || !functions->initializeOpenGLFunctions()) {
+            qDebug() << "SelectionHighlighter::initialize() -> OpenGL 3.3 is required for the selection highlight.";
+            return false;
+        }
+
+        QOpenGLShaderProgram* program = new QOpenGLShaderProgram();
+        if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, selectionComposite_vertex) ||
+            !program->addShaderFromSourceCode(QOpenGLShader::Fragment, selectionComposite_fragment) ||
+            !program->link()) {
+            qDebug() << "SelectionHighlighter::initialize() -> Unable to build the composite shader:" << program->log();
+            delete program;
+            return false;
+        }
+
+        // the composite's uniforms never change, so they are set once here
+        GLint previousProgram = 0;
+        functions->glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+        program->bind();
+        program->setUniformValue("mask", 0);
+        program->setUniformValue("outlineWidth", (GLint)OutlineWidth);
+        program->setUniformValue("tintColor", 1.0f, 0.65f, 0.0f, 0.35f);
+        program->setUniformValue("outlineColor", 1.0f, 0.65f, 0.0f, 1.0f);
+        functions->glUseProgram(previousProgram);
+
+        // the full-screen triangle is made up from gl_VertexID, but core profiles still want a
+        // vertex array bound to draw
+        functions->glGenVertexArrays(1, &this->compositeVertexArray);
+        this->compositeProgram = program;
+        this->gl = functions;
+
+        this->maskMaterial = this->engine->createMaterial<Core::BasicColoredMaterial>();
+        this->maskMaterial->setLit(false);
+        this->maskMaterial->setBlendingMode(Core::RenderState::BlendingMode::None);
+        this->maskMaterial->setColor(Core::Color(1.0, 1.0, 1.0, 1.0));
+        // the mask's depth comes from the scene, which has these very surfaces in it
+        this->maskMaterial->setZOffset(-.00005f);
+        this->initializeFailed = false;
+        return true;
+    }
+
+    void SelectionHighlighter::drawMask(Core::WeakPointer<Core::Camera> camera, Core::WeakPointer<Core::Camera> maskCamera,
+                                        const std::vector<Core::WeakPointer<Core::Object3D>>& objects) {
+        Core::WeakPointer<Core::Graphics> graphics = this->engine->getGraphicsSystem();
+        Core::WeakPointer<Core::RenderTarget> viewTarget = camera->getRenderTarget();
+        Core::Vector4u viewport = viewTarget->getViewport();
+        if (!this->maskTarget) {
+            Core::TextureAttributes colorAttributes;
+            colorAttributes.Format = Core::TextureFormat::RGBA8;
+            colorAttributes.FilterMode = Core::TextureFilter::Point;
+            colorAttributes.MipLevels = 0;
+            // made like the view targets, so their depth can be blitted across as is
+            this->maskTarget = graphics->createRenderTarget2D(true, true, false, colorAttributes, Core::Vector2u(viewport.z, viewport.w));
+        } else if (viewport.z != this->maskWidth || viewport.w != this->maskHeight) {
+            this->maskTarget->setSize(viewport.z, viewport.w);
+        }
+        this->maskWidth = viewport.z;
+        this->maskHeight = viewport.w;
+
+        GLint viewFramebuffer = 0;
+        GLint maskFramebuffer = 0;
+        graphics->activateRenderTarget(viewTarget);
+        this->gl->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &viewFramebuffer);
+        graphics->activateRenderTarget(this->maskTarget);
+        this->gl->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &maskFramebuffer);
+        // resizing may have replaced the texture behind the attachment
+        GLint maskTexture = 0;
+        this->gl->glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &maskTexture);
+        this->maskTexture = (GLuint)maskTexture;
+
+        this->gl->glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        this->gl->glClear(GL_COLOR_BUFFER_BIT);
+        this->gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)viewFramebuffer);
+        this->gl->glBlitFramebuffer(0, 0, (GLint)viewport.z, (GLint)viewport.w, 0, 0, (GLint)viewport.z, (GLint)viewport.w, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        this->gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)maskFramebuffer);
+
+        Core::Transform& cameraTransform = camera->getOwner()->getTransform();
+        cameraTransform.updateWorldMatrix();
+        maskCamera->getOwner()->getTransform().getLocalMatrix().copy(cameraTransform.getWorldMatrix());
+        maskCamera->getOwner()->getTransform().updateWorldMatrix();
+        maskCamera->setRenderTarget(this->maskTarget);
+
+        auto renderer = graphics->getRenderer();
+        for (Core::WeakPointer<Core::Object3D> object : objects) {
+            Core::WeakPointer<Core::Object3D> drawn[] = {object, this->proxyResolver ? this->proxyResolver(object) : Core::WeakPointer<Core::Object3D>()};
+            for (Core::WeakPointer<Core::Object3D> drawObject : drawn) {
+                if (drawObject) renderer->renderObjectBasic(drawObject, maskCamera, this->maskMaterial);
+            }
+        }
+    }
+
+    // Core keeps track of the GL state it sets, so everything changed here is put back
+    void SelectionHighlighter::composite(Core::WeakPointer<Core::Camera> camera) {
+        Core::WeakPointer<Core::Graphics> graphics = this->engine->getGraphicsSystem();
+        graphics->activateRenderTarget(camera->getRenderTarget());
+
+        GLint previousViewport[4];
+        GLint previousProgram = 0;
+        GLint previousVertexArray = 0;
+        GLint previousActiveTexture = 0;
+        GLint previousTexture = 0;
+        GLint previousBlendSource[2];
+        GLint previousBlendDest[2];
+        this->gl->glGetIntegerv(GL_VIEWPORT, previousViewport);
+        this->gl->glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+        this->gl->glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+        this->gl->glGetIntegerv(GL_ACTIVE_TEXTURE, &previousActiveTexture);
+        this->gl->glActiveTexture(GL_TEXTURE0);
+        this->gl->glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+        this->gl->glGetIntegerv(GL_BLEND_SRC_RGB, &previousBlendSource[0]);
+        this->gl->glGetIntegerv(GL_BLEND_SRC_ALPHA, &previousBlendSource[1]);
+        this->gl->glGetIntegerv(GL_BLEND_DST_RGB, &previousBlendDest[0]);
+        this->gl->glGetIntegerv(GL_BLEND_DST_ALPHA, &previousBlendDest[1]);
+        GLboolean depthTest = this->gl->glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = this->gl->glIsEnabled(GL_BLEND);
+
+        this->gl->glViewport(0, 0, (GLsizei)this->maskWidth, (GLsizei)this->maskHeight);
+        this->gl->glDisable(GL_DEPTH_TEST);
+        this->gl->glEnable(GL_BLEND);
+        this->gl->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        this->gl->glBindTexture(GL_TEXTURE_2D, this->maskTexture);
+        this->compositeProgram->bind();
+        this->gl->glBindVertexArray(this->compositeVertexArray);
+        this->gl->glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        this->gl->glBindVertexArray((GLuint)previousVertexArray);
+        this->gl->glUseProgram((GLuint)previousProgram);
+        this->gl->glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+        this->gl->glActiveTexture((GLenum)previousActiveTexture);
+        this->gl->glBlendFuncSeparate(previousBlendSource[0], previousBlendDest[0], previousBlendSource[1], previousBlendDest[1]);
+        if (!blend) this->gl->glDisable(GL_BLEND);
+        if (depthTest) this->gl->glEnable(GL_DEPTH_TEST);
+        this->gl->glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    }
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+#include <QtGui/QOpenGLShaderProgram>
+
+#include "Core/Engine.h"
+#include "Core/render/RenderTarget2D.h"
+#include "Core/material/BasicColoredMaterial.h"
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // The selection highlight: a tint over the selected objects and an outline around them.
+    //
+    // Each selected object is drawn once per view, flat white into an offscreen mask that
+    // starts out with a copy of the view's depth, so parts hidden behind other geometry stay
+    // unmarked. One full-screen pass then blends the tint over the mask and the outline along
+    // its outer edge into the view. The cost past that single draw is per pixel, not per
+    // selected triangle, so large selections get the same highlight as small ones.
+    //
+    // The mask is drawn through a second camera per view that follows the view camera and has
+    // its clears off for good, and the composite is plain GL with its state restored
+    // afterwards, so the view cameras are never touched.
+    //
+    // Everything here runs on the render thread.
+    class SelectionHighlighter {
+    public:
+        // in pixels, outside the selected silhouette
+        static const Core::Int32 OutlineWidth = 2;
+
+        // returns an extra object to draw along with a selected one, for geometry that isn't
+        // rendered by the object itself, or an invalid pointer
+        typedef std::function<Core::WeakPointer<Core::Object3D>(Core::WeakPointer<Core::Object3D>)> ProxyResolver;
+
+        SelectionHighlighter(Core::WeakPointer<Core::Engine> engine);
+        ~SelectionHighlighter();
+
+        void setProxyResolver(ProxyResolver resolver);
+
+        // a camera outside the scene for a view camera's mask; it must get the same lens and
+        // aspect ratio as the view camera
+        static void setupMaskCamera(Core::WeakPointer<Core::Camera> maskCamera);
+
+        // call from an onRender callback after the view's scene is drawn
+        void render(Core::WeakPointer<Core::Camera> camera, Core::WeakPointer<Core::Camera> maskCamera,
+                    const std::vector<Core::WeakPointer<Core::Object3D>>& objects);
+
+    private:
+        bool initialize();
+        void drawMask(Core::WeakPointer<Core::Camera> camera, Core::WeakPointer<Core::Camera> maskCamera,
+                      const std::vector<Core::WeakPointer<Core::Object3D>>& objects);
+        void composite(Core::WeakPointer<Core::Camera> camera);
+
+        Core::WeakPointer<Core::Engine> engine;
+        QOpenGLFunctions_3_3_Core* gl;
+        bool initializeFailed;
+        Core::WeakPointer<Core::BasicColoredMaterial> maskMaterial;
+        Core::WeakPointer<Core::RenderTarget2D> maskTarget;
+        Core::UInt32 maskWidth;
+        Core::UInt32 maskHeight;
+        GLuint maskTexture;
+        QOpenGLShaderProgram* compositeProgram;
+        GLuint compositeVertexArray;
+        ProxyResolver proxyResolver;
+    };
+
+}
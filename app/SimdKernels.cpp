@@ -0,0 +1,347 @@
+#include <cstring>
+
+#include "SimdKernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define MODELER_SIMD_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define MODELER_TARGET_AVX2
+    #else
+        #define MODELER_TARGET_AVX2 __attribute__((target("avx2,fma")))
+    #endif
+#endif
+
+namespace Modeler {
+
+    namespace {
+
+        // Only rejects rays (numerically) parallel to the triangle. The determinant scales with
+        // the squared edge length, so anything much larger would start dropping the tiny
+        // triangles of models imported at a small scale (edges of 1e-4 give about 1e-8).
+        const Core::Real DeterminantEpsilon = 1e-12f;
+
+        class KernelTable {
+        public:
+            void (*multiplyMatrices)(const Core::Real* a, const Core::Real* b, Core::Real* out);
+            void (*transformPoints)(const Core::Real* matrix, const Core::Real* points, Core::UInt32 count, Core::Real* out);
+            Core::Int32 (*intersectPacket)(const SimdKernels::TrianglePacket& packet, const BVHRay& ray, Core::Real maxT,
+                                           Core::Real& t, Core::Real& u, Core::Real& v);
+        };
+
+        // ---- scalar ----
+
+        void multiplyMatricesScalar(const Core::Real* a, const Core::Real* b, Core::Real* out) {
+            Core::Real result[16];
+            for (unsigned int column = 0; column < 4; column++) {
+                for (unsigned int row = 0; row < 4; row++) {
+                    Core::Real sum = 0.0f;
+                    for (unsigned int k = 0; k < 4; k++) {
+                        sum += a[k * 4 + row] * b[column * 4 + k];
+                    }
+                    result[column * 4 + row] = sum;
+                }
+            }
+            memcpy(out, result, sizeof(result));
+        }
+
+        void transformPointsScalar(const Core::Real* matrix, const Core::Real* points, Core::UInt32 count, Core::Real* out) {
+            for (Core::UInt32 i = 0; i < count; i++) {
+                Core::Real x = points[i * 4];
+                Core::Real y = points[i * 4 + 1];
+                Core::Real z = points[i * 4 + 2];
+                for (unsigned int row = 0; row < 4; row++) {
+                    out[i * 4 + row] = matrix[row] * x + matrix[4 + row] * y + matrix[8 + row] * z + matrix[12 + row];
+                }
+            }
+        }
+
+        Core::Int32 intersectPacketScalar(const SimdKernels::TrianglePacket& packet, const BVHRay& ray, Core::Real maxT,
+                                          Core::Real& t, Core::Real& u, Core::Real& v) {
+            Core::Int32 hitLane = -1;
+            const Core::Real* d = ray.direction;
+            for (unsigned int lane = 0; lane < SimdKernels::PacketWidth; lane++) {
+                Core::Real e1[3] = {packet.edge1[0][lane], packet.edge1[1][lane], packet.edge1[2][lane]};
+                Core::Real e2[3] = {packet.edge2[0][lane], packet.edge2[1][lane], packet.edge2[2][lane]};
+                Core::Real p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+                Core::Real det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+                if (det > -DeterminantEpsilon && det < DeterminantEpsilon) continue;
+                Core::Real invDet = 1.0f / det;
+
+                Core::Real s[3] = {ray.origin[0] - packet.v0[0][lane], ray.origin[1] - packet.v0[1][lane], ray.origin[2] - packet.v0[2][lane]};
+                Core::Real laneU = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+                if (laneU < 0.0f || laneU > 1.0f) continue;
+
+                Core::Real q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+                Core::Real laneV = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * invDet;
+                if (laneV < 0.0f || laneU + laneV > 1.0f) continue;
+
+                Core::Real laneT = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+                if (laneT <= 0.0f || laneT >= maxT) continue;
+
+                maxT = laneT;
+                t = laneT;
+                u = laneU;
+                v = laneV;
+                hitLane = (Core::Int32)lane;
+            }
+            return hitLane;
+        }
+
+#ifdef MODELER_SIMD_X86
+
+        // picks the closest lane set in mask, writing its results
+        Core::Int32 closestLane(int mask, const Core::Real* laneT, const Core::Real* laneU, const Core::Real* laneV,
+                                Core::Real& t, Core::Real& u, Core::Real& v) {
+            if (mask == 0) return -1;
+            Core::Int32 hitLane = -1;
+            for (unsigned int lane = 0; lane < SimdKernels::PacketWidth; lane++) {
+                if (!(mask & (1 << lane))) continue;
+                if (hitLane < 0 || laneT[lane] < laneT[hitLane]) hitLane = (Core::Int32)lane;
+            }
+            t = laneT[hitLane];
+            u = laneU[hitLane];
+            v = laneV[hitLane];
+            return hitLane;
+        }
+
+        // ---- SSE2 (baseline on x86-64) ----
+
+        void multiplyMatricesSSE2(const Core::Real* a, const Core::Real* b, Core::Real* out) {
+            __m128 a0 = _mm_loadu_ps(a);
+            __m128 a1 = _mm_loadu_ps(a + 4);
+            __m128 a2 = _mm_loadu_ps(a + 8);
+            __m128 a3 = _mm_loadu_ps(a + 12);
+            __m128 columns[4];
+            for (unsigned int column = 0; column < 4; column++) {
+                __m128 sum = _mm_mul_ps(a0, _mm_set1_ps(b[column * 4]));
+                sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(b[column * 4 + 1])));
+                sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(b[column * 4 + 2])));
+                sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(b[column * 4 + 3])));
+                columns[column] = sum;
+            }
+            for (unsigned int column = 0; column < 4; column++) _mm_storeu_ps(out + column * 4, columns[column]);
+        }
+
+        void transformPointsSSE2(const Core::Real* matrix, const Core::Real* points, Core::UInt32 count, Core::Real* out) {
+            __m128 c0 = _mm_loadu_ps(matrix);
+            __m128 c1 = _mm_loadu_ps(matrix + 4);
+            __m128 c2 = _mm_loadu_ps(matrix + 8);
+            __m128 c3 = _mm_loadu_ps(matrix + 12);
+            for (Core::UInt32 i = 0; i < count; i++) {
+                __m128 p = _mm_loadu_ps(points + i * 4);
+                __m128 result = _mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0))), c3);
+                result = _mm_add_ps(result, _mm_mul_ps(c1, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1))));
+                result = _mm_add_ps(result, _mm_mul_ps(c2, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2))));
+                _mm_storeu_ps(out + i * 4, result);
+            }
+        }
+
+        Core::Int32 intersectPacketSSE2(const SimdKernels::TrianglePacket& packet, const BVHRay& ray, Core::Real maxT,
+                                        Core::Real& t, Core::Real& u, Core::Real& v) {
+            __m128 dx = _mm_set1_ps(ray.direction[0]);
+            __m128 dy = _mm_set1_ps(ray.direction[1]);
+            __m128 dz = _mm_set1_ps(ray.direction[2]);
+            __m128 e1x = _mm_loadu_ps(packet.edge1[0]);
+            __m128 e1y = _mm_loadu_ps(packet.edge1[1]);
+            __m128 e1z = _mm_loadu_ps(packet.edge1[2]);
+            __m128 e2x = _mm_loadu_ps(packet.edge2[0]);
+            __m128 e2y = _mm_loadu_ps(packet.edge2[1]);
+            __m128 e2z = _mm_loadu_ps(packet.edge2[2]);
+
+            __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+            __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+            __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+            __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+            __m128 valid = _mm_or_ps(_mm_cmplt_ps(det, _mm_set1_ps(-DeterminantEpsilon)), _mm_cmpgt_ps(det, _mm_set1_ps(DeterminantEpsilon)));
+            if (_mm_movemask_ps(valid) == 0) return -1;
+            __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+            __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin[0]), _mm_loadu_ps(packet.v0[0]));
+            __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin[1]), _mm_loadu_ps(packet.v0[1]));
+            __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin[2]), _mm_loadu_ps(packet.v0[2]));
+            __m128 laneU = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+            valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(laneU, _mm_setzero_ps()), _mm_cmple_ps(laneU, _mm_set1_ps(1.0f))));
+
+            __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+            __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+            __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+            __m128 laneV = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+            valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(laneV, _mm_setzero_ps()), _mm_cmple_ps(_mm_add_ps(laneU, laneV), _mm_set1_ps(1.0f))));
+
+            __m128 laneT = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+            valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(laneT, _mm_setzero_ps()), _mm_cmplt_ps(laneT, _mm_set1_ps(maxT))));
+
+            Core::Real ts[4], us[4], vs[4];
+            _mm_storeu_ps(ts, laneT);
+            _mm_storeu_ps(us, laneU);
+            _mm_storeu_ps(vs, laneV);
+            return closestLane(_mm_movemask_ps(valid), ts, us, vs, t, u, v);
+        }
+
+        // ---- AVX2 + FMA ----
+        // Packets stay 4 wide to match the 4-triangle BVH leaves, so the ray test keeps using
+        // the SSE2 kernel; the 8-wide registers pay off in the matrix kernels, which handle
+        // two columns or two points per instruction.
+
+        MODELER_TARGET_AVX2
+        void multiplyMatricesAVX2(const Core::Real* a, const Core::Real* b, Core::Real* out) {
+            __m256 a0 = _mm256_broadcast_ps((const __m128*)a);
+            __m256 a1 = _mm256_broadcast_ps((const __m128*)(a + 4));
+            __m256 a2 = _mm256_broadcast_ps((const __m128*)(a + 8));
+            __m256 a3 = _mm256_broadcast_ps((const __m128*)(a + 12));
+            // each half of a b register holds one column, permuted so every lane of a half
+            // sees the same component of that column
+            __m256 b01 = _mm256_loadu_ps(b);
+            __m256 b23 = _mm256_loadu_ps(b + 8);
+            __m256 columns01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, _MM_SHUFFLE(0, 0, 0, 0)));
+            columns01 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b01, _MM_SHUFFLE(1, 1, 1, 1)), columns01);
+            columns01 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b01, _MM_SHUFFLE(2, 2, 2, 2)), columns01);
+            columns01 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b01, _MM_SHUFFLE(3, 3, 3, 3)), columns01);
+            __m256 columns23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, _MM_SHUFFLE(0, 0, 0, 0)));
+            columns23 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b23, _MM_SHUFFLE(1, 1, 1, 1)), columns23);
+            columns23 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b23, _MM_SHUFFLE(2, 2, 2, 2)), columns23);
+            columns23 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b23, _MM_SHUFFLE(3, 3, 3, 3)), columns23);
+            _mm256_storeu_ps(out, columns01);
+            _mm256_storeu_ps(out + 8, columns23);
+        }
+
+        MODELER_TARGET_AVX2
+        void transformPointsAVX2(const Core::Real* matrix, const Core::Real* points, Core::UInt32 count, Core::Real* out) {
+            __m256 c0 = _mm256_broadcast_ps((const __m128*)matrix);
+            __m256 c1 = _mm256_broadcast_ps((const __m128*)(matrix + 4));
+            __m256 c2 = _mm256_broadcast_ps((const __m128*)(matrix + 8));
+            __m256 c3 = _mm256_broadcast_ps((const __m128*)(matrix + 12));
+            Core::UInt32 i = 0;
+            for (; i + 2 <= count; i += 2) {
+                __m256 p = _mm256_loadu_ps(points + i * 4);
+                __m256 result = _mm256_fmadd_ps(c0, _mm256_permute_ps(p, _MM_SHUFFLE(0, 0, 0, 0)), c3);
+                result = _mm256_fmadd_ps(c1, _mm256_permute_ps(p, _MM_SHUFFLE(1, 1, 1, 1)), result);
+                result = _mm256_fmadd_ps(c2, _mm256_permute_ps(p, _MM_SHUFFLE(2, 2, 2, 2)), result);
+                _mm256_storeu_ps(out + i * 4, result);
+            }
+            if (i < count) transformPointsSSE2(matrix, points + i * 4, count - i, out + i * 4);
+        }
+
+        bool cpuSupportsAVX2() {
+        #if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) return false;
+            __cpuid(info, 1);
+            bool fma = (info[2] & (1 << 12)) != 0;
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            if (!fma || !osxsave || !avx) return false;
+            // the OS has to save the upper halves of the ymm registers
+            if ((_xgetbv(0) & 0x6) != 0x6) return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+        #else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        #endif
+        }
+
+#endif
+
+        SimdKernels::InstructionSet detectInstructionSet() {
+        #ifdef MODELER_SIMD_X86
+            return cpuSupportsAVX2() ? SimdKernels::InstructionSet::AVX2 : SimdKernels::InstructionSet::SSE2;
+        #else
+            return SimdKernels::InstructionSet::Scalar;
+        #endif
+        }
+
+        KernelTable buildKernelTable(SimdKernels::InstructionSet instructionSet) {
+            KernelTable table;
+            table.multiplyMatrices = multiplyMatricesScalar;
+            table.transformPoints = transformPointsScalar;
+            table.intersectPacket = intersectPacketScalar;
+        #ifdef MODELER_SIMD_X86
+            if (instructionSet >= SimdKernels::InstructionSet::SSE2) {
+                table.multiplyMatrices = multiplyMatricesSSE2;
+                table.transformPoints = transformPointsSSE2;
+                table.intersectPacket = intersectPacketSSE2;
+            }
+            // packets are four wide, so AVX2 keeps the SSE2 intersection, see getPacketInstructionSet()
+            if (instructionSet >= SimdKernels::InstructionSet::AVX2) {
+                table.multiplyMatrices = multiplyMatricesAVX2;
+                table.transformPoints = transformPointsAVX2;
+            }
+        #endif
+            return table;
+        }
+
+        class Dispatch {
+        public:
+            Dispatch(): supported(detectInstructionSet()), active(supported), kernels(buildKernelTable(supported)) {}
+
+            SimdKernels::InstructionSet supported;
+            SimdKernels::InstructionSet active;
+            KernelTable kernels;
+        };
+
+        Dispatch& getDispatch() {
+            static Dispatch dispatch;
+            return dispatch;
+        }
+
+    }
+
+    SimdKernels::TrianglePacket::TrianglePacket() {
+        memset(this->v0, 0, sizeof(this->v0));
+        memset(this->edge1, 0, sizeof(this->edge1));
+        memset(this->edge2, 0, sizeof(this->edge2));
+    }
+
+    void SimdKernels::TrianglePacket::setTriangle(Core::UInt32 lane, const Core::Real* v0, const Core::Real* v1, const Core::Real* v2) {
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            this->v0[axis][lane] = v0[axis];
+            this->edge1[axis][lane] = v1[axis] - v0[axis];
+            this->edge2[axis][lane] = v2[axis] - v0[axis];
+        }
+    }
+
+    SimdKernels::InstructionSet SimdKernels::getSupportedInstructionSet() {
+        return getDispatch().supported;
+    }
+
+    SimdKernels::InstructionSet SimdKernels::getInstructionSet() {
+        return getDispatch().active;
+    }
+
+    void SimdKernels::setInstructionSet(InstructionSet instructionSet) {
+        Dispatch& dispatch = getDispatch();
+        if (instructionSet > dispatch.supported) instructionSet = dispatch.supported;
+        dispatch.active = instructionSet;
+        dispatch.kernels = buildKernelTable(instructionSet);
+    }
+
+    SimdKernels::InstructionSet SimdKernels::getPacketInstructionSet(InstructionSet instructionSet) {
+        return instructionSet > InstructionSet::SSE2 ? InstructionSet::SSE2 : instructionSet;
+    }
+
+    const char* SimdKernels::getName(InstructionSet instructionSet) {
+        switch (instructionSet) {
+            case InstructionSet::SSE2: return "SSE2";
+            case InstructionSet::AVX2: return "AVX2";
+            default: return "scalar";
+        }
+    }
+
+    void SimdKernels::multiplyMatrices(const Core::Real* a, const Core::Real* b, Core::Real* out) {
+        getDispatch().kernels.multiplyMatrices(a, b, out);
+    }
+
+    void SimdKernels::transformPoints(const Core::Real* matrix, const Core::Real* points, Core::UInt32 count, Core::Real* out) {
+        getDispatch().kernels.transformPoints(matrix, points, count, out);
+    }
+
+    Core::Int32 SimdKernels::intersectPacket(const TrianglePacket& packet, const BVHRay& ray, Core::Real maxT,
+                                             Core::Real& t, Core::Real& u, Core::Real& v) {
+        return getDispatch().kernels.intersectPacket(packet, ray, maxT, t, u, v);
+    }
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "BVH.h"
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Hot math kernels with SSE2 and AVX2/FMA variants, picked once at runtime from what the
+    // CPU supports. Non-x86 builds only have the scalar versions. All matrices are
+    // column-major 4x4.
+    class SimdKernels {
+    public:
+        enum class InstructionSet {
+            Scalar = 0,
+            SSE2 = 1,
+            AVX2 = 2,
+        };
+
+        static const Core::UInt32 PacketWidth = 4;
+
+        // PacketWidth triangles in structure-of-arrays form with precomputed edges, so one
+        // ray can be tested against all of them at once. Unused lanes are left zeroed, which
+        // makes them degenerate and never hit.
+        class TrianglePacket {
+        public:
+            TrianglePacket();
+
+            void setTriangle(Core::UInt32 lane, const Core::Real* v0, const Core::Real* v1, const Core::Real* v2);
+
+            Core::Real v0[3][PacketWidth];
+            Core::Real edge1[3][PacketWidth];
+            Core::Real edge2[3][PacketWidth];
+        };
+
+        static InstructionSet getSupportedInstructionSet();
+        static InstructionSet getInstructionSet();
+        // clamped to what the CPU supports; not thread-safe, meant for benchmarks
+        static void setInstructionSet(InstructionSet instructionSet);
+        static const char* getName(InstructionSet instructionSet);
+        // the set whose intersectPacket() runs under instructionSet; the packets are only
+        // four wide, so AVX2 has no packet kernel of its own
+        static InstructionSet getPacketInstructionSet(InstructionSet instructionSet);
+
+        // out = a * b; out may alias either input
+        static void multiplyMatrices(const Core::Real* a, const Core::Real* b, Core::Real* out);
+        // points are 4 Reals each with w taken as 1; out may alias points
+        static void transformPoints(const Core::Real* matrix, const Core::Real* points, Core::UInt32 count, Core::Real* out);
+        // two-sided Moller-Trumbore against every lane; returns the lane of the closest hit with
+        // 0 < t < maxT, or -1
+        static Core::Int32 intersectPacket(const TrianglePacket& packet, const BVHRay& ray, Core::Real maxT,
+                                           Core::Real& t, Core::Real& u, Core::Real& v);
+
+    private:
+        SimdKernels();
+    };
+
+}
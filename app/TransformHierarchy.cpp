@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cstring>
+
+#include <QDebug>
+
+#include "TransformHierarchy.h"
+#include "SimdKernels.h"
+
+namespace Modeler {
+
+    TransformHierarchy::TransformHierarchy(std::shared_ptr<JobSystem> jobSystem): jobSystem(jobSystem) {
+
+    }
+
+    Core::UInt32 TransformHierarchy::addHierarchy(const std::vector<Core::Int32>& parentIndices, const std::vector<const Core::Real*>& localMatrices) {
+        if (parentIndices.size() == 0 || parentIndices.size() != localMatrices.size()) {
+            qDebug() << "TransformHierarchy::addHierarchy() -> Parent and matrix counts don't match.";
+            return InvalidIndex;
+        }
+
+        // pre-order means every parent is somewhere on the chain of ancestors of the previous node
+        std::vector<Core::Int32> ancestors;
+        bool valid = parentIndices[0] < 0;
+        for (Core::UInt32 n = 1; n < parentIndices.size() && valid; n++) {
+            ancestors.push_back((Core::Int32)n - 1);
+            while (ancestors.size() > 0 && ancestors.back() != parentIndices[n]) ancestors.pop_back();
+            valid = ancestors.size() > 0;
+        }
+        if (!valid) {
+            qDebug() << "TransformHierarchy::addHierarchy() -> Nodes are not in pre-order.";
+            return InvalidIndex;
+        }
+
+        Core::UInt32 base = (Core::UInt32)this->parents.size();
+        Core::UInt32 count = (Core::UInt32)parentIndices.size();
+        this->parents.resize(base + count);
+        this->subtreeEnds.resize(base + count);
+        this->localMatrices.resize((base + count) * 16);
+        this->worldMatrices.resize((base + count) * 16);
+        this->dirty.resize(base + count, false);
+        for (Core::UInt32 n = 0; n < count; n++) {
+            this->parents[base + n] = parentIndices[n] < 0 ? InvalidIndex : base + parentIndices[n];
+            this->subtreeEnds[base + n] = base + n + 1;
+            memcpy(&this->localMatrices[(base + n) * 16], localMatrices[n], sizeof(Core::Real) * 16);
+        }
+        for (Core::UInt32 n = count - 1; n > 0; n--) {
+            Core::UInt32 parent = this->parents[base + n];
+            this->subtreeEnds[parent] = std::max(this->subtreeEnds[parent], this->subtreeEnds[base + n]);
+        }
+
+        this->markDirty(base);
+        return base;
+    }
+
+    void TransformHierarchy::setLocalMatrix(Core::UInt32 node, const Core::Real* localMatrix) {
+        memcpy(&this->localMatrices[node * 16], localMatrix, sizeof(Core::Real) * 16);
+        this->markDirty(node);
+    }
+
+    Core::UInt32 TransformHierarchy::update() {
+        this->updatedRanges.clear();
+        if (this->dirtyNodes.size() == 0) return 0;
+
+        // a dirty node inside an already dirty subtree is covered by that subtree, and sorting
+        // means its ancestors always come first
+        std::sort(this->dirtyNodes.begin(), this->dirtyNodes.end());
+        std::vector<Range> tasks;
+        Core::UInt32 coveredEnd = 0;
+        Core::UInt32 updatedCount = 0;
+        for (Core::UInt32 node : this->dirtyNodes) {
+            this->dirty[node] = false;
+            if (node < coveredEnd) continue;
+            this->splitSubtree(node, tasks);
+            coveredEnd = this->subtreeEnds[node];
+            this->updatedRanges.push_back(Range(node, coveredEnd));
+            updatedCount += coveredEnd - node;
+        }
+        this->dirtyNodes.clear();
+
+        if (tasks.size() > 1 && updatedCount > MinParallelNodes) {
+            this->jobSystem->parallelFor((unsigned int)tasks.size(), [this, &tasks](unsigned int t) {
+                this->updateRange(tasks[t]);
+            });
+        } else {
+            for (const Range& task : tasks) this->updateRange(task);
+        }
+        return updatedCount;
+    }
+
+    const std::vector<TransformHierarchy::Range>& TransformHierarchy::getUpdatedRanges() const {
+        return this->updatedRanges;
+    }
+
+    const Core::Real* TransformHierarchy::getWorldMatrix(Core::UInt32 node) const {
+        return &this->worldMatrices[node * 16];
+    }
+
+    Core::UInt32 TransformHierarchy::getNodeCount() const {
+        return (Core::UInt32)this->parents.size();
+    }
+
+    void TransformHierarchy::markDirty(Core::UInt32 node) {
+        if (this->dirty[node]) return;
+        this->dirty[node] = true;
+        this->dirtyNodes.push_back(node);
+    }
+
+    // Splits a subtree into tasks that can run in any order. A large subtree has its root
+    // updated right away, then its children's subtrees (which follow the root back to back)
+    // become tasks, with runs of small siblings merged into one. An explicit stack keeps long
+    // chains from recursing deeply.
+    void TransformHierarchy::splitSubtree(Core::UInt32 root, std::vector<Range>& tasks) {
+        std::vector<Core::UInt32> pending;
+        pending.push_back(root);
+        while (pending.size() > 0) {
+            Core::UInt32 node = pending.back();
+            pending.pop_back();
+
+            Core::UInt32 end = this->subtreeEnds[node];
+            if (end - node <= MinParallelNodes) {
+                tasks.push_back(Range(node, end));
+                continue;
+            }
+
+            this->updateRange(Range(node, node + 1));
+            Core::UInt32 runBegin = node + 1;
+            for (Core::UInt32 child = node + 1; child < end; child = this->subtreeEnds[child]) {
+                Core::UInt32 childEnd = this->subtreeEnds[child];
+                if (childEnd - child > MinParallelNodes) {
+                    if (runBegin < child) tasks.push_back(Range(runBegin, child));
+                    pending.push_back(child);
+                    runBegin = childEnd;
+                } else if (childEnd - runBegin > MinParallelNodes) {
+                    if (runBegin < child) tasks.push_back(Range(runBegin, child));
+                    runBegin = child;
+                }
+            }
+            if (runBegin < end) tasks.push_back(Range(runBegin, end));
+        }
+    }
+
+    // parents come before their children, so a single forward pass is enough as long as
+    // the parent of range.begin is already up to date
+    void TransformHierarchy::updateRange(const Range& range) {
+        for (Core::UInt32 i = range.begin; i < range.end; i++) {
+            Core::UInt32 parent = this->parents[i];
+            if (parent == InvalidIndex) {
+                memcpy(&this->worldMatrices[i * 16], &this->localMatrices[i * 16], sizeof(Core::Real) * 16);
+            } else {
+                SimdKernels::multiplyMatrices(&this->worldMatrices[parent * 16], &this->localMatrices[i * 16], &this->worldMatrices[i * 16]);
+            }
+        }
+    }
+
+}
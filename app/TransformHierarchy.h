@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "JobSystem.h"
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    // Flattened mirror of the imported scene hierarchies, used for the world matrices the app
+    // itself needs (picking, culling, highlight proxies) instead of asking every object's
+    // Transform in turn.
+    //
+    // Nodes are stored parents-first in pre-order, so every subtree is one contiguous index
+    // range. Changing a local matrix marks its node dirty; update() recomputes only the dirty
+    // subtrees, splitting large ones at their children and handing the pieces to the job
+    // system. Hierarchies hang directly off the scene root, whose transform is identity.
+    class TransformHierarchy {
+    public:
+        static const Core::UInt32 InvalidIndex = 0xFFFFFFFF;
+        // subtrees (or runs of sibling subtrees) up to this many nodes are updated as one task
+        static const Core::UInt32 MinParallelNodes = 512;
+
+        // nodes begin to end - 1
+        class Range {
+        public:
+            Range(Core::UInt32 begin, Core::UInt32 end): begin(begin), end(end) {}
+
+            Core::UInt32 begin;
+            Core::UInt32 end;
+        };
+
+        TransformHierarchy(std::shared_ptr<JobSystem> jobSystem);
+
+        // parentIndices are relative to the new hierarchy (-1 for its root) and must be in
+        // pre-order, the way ImportedModel stores its nodes. Matrices are column-major 4x4.
+        // Returns the index of the hierarchy's root; node n ends up at root + n.
+        Core::UInt32 addHierarchy(const std::vector<Core::Int32>& parentIndices, const std::vector<const Core::Real*>& localMatrices);
+        void setLocalMatrix(Core::UInt32 node, const Core::Real* localMatrix);
+
+        // returns the number of nodes whose world matrix was recomputed
+        Core::UInt32 update();
+        // the subtrees the last update() recomputed, so whatever mirrors their world matrices
+        // can follow without scanning every node
+        const std::vector<Range>& getUpdatedRanges() const;
+
+        // valid until the next addHierarchy()
+        const Core::Real* getWorldMatrix(Core::UInt32 node) const;
+        Core::UInt32 getNodeCount() const;
+
+    private:
+        void markDirty(Core::UInt32 node);
+        void splitSubtree(Core::UInt32 root, std::vector<Range>& tasks);
+        void updateRange(const Range& range);
+
+        std::shared_ptr<JobSystem> jobSystem;
+        std::vector<Core::UInt32> parents;     // InvalidIndex for hierarchy roots
+        std::vector<Core::UInt32> subtreeEnds; // one past the last node of each node's subtree
+        std::vector<Core::Real> localMatrices;
+        std::vector<Core::Real> worldMatrices;
+        std::vector<bool> dirty;
+        std::vector<Core::UInt32> dirtyNodes;
+        std::vector<Range> updatedRanges;
+    };
+
+}
@@ -1,269 +0,0 @@
-/****************************************************************************
-**
-** Copyright (C) 2015 The Qt Company Ltd.
-** Contact: http://www.qt.io/licensing/
-**
-** This file is part of the examples of the Qt Toolkit.
-**
-** $QT_BEGIN_LICENSE:BSD$
-** You may use this file under the terms of the BSD license as follows:
-**
-** "Redistribution and use in source and binary forms, with or without
-** modification, are permitted provided that the following conditions are
-** met:
-**   * Redistributions of source code must retain the above copyright
-**     notice, this list of conditions and the following disclaimer.
-**   * Redistributions in binary form must reproduce the above copyright
-**     notice, this list of conditions and the following disclaimer in
-**     the documentation and/or other materials provided with the
-**     distribution.
-**   * Neither the name of The Qt Company Ltd nor the names of its
-**     contributors may be used to endorse or promote products derived
-**     from this software without specific prior written permission.
-**
-**
-** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
-** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
-** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
-** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
-** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
-** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
-** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
-** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
-** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
-** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
-**
-** $QT_END_LICENSE$
-**
-****************************************************************************/
-
-/*
-    treemodel.cpp
-    Provides a simple tree model to show how to create and use hierarchical
-    models.
-*/
-
-#include "TreeItem.h"
-#include "TreeModel.h"
-
-#include <QStringList>
-#include <QStandardItemModel>
-
-
-TreeModel::TreeModel(QObject *parent)
-    : QStandardItemModel(parent)
-{
-    m_roleNameMapping[MyTreeModel_Role_Name] = "name_role";
-
-    addEntry( "Option A", "Recommended");
-   addEntry( "Option B", "Recommended");
-   addEntry( "Option C", "Recommended");
-   addEntry( "Option D", "Recommended");
-
-   addEntry( "Option E", "Optional");
-   addEntry( "Option F", "Optional");
-   addEntry( "Option G", "Optional");
-   addEntry( "Option H", "Optional" );
-}
-
-
-TreeModel::~TreeModel()
-{
-   // delete rootItem;
-}
-
-void TreeModel::addEntry( const QString& name, const QString& type)
-{
-    auto childEntry = new QStandardItem(name);
-
-    QStandardItem* entry = getBranch(type);
-    entry->appendRow(childEntry);
-}
-
-QStandardItem *TreeModel::getBranch(const QString &branchName)
-{
-    QStandardItem* entry;
-    auto entries = this->findItems( branchName );
-    if ( entries.count() > 0 )
-    {
-        entry = entries.at(0);
-    }
-    else
-    {
-        entry = new QStandardItem( branchName );
-        this->appendRow( entry );
-    }
-    return entry;
-}
-
-QHash<int, QByteArray> TreeModel::roleNames() const
-{
-    return m_roleNameMapping;
-}
-
-/*
-//! [2]
-int TreeModel::columnCount(const QModelIndex &parent) const
-{
-    if (parent.isValid())
-        return static_cast<TreeItem*>(parent.internalPointer())->columnCount();
-    else
-        return rootItem->columnCount();
-}
-//! [2]
-
-//! [3]
-QVariant TreeModel::data(const QModelIndex &index, int role) const
-{
-    if (!index.isValid())
-        return QVariant();
-
-    if (role != TreeModelRoleName && role != TreeModelRoleDescription)
-        return QVariant();
-
-    TreeItem *item = static_cast<TreeItem*>(index.internalPointer());
-
-    return item->data(role - Qt::UserRole - 1);
-}
-//! [3]
-
-//! [4]
-Qt::ItemFlags TreeModel::flags(const QModelIndex &index) const
-{
-    if (!index.isValid())
-        return 0;
-
-    return QAbstractItemModel::flags(index);
-}
-//! [4]
-
-//! [5]
-QVariant TreeModel::headerData(int section, Qt::Orientation orientation,
-                               int role) const
-{
-    if (orientation == Qt::Horizontal && role == Qt::DisplayRole)
-        return rootItem->data(section);
-
-    return QVariant();
-}
-//! [5]
-
-//! [6]
-QModelIndex TreeModel::index(int row, int column, const QModelIndex &parent)
-            const
-{
-    if (!hasIndex(row, column, parent))
-        return QModelIndex();
-
-    TreeItem *parentItem;
-
-    if (!parent.isValid())
-        parentItem = rootItem;
-    else
-        parentItem = static_cast<TreeItem*>(parent.internalPointer());
-
-    TreeItem *childItem = parentItem->child(row);
-    if (childItem)
-        return createIndex(row, column, childItem);
-    else
-        return QModelIndex();
-}
-//! [6]
-
-//! [7]
-QModelIndex TreeModel::parent(const QModelIndex &index) const
-{
-    if (!index.isValid())
-        return QModelIndex();
-
-    TreeItem *childItem = static_cast<TreeItem*>(index.internalPointer());
-    TreeItem *parentItem = childItem->parentItem();
-
-    if (parentItem == rootItem)
-        return QModelIndex();
-
-    return createIndex(parentItem->row(), 0, parentItem);
-}
-//! [7]
-
-//! [8]
-int TreeModel::rowCount(const QModelIndex &parent) const
-{
-    TreeItem *parentItem;
-    if (parent.column() > 0)
-        return 0;
-
-    if (!parent.isValid())
-        parentItem = rootItem;
-    else
-        parentItem = static_cast<TreeItem*>(parent.internalPointer());
-
-    return parentItem->childCount();
-}
-//! [8]
-
-QHash<int, QByteArray> TreeModel::roleNames() const
-{
-    return m_roleNameMapping;
-}
-
-void TreeModel::setupModelData(const QStringList &lines, TreeItem *parent)
-{
-    QList<TreeItem*> parents;
-    QList<int> indentations;
-    parents << parent;
-    indentations << 0;
-
-    int number = 0;
-
-    while (number < lines.count()) {
-        int position = 0;
-        while (position < lines[number].length()) {
-            if (lines[number].at(position) != ' ')
-                break;
-            position++;
-        }
-
-        QString lineData = lines[number].mid(position).trimmed();
-
-        if (!lineData.isEmpty()) {
-            // Read the column data from the rest of the line.
-            QStringList columnStrings = lineData.split("\t", QString::SkipEmptyParts);
-            QList<QVariant> columnData;
-            for (int column = 0; column < columnStrings.count(); ++column)
-                //columnData << newCustomType(columnStrings[column], position);
-
-            if (position > indentations.last()) {
-                // The last child of the current parent is now the new parent
-                // unless the current parent has no children.
-
-                if (parents.last()->childCount() > 0) {
-                    parents << parents.last()->child(parents.last()->childCount()-1);
-                    indentations << position;
-                }
-            } else {
-                while (position < indentations.last() && parents.count() > 0) {
-                    parents.pop_back();
-                    indentations.pop_back();
-                }
-            }
-
-            // Append a new item to the current parent's list of children.
-            parents.last()->appendChild(new TreeItem(columnData, parents.last()));
-        }
-
-        ++number;
-    }
-
-}
-
-void TreeModel::addItem(const std::string& text, const std::string& summary) {
-    this->addItem(text, summary, this->rootItem);
-}
-
-void TreeModel::addItem(const std::string& text, const std::string& summary, TreeItem *parent) {
-    QList<QVariant> data;
-    data << QString::fromStdString(text) << QString::fromStdString(summary);
-    parent->appendChild(new TreeItem(data, parent));
-}*/
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "VertexPacking.h"
+
+namespace Modeler {
+
+    namespace {
+
+        const Core::Real NormalSteps = 32767.0f;
+
+        Core::UInt32 toSnorm16(Core::Real value) {
+            Core::Int32 quantized = (Core::Int32)std::round(std::max(-1.0f, std::min(1.0f, value)) * NormalSteps);
+            return (Core::UInt32)(quantized & 0xFFFF);
+        }
+
+        Core::Real fromSnorm16(Core::UInt32 bits) {
+            Core::Int32 value = (Core::Int32)(bits & 0xFFFF);
+            if (value >= 0x8000) value -= 0x10000;
+            return std::max(-1.0f, (Core::Real)value / NormalSteps);
+        }
+
+        Core::UInt32 toUnorm8(Core::Real value) {
+            return (Core::UInt32)std::round(std::max(0.0f, std::min(1.0f, value)) * 255.0f);
+        }
+
+        Core::Real signNotZero(Core::Real value) {
+            return value >= 0.0f ? 1.0f : -1.0f;
+        }
+
+    }
+
+    void VertexPacking::pack(const ImportedMesh& mesh, PackedMesh& packed) {
+        Core::UInt32 vertexCount = mesh.vertexCount;
+        packed.positions.resize(vertexCount * 3);
+        packed.normals.resize(vertexCount);
+        packed.faceNormals.resize(vertexCount);
+        packed.colors.resize(vertexCount);
+        for (Core::UInt32 v = 0; v < vertexCount; v++) {
+            // w is always 1 for imported positions, so only x, y and z are kept
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                packed.positions[v * 3 + axis] = mesh.positions[v * 4 + axis];
+            }
+
+            packed.normals[v] = encodeOctahedral(&mesh.normals[v * 4]);
+            packed.faceNormals[v] = encodeOctahedral(&mesh.faceNormals[v * 4]);
+
+            const Core::Real* color = &mesh.colors[v * 4];
+            packed.colors[v] = toUnorm8(color[0]) | (toUnorm8(color[1]) << 8) | (toUnorm8(color[2]) << 16) | (toUnorm8(color[3]) << 24);
+        }
+    }
+
+    void VertexPacking::unpack(const PackedMesh& packed, ImportedMesh& mesh) {
+        Core::UInt32 vertexCount = mesh.vertexCount;
+        mesh.positions.resize(vertexCount * 4);
+        mesh.normals.resize(vertexCount * 4);
+        mesh.faceNormals.resize(vertexCount * 4);
+        mesh.colors.resize(vertexCount * 4);
+        for (Core::UInt32 v = 0; v < vertexCount; v++) {
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                mesh.positions[v * 4 + axis] = packed.positions[v * 3 + axis];
+            }
+            mesh.positions[v * 4 + 3] = 1.0f;
+
+            decodeOctahedral(packed.normals[v], &mesh.normals[v * 4]);
+            mesh.normals[v * 4 + 3] = 0.0f;
+            decodeOctahedral(packed.faceNormals[v], &mesh.faceNormals[v * 4]);
+            mesh.faceNormals[v * 4 + 3] = 0.0f;
+
+            for (unsigned int channel = 0; channel < 4; channel++) {
+                mesh.colors[v * 4 + channel] = (Core::Real)((packed.colors[v] >> (channel * 8)) & 0xFF) / 255.0f;
+            }
+        }
+    }
+
+    void VertexPacking::compact(ImportedMesh& mesh) {
+        std::shared_ptr<PackedMesh> packed = std::make_shared<PackedMesh>();
+        pack(mesh, *packed);
+        mesh.packed = packed;
+        std::vector<Core::Real>().swap(mesh.positions);
+        std::vector<Core::Real>().swap(mesh.normals);
+        std::vector<Core::Real>().swap(mesh.faceNormals);
+        std::vector<Core::Real>().swap(mesh.colors);
+    }
+
+    void VertexPacking::quantize(ImportedMesh& mesh) {
+        PackedMesh packed;
+        pack(mesh, packed);
+        unpack(packed, mesh);
+    }
+
+    const ImportedMesh& VertexPacking::resolve(const ImportedMesh& mesh, ImportedMesh& scratch) {
+        if (!mesh.packed) return mesh;
+        scratch.vertexCount = mesh.vertexCount;
+        scratch.materialIndex = mesh.materialIndex;
+        scratch.indices = mesh.indices;
+        unpack(*mesh.packed, scratch);
+        return scratch;
+    }
+
+    Core::UInt32 VertexPacking::encodeOctahedral(const Core::Real* normal) {
+        Core::Real length = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+        if (length <= 0.0f) return toSnorm16(0.0f) | (toSnorm16(0.0f) << 16);
+
+        // project onto the octahedron, then fold the lower hemisphere over the diagonals
+        Core::Real x = normal[0] / length;
+        Core::Real y = normal[1] / length;
+        if (normal[2] < 0.0f) {
+            Core::Real foldedX = (1.0f - std::abs(y)) * signNotZero(x);
+            Core::Real foldedY = (1.0f - std::abs(x)) * signNotZero(y);
+            x = foldedX;
+            y = foldedY;
+        }
+        return toSnorm16(x) | (toSnorm16(y) << 16);
+    }
+
+    void VertexPacking::decodeOctahedral(Core::UInt32 encoded, Core::Real* normal) {
+        Core::Real x = fromSnorm16(encoded);
+        Core::Real y = fromSnorm16(encoded >> 16);
+        Core::Real z = 1.0f - std::abs(x) - std::abs(y);
+        if (z < 0.0f) {
+            Core::Real unfoldedX = (1.0f - std::abs(y)) * signNotZero(x);
+            Core::Real unfoldedY = (1.0f - std::abs(x)) * signNotZero(y);
+            x = unfoldedX;
+            y = unfoldedY;
+        }
+
+        Core::Real length = std::sqrt(x * x + y * y + z * z);
+        Core::Real scale = length > 0.0f ? 1.0f / length : 0.0f;
+        normal[0] = x * scale;
+        normal[1] = y * scale;
+        normal[2] = z * scale;
+    }
+
+}
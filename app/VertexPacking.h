@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+#include "ImportedModel.h"
+
+#include "Core/common/types.h"
+
+namespace Modeler {
+
+    enum class VertexFormat {
+        Float = 0,  // 64 bytes per vertex, as the engine's attribute arrays expect
+        Packed = 1, // 24 bytes per vertex in RAM and in the cache, decoded to the float layout for upload
+    };
+
+    // Compact vertex storage for queued imports and cache entries. The GPU still gets floats:
+    // Core's attribute arrays take nothing else, so this saves memory and disk, not VRAM.
+    //   positions    - x, y, z floats, kept exact so geometry and picking are unchanged
+    //   normals      - octahedral encoding, 16-bit snorm per component
+    //   face normals - same as normals
+    //   colors       - 8-bit unorm RGBA
+    class PackedMesh {
+    public:
+        std::vector<Core::Real> positions;
+        std::vector<Core::UInt32> normals;
+        std::vector<Core::UInt32> faceNormals;
+        std::vector<Core::UInt32> colors;
+    };
+
+    class VertexPacking {
+    public:
+        static void pack(const ImportedMesh& mesh, PackedMesh& packed);
+        // fills the float attribute arrays of mesh (vertexCount must already be set)
+        static void unpack(const PackedMesh& packed, ImportedMesh& mesh);
+
+        // replaces the mesh's float attributes with their packed form; indices stay as they are
+        static void compact(ImportedMesh& mesh);
+        // snaps the normals and colors to what the packed format can represent, so data that goes
+        // through the packed format later decodes to exactly what was used before
+        static void quantize(ImportedMesh& mesh);
+        // the mesh itself if it holds float attributes, otherwise scratch filled with the decoded copy
+        static const ImportedMesh& resolve(const ImportedMesh& mesh, ImportedMesh& scratch);
+
+        static Core::UInt32 encodeOctahedral(const Core::Real* normal);
+        static void decodeOctahedral(Core::UInt32 encoded, Core::Real* normal);
+
+    private:
+        VertexPacking();
+    };
+
+}
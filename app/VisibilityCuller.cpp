@@ -0,0 +1,274 @@
+#include <cmath>
+
+#include "VisibilityCuller.h"
+
+namespace Modeler {
+
+    namespace {
+
+        // projected bounding sphere diameter, as a fraction of the viewport height, below which
+        // LOD 1 is used; every further level switches at half the size of the previous one
+        const Core::Real LodSwitchScreenSize = 0.4f;
+        // a level switch has to overshoot its threshold by this fraction, so objects near a
+        // threshold don't pop back and forth while the camera moves
+        const Core::Real LodHysteresis = 0.15f;
+
+        // signed distance range of a box to a plane (normal pointing into the frustum)
+        void planeRange(const Core::Real* plane, const BVHBounds& bounds, Core::Real& minDistance, Core::Real& maxDistance) {
+            minDistance = maxDistance = plane[3];
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                Core::Real a = plane[axis] * bounds.min[axis];
+                Core::Real b = plane[axis] * bounds.max[axis];
+                minDistance += a < b ? a : b;
+                maxDistance += a < b ? b : a;
+            }
+        }
+
+    }
+
+    VisibilityCuller::VisibilityCuller(): needsRebuild(false), needsRefit(false), frustumCount(0), visibleCount(0) {
+    }
+
+    void VisibilityCuller::addObject(Core::WeakPointer<Core::Object3D> object, const BVHBounds& localBounds) {
+        object->getTransform().updateWorldMatrix();
+        Core::Matrix4x4 worldMatrix = object->getTransform().getWorldMatrix();
+        this->addObject(object, localBounds, worldMatrix.getData());
+    }
+
+    void VisibilityCuller::addObject(Core::WeakPointer<Core::Object3D> object, const BVHBounds& localBounds, const Core::Real* worldMatrix) {
+        Entry entry;
+        entry.object = object;
+        entry.visible = true;
+        entry.lodLevel = 0;
+        entry.localBounds = localBounds;
+        localBounds.transform(worldMatrix, entry.worldBounds);
+        this->entryIndices[object->getObjectID()] = (Core::UInt32)this->entries.size();
+        this->entries.push_back(entry);
+        this->visibleCount++;
+        this->needsRebuild = true;
+    }
+
+    bool VisibilityCuller::updateObjectTransform(Core::WeakPointer<Core::Object3D> object, const Core::Real* worldMatrix) {
+        auto found = this->entryIndices.find(object->getObjectID());
+        if (found == this->entryIndices.end()) return false;
+
+        Entry& entry = this->entries[found->second];
+        entry.localBounds.transform(worldMatrix, entry.worldBounds);
+        this->needsRefit = true;
+        return true;
+    }
+
+    bool VisibilityCuller::setLodObjects(Core::WeakPointer<Core::Object3D> object, const std::vector<Core::WeakPointer<Core::Object3D>>& lodObjects) {
+        auto found = this->entryIndices.find(object->getObjectID());
+        if (found == this->entryIndices.end()) return false;
+
+        Entry& entry = this->entries[found->second];
+        if (entry.lodLevel > 0) {
+            this->getLodObject(entry, entry.lodLevel)->setActive(false);
+            if (entry.visible) entry.object->setActive(true);
+        }
+        entry.lodObjects = lodObjects;
+        entry.lodLevel = 0;
+        return true;
+    }
+
+    void VisibilityCuller::clearShadowLights() {
+        this->shadowLights.clear();
+    }
+
+    void VisibilityCuller::addDirectionalShadowLight(const Core::Real* direction) {
+        ShadowLight light;
+        light.directional = true;
+        for (unsigned int i = 0; i < 3; i++) light.vector[i] = direction[i];
+        this->shadowLights.push_back(light);
+    }
+
+    void VisibilityCuller::addPointShadowLight(const Core::Real* position) {
+        ShadowLight light;
+        light.directional = false;
+        for (unsigned int i = 0; i < 3; i++) light.vector[i] = position[i];
+        this->shadowLights.push_back(light);
+    }
+
+    void VisibilityCuller::cull(const Core::Real* viewProjection, const Core::Real* cameraPosition, Core::Real projectionScale) {
+        View view;
+        view.viewProjection = viewProjection;
+        view.cameraPosition = cameraPosition;
+        view.projectionScale = projectionScale;
+        this->cull(&view, 1);
+    }
+
+    void VisibilityCuller::cull(const View* views, Core::UInt32 viewCount) {
+        if (this->needsRebuild) {
+            std::vector<BVHBounds> bounds(this->entries.size());
+            for (Core::UInt32 i = 0; i < this->entries.size(); i++) bounds[i] = this->entries[i].worldBounds;
+            BVHBuilder::build(bounds, MaxLeafObjects, this->nodes, this->entryOrder);
+            this->needsRebuild = false;
+            this->needsRefit = false;
+        }
+        else if (this->needsRefit) {
+            // moved objects keep their place in the tree, only the bounds grow around them
+            for (BVHNode& node : this->nodes) {
+                if (!node.isLeaf()) continue;
+                node.bounds.reset();
+                for (Core::UInt32 i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                    node.bounds.grow(this->entries[this->entryOrder[i]].worldBounds);
+                }
+            }
+            BVHBuilder::refitInterior(this->nodes);
+            this->needsRefit = false;
+        }
+        if (this->nodes.size() == 0 || viewCount == 0) return;
+
+        this->frustumCount = viewCount < MaxViews ? viewCount : MaxViews;
+        for (Core::UInt32 v = 0; v < this->frustumCount; v++) {
+            Frustum& frustum = this->frustums[v];
+            const Core::Real* m = views[v].viewProjection;
+            for (unsigned int i = 0; i < 3; i++) frustum.cameraPosition[i] = views[v].cameraPosition[i];
+            frustum.projectionScale = views[v].projectionScale;
+
+            // Gribb/Hartmann extraction from the rows of the view-projection matrix
+            for (unsigned int i = 0; i < 3; i++) {
+                for (unsigned int j = 0; j < 4; j++) {
+                    Core::Real w = m[j * 4 + 3];
+                    Core::Real r = m[j * 4 + i];
+                    frustum.planes[i * 2][j] = w + r;
+                    frustum.planes[i * 2 + 1][j] = w - r;
+                }
+            }
+        }
+
+        // one growable stack for the whole walk, so no subtree is ever skipped. Below a node that
+        // is wholly inside or outside, the nodes take its result instead of being tested again.
+        this->traversalStack.clear();
+        this->traversalStack.push_back(TraversalEntry(0, Containment::Intersecting));
+        while (this->traversalStack.size() > 0) {
+            TraversalEntry entry = this->traversalStack.back();
+            this->traversalStack.pop_back();
+            const BVHNode& node = this->nodes[entry.node];
+            Containment containment = entry.containment;
+            if (containment == Containment::Intersecting) containment = this->classify(node.bounds);
+
+            if (node.isLeaf()) {
+                for (Core::UInt32 i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                    Core::UInt32 entryIndex = this->entryOrder[i];
+                    bool visible = containment == Containment::Inside ||
+                                   (containment == Containment::Intersecting && this->classify(this->entries[entryIndex].worldBounds) != Containment::Outside);
+                    this->setVisible(entryIndex, visible);
+                }
+                continue;
+            }
+
+            this->traversalStack.push_back(TraversalEntry(node.firstChild, containment));
+            this->traversalStack.push_back(TraversalEntry(node.firstChild + 1, containment));
+        }
+    }
+
+    Core::UInt32 VisibilityCuller::getObjectCount() const {
+        return (Core::UInt32)this->entries.size();
+    }
+
+    Core::UInt32 VisibilityCuller::getVisibleCount() const {
+        return this->visibleCount;
+    }
+
+    VisibilityCuller::Containment VisibilityCuller::classify(const BVHBounds& bounds) const {
+        // inside any view beats intersecting any, which beats outside all of them
+        Containment containment = Containment::Outside;
+        for (Core::UInt32 v = 0; v < this->frustumCount && containment != Containment::Inside; v++) {
+            Containment viewContainment = this->classify(bounds, this->frustums[v]);
+            if ((int)viewContainment > (int)containment) containment = viewContainment;
+        }
+        return containment;
+    }
+
+    VisibilityCuller::Containment VisibilityCuller::classify(const BVHBounds& bounds, const Frustum& frustum) const {
+        bool inside = true;
+        for (unsigned int p = 0; p < 6; p++) {
+            Core::Real minDistance, maxDistance;
+            planeRange(frustum.planes[p], bounds, minDistance, maxDistance);
+            if (maxDistance < 0.0f) {
+                return this->shadowReachesFrustum(bounds, frustum) ? Containment::Intersecting : Containment::Outside;
+            }
+            if (minDistance < 0.0f) inside = false;
+        }
+        return inside ? Containment::Inside : Containment::Intersecting;
+    }
+
+    bool VisibilityCuller::shadowReachesFrustum(const BVHBounds& bounds, const Frustum& frustum) const {
+        for (const ShadowLight& light : this->shadowLights) {
+            bool separated = false;
+            for (unsigned int p = 0; p < 6 && !separated; p++) {
+                const Core::Real* plane = frustum.planes[p];
+                Core::Real minDistance, maxDistance;
+                planeRange(plane, bounds, minDistance, maxDistance);
+                if (maxDistance >= 0.0f) continue;
+
+                // the shadow volume is the box swept away from the light; it stays outside
+                // this plane when the sweep never moves towards the frustum
+                if (light.directional) {
+                    Core::Real approach = plane[0] * light.vector[0] + plane[1] * light.vector[1] + plane[2] * light.vector[2];
+                    separated = approach <= 0.0f;
+                }
+                else {
+                    Core::Real lightDistance = plane[0] * light.vector[0] + plane[1] * light.vector[1] + plane[2] * light.vector[2] + plane[3];
+                    separated = maxDistance <= lightDistance;
+                }
+            }
+            if (!separated) return true;
+        }
+        return false;
+    }
+
+    void VisibilityCuller::setVisible(Core::UInt32 entryIndex, bool visible) {
+        Entry& entry = this->entries[entryIndex];
+        Core::UInt32 lodLevel = visible && entry.lodObjects.size() > 0 ? this->selectLodLevel(entry) : entry.lodLevel;
+        if (entry.visible == visible && entry.lodLevel == lodLevel) return;
+
+        if (entry.visible) this->getLodObject(entry, entry.lodLevel)->setActive(false);
+        if (visible) this->getLodObject(entry, lodLevel)->setActive(true);
+        if (visible != entry.visible) {
+            if (visible) this->visibleCount++;
+            else this->visibleCount--;
+        }
+        entry.visible = visible;
+        entry.lodLevel = lodLevel;
+    }
+
+    Core::UInt32 VisibilityCuller::selectLodLevel(const Entry& entry) const {
+        const BVHBounds& bounds = entry.worldBounds;
+        Core::Real radiusSquared = 0.0f;
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            Core::Real extent = (bounds.max[axis] - bounds.min[axis]) * 0.5f;
+            radiusSquared += extent * extent;
+        }
+
+        // views share the object, so the one it appears largest in decides the level
+        Core::Real screenSize = 0.0f;
+        for (Core::UInt32 v = 0; v < this->frustumCount; v++) {
+            const Frustum& frustum = this->frustums[v];
+            Core::Real distanceSquared = 0.0f;
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                Core::Real offset = bounds.centroid(axis) - frustum.cameraPosition[axis];
+                distanceSquared += offset * offset;
+            }
+            if (distanceSquared <= radiusSquared) return 0;
+
+            // diameter over the viewport height (2 in NDC) cancels the factor of two
+            Core::Real viewScreenSize = std::sqrt(radiusSquared / distanceSquared) * frustum.projectionScale;
+            if (viewScreenSize > screenSize) screenSize = viewScreenSize;
+        }
+
+        // thresholds are relative to the current level, which gives the hysteresis band
+        Core::UInt32 level = entry.lodLevel;
+        Core::UInt32 maxLevel = (Core::UInt32)entry.lodObjects.size();
+        while (level < maxLevel && screenSize < LodSwitchScreenSize / (Core::Real)(1 << level) * (1.0f - LodHysteresis)) level++;
+        while (level > 0 && screenSize > LodSwitchScreenSize / (Core::Real)(1 << (level - 1)) * (1.0f + LodHysteresis)) level--;
+        return level;
+    }
+
+    Core::WeakPointer<Core::Object3D> VisibilityCuller::getLodObject(const Entry& entry, Core::UInt32 level) const {
+        return level == 0 ? entry.object : entry.lodObjects[level - 1];
+    }
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "BVH.h"
+
+#include "Core/Engine.h"
+
+namespace Modeler {
+
+    // Frustum culling and LOD selection for leaf renderables. Objects are kept in a
+    // BVH over their world-space bounds; each frame the camera frustums are walked
+    // through it and objects are (de)activated only when their visibility or LOD
+    // level changes. With several views the BVH is walked once and an object stays
+    // active while any of them can see it, since they all render the same scene.
+    //
+    // The engine renders shadow maps from the same active set, so an object is only
+    // culled when it is outside the frustum *and* its shadow, extruded away from
+    // every registered shadow-casting light, cannot reach the frustum either.
+    class VisibilityCuller {
+    public:
+        static const Core::UInt32 MaxLeafObjects = 4;
+        static const Core::UInt32 MaxViews = 4;
+
+        // viewProjection is column-major, projectionScale is its y scale (cot(fov / 2))
+        class View {
+        public:
+            const Core::Real* viewProjection;
+            const Core::Real* cameraPosition;
+            Core::Real projectionScale;
+        };
+
+        VisibilityCuller();
+
+        // objects must not have children: deactivating an object hides its whole subtree
+        void addObject(Core::WeakPointer<Core::Object3D> object, const BVHBounds& localBounds);
+        // same, for callers that already know the object's world matrix (column-major)
+        void addObject(Core::WeakPointer<Core::Object3D> object, const BVHBounds& localBounds, const Core::Real* worldMatrix);
+        // the object (and its LODs) moved; the BVH is refit on the next cull()
+        bool updateObjectTransform(Core::WeakPointer<Core::Object3D> object, const Core::Real* worldMatrix);
+        // coarser stand-ins for a registered object, finest first. They must share its world
+        // transform and start out inactive.
+        bool setLodObjects(Core::WeakPointer<Core::Object3D> object, const std::vector<Core::WeakPointer<Core::Object3D>>& lodObjects);
+        void clearShadowLights();
+        void addDirectionalShadowLight(const Core::Real* direction);
+        void addPointShadowLight(const Core::Real* position);
+
+        // render thread only
+        void cull(const Core::Real* viewProjection, const Core::Real* cameraPosition, Core::Real projectionScale);
+        // views past MaxViews are ignored
+        void cull(const View* views, Core::UInt32 viewCount);
+
+        Core::UInt32 getObjectCount() const;
+        Core::UInt32 getVisibleCount() const;
+
+    private:
+        class Entry {
+        public:
+            Core::WeakPointer<Core::Object3D> object;
+            std::vector<Core::WeakPointer<Core::Object3D>> lodObjects;
+            BVHBounds localBounds;
+            BVHBounds worldBounds;
+            bool visible;
+            Core::UInt32 lodLevel;
+        };
+
+        class ShadowLight {
+        public:
+            bool directional;
+            Core::Real vector[3]; // direction for directional lights, position for point lights
+        };
+
+        class Frustum {
+        public:
+            Core::Real planes[6][4];
+            Core::Real cameraPosition[3];
+            Core::Real projectionScale;
+        };
+
+        enum class Containment {
+            Outside = 0,
+            Intersecting = 1,
+            Inside = 2,
+        };
+
+        class TraversalEntry {
+        public:
+            TraversalEntry(Core::UInt32 node, Containment containment): node(node), containment(containment) {}
+
+            Core::UInt32 node;
+            Containment containment; // Intersecting: still to be tested
+        };
+
+        Containment classify(const BVHBounds& bounds) const;
+        Containment classify(const BVHBounds& bounds, const Frustum& frustum) const;
+        bool shadowReachesFrustum(const BVHBounds& bounds, const Frustum& frustum) const;
+        void setVisible(Core::UInt32 entryIndex, bool visible);
+        Core::UInt32 selectLodLevel(const Entry& entry) const;
+        Core::WeakPointer<Core::Object3D> getLodObject(const Entry& entry, Core::UInt32 level) const;
+
+        std::vector<Entry> entries;
+        std::vector<BVHNode> nodes;
+        std::vector<Core::UInt32> entryOrder;
+        std::vector<TraversalEntry> traversalStack; // kept between frames for its capacity
+        std::vector<ShadowLight> shadowLights;
+        std::unordered_map<Core::UInt64, Core::UInt32> entryIndices; // by object ID
+        bool needsRebuild;
+        bool needsRefit;
+        Frustum frustums[MaxViews];
+        Core::UInt32 frustumCount;
+        Core::UInt32 visibleCount;
+    };
+
+}
@@ -6,6 +6,8 @@ INCLUDEPATH += $$PWD
 HEADERS += \
     $$PWD/RenderSurface.h \
     $$PWD/RendererGL.h \
+    $$PWD/RenderThread.h \
+    $$PWD/FrameRing.h \
     $$PWD/ModelerApp.h \
     $$PWD/ModelerAppWindow.h \
     $$PWD/MouseAdapter.h \
@@ -13,17 +15,41 @@ HEADERS += \
     $$PWD/EventQueue.h \
     $$PWD/Event.h \
     $$PWD/Types.h \
-    $$PWD/PipedEventAdapter.h \
     $$PWD/OrbitControls.h \
     $$PWD/Settings.h \
     $$PWD/Exception.h \
     $$PWD/CoreSync.h \
-    $$PWD/TreeModel.h \
-    $$PWD/TreeItem.h
+    $$PWD/OutlinerModel.h \
+    $$PWD/JobSystem.h \
+    $$PWD/ImportedModel.h \
+    $$PWD/ModelImporter.h \
+    $$PWD/ModelStreamer.h \
+    $$PWD/ModelCache.h \
+    $$PWD/MeshBatcher.h \
+    $$PWD/MeshSimplifier.h \
+    $$PWD/MeshOptimizer.h \
+    $$PWD/VertexPacking.h \
+    $$PWD/BVH.h \
+    $$PWD/MeshBVH.h \
+    $$PWD/SceneBVH.h \
+    $$PWD/GpuPicker.h \
+    $$PWD/SelectionHighlighter.h \
+    $$PWD/VisibilityCuller.h \
+    $$PWD/TransformHierarchy.h \
+    $$PWD/SimdKernels.h \
+    $$PWD/PickingBenchmark.h \
+    $$PWD/KernelBenchmark.h \
+    $$PWD/BenchmarkHarness.h \
+    $$PWD/Profiler.h \
+    $$PWD/ProfilerOverlay.h \
+    $$PWD/CommandQueue.h \
+    $$PWD/RenderCommand.h
 
 SOURCES += \
     $$PWD/RenderSurface.cpp \
     $$PWD/RendererGL.cpp \
+    $$PWD/RenderThread.cpp \
+    $$PWD/FrameRing.cpp \
     $$PWD/Main.cpp \
     $$PWD/ModelerApp.cpp \
     $$PWD/ModelerAppWindow.cpp \
@@ -33,8 +59,28 @@ SOURCES += \
     $$PWD/OrbitControls.cpp \
     $$PWD/Settings.cpp \
     $$PWD/CoreSync.cpp \
-    $$PWD/TreeModel.cpp \
-    $$PWD/TreeItem.cpp
+    $$PWD/OutlinerModel.cpp \
+    $$PWD/JobSystem.cpp \
+    $$PWD/ModelImporter.cpp \
+    $$PWD/ModelStreamer.cpp \
+    $$PWD/ModelCache.cpp \
+    $$PWD/MeshBatcher.cpp \
+    $$PWD/MeshSimplifier.cpp \
+    $$PWD/MeshOptimizer.cpp \
+    $$PWD/VertexPacking.cpp \
+    $$PWD/BVH.cpp \
+    $$PWD/MeshBVH.cpp \
+    $$PWD/SceneBVH.cpp \
+    $$PWD/GpuPicker.cpp \
+    $$PWD/SelectionHighlighter.cpp \
+    $$PWD/VisibilityCuller.cpp \
+    $$PWD/TransformHierarchy.cpp \
+    $$PWD/SimdKernels.cpp \
+    $$PWD/PickingBenchmark.cpp \
+    $$PWD/KernelBenchmark.cpp \
+    $$PWD/BenchmarkHarness.cpp \
+    $$PWD/Profiler.cpp \
+    $$PWD/ProfilerOverlay.cpp
 
 RESOURCES += \
     $$PWD/qml/qml.qrc
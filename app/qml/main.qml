@@ -26,6 +26,18 @@ Item {
         visible: false
     }
 
+    FileDialog {
+        id: traceExportDialog
+        title: "Export Chrome trace"
+        folder: shortcuts.home
+        selectExisting: false
+        nameFilters: [ "Trace files (*.json)" ]
+        onAccepted: {
+            _profiler.exportTrace(traceExportDialog.fileUrl)
+        }
+        visible: false
+    }
+
 
     Rectangle {
         id: topMenu
@@ -102,12 +114,155 @@ Item {
                width: 15
             }
 
+            CheckBox {
+               id: packedCheckbox
+               text: qsTr("Compact RAM/cache")
+               checked: false
+            }
+
+            Rectangle{
+               height: navigation.height
+               width: 15
+            }
+
+            CheckBox {
+               id: optimizeCheckbox
+               text: qsTr("Optimize")
+               checked: false
+            }
+
+            Rectangle{
+               height: navigation.height
+               width: 15
+            }
+
+            CheckBox {
+               id: lodCheckbox
+               text: qsTr("LODs")
+               checked: false
+            }
+
+            Rectangle{
+               height: navigation.height
+               width: 15
+            }
+
+            CheckBox {
+               id: streamCheckbox
+               text: qsTr("Stream")
+               checked: false
+            }
+
+            Rectangle{
+               height: navigation.height
+               width: 15
+            }
+
+            CheckBox {
+               id: gpuPickCheckbox
+               text: qsTr("GPU picking")
+               checked: false
+               onCheckedChanged: _modelerApp.setGpuPickingEnabled(checked)
+            }
+
+            Rectangle{
+               height: navigation.height
+               width: 15
+            }
+
+            CheckBox {
+               id: animateLightCheckbox
+               text: qsTr("Animate light")
+               checked: true
+               onCheckedChanged: _modelerApp.setLightAnimationEnabled(checked)
+            }
+
+            Rectangle{
+               height: navigation.height
+               width: 15
+            }
+
+            CheckBox {
+               id: quadViewCheckbox
+               text: qsTr("Quad view")
+               checked: false
+               onCheckedChanged: _modelerApp.setQuadViewEnabled(checked)
+            }
+
+            Rectangle{
+               height: navigation.height
+               width: 15
+            }
+
+            CheckBox {
+               id: profileCheckbox
+               text: qsTr("Profile")
+               checked: _profiler.enabled
+               onCheckedChanged: _profiler.enabled = checked
+            }
+
+            Rectangle{
+               height: navigation.height
+               width: 15
+            }
+
             Button {
                 text: "Load"
                 onClicked: {
-                    _modelerApp.loadModel(modelNameText.text, modelScaleText.text, modelSmoothingThresholdText.text, zUpCheckbox.checked);
+                    _modelerApp.loadModel(modelNameText.text, modelScaleText.text, modelSmoothingThresholdText.text, zUpCheckbox.checked, lodCheckbox.checked, optimizeCheckbox.checked, packedCheckbox.checked, streamCheckbox.checked);
                 }
             }
+
+            Rectangle{
+               height: navigation.height
+               width: 15
+            }
+
+            // loads every model in the folder named in the path field
+            Button {
+                text: "Load folder"
+                onClicked: {
+                    _modelerApp.loadModels([modelNameText.text], modelScaleText.text, modelSmoothingThresholdText.text, zUpCheckbox.checked, lodCheckbox.checked, optimizeCheckbox.checked, packedCheckbox.checked, streamCheckbox.checked);
+                }
+            }
+
+            Rectangle{
+               height: navigation.height
+               width: 15
+            }
+
+            ProgressBar {
+                id: importProgressBar
+                Layout.preferredWidth: 150
+                minimumValue: 0
+                maximumValue: 1
+                value: 0
+                visible: false
+            }
+
+            Label {
+                id: importStatusLabel
+                text: ""
+            }
+        }
+
+        Connections {
+            target: _modelerApp
+            onImportProgress: {
+                importProgressBar.visible = true
+                importProgressBar.value = progress
+                importStatusLabel.text = qsTr("Importing...")
+            }
+            onImportFinished: {
+                importProgressBar.visible = false
+                importStatusLabel.text = success ? "" : qsTr("Import failed")
+            }
+            onImportNotice: {
+                importStatusLabel.text = message
+            }
+            onLightAnimationChanged: {
+                animateLightCheckbox.checked = enabled
+            }
         }
     }
 
@@ -124,7 +279,7 @@ Item {
 
         TreeView {
             anchors.fill: parent
-            model: theModel
+            model: _outliner
             alternatingRowColors: false
             style: TreeViewStyle {
                 alternateBackgroundColor: 'white'
@@ -164,7 +319,7 @@ Item {
              }
 
              TableViewColumn {
-                role: "name_role"
+                role: "name"
                 title: "Name"
              }
         }
@@ -172,13 +327,6 @@ Item {
 
     RenderSurface {
         objectName: "render_surface"
-        SequentialAnimation on t {
-            NumberAnimation { to: 1; duration: 2500; easing.type: Easing.InQuad }
-            NumberAnimation { to: 0; duration: 2500; easing.type: Easing.OutQuad }
-            loops: Animation.Infinite
-            running: true
-        }
-
         anchors.left: leftMenu.right
         anchors.top: topMenu.bottom
         width: parent.width - leftMenu.width
@@ -190,6 +338,57 @@ Item {
 
            // onClicked: { console.log("Bar"); }
         }
+
+        Rectangle {
+            id: selectionMarquee
+            visible: false
+            color: Qt.rgba(1.0, 0.65, 0.0, 0.15)
+            border.width: 1
+            border.color: Qt.rgba(1.0, 0.65, 0.0, 1.0)
+        }
+
+        Connections {
+            target: _modelerApp
+            onSelectionMarqueeChanged: {
+                selectionMarquee.x = x
+                selectionMarquee.y = y
+                selectionMarquee.width = width
+                selectionMarquee.height = height
+                selectionMarquee.visible = active
+            }
+        }
+
+        Rectangle {
+            id: profilerOverlay
+            visible: _profiler.enabled
+            color: Qt.rgba(0, 0, 0, 0.6)
+            anchors.top: parent.top
+            anchors.right: parent.right
+            anchors.margins: 8
+            width: profilerColumn.width + 16
+            height: profilerColumn.height + 16
+
+            Column {
+                id: profilerColumn
+                x: 8
+                y: 8
+                spacing: 6
+
+                Text {
+                    color: "white"
+                    font.family: "monospace"
+                    font.pixelSize: 11
+                    text: _profiler.report
+                }
+
+                Button {
+                    text: "Export trace"
+                    onClicked: {
+                        traceExportDialog.visible = true
+                    }
+                }
+            }
+        }
         /*MouseArea {
             anchors.bottom: parent.bottom
             anchors.left: parent.left